@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <GL/glut.h>
+#include "Utils/Input/Images/igluPPM.h"
 
 // Visual Studio 2005 arbitrarily decided all sorts of standard library calls
 //    are obsolete, making this essential to avoid pages and pages of useless
@@ -42,6 +43,7 @@ void IGLUFrameGrab::CaptureFrame( void )
 	unsigned char *frameData = GrabWholeFrame( &width, &height );
 	sprintf( outputFile, "%s%d.ppm", baseName, nextFrameNum++ );
 	FrameToPPM( outputFile, frameData, width, height );
+	free( frameData );
 }
 
 void IGLUFrameGrab::CaptureFrame( char *outputFilename ) 
@@ -49,6 +51,7 @@ void IGLUFrameGrab::CaptureFrame( char *outputFilename )
 	int width, height;
 	unsigned char *frameData = GrabWholeFrame( &width, &height );
 	FrameToPPM( outputFilename, frameData, width, height ); 
+	free( frameData );
 }
 
 void IGLUFrameGrab::CaptureFrameAsFloat( char *outputFilename )
@@ -93,6 +96,7 @@ void IGLUFrameGrab::CaptureFrameRegion( int left, int bottom, int right, int top
 	unsigned char *frameData = GrabFrameRegion( left, bottom, right, top );
 	sprintf( outputFile, "%s%d.ppm", baseName, nextFrameNum++ );
 	FrameToPPM( outputFile, frameData, abs(right-left), abs(top-bottom) );
+	free( frameData );
 }
 
 void IGLUFrameGrab::GetFilenameForNextFrame( char *nextName, int maxSize )
@@ -169,6 +173,7 @@ void IGLUFrameGrab::CaptureStencil( char *outputFilename )
 	glReadBuffer( oldBuffer );
 
 	FrameToPGM( outputFilename, frameData, width, height ); 
+	free( frameData );
 }
 
 void IGLUFrameGrab::CaptureDepth( char *outputFilename )
@@ -192,46 +197,17 @@ void IGLUFrameGrab::CaptureDepth( char *outputFilename )
 	glReadBuffer( oldBuffer );
 
 	FrameToPGM( outputFilename, frameData, width, height ); 
+	free( frameData );
 }
 
 
 void IGLUFrameGrab::FrameToPGM( char *f, unsigned char *data, int width, int height )
 {
-  FILE *out = fopen(f, "wb");
-  if (!out) 
-  {
-	  fprintf( stderr, "***Error: Unable to capture frame.  fopen() failed!!\n");
-	  return;
-  }
-  
-  fprintf(out, "P5\n# File captured by Chris Wyman's OpenGL framegrabber\n");  
-  fprintf(out, "%d %d\n", width, height);
-  fprintf(out, "%d\n", 255); 
-  
-  for ( int y = height-1; y >= 0; y-- )
-	  fwrite( data+(y*width), 1, width, out );
-
-  fprintf(out, "\n");
-  fclose(out);
+	// OpenGL's rows start at the bottom, so flip them as they're written
+	WritePNM( f, PGM_RAW, width, height, 1, data, true, "File captured by Chris Wyman's OpenGL framegrabber" );
 }
 
 void IGLUFrameGrab::FrameToPPM( char *f, unsigned char *data, int width, int height )
 {
-  FILE *out = fopen(f, "wb");
-  if (!out) 
-  {
-	  fprintf( stderr, "***Error: Unable to capture frame.  fopen() failed!!\n");
-	  return;
-  }
-  
-  fprintf(out, "P6\n# File captured by Chris Wyman's OpenGL framegrabber\n");  
-  fprintf(out, "%d %d\n", width, height);
-  fprintf(out, "%d\n", 255); 
-  
-  for ( int y = height-1; y >= 0; y-- )
-	  fwrite( data+(3*y*width), 1, 3*width, out );
-
-  fprintf(out, "\n");
-  fclose(out);
+	WritePNM( f, PPM_RAW, width, height, 3, data, true, "File captured by Chris Wyman's OpenGL framegrabber" );
 }
-
@@ -89,34 +89,15 @@ int IGLUShaderStage::ReloadShader( void )
 // Open a shader, read its contents into a string in memory.
 char *IGLUShaderStage::ReturnFileAsString( char *filename, int recurseDepth )
 {	
-	/* open the file */
-	FILE *file;
-	
 	if( recurseDepth > 5 )
 	{
 		fprintf(stderr, "*** Error: IGLUShaderStage::ReturnFileAsString() recursion limit exceeded.\n" );
 		return 0;
 	}
 	
-	file = fopen( filename, "rb" );
-	if (!file) return 0;	
-
-	/* get the length of the file */
-	fseek( file, 0, SEEK_END );
-	long size = ftell( file );
-	rewind( file );
-
-	/* allocate memory for the shader string */
-	char *shaderMemory = (char *)calloc( (size+1), sizeof(char) );
-	if (!shaderMemory) { fclose(file); return 0; }
-	memset( shaderMemory, 0, (size+1) );
-
-	/* read shader data from the file */
-	fread (shaderMemory,1,size,file);
-	shaderMemory[size] = 0;
-
-	/* clean up and return the data */
-	fclose(file);
+	/* read the whole file (from disk, or from a mounted I/O provider) */
+	char *shaderMemory = IGLUFileSystem::ReadFile( filename );
+	if (!shaderMemory) return 0;
 	
 	/* process the string for macros */
 	return ReturnProcessedShaderString( filename, shaderMemory, recurseDepth );
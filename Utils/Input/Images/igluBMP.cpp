@@ -13,116 +13,100 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "igluBMP.h"
+#include "iglu/parsing/igluFileSystem.h"
 
 using namespace iglu;
 
-int ReadInt(FILE *fp);
 void WriteInt(int x, FILE *fp);
-unsigned short int ReadUnsignedShort(FILE *fp);
 void WriteUnsignedShort(unsigned short int x, FILE *fp);
-unsigned int ReadUnsignedInt(FILE *fp);
 void WriteUnsignedInt(unsigned int x, FILE *fp);
 
 void Error( char *msg );
 void FatalError( char *msg );
 
+/* Little endian values from the header */
+static inline unsigned int GetUnsignedShort( const unsigned char *p ) { return p[0] | (p[1] << 8); }
+static inline unsigned int GetUnsignedInt( const unsigned char *p )   { return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24); }
 
-unsigned char *iglu::ReadBMP( char *f, int *width, int *height, bool invertY )
+
+bool iglu::ReadBMPInfo( const unsigned char *data, size_t size, IGLUImageInfo *info )
 {
-    unsigned char *img;
-	unsigned char *tmp;
-    int x, y;
-    int lineLength;
-    
-	FILE *fp;
-	char buf[1024];
-	unsigned short int bmpType, bmpReserved1, bmpReserved2;
-	unsigned int bmpSize, bmpOffBits;
+	/* Check the file header, then the info header (which may be one of the later, longer versions) */
+	if (size < MYBMP_BF_OFF_BITS || GetUnsignedShort( data ) != MYBMP_BF_TYPE)
+		return false;
+	unsigned int offBits = GetUnsignedInt( data+10 );
+	const unsigned char *hdr = data + 14;
+	int width  = int( GetUnsignedInt( hdr+4 ) );
+	int height = int( GetUnsignedInt( hdr+8 ) );
+	if ( GetUnsignedInt( hdr ) < MYBMP_BI_SIZE || GetUnsignedShort( hdr+12 ) != 1 ||
+		 GetUnsignedShort( hdr+14 ) != 24 || GetUnsignedInt( hdr+16 ) != MYBMP_BI_RGB ||
+		 width <= 0 || height == 0 || height == int(0x80000000) )
+		return false;
+
+	/* Is all the pixel data there?  (Negative heights mean rows are stored top to bottom) */
+	size_t lineLength = (3*size_t(width) + 3) & ~size_t(3);
+	size_t rows = size_t( height > 0 ? height : -height );
+	if (offBits < MYBMP_BF_OFF_BITS || offBits > size || (size - offBits) / lineLength < rows)
+		return false;
+
+	info->width    = width;
+	info->height   = int( rows );
+	info->channels = 3;
+	return true;
+}
 
-	unsigned int imgSize, imgSizeImage, imgCompression, imgClrUsed, imgClrImportant;
-	int imgWidth, imgHeight, imgXPelsPerMeter, imgYPelsPerMeter;
-	unsigned short int imgPlanes, imgBitCount;
+bool iglu::DecodeBMP( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp )
+{
+	IGLUImageInfo info;
+	if (!ReadBMPInfo( data, size, &info )) return false;
 
-	fp = fopen( f, "rb" );
-	if (!fp)
+	bool fileTopDown = int( GetUnsignedInt( data+22 ) ) < 0;
+	size_t lineLength = (3*size_t(info.width) + 3) & ~size_t(3);
+	size_t dstLength  = size_t(channels) * info.width;
+	const unsigned char *src = data + GetUnsignedInt( data+10 );
+
+	/* Rows are BGR, so swap to RGB on the way out */
+	for (int y = 0; y < info.height; y++, src += lineLength)
 	{
-		sprintf( buf, "ReadBMP() unable to open file '%s'!", f );
-		FatalError( buf );
+		int fromTop = fileTopDown ? y : (info.height-1-y);
+		unsigned char *row = dst + dstLength * size_t( bottomUp ? (info.height-1-fromTop) : fromTop );
+		if (channels == 4)
+			IGLUPixelOps::ExpandRGBToRGBA( row, src, info.width, 255, true );
+		else
+			IGLUPixelOps::SwapRedBlue( row, src, info.width, 3 );
 	}
+	return true;
+}
 
-    /* Read file header */
-    bmpType = ReadUnsignedShort(fp);
-    bmpSize = ReadUnsignedInt(fp);
-    bmpReserved1 = ReadUnsignedShort(fp);
-    bmpReserved2 = ReadUnsignedShort(fp);
-    bmpOffBits = ReadUnsignedInt(fp);
+unsigned char *iglu::ReadBMP( char *f, int *width, int *height, bool invertY )
+{
+	char buf[1024];
+	IGLUImageInfo info;
 
-    /* Check file header */
-    if (bmpType != MYBMP_BF_TYPE || bmpOffBits != MYBMP_BF_OFF_BITS)
+	IGLUFileData *file = IGLUFileSystem::Open( f );
+	if (!file)
 	{
-		sprintf( buf, "ReadBMP() encountered bad header in file '%s'!", f);
+		sprintf( buf, "ReadBMP() unable to open file '%s'!", f );
 		FatalError( buf );
 	}
 
-    /* Read info header */
-    imgSize = ReadUnsignedInt(fp);
-    imgWidth = ReadInt(fp);
-    imgHeight = ReadInt(fp);
-    imgPlanes = ReadUnsignedShort(fp);
-    imgBitCount = ReadUnsignedShort(fp);
-    imgCompression = ReadUnsignedInt(fp);
-    imgSizeImage = ReadUnsignedInt(fp);
-    imgXPelsPerMeter = ReadInt(fp);
-    imgYPelsPerMeter = ReadInt(fp);
-    imgClrUsed = ReadUnsignedInt(fp);
-    imgClrImportant = ReadUnsignedInt(fp);
-
-    /* Check info header */
-    if( imgSize != MYBMP_BI_SIZE || imgWidth <= 0 || 
-		imgHeight <= 0 || imgPlanes != 1 || 
-		imgBitCount != 24 || imgCompression != MYBMP_BI_RGB ||
-		imgSizeImage == 0 )
+	const unsigned char *data = (const unsigned char *)file->GetData();
+	if (!ReadBMPInfo( data, file->GetSize(), &info ))
 	{
-		sprintf( buf, "ReadBMP() encountered unsupported bitmap type in '%s'!", f);
+		sprintf( buf, "ReadBMP() encountered bad header or unsupported bitmap type in '%s'!", f);
 		FatalError( buf );
 	}
-    
-	/* compute the line length */
-    lineLength = imgWidth * 3; 
-    if ((lineLength % 4) != 0) 
-		lineLength = (lineLength / 4 + 1) * 4;
 
-    /* Creates the image */
-    img = (unsigned char *) malloc( 3 * imgWidth * imgHeight * sizeof( unsigned char ) );
-	tmp = (unsigned char *) malloc( 3 * lineLength * sizeof( unsigned char ) );
-	if (!tmp || !img)
+	/* The file is (usually) stored bottom row first, so *not* inverting leaves it that way */
+	unsigned char *img = (unsigned char *) malloc( 3 * info.width * info.height * sizeof( unsigned char ) );
+	if (!img)
 		FatalError( "Unable to allocate memory in ReadBMP()!");
-   
-	/* Position the file after header.  Header should be 54 bytes long -- checked above */
-    fseek(fp, (long) bmpOffBits, SEEK_SET);  
+	DecodeBMP( data, file->GetSize(), img, 3, !invertY );
+	delete file;
 
-	/* Read the image */
-    for (y = 0; y < imgHeight; y++) {
-		int yy = invertY ? (imgHeight-1-y) : y;
-        fread(tmp, 1, lineLength, fp);
-
-        /* Copy into permanent structure */
-        for (x = 0; x < imgWidth; x++)
-		{
-			*(img+(yy*3*imgWidth)+3*x+2) = tmp[3*x+0]; 
-			*(img+(yy*3*imgWidth)+3*x+1) = tmp[3*x+1]; 
-			*(img+(yy*3*imgWidth)+3*x+0) = tmp[3*x+2]; 
-		}
-    }
-
-	/* cleanup */
-    free( tmp );
-	fclose( fp );
- 
-	/* return our image */
-	*width = imgWidth;
-	*height = imgHeight;
-    return img;
+	*width = info.width;
+	*height = info.height;
+	return img;
 }
 
 
@@ -194,18 +178,6 @@ int iglu::WriteBMP( char *f, int width, int height, unsigned char *ptr )
 
 
 
-/* Reads an unsigned short from a file in little endian format */
-unsigned short int ReadUnsignedShort(FILE *fp)
-{
-    unsigned short int lsb, msb;
-
-    lsb = getc(fp);
-    msb = getc(fp);
-    return (msb << 8) | lsb;
-}
-
-
-
 /* Writes as unsigned short to a file in little endian format */
 void WriteUnsignedShort(unsigned short int x, FILE *fp)
 {
@@ -217,20 +189,6 @@ void WriteUnsignedShort(unsigned short int x, FILE *fp)
     putc(msb, fp);
 }
 
-/* Reads as unsigned int word from a file in little endian format */
-unsigned int ReadUnsignedInt(FILE *fp)
-{
-    unsigned int b1, b2, b3, b4;
-
-    b1 = getc(fp);
-    b2 = getc(fp);
-    b3 = getc(fp);
-    b4 = getc(fp);
-    return (b4 << 24) | (b3 << 16) | (b2 << 8) | b1;
-}
-
-
-
 /* Writes an unsigned int to a file in little endian format */
 void WriteUnsignedInt(unsigned int x, FILE *fp)
 {
@@ -247,19 +205,6 @@ void WriteUnsignedInt(unsigned int x, FILE *fp)
 }
 
 
-/* Reads an int word from a file in little endian format */
-int ReadInt(FILE *fp)
-{
-    int b1, b2, b3, b4;
-
-    b1 = getc(fp);
-    b2 = getc(fp);
-    b3 = getc(fp);
-    b4 = getc(fp);
-    return (b4 << 24) | (b3 << 16) | (b2 << 8) | b1;
-}
-
-
 /* Writes an int to a file in little endian format */
 void WriteInt(int x, FILE *fp)
 {
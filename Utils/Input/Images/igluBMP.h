@@ -14,6 +14,9 @@
 
 #pragma warning( disable: 4996 )
 
+#include <stddef.h>
+#include "iglu/igluImageDecoder.h"
+
 namespace iglu {
 
 /* define return codes for WriteBMP() */
@@ -47,6 +50,14 @@ namespace iglu {
 /*    The values stored in *w and *h are the image width & height           */
 unsigned char *ReadBMP( char *f, int *width, int *height, bool invertY=false );
 
+/* The decoder IGLUImageDecoder uses (and ReadBMP() wraps), working on the  */
+/*    file's contents in memory.  Also reads top-down (negative height)     */
+/*    files, and any version of the info header.  DecodeBMP() writes RGB    */
+/*    (channels = 3) or RGBA (channels = 4) rows, top row first unless      */
+/*    bottomUp is set.  Both return false on bad or unsupported data.       */
+bool ReadBMPInfo( const unsigned char *data, size_t size, IGLUImageInfo *info );
+bool DecodeBMP( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp );
+
 
 /* Writes an uncompressed 24-bit BMP to the file 'f'                        */
 /*    Returns:  One of the error codes from above or GFXIO_OK               */
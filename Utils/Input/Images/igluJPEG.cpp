@@ -11,9 +11,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <setjmp.h>
 #include "jpeg/jpeglib.h"
 #include "jpeg/jerror.h"
 #include "igluJPEG.h"
+#include "iglu/parsing/igluFileSystem.h"
 #include "iglu/errors/igluErrorExit.h"
 #include "iglu/errors/igluWarning.h"
 
@@ -21,47 +23,139 @@ using namespace iglu;
 
 void FatalError( char *msg );
 
+// namespace {  anonymous namespace for stuff used inside this file
+
+// libjpeg's default error handler exits the program.  Ours jumps back to the
+//    decode call, so a corrupt file just fails to load.
+struct IGLUJPEGError
+{
+	struct jpeg_error_mgr pub;
+	jmp_buf               jumpBack;
+};
+
+static void JPEGErrorExit( j_common_ptr cinfo )
+{
+	IGLUJPEGError *err = (IGLUJPEGError *)cinfo->err;
+	(*cinfo->err->output_message)( cinfo );
+	longjmp( err->jumpBack, 1 );
+}
+
+// Starts decompressing data in memory.  Only gray and RGB output are supported.
+static bool StartJPEG( jpeg_decompress_struct *cinfo, const unsigned char *data, size_t size )
+{
+	jpeg_mem_src( cinfo, (unsigned char *)data, (unsigned long)size );
+	if (jpeg_read_header( cinfo, TRUE ) != JPEG_HEADER_OK)
+		return false;
+	if (cinfo->jpeg_color_space != JCS_GRAYSCALE)
+		cinfo->out_color_space = JCS_RGB;
+	jpeg_calc_output_dimensions( cinfo );
+	return cinfo->out_color_space == JCS_RGB || cinfo->out_color_space == JCS_GRAYSCALE;
+}
+
+// };  End: anonymous namespace
+
+
+bool iglu::ReadJPEGInfo( const unsigned char *data, size_t size, IGLUImageInfo *info )
+{
+	struct jpeg_decompress_struct cinfo;
+	IGLUJPEGError jerr;
+
+	cinfo.err = jpeg_std_error( &jerr.pub );
+	jerr.pub.error_exit = JPEGErrorExit;
+	jpeg_create_decompress( &cinfo );
+	if (setjmp( jerr.jumpBack ))
+	{
+		jpeg_destroy_decompress( &cinfo );
+		return false;
+	}
+
+	bool ok = StartJPEG( &cinfo, data, size );
+	info->width    = cinfo.output_width;
+	info->height   = cinfo.output_height;
+	info->channels = 3;
+	jpeg_destroy_decompress( &cinfo );
+	return ok;
+}
+
+bool iglu::DecodeJPEG( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp )
+{
+	struct jpeg_decompress_struct cinfo;
+	IGLUJPEGError jerr;
+	unsigned char * volatile tmp = 0;
+
+	cinfo.err = jpeg_std_error( &jerr.pub );
+	jerr.pub.error_exit = JPEGErrorExit;
+	jpeg_create_decompress( &cinfo );
+	if (setjmp( jerr.jumpBack ))
+	{
+		jpeg_destroy_decompress( &cinfo );
+		free( tmp );
+		return false;
+	}
+
+	if (!StartJPEG( &cinfo, data, size ))
+	{
+		jpeg_destroy_decompress( &cinfo );
+		return false;
+	}
+	jpeg_start_decompress( &cinfo );
+
+	// RGB to RGB scanlines go straight into the output;  otherwise, through a temporary row
+	int width = cinfo.output_width, height = cinfo.output_height;
+	bool direct = (channels == 3 && cinfo.output_components == 3);
+	if (!direct)
+		tmp = (unsigned char *)malloc( size_t(width) * cinfo.output_components );
+
+	while (cinfo.output_scanline < cinfo.output_height)
+	{
+		int y = cinfo.output_scanline;
+		unsigned char *row = dst + size_t(bottomUp ? height-1-y : y) * width * channels;
+		JSAMPROW line = direct ? row : tmp;
+		if (jpeg_read_scanlines( &cinfo, &line, 1 ) != 1)
+			break;
+		if (direct) continue;
+		if (cinfo.output_components == 1)
+			IGLUPixelOps::ExpandGray( row, tmp, width, channels );
+		else
+			IGLUPixelOps::ExpandRGBToRGBA( row, tmp, width );
+	}
+
+	jpeg_finish_decompress( &cinfo );
+	jpeg_destroy_decompress( &cinfo );
+	free( tmp );
+	return true;
+}
 
 unsigned char *iglu::ReadJPEG( char *f, int *width, int *height )
 { 
 	char buf[256];
-	FILE *pFile = fopen( f, "rb" );
-	if (!pFile) {
+	IGLUFileData *file = IGLUFileSystem::Open( f );
+	if (!file) {
 		sprintf( buf, "ReadJPEG() unable to open file '%s'!", f );
 		ErrorExit( buf, __FILE__, __FUNCTION__, __LINE__ );
 	}
 
-	struct jpeg_decompress_struct cinfo;
-	struct jpeg_error_mgr jerr;
-
-	cinfo.err = jpeg_std_error(&jerr);
-	jpeg_create_decompress(&cinfo);
-	jpeg_stdio_src(&cinfo, pFile);
-	jpeg_read_header(&cinfo, TRUE);
-	jpeg_start_decompress(&cinfo);
+	IGLUImageInfo info;
+	const unsigned char *data = (const unsigned char *)file->GetData();
+	if (!ReadJPEGInfo( data, file->GetSize(), &info )) {
+		sprintf( buf, "ReadJPEG() unable to read file '%s'!", f );
+		ErrorExit( buf, __FILE__, __FUNCTION__, __LINE__ );
+	}
 
-    *width = cinfo.output_width;
-    *height = cinfo.output_height;
+	*width = info.width;
+	*height = info.height;
 
-	unsigned char *img = (unsigned char *)malloc( cinfo.output_width * 
-		                                          cinfo.output_height *
-												  3 * sizeof(unsigned char) );
-	unsigned char *ptr = img;
+	unsigned char *img = (unsigned char *)malloc( size_t(info.width) * info.height * 3 * sizeof(unsigned char) );
 	if (!img) {
-		sprintf( buf, "ReadJPEG() unable to allocate temporary memory!", f );
+		sprintf( buf, "ReadJPEG() unable to allocate temporary memory!" );
 		FatalError( buf );
 	}
 
-	while (cinfo.output_scanline < cinfo.output_height) {
-		int numlines = jpeg_read_scanlines(&cinfo, &ptr, 1);
-		ptr += numlines * 3 * cinfo.output_width;
+	if (!DecodeJPEG( data, file->GetSize(), img, 3, false )) {
+		sprintf( buf, "ReadJPEG() unable to decode file '%s'!", f );
+		ErrorExit( buf, __FILE__, __FUNCTION__, __LINE__ );
 	}
 
-	jpeg_finish_decompress(&cinfo);
-	jpeg_destroy_decompress(&cinfo);
-
-	fclose(pFile);
+	delete file;
 	return img;
 }
-
-
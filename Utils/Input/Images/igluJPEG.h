@@ -11,11 +11,21 @@
 #ifndef IGLU__IJPEG_H__
 #define IGLU__IJPEG_H__
 
+#include <stddef.h>
+#include "iglu/igluImageDecoder.h"
+
 namespace iglu {
 
 // Reads .jpg images using IGLU's built-in version of libjpeg
 unsigned char *ReadJPEG( char *f, int *width, int *height );
 
+// The decoder IGLUImageDecoder uses (and ReadJPEG() wraps), working on the file's
+//   contents in memory.  Handles RGB and grayscale JPEGs.  DecodeJPEG() writes RGB
+//   (channels = 3) or RGBA (channels = 4) rows, top row first unless bottomUp is set.
+//   Both return false on bad or unsupported data.
+bool ReadJPEGInfo( const unsigned char *data, size_t size, IGLUImageInfo *info );
+bool DecodeJPEG( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp );
+
 }
 
 #endif
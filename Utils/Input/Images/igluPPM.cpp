@@ -1,7 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <errno.h>
+#ifndef _WIN32
+  #include <unistd.h>
+  #include <sys/uio.h>
+#endif
 #include "igluPPM.h"
+#include "iglu/parsing/igluFileSystem.h"
+
+using namespace iglu;
 
 /* 
 ** check if integer specified is a valid 
@@ -85,205 +94,398 @@ void Warning( char *formatStr, char *insertThisStr )
 
 
 
+// namespace {  anonymous namespace for stuff used inside this file
+
+/* Skips whitespace and '#' comments (which run to the end of the line) */
+static const unsigned char *SkipPPMSpace( const unsigned char *ptr, const unsigned char *end )
+{
+  while (ptr < end)
+  {
+    if (*ptr == '#')
+      while (ptr < end && *ptr != '\n' && *ptr != '\r') ptr++;
+    else if (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r' || *ptr == '\v' || *ptr == '\f')
+      ptr++;
+    else
+      break;
+  }
+  return ptr;
+}
+
+/* Reads a (non-negative) decimal number.  Returns NULL if there isn't one. */
+static const unsigned char *ReadPPMNumber( const unsigned char *ptr, const unsigned char *end, int *value )
+{
+  ptr = SkipPPMSpace( ptr, end );
+  if (ptr >= end || *ptr < '0' || *ptr > '9') return 0;
+  unsigned int v = 0;
+  while (ptr < end && *ptr >= '0' && *ptr <= '9' && v < 100000000)
+    v = 10*v + (*ptr++ - '0');
+  *value = int(v);
+  return ptr;
+}
+
+/* Parses the header, returning a pointer to the first byte of pixel data (or NULL) */
+static const unsigned char *ReadPPMHeader( const unsigned char *data, size_t size, int *mode,
+                                           int *width, int *height, int *maxVal )
+{
+  const unsigned char *end = data + size, *ptr = data;
+  if (size < 3 || (data[0] != 'P' && data[0] != 'p')) return 0;
+  *mode = data[1] - '0';
+  if (!IsValidMode( *mode )) return 0;
+
+  /* PBMs are just 1's and 0's, so there's no max_component */
+  *maxVal = 1;
+  ptr = ReadPPMNumber( data+2, end, width );
+  if (ptr) ptr = ReadPPMNumber( ptr, end, height );
+  if (ptr && *mode != PBM_RAW && *mode != PBM_ASCII)
+    ptr = ReadPPMNumber( ptr, end, maxVal );
+  if (!ptr || *width <= 0 || *height <= 0 || *maxVal <= 0 || *maxVal > 65535) return 0;
+
+  /* Raw data starts after exactly one whitespace character */
+  if (RawMode( *mode ))
+    return (ptr < end) ? ptr+1 : 0;
+  return ptr;
+}
+
+/* Converts a sample to 8 bits.  (Files with a max value under 255 are kept as is.) */
+static inline unsigned char PPMSample( int value, int maxVal )
+{
+  if (maxVal <= 255) return (unsigned char)( value > 255 ? 255 : value );
+  return (unsigned char)( ( (value > maxVal ? maxVal : value) * 255 + maxVal/2 ) / maxVal );
+}
+
+// };  End: anonymous namespace
+
+
+bool iglu::ReadPPMInfo( const unsigned char *data, size_t size, IGLUImageInfo *info )
+{
+  int mode, maxVal;
+  if (!ReadPPMHeader( data, size, &mode, &info->width, &info->height, &maxVal ))
+    return false;
+  info->channels = 3;
+  return true;
+}
+
+bool iglu::DecodePPM( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp )
+{
+  int mode, width, height, maxVal;
+  const unsigned char *ptr = ReadPPMHeader( data, size, &mode, &width, &height, &maxVal );
+  const unsigned char *end = data + size;
+  if (!ptr) return false;
+
+  /* Bytes per sample, and samples per pixel, in the file */
+  int sampleBytes = (maxVal > 255) ? 2 : 1;
+  int samples = (mode == PPM_RAW || mode == PPM_ASCII) ? 3 : 1;
+  size_t dstRowBytes = size_t(channels) * width;
+
+  /* Raw rows that need no conversion, other than expanding channels, are handled a row at a time */
+  if (RawMode( mode ) && sampleBytes == 1)
+  {
+    size_t srcRowBytes = (mode == PBM_RAW) ? size_t(width+7)/8 : size_t(samples) * width;
+    if (size_t(end - ptr) / srcRowBytes < size_t(height)) return false;
+    for (int y = 0; y < height; y++, ptr += srcRowBytes)
+    {
+      unsigned char *row = dst + dstRowBytes * size_t( bottomUp ? height-1-y : y );
+      if (mode == PPM_RAW && channels == 3)
+        memcpy( row, ptr, srcRowBytes );
+      else if (mode == PPM_RAW)
+        IGLUPixelOps::ExpandRGBToRGBA( row, ptr, width );
+      else if (mode == PGM_RAW)
+        IGLUPixelOps::ExpandGray( row, ptr, width, channels );
+      else
+      {
+        /* PBM:  one bit per pixel, most significant first, where 1 is black */
+        for (int x = 0; x < width; x++)
+        {
+          unsigned char c = (ptr[x >> 3] & (0x80 >> (x & 7))) ? 0 : 255;
+          row[channels*x+0] = row[channels*x+1] = row[channels*x+2] = c;
+          if (channels == 4) row[channels*x+3] = 255;
+        }
+      }
+    }
+    return true;
+  }
+
+  /* Otherwise, read samples one at a time (16-bit raw, or ASCII) */
+  if (RawMode( mode ) && size_t(end - ptr) / (size_t(samples) * sampleBytes * width) < size_t(height))
+    return false;
+  for (int y = 0; y < height; y++)
+  {
+    unsigned char *row = dst + dstRowBytes * size_t( bottomUp ? height-1-y : y );
+    for (int x = 0; x < width; x++)
+    {
+      unsigned char *pix = row + channels*x;
+      for (int c = 0; c < samples; c++)
+      {
+        int value;
+        if (RawMode( mode ))
+        {
+          value = (ptr[0] << 8) | ptr[1];
+          ptr += 2;
+        }
+        else if (mode == PBM_ASCII)
+        {
+          /* Bits need not be separated by whitespace */
+          ptr = SkipPPMSpace( ptr, end );
+          if (ptr >= end || (*ptr != '0' && *ptr != '1')) return false;
+          value = (*ptr++ == '1') ? 0 : 255;
+        }
+        else if (!(ptr = ReadPPMNumber( ptr, end, &value )))
+          return false;
+        pix[c] = (mode == PBM_ASCII) ? (unsigned char)value : PPMSample( value, maxVal );
+      }
+      if (samples == 1) pix[1] = pix[2] = pix[0];
+      if (channels == 4) pix[3] = 255;
+    }
+  }
+  return true;
+}
+
 /* read a texture from a file */
 unsigned char *iglu::ReadPPM( char *f, int *mode, int *width, int *height, bool invertY )
 {
-  FILE *infile;
-  char string[256], buf[80];
+  char buf[256];
+  int img_max;
   unsigned char *texImage;
-  int i, j, count=0, img_max;
-  long img_size;
-  int r, g, b, bw, c=0, raw=0, ascii=0;
-    
+
   /* open file containing texture */
-  if ((infile = fopen(f, "rb")) == NULL) {
+  IGLUFileData *file = IGLUFileSystem::Open( f );
+  if (!file) {
     sprintf(buf, "IGLU: Can't open file '%s'!", f);
     FatalError( buf );
   }
-  
-  /* read and discard first line (the P3 or P6, etc...) */
-  fgets(string, 256, infile);
-  *mode = string[1]-'0';
-  if ((!IsValidMode(*mode)) || (string[0] != 'P' && string[0] != 'p'))
-    {
-      sprintf(buf, "IGLU: Invalid PPM format specification in '%s'!", f);
-      FatalError(buf);
-    }
-  raw = RawMode( *mode );
-  ascii = ASCIIMode( *mode );
-
-  /* discard all the comments at the top of the file               */
-  /* if there are comments elsewhere, this code doesn't handle it! */
-  fgets(string, 256, infile);
-  while (string[0] == '#')
-     fgets(string, 256, infile);
-
-  /* read image size and max component value */
-  sscanf(string, "%d %d", width, height);
-  
-  /* PBMs are just 1's and 0's, so there's no max_component */
-  if (*mode != PBM_RAW && *mode != PBM_ASCII)
-    {
-      fscanf(infile, "%d ", &img_max);
-      if ((raw && img_max > 255) || (img_max <= 0))
-	  FatalError( "IGLU: Invalid value for maximum image color! (%s)", f );
-    }
+
+  const unsigned char *data = (const unsigned char *)file->GetData();
+  if (!ReadPPMHeader( data, file->GetSize(), mode, width, height, &img_max ))
+  {
+    sprintf(buf, "IGLU: Invalid PPM format specification in '%s'!", f);
+    FatalError(buf);
+  }
 
   /* allocate texture array */
-  img_size = 3*(*height)*(*width);
-  if ((texImage = (unsigned char *)calloc(img_size, sizeof(char))) == NULL)
+  if ((texImage = (unsigned char *)calloc(3*(*height)*(*width), sizeof(char))) == NULL)
     FatalError("IGLU: Cannot allocate memory for image! (%s)", f );
-  
-  /* read image data */
-  for (i=0; i < *height; i++) {
-    for (j=0; j < *width; j++) {
-	  int loc = invertY ? 3*((*width)*(*height-1-i) + j) : 3*((*width)*i + j);
-      if (raw)
-	    {
-		  if (*mode==PBM_RAW)
-	      {
-	        int bit_pos;
-	        if ((count%8)==0) bw=fgetc(infile);
-	        bit_pos = 7-(count%8);
-	        r=g=b=((bw & (1 << bit_pos))?0:255);
-	        count++;
-	        if ((j+1)==*width) count=0;
-	      }
-	    else if (*mode==PGM_RAW)
-	      r=g=b=fgetc(infile);
-	    else if (*mode==PPM_RAW)
-	      {
-	        r = fgetc(infile);
-	        g = fgetc(infile);
-	        b = fgetc(infile);
-	      }
-	  texImage[loc+0] = r;
-	  texImage[loc+1] = g;
-	  texImage[loc+2] = b;
-	  }
-      else /* then ASCII mode */
-	  {
-	    if (*mode==PBM_ASCII)
-	      {
-	        fscanf(infile, "%d", &r);
-	        if (r!=1 && r!=0) r=0;
-	        r=g=b=r*255;
-	      }
-	    else if (*mode==PGM_ASCII)
-	      {
-	        fscanf(infile, "%d", &r);
-	        r=g=b=r;
-	      }
-	    else if (*mode==PPM_ASCII)
-	    fscanf(infile, "%d %d %d", &r, &g, &b);
-		texImage[loc+0] = r;
-		texImage[loc+1] = g;
-		texImage[loc+2] = b;
-	  }
-    }
-  }
- 
-  fclose( infile );
-  
+
+  /* read image data (a truncated file leaves the rest black) */
+  if (!DecodePPM( data, file->GetSize(), texImage, 3, invertY ))
+    Warning( "IGLU: Truncated or corrupt image data in '%s'!", f );
+
+  delete file;
   return texImage;
 }
 
 
 
-/* 
-** write the image with a given width & height to a file called filename,
-** the data is given as a stream of chars (unsigned bytes) in the pointer 
-** ptr.
-*/
-int iglu::WritePPM( char *f, int mode, int width, int height, unsigned char *ptr )
+// namespace {  anonymous namespace for stuff used inside this file
+
+/* Converted output is built in blocks of about this many bytes, then written at once */
+#define PNM_WRITE_BLOCK   (256*1024)
+
+/* Writes 0..255 in decimal, without the overhead of fprintf() */
+static inline unsigned char *PutPPMNumber( unsigned char *out, int v )
+{
+  if (v >= 100) { *out++ = '0' + v/100; v %= 100; *out++ = '0' + v/10; }
+  else if (v >= 10) *out++ = '0' + v/10;
+  *out++ = '0' + v%10;
+  return out;
+}
+
+/* Largest number of bytes FormatPNMRow() writes for one row */
+static size_t MaxPNMRowBytes( int mode, int width )
 {
-  time_t thetime;
-  int x, y, i;
-  unsigned char r, g, b, bw=0;
-  int invertedHeight = 0;
-  FILE *out;
+  if (mode == PPM_RAW)   return 3*size_t(width);
+  if (mode == PGM_RAW)   return size_t(width);
+  if (mode == PBM_RAW)   return size_t(width+7)/8;
+  if (mode == PPM_ASCII) return 12*size_t(width) + width/5 + 1;
+  if (mode == PGM_ASCII) return 4*size_t(width) + width/15 + 1;
+  return 2*size_t(width) + width/15 + 1;
+}
 
-  if (height < 0) 
+/* Converts one row of 1-, 3-, or 4-channel pixels into the given mode's format.  Color */
+/*    goes to gray by averaging, and gray to black & white by thresholding at 128.      */
+/*    Returns the number of bytes written to out.                                       */
+static size_t FormatPNMRow( unsigned char *out, const unsigned char *row, int width, int channels, int mode )
+{
+  unsigned char *start = out;
+  if (mode == PPM_RAW)
   {
-	invertedHeight = 1;
-	height = -height;
+    if (channels == 4)      IGLUPixelOps::DropAlpha( out, row, width );
+    else if (channels == 1) IGLUPixelOps::ExpandGray( out, row, width, 3 );
+    else                    memcpy( out, row, 3*size_t(width) );
+    return 3*size_t(width);
   }
 
-  if (mode<0) 
+  unsigned char bw = 0;
+  for (int x = 0; x < width; x++, row += channels)
+  {
+    int gray = (channels == 1) ? row[0] : (row[0]+row[1]+row[2])/3;
+    switch (mode)
     {
-      Error("IGLU: Bad image format type!");
-      return GFXIO_UNSUPPORTED;
+    case PPM_ASCII:
+      for (int c = 0; c < 3; c++)
+      {
+        out = PutPPMNumber( out, row[(channels == 1) ? 0 : c] );
+        *out++ = ' ';
+      }
+      if (x % 5 == 4) *out++ = '\n';
+      break;
+    case PGM_RAW:
+      *out++ = (unsigned char)gray;
+      break;
+    case PGM_ASCII:
+      out = PutPPMNumber( out, gray );
+      *out++ = (x % 15 == 14) ? '\n' : ' ';
+      break;
+    case PBM_ASCII:
+      *out++ = (gray < 128) ? '1' : '0';
+      *out++ = (x % 15 == 14) ? '\n' : ' ';
+      break;
+    case PBM_RAW:
+      /* 8 pixels per byte, and rows are padded to a whole byte */
+      bw = (bw << 1) | ((gray < 128) ? 1 : 0);
+      if ((x & 7) == 7 || x == width-1)
+      {
+        *out++ = (unsigned char)(bw << (7 - (x & 7)));
+        bw = 0;
+      }
+      break;
     }
+  }
+  if (ASCIIMode( mode ) && out > start && out[-1] != '\n') *out++ = '\n';
+  return out - start;
+}
+
+/* Writes rows from the bottom of the image up, straight from ptr (no copies) */
+static bool WriteReversedRows( FILE *out, const unsigned char *ptr, size_t rowBytes, int height )
+{
+#ifdef _WIN32
+  for (int y = height-1; y >= 0; y--)
+    if (fwrite( ptr + size_t(y)*rowBytes, 1, rowBytes, out ) != rowBytes) return false;
+  return true;
+#else
+  /* Hand the kernel a batch of rows per call */
+  if (fflush( out )) return false;
+  int fd = fileno( out );
+  struct iovec iov[64];
+  for (int y = height-1; y >= 0; )
+  {
+    int n = 0;
+    for ( ; n < 64 && y >= 0; n++, y--)
+    {
+      iov[n].iov_base = (void *)(ptr + size_t(y)*rowBytes);
+      iov[n].iov_len  = rowBytes;
+    }
+    struct iovec *cur = iov;
+    while (n > 0)
+    {
+      ssize_t written = writev( fd, cur, n );
+      if (written < 0 && errno == EINTR) continue;
+      if (written <= 0) return false;
+      /* Partial write?  Skip what went out, and go again */
+      for ( ; n > 0 && size_t(written) >= cur->iov_len; n--, cur++) written -= cur->iov_len;
+      if (n > 0)
+      {
+        cur->iov_base = (char *)cur->iov_base + written;
+        cur->iov_len -= written;
+      }
+    }
+  }
+  return true;
+#endif
+}
+
+/* Writes the pixel data, in whichever way avoids the most work */
+static bool WritePNMData( FILE *out, int mode, int width, int height, int channels,
+                          const unsigned char *ptr, bool flipY )
+{
+  size_t srcRowBytes = size_t(channels) * width;
+
+  /* Already in the file's format?  Write it as is. */
+  if ((mode == PPM_RAW && channels == 3) || (mode == PGM_RAW && channels == 1))
+  {
+    if (flipY) return WriteReversedRows( out, ptr, srcRowBytes, height );
+    return fwrite( ptr, 1, srcRowBytes*height, out ) == srcRowBytes*height;
+  }
+
+  /* Otherwise, convert a block of rows at a time, then write the block */
+  size_t maxRowBytes = MaxPNMRowBytes( mode, width );
+  int blockRows = int( PNM_WRITE_BLOCK / maxRowBytes );
+  if (blockRows < 1) blockRows = 1;
+  if (blockRows > height) blockRows = height;
+  unsigned char *block = (unsigned char *)malloc( maxRowBytes * blockRows );
+  if (!block) return false;
+
+  bool ok = true;
+  for (int y = 0; y < height && ok; y += blockRows)
+  {
+    size_t bytes = 0;
+    for (int i = y; i < y+blockRows && i < height; i++)
+      bytes += FormatPNMRow( block + bytes, ptr + srcRowBytes * size_t(flipY ? height-1-i : i),
+                             width, channels, mode );
+    ok = (fwrite( block, 1, bytes, out ) == bytes);
+  }
+  free( block );
+  return ok;
+}
+
+// };  End: anonymous namespace
+
+
+/*
+** write the image with a given width & height to a file called filename.
+** see the header for details.
+*/
+int iglu::WritePNM( char *f, int mode, int width, int height, int channels,
+                    const unsigned char *ptr, bool flipY, const char *comment )
+{
+  if (!IsValidMode( mode ) || (channels != 1 && channels != 3 && channels != 4))
+  {
+    Error("IGLU: Bad image format type!");
+    return GFXIO_UNSUPPORTED;
+  }
   if (mode==PBM_RAW || mode==PBM_ASCII)
     Warning("IGLU: Distortions occur converting to PBM format!");
 
-  out = fopen(f, "wb");
+  FILE *out = fopen(f, "wb");
   if (!out) {
     char buf[256];
     sprintf( buf, "IGLU: Unable to open file '%s', output lost!", f );
     Error( buf );
     return GFXIO_OPENERROR;
   }
-  
-  fprintf(out, "P%d\n", mode);  
-  thetime = time(0);
-  fprintf(out, "# File created by Chris Wyman's PPM Library on %s",
-	  ctime(&thetime));
+
+  fprintf(out, "P%d\n", mode);
+  if (comment)
+    fprintf(out, "# %s\n", comment);
   fprintf(out, "%d %d\n", width, height);
   /* PBM's are just 1's and 0's, so there's no max component entry */
   if (mode!=PBM_RAW && mode!=PBM_ASCII)
-    fprintf(out, "%d\n", 255); 
-  
-  for (   y = (invertedHeight? height-1 : 0)     ; 
-	      (invertedHeight? y >= 0 : y < height)  ; 
-		  (invertedHeight? y-- : y++)            ) {
-    for (x = 0; x < width; x++) {
-      r = *(ptr+3*(y*width+x));  
-      g = *(ptr+3*(y*width+x)+1);
-      b = *(ptr+3*(y*width+x)+2);
-
-      if (mode == PPM_RAW)
-        fprintf(out, "%c%c%c", r, g, b);
-      else if (mode == PPM_ASCII)
-	  {
-	    fprintf(out, "%d %d %d ", r, g, b);
-	    if (((++i) % 5) == 0) fprintf( out, "\n" ); 
-	  }
-      else if (mode == PGM_RAW)
-        fprintf(out, "%c", ((r+g+b)/3));
-      else if (mode == PGM_ASCII)
-	  {
-	    fprintf(out, "%d ", (r+g+b)/3);
-	    if (((++i) % 15) == 0) fprintf( out, "\n" ); 
-	  }
-      else if (mode == PBM_ASCII)
-	  {
-	    fprintf(out, "%d ", ( (((r+g+b)/3)<128) ? 1 : 0));
-	    if (((++i) % 15) == 0) fprintf( out, "\n" ); 
-	  }
-      else if (mode == PBM_RAW)
-	  {
-	    char add=0;
-	    if (((r+g+b)/3)<128) add=1;
-	    bw = (bw << 1)+add;
-	    if (((++i) % 8) == 0) 
-	    {
-	      fprintf( out, "%c", bw );
-	      bw = 0;
-	    }
-	    else if ((x+1)==width) 
-	    /* there's padding at the end of rows, evidently... grr! */
-	    {
-	      int bits=8-(i%8);
-	      bw = bw<<bits;
-	      fprintf( out, "%c", bw );
-	      bw=i=0;
-	    }
-	  }
-    }
-  }
-  fprintf(out, "\n");
-  fclose(out);
+    fprintf(out, "%d\n", 255);
 
+  bool ok = WritePNMData( out, mode, width, height, channels, ptr, flipY );
+  if (fclose(out) || !ok) {
+    char buf[256];
+    sprintf( buf, "IGLU: Error writing file '%s', output lost!", f );
+    Error( buf );
+    return GFXIO_OPENERROR;
+  }
   return GFXIO_OK;
-}
\ No newline at end of file
+}
+
+/* 
+** write the image with a given width & height to a file called filename,
+** the data is given as a stream of chars (unsigned bytes) in the pointer 
+** ptr.
+*/
+int iglu::WritePPM( char *f, int mode, int width, int height, unsigned char *ptr )
+{
+  char comment[128];
+  time_t thetime = time(0);
+
+  /* a negative height means the rows are stored bottom to top */
+  bool invertedHeight = (height < 0);
+  if (invertedHeight) height = -height;
+
+  sprintf(comment, "File created by Chris Wyman's PPM Library on %s", ctime(&thetime));
+  comment[strcspn(comment, "\n")] = 0;
+  return WritePNM( f, mode, width, height, 3, ptr, invertedHeight, comment );
+}
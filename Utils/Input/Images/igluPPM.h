@@ -14,6 +14,9 @@
 
 #pragma warning( disable: 4996 )
 
+#include <stddef.h>
+#include "iglu/igluImageDecoder.h"
+
 namespace iglu {
 
 /* Modes this code works for (returned in *mode for ReadPPM(), values to    */
@@ -49,6 +52,14 @@ namespace iglu {
 /*    The values stored in *w and *h are the image width & height           */             
 unsigned char *ReadPPM( char *f, int *mode, int *width, int *height, bool invertY=false );
 
+/* The decoder IGLUImageDecoder uses (and ReadPPM() wraps), working on the  */
+/*    file's contents in memory.  DecodePPM() writes RGB (channels = 3) or  */
+/*    RGBA (channels = 4) rows, top row first unless bottomUp is set.       */
+/*    Samples over 8 bits are scaled down to 8.  Both return false on bad   */
+/*    or truncated data.                                                    */
+bool ReadPPMInfo( const unsigned char *data, size_t size, IGLUImageInfo *info );
+bool DecodePPM( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp );
+
 /* Writes a PPM/PGM/PBM to the file 'f'                                     */
 /*    Returns:  One of the error codes from above or GFXIO_OK               */
 /*    Input:  'f', the filename to write to                                 */
@@ -60,6 +71,18 @@ unsigned char *ReadPPM( char *f, int *mode, int *width, int *height, bool invert
 /*                 format the data is to be written as (even b&w images)!   */
 int WritePPM( char *f, int mode, int width, int height, unsigned char *ptr );
 
+/* Writes a PPM/PGM/PBM to the file 'f' from gray, RGB, or RGBA data        */
+/*    Returns:  One of the error codes from above or GFXIO_OK               */
+/*    Input:  mode, width, height, as for WritePPM() (height > 0 here)      */
+/*            channels, bytes per pixel in ptr:  1 (gray), 3, or 4 (RGBA,   */
+/*                 whose alpha is not written)                              */
+/*            flipY, write the rows bottom to top (e.g., for glReadPixels()) */
+/*            comment, an optional line for the header                      */
+/*    Raw PPMs from RGB and raw PGMs from gray data are written straight    */
+/*         from ptr;  other combinations are converted a block at a time.   */
+int WritePNM( char *f, int mode, int width, int height, int channels,
+              const unsigned char *ptr, bool flipY=false, const char *comment=0 );
+
 
 // End iglu namespace
 }
@@ -0,0 +1,185 @@
+/******************************************************************/
+/* igluPixelOps.cpp                                               */
+/* -----------------------                                        */
+/*                                                                */
+/* The byte-level pixel conversions used by the image decoders.   */
+/*    Each has a plain C version, plus SSE2 and/or SSSE3 versions */
+/*    used when the compiler targets them (e.g., x64 always has   */
+/*    SSE2;  SSSE3 needs -mssse3 with gcc, or /arch:AVX with      */
+/*    Visual Studio).  The plain versions finish off whatever the */
+/*    vector loops leave.                                         */
+/*                                                                */
+/******************************************************************/
+
+#include <string.h>
+#include "iglu/igluImageDecoder.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define IGLU_PIXEL_SSE2
+#endif
+#if defined(IGLU_PIXEL_SSE2) && (defined(__SSSE3__) || defined(__AVX__))
+	#include <tmmintrin.h>
+	#define IGLU_PIXEL_SSSE3
+#endif
+
+using namespace iglu;
+
+
+void IGLUPixelOps::SwapRedBlue( unsigned char *dst, const unsigned char *src, size_t numPixels, int channels )
+{
+	size_t i = 0;
+	if (channels == 4)
+	{
+#ifdef IGLU_PIXEL_SSE2
+		// Four pixels at a time, as 32-bit words:  keep green & alpha, and swap the other two bytes
+		const __m128i keep = _mm_set1_epi32( 0xFF00FF00 ), low = _mm_set1_epi32( 0x000000FF );
+		for ( ; i+4 <= numPixels; i+=4)
+		{
+			__m128i px = _mm_loadu_si128( (const __m128i *)(src + 4*i) );
+			__m128i rb = _mm_or_si128( _mm_slli_epi32( _mm_and_si128( px, low ), 16 ),
+				                       _mm_and_si128( _mm_srli_epi32( px, 16 ), low ) );
+			_mm_storeu_si128( (__m128i *)(dst + 4*i), _mm_or_si128( _mm_and_si128( px, keep ), rb ) );
+		}
+#endif
+		for ( ; i<numPixels; i++)
+		{
+			unsigned char r = src[4*i+0];
+			dst[4*i+0] = src[4*i+2];
+			dst[4*i+1] = src[4*i+1];
+			dst[4*i+2] = r;
+			dst[4*i+3] = src[4*i+3];
+		}
+		return;
+	}
+
+#ifdef IGLU_PIXEL_SSSE3
+	// Five pixels (15 bytes) at a time.  The 16th byte is copied unchanged (and redone next time).
+	const __m128i swap3 = _mm_setr_epi8( 2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15 );
+	for ( ; 3*i+16 <= 3*numPixels; i+=5)
+	{
+		__m128i px = _mm_loadu_si128( (const __m128i *)(src + 3*i) );
+		_mm_storeu_si128( (__m128i *)(dst + 3*i), _mm_shuffle_epi8( px, swap3 ) );
+	}
+#endif
+	for ( ; i<numPixels; i++)
+	{
+		unsigned char r = src[3*i+0];
+		dst[3*i+0] = src[3*i+2];
+		dst[3*i+1] = src[3*i+1];
+		dst[3*i+2] = r;
+	}
+}
+
+void IGLUPixelOps::ExpandRGBToRGBA( unsigned char *dst, const unsigned char *src, size_t numPixels,
+	                                unsigned char alpha, bool swapRedBlue )
+{
+	size_t i = 0;
+	int r = swapRedBlue ? 2 : 0, b = 2 - r;
+
+#ifdef IGLU_PIXEL_SSSE3
+	// Four pixels (12 bytes) at a time, reading (but ignoring) four more
+	const __m128i expand = swapRedBlue ?
+		_mm_setr_epi8( 2,1,0,-1, 5,4,3,-1, 8,7,6,-1, 11,10,9,-1 ) :
+		_mm_setr_epi8( 0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1 );
+	const __m128i alphas = _mm_set1_epi32( int( (unsigned int)alpha << 24 ) );
+	for ( ; 3*i+16 <= 3*numPixels; i+=4)
+	{
+		__m128i px = _mm_loadu_si128( (const __m128i *)(src + 3*i) );
+		_mm_storeu_si128( (__m128i *)(dst + 4*i), _mm_or_si128( _mm_shuffle_epi8( px, expand ), alphas ) );
+	}
+#endif
+	for ( ; i<numPixels; i++)
+	{
+		dst[4*i+0] = src[3*i+r];
+		dst[4*i+1] = src[3*i+1];
+		dst[4*i+2] = src[3*i+b];
+		dst[4*i+3] = alpha;
+	}
+}
+
+void IGLUPixelOps::ExpandGray( unsigned char *dst, const unsigned char *src, size_t numPixels, int channels,
+	                           unsigned char alpha )
+{
+	size_t i = 0;
+	if (channels == 4)
+	{
+#ifdef IGLU_PIXEL_SSE2
+		// Sixteen pixels at a time:  pair up (g,g) and (g,a) bytes, then pair up those pairs
+		const __m128i alphas = _mm_set1_epi8( char( alpha ) );
+		for ( ; i+16 <= numPixels; i+=16)
+		{
+			__m128i g    = _mm_loadu_si128( (const __m128i *)(src + i) );
+			__m128i ggLo = _mm_unpacklo_epi8( g, g ),      ggHi = _mm_unpackhi_epi8( g, g );
+			__m128i gaLo = _mm_unpacklo_epi8( g, alphas ), gaHi = _mm_unpackhi_epi8( g, alphas );
+			__m128i *out = (__m128i *)(dst + 4*i);
+			_mm_storeu_si128( out+0, _mm_unpacklo_epi16( ggLo, gaLo ) );
+			_mm_storeu_si128( out+1, _mm_unpackhi_epi16( ggLo, gaLo ) );
+			_mm_storeu_si128( out+2, _mm_unpacklo_epi16( ggHi, gaHi ) );
+			_mm_storeu_si128( out+3, _mm_unpackhi_epi16( ggHi, gaHi ) );
+		}
+#endif
+		for ( ; i<numPixels; i++)
+		{
+			dst[4*i+0] = dst[4*i+1] = dst[4*i+2] = src[i];
+			dst[4*i+3] = alpha;
+		}
+		return;
+	}
+
+#ifdef IGLU_PIXEL_SSSE3
+	// Sixteen pixels (48 output bytes) at a time
+	const __m128i rep0 = _mm_setr_epi8( 0,0,0, 1,1,1, 2,2,2, 3,3,3, 4,4,4, 5 );
+	const __m128i rep1 = _mm_setr_epi8( 5,5, 6,6,6, 7,7,7, 8,8,8, 9,9,9, 10,10 );
+	const __m128i rep2 = _mm_setr_epi8( 10, 11,11,11, 12,12,12, 13,13,13, 14,14,14, 15,15,15 );
+	for ( ; i+16 <= numPixels; i+=16)
+	{
+		__m128i g = _mm_loadu_si128( (const __m128i *)(src + i) );
+		__m128i *out = (__m128i *)(dst + 3*i);
+		_mm_storeu_si128( out+0, _mm_shuffle_epi8( g, rep0 ) );
+		_mm_storeu_si128( out+1, _mm_shuffle_epi8( g, rep1 ) );
+		_mm_storeu_si128( out+2, _mm_shuffle_epi8( g, rep2 ) );
+	}
+#endif
+	for ( ; i<numPixels; i++)
+		dst[3*i+0] = dst[3*i+1] = dst[3*i+2] = src[i];
+}
+
+void IGLUPixelOps::DropAlpha( unsigned char *dst, const unsigned char *src, size_t numPixels )
+{
+	size_t i = 0;
+#ifdef IGLU_PIXEL_SSSE3
+	// Four pixels at a time.  Each store writes 4 bytes past the pixels (redone next time),
+	//    which also stays behind the reads if dst == src.
+	const __m128i pack = _mm_setr_epi8( 0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1 );
+	for ( ; 3*i+16 <= 3*numPixels; i+=4)
+	{
+		__m128i px = _mm_loadu_si128( (const __m128i *)(src + 4*i) );
+		_mm_storeu_si128( (__m128i *)(dst + 3*i), _mm_shuffle_epi8( px, pack ) );
+	}
+#endif
+	for ( ; i<numPixels; i++)
+	{
+		dst[3*i+0] = src[4*i+0];
+		dst[3*i+1] = src[4*i+1];
+		dst[3*i+2] = src[4*i+2];
+	}
+}
+
+void IGLUPixelOps::FlipRows( unsigned char *data, size_t rowBytes, int height )
+{
+	// Swap rows from the outside in, a piece at a time through a small buffer
+	unsigned char tmp[4096];
+	for (int y=0; y<height/2; y++)
+	{
+		unsigned char *top = data + size_t(y)*rowBytes;
+		unsigned char *bot = data + size_t(height-1-y)*rowBytes;
+		for (size_t off=0; off<rowBytes; off+=sizeof(tmp))
+		{
+			size_t n = (rowBytes-off < sizeof(tmp)) ? rowBytes-off : sizeof(tmp);
+			memcpy( tmp, top+off, n );
+			memcpy( top+off, bot+off, n );
+			memcpy( bot+off, tmp, n );
+		}
+	}
+}
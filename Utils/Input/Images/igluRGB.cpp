@@ -12,263 +12,215 @@
 #include <stdlib.h> 
 #include <string.h>
 #include "igluRGB.h"
+#include "iglu/igluParallel.h"
+#include "iglu/parsing/igluFileSystem.h"
 
 #pragma warning( disable: 4996 )
 
 using namespace iglu;
 
-
-void
-bwtorgba(unsigned char *b,unsigned char *l,int n) {
-    while(n--) {
-	l[0] = *b;
-	l[1] = *b;
-	l[2] = *b;
-	l[3] = 0xff;
-	l += 4; b++;
-    }
+// namespace {  anonymous namespace for stuff used inside this file
+
+/* The parts of the header we use (everything in the file is big endian) */
+typedef struct _SGIImage {
+    const unsigned char *data;
+    size_t size;
+    int rle;
+    int xsize, ysize, zsize;
+} SGIImage;
+
+static inline unsigned int GetShort(const unsigned char *p) { return (p[0] << 8) | p[1]; }
+static inline unsigned int GetLong(const unsigned char *p)  { return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+static bool
+ReadSGIHeader(const unsigned char *data, size_t size, SGIImage *image) {
+    if (size < 512 || GetShort(data) != 474)
+	return false;
+    image->data  = data;
+    image->size  = size;
+    image->rle   = data[2];
+    int bpc      = data[3];
+    int dim      = GetShort(data+4);
+    image->xsize = GetShort(data+6);
+    image->ysize = (dim >= 2) ? GetShort(data+8)  : 1;
+    image->zsize = (dim >= 3) ? GetShort(data+10) : 1;
+
+    /* Only 8-bit channels are supported */
+    if (bpc != 1 || image->rle > 1 || image->xsize == 0 || image->ysize == 0 || image->zsize == 0)
+	return false;
+
+    /* Are the RLE tables (or the verbatim data) all there? */
+    size_t tableEntries = size_t(image->ysize) * image->zsize;
+    if (image->rle)
+	return (size - 512) / 8 >= tableEntries;
+    return (size - 512) / image->xsize >= tableEntries;
 }
 
-void
-latorgba(unsigned char *b, unsigned char *a,unsigned char *l,int n) {
-    while(n--) {
-	l[0] = *b;
-	l[1] = *b;
-	l[2] = *b;
-	l[3] = *a;
-	l += 4; b++; a++;
+/* Decodes row y of channel z into every stride'th byte of buf.  Returns false on bad data. */
+static bool
+DecodeSGIRow(const SGIImage *image, unsigned char *buf, int stride, int y, int z) {
+    size_t tableIdx = size_t(z) * image->ysize + y;
+    if (!image->rle) {
+	const unsigned char *iPtr = image->data + 512 + tableIdx * image->xsize;
+	for (int x = 0; x < image->xsize; x++)
+	    buf[x*stride] = iPtr[x];
+	return true;
     }
-}
 
-void
-rgbtorgba(unsigned char *r,unsigned char *g,unsigned char *b,unsigned char *l,int n) {
-    while(n--) {
-	l[0] = r[0];
-	l[1] = g[0];
-	l[2] = b[0];
-	l[3] = 0xff;
-	l += 4; r++; g++; b++;
+    size_t tableEntries = size_t(image->ysize) * image->zsize;
+    size_t start  = GetLong(image->data + 512 + 4*tableIdx);
+    size_t length = GetLong(image->data + 512 + 4*tableEntries + 4*tableIdx);
+    if (start > image->size || length > image->size - start)
+	return false;
+
+    const unsigned char *iPtr = image->data + start, *iEnd = iPtr + length;
+    unsigned char *oPtr = buf;
+    int x = 0;
+    while (iPtr < iEnd) {
+	unsigned char pixel = *iPtr++;
+	int count = (int)(pixel & 0x7F);
+	if (!count)
+	    break;
+	if (x + count > image->xsize)
+	    return false;
+	x += count;
+	if (pixel & 0x80) {
+	    if (count > iEnd - iPtr)
+		return false;
+	    while (count--) {
+		*oPtr = *iPtr++;
+		oPtr += stride;
+	    }
+	} else {
+	    if (iPtr >= iEnd)
+		return false;
+	    pixel = *iPtr++;
+	    while (count--) {
+		*oPtr = pixel;
+		oPtr += stride;
+	    }
+	}
     }
-}
 
-void
-rgbatorgba(unsigned char *r,unsigned char *g,unsigned char *b,unsigned char *a,unsigned char *l,int n) {
-    while(n--) {
-	l[0] = r[0];
-	l[1] = g[0];
-	l[2] = b[0];
-	l[3] = a[0];
-        l += 4; r++; g++; b++; a++;
-    }
+    /* Short rows are padded with black */
+    for ( ; x < image->xsize; x++, oPtr += stride)
+	*oPtr = 0;
+    return true;
 }
 
-typedef struct _ImageRec {
-    unsigned short imagic;
-    unsigned short type;
-    unsigned short dim;
-    unsigned short xsize, ysize, zsize;
-    unsigned int min, max;
-    unsigned int wasteBytes;
-    char name[80];
-    unsigned long colorMap;
-    FILE *file;
-    unsigned char *tmp, *tmpR, *tmpG, *tmpB;
-    unsigned long rleEnd;
-    unsigned int *rowStart;
-    int *rowSize;
-} ImageRec;
-
-static void
-ConvertShort(unsigned short *array, long length) {
-    unsigned b1, b2;
-    unsigned char *ptr;
-
-    ptr = (unsigned char *)array;
-    while (length--) {
-	b1 = *ptr++;
-	b2 = *ptr++;
-	*array++ = (b1 << 8) | (b2);
-    }
+/* Decodes every channel of row y straight into its interleaved RGB or RGBA output row */
+static bool
+DecodeSGIPixelRow(const SGIImage *image, unsigned char *row, int channels, int y) {
+    /* Gray images fill red, then copy it to green and blue.  Gray+alpha has its alpha second. */
+    int colorPlanes = (image->zsize >= 3) ? 3 : 1;
+    int alphaPlane  = (image->zsize >= 4) ? 3 : ((image->zsize == 2) ? 1 : -1);
+
+    for (int z = 0; z < colorPlanes; z++)
+	if (!DecodeSGIRow(image, row + z, channels, y, z))
+	    return false;
+    if (colorPlanes == 1)
+	for (int x = 0; x < image->xsize; x++)
+	    row[channels*x+1] = row[channels*x+2] = row[channels*x];
+
+    if (channels < 4)
+	return true;
+    if (alphaPlane >= 0)
+	return DecodeSGIRow(image, row + 3, 4, y, alphaPlane);
+    for (int x = 0; x < image->xsize; x++)
+	row[4*x+3] = 255;
+    return true;
 }
 
-static void
-ConvertLong(unsigned *array, long length) {
-    unsigned b1, b2, b3, b4;
-    unsigned char *ptr;
+/* What DecodeRGB() passes to IGLUParallel::For(), which decodes a block of rows per item */
+typedef struct _SGIDecodeJob {
+    const SGIImage *image;
+    unsigned char *dst;
+    int channels, rowsPerItem;
+    bool bottomUp;
+    volatile bool failed;
+} SGIDecodeJob;
 
-    ptr = (unsigned char *)array;
-    while (length--) {
-	b1 = *ptr++;
-	b2 = *ptr++;
-	b3 = *ptr++;
-	b4 = *ptr++;
-	*array++ = (b1 << 24) | (b2 << 16) | (b3 << 8) | (b4);
+static void
+DecodeSGIRows(int item, void *jobPtr) {
+    SGIDecodeJob *job = (SGIDecodeJob *)jobPtr;
+    const SGIImage *image = job->image;
+    size_t dstRowBytes = size_t(job->channels) * image->xsize;
+    int yEnd = (item+1) * job->rowsPerItem;
+    if (yEnd > image->ysize)
+	yEnd = image->ysize;
+
+    /* Rows are stored bottom row first */
+    for (int y = item * job->rowsPerItem; y < yEnd && !job->failed; y++) {
+	unsigned char *row = job->dst + dstRowBytes * size_t(job->bottomUp ? y : image->ysize-1-y);
+	if (!DecodeSGIPixelRow(image, row, job->channels, y))
+	    job->failed = true;
     }
 }
 
-static ImageRec *ImageOpen(const char *fileName)
-{
-    union {
-	int testWord;
-	char testByte[4];
-    } endianTest;
-    ImageRec *image;
-    int swapFlag;
-    int x;
-
-    endianTest.testWord = 1;
-    if (endianTest.testByte[0] == 1) {
-	swapFlag = 1;
-    } else {
-	swapFlag = 0;
-    }
+// };  End: anonymous namespace
 
-    image = (ImageRec *)malloc(sizeof(ImageRec));
-    if (image == NULL) {
-	fprintf(stderr, "Out of memory!\n");
-	exit(1);
-    }
-    if ((image->file = fopen(fileName, "rb")) == NULL) {
-	perror(fileName);
-	exit(1);
-    }
-
-    fread(image, 1, 12, image->file);
-
-    if (swapFlag) {
-	ConvertShort(&image->imagic, 6);
-    }
 
-    image->tmp = (unsigned char *)malloc(image->xsize*256);
-    image->tmpR = (unsigned char *)malloc(image->xsize*256);
-    image->tmpG = (unsigned char *)malloc(image->xsize*256);
-    image->tmpB = (unsigned char *)malloc(image->xsize*256);
-    if (image->tmp == NULL || image->tmpR == NULL || image->tmpG == NULL ||
-	image->tmpB == NULL) {
-	fprintf(stderr, "Out of memory!\n");
-	exit(1);
-    }
-
-    if ((image->type & 0xFF00) == 0x0100) {
-	x = image->ysize * image->zsize * sizeof(unsigned);
-	image->rowStart = (unsigned *)malloc(x);
-	image->rowSize = (int *)malloc(x);
-	if (image->rowStart == NULL || image->rowSize == NULL) {
-	    fprintf(stderr, "Out of memory!\n");
-	    exit(1);
-	}
-	image->rleEnd = 512 + (2 * x);
-	fseek(image->file, 512, SEEK_SET);
-	fread(image->rowStart, 1, x, image->file);
-	fread(image->rowSize, 1, x, image->file);
-	if (swapFlag) {
-	    ConvertLong(image->rowStart, x/sizeof(unsigned));
-	    ConvertLong((unsigned *)image->rowSize, x/sizeof(int));
-	}
-    }
-    return image;
+bool
+iglu::ReadRGBInfo(const unsigned char *data, size_t size, IGLUImageInfo *info) {
+    SGIImage image;
+    if (!ReadSGIHeader(data, size, &image))
+	return false;
+    info->width = image.xsize;
+    info->height = image.ysize;
+    info->channels = 4;
+    return true;
 }
 
-static void
-ImageClose(ImageRec *image) {
-    fclose(image->file);
-    free(image->tmp);
-    free(image->tmpR);
-    free(image->tmpG);
-    free(image->tmpB);
-    free(image);
-}
-
-static void
-ImageGetRow(ImageRec *image, unsigned char *buf, int y, int z) {
-    unsigned char *iPtr, *oPtr, pixel;
-    int count;
-
-    if ((image->type & 0xFF00) == 0x0100) {
-	fseek(image->file, image->rowStart[y+z*image->ysize], SEEK_SET);
-	fread(image->tmp, 1, (unsigned int)image->rowSize[y+z*image->ysize],
-	      image->file);
-
-	iPtr = image->tmp;
-	oPtr = buf;
-	while (1) {
-	    pixel = *iPtr++;
-	    count = (int)(pixel & 0x7F);
-	    if (!count) {
-		return;
-	    }
-	    if (pixel & 0x80) {
-		while (count--) {
-		    *oPtr++ = *iPtr++;
-		}
-	    } else {
-		pixel = *iPtr++;
-		while (count--) {
-		    *oPtr++ = pixel;
-		}
-	    }
-	}
-    } else {
-	fseek(image->file, 512+(y*image->xsize)+(z*image->xsize*image->ysize),
-	      SEEK_SET);
-	fread(buf, 1, image->xsize, image->file);
-    }
+bool
+iglu::DecodeRGB(const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp) {
+    SGIImage image;
+    if (!ReadSGIHeader(data, size, &image))
+	return false;
+
+    /* The file is all in memory, and the offset tables say where every row is, so
+       blocks of rows (roughly 64 KB of pixels each) can be decoded in parallel */
+    SGIDecodeJob job;
+    job.image = &image;
+    job.dst = dst;
+    job.channels = channels;
+    job.bottomUp = bottomUp;
+    job.failed = false;
+    job.rowsPerItem = 1 + 65536 / (image.xsize * channels);
+    int numItems = (image.ysize + job.rowsPerItem - 1) / job.rowsPerItem;
+    if (numItems > 1)
+	IGLUParallel::For(numItems, DecodeSGIRows, &job);
+    else
+	DecodeSGIRows(0, &job);
+    return !job.failed;
 }
 
 unsigned char *
 iglu::ReadRGB(const char *name, int *width, int *height, int *components, bool invertY ) {
-    unsigned *base, *lptr;
-    unsigned char *rbuf, *gbuf, *bbuf, *abuf;
-    ImageRec *image;
-    int y;
-
-    image = ImageOpen(name);
-    
-    if(!image)
+    IGLUImageInfo info;
+    SGIImage image;
+    IGLUFileData *file = IGLUFileSystem::Open(name);
+    if (!file) {
+	fprintf(stderr, "ReadRGB() unable to open file '%s'!\n", name);
 	return NULL;
-    (*width)=image->xsize;
-    (*height)=image->ysize;
-    (*components)=image->zsize;
-    base = (unsigned *)malloc(image->xsize*image->ysize*sizeof(unsigned));
-    rbuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    gbuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    bbuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    abuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    if(!base || !rbuf || !gbuf || !bbuf)
-      return NULL;
-    lptr = base;
-    for(y=0; y<image->ysize; y++) {
-	int yy = invertY ? (image->ysize-1-y) : y;
-	if(image->zsize>=4) {
-	    ImageGetRow(image,rbuf,yy,0);
-	    ImageGetRow(image,gbuf,yy,1);
-	    ImageGetRow(image,bbuf,yy,2);
-	    ImageGetRow(image,abuf,yy,3);
-	    rgbatorgba(rbuf,gbuf,bbuf,abuf,(unsigned char *)lptr,image->xsize);
-	    lptr += image->xsize;
-	} else if(image->zsize==3) {
-	    ImageGetRow(image,rbuf,yy,0);
-	    ImageGetRow(image,gbuf,yy,1);
-	    ImageGetRow(image,bbuf,yy,2);
-	    rgbtorgba(rbuf,gbuf,bbuf,(unsigned char *)lptr,image->xsize);
-	    lptr += image->xsize;
-	} else if(image->zsize==2) {
-	    ImageGetRow(image,rbuf,yy,0);
-	    ImageGetRow(image,abuf,yy,1);
-	    latorgba(rbuf,abuf,(unsigned char *)lptr,image->xsize);
-	    lptr += image->xsize;
-	} else {
-	    ImageGetRow(image,rbuf,yy,0);
-	    bwtorgba(rbuf,(unsigned char *)lptr,image->xsize);
-	    lptr += image->xsize;
-	}
     }
-    ImageClose(image);
-    free(rbuf);
-    free(gbuf);
-    free(bbuf);
-    free(abuf);
 
-    return (unsigned char*) base;
+    const unsigned char *data = (const unsigned char *)file->GetData();
+    unsigned char *base = NULL;
+    info.width = info.height = 0;
+    image.zsize = 0;
+    if (ReadSGIHeader(data, file->GetSize(), &image) && ReadRGBInfo(data, file->GetSize(), &info)) {
+	base = (unsigned char *)malloc(4 * size_t(info.width) * info.height);
+	if (base && !DecodeRGB(data, file->GetSize(), base, 4, !invertY)) {
+	    free(base);
+	    base = NULL;
+	}
+    }
+    if (!base)
+	fprintf(stderr, "ReadRGB() unable to read '%s'!\n", name);
+
+    (*width) = info.width;
+    (*height) = info.height;
+    (*components) = image.zsize;
+    delete file;
+    return base;
 }
-
@@ -13,12 +13,22 @@
 #ifndef IGLU__IRGB_H__
 #define IGLU__IRGB_H__
 
+#include <stddef.h>
+#include "iglu/igluImageDecoder.h"
+
 namespace iglu {
 
 // Reads '.rgb' and '.rgba' files  (SGI file format)
 //   -> 'components' is the number of unsigned chars per pixel.
 unsigned char *ReadRGB( const char *name, int *width, int *height, int *components, bool invertY=false );
 
+// The decoder IGLUImageDecoder uses (and ReadRGB() wraps), working on the file's
+//   contents in memory.  Handles 8-bit verbatim and RLE files with 1 to 4 channels.
+//   DecodeRGB() writes RGB (channels = 3) or RGBA (channels = 4) rows, top row
+//   first unless bottomUp is set.  Both return false on bad or unsupported data.
+bool ReadRGBInfo( const unsigned char *data, size_t size, IGLUImageInfo *info );
+bool DecodeRGB( const unsigned char *data, size_t size, unsigned char *dst, int channels, bool bottomUp );
+
 
 }
 
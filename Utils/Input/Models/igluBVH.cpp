@@ -0,0 +1,911 @@
+/******************************************************************/
+/* igluBVH.cpp                                                    */
+/* -----------------------                                        */
+/*                                                                */
+/* A 4-wide bounding volume hierarchy over triangles, for CPU ray */
+/*    queries.  It is built as a binary tree using binned SAH     */
+/*    splits (as in I. Wald, "On Fast Construction of SAH-based   */
+/*    Bounding Volume Hierarchies," IEEE Symposium on Interactive */
+/*    Ray Tracing, 2007), then collapsed to four children per     */
+/*    node.                                                       */
+/*                                                                */
+/* The top of the tree is built on one thread (binning the big    */
+/*    nodes in parallel), and the subtrees below it are built in  */
+/*    parallel.                                                   */
+/******************************************************************/
+
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include "iglu.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define IGLU_BVH_USE_SSE
+#endif
+
+using namespace iglu;
+
+// Tuning parameters for the build
+#define IGLU_BVH_NUM_BINS        16      // SAH bins per axis
+#define IGLU_BVH_MAX_LEAF_SIZE   8       // Nodes with more triangles than this are always split
+#define IGLU_BVH_TRAVERSAL_COST  1.0f    // Cost of visiting a node, relative to testing one triangle
+#define IGLU_BVH_MAX_SAH_DEPTH   64      // Below this depth, split at the median (bounding the tree's depth)
+#define IGLU_BVH_PARALLEL_BINS   65536   // Bin nodes with more triangles than this on multiple threads
+
+// Traversal pushes at most 3 nodes per level, and the depth is at most IGLU_BVH_MAX_SAH_DEPTH
+//    plus the levels needed to get down to leaves by median splits (< 32).
+#define IGLU_BVH_STACK_SIZE      320
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// A node of the binary tree built before collapsing to IGLUBVHNodes.  Nodes with count > 0
+//    are leaves, covering builder refs[first .. first+count-1].
+struct IGLUBVHBuildNode
+{
+	float bMin[3], bMax[3];
+	uint  left, right;
+	uint  first, count;
+};
+
+struct IGLUBVHBin
+{
+	float bMin[3], bMax[3];
+	uint  count;
+};
+
+// Bounds, centroid bounds, and SAH bins for a range of triangles (or a chunk of one)
+struct IGLUBVHRangeInfo
+{
+	float      bMin[3], bMax[3];
+	float      cMin[3], cMax[3];
+	IGLUBVHBin bins[3][IGLU_BVH_NUM_BINS];
+};
+
+// A subtree left to be built by a separate task.  Its finished nodes replace node nodeIdx.
+struct IGLUBVHBuildTask
+{
+	uint nodeIdx, first, count, depth;
+	std::vector<IGLUBVHBuildNode> nodes;
+};
+
+struct IGLUBVHBuilder
+{
+	const float *triBounds;     // Min x,y,z then max x,y,z for each triangle
+	const float *centroids;     // Bounding box center for each triangle
+	uint        *refs;          // The triangles, partitioned in place as we split
+	int          numThreads;
+	uint         taskSize;      // Subtrees with this many triangles (or fewer) are built as separate tasks
+	std::vector<IGLUBVHBuildTask> tasks;
+};
+
+// Passed to the IGLUParallel::For() callback that computes range info a chunk at a time
+struct IGLUBVHRangeJob
+{
+	const IGLUBVHBuilder *builder;
+	uint  first, count, chunkSize;
+	bool  binning;                      // Computing bins (rather than bounds)?
+	float cMin[3], binScale[3];
+	IGLUBVHRangeInfo *chunks;
+};
+
+// Passed to the IGLUParallel::For() callback that runs batches of ray queries
+struct IGLUBVHRayJob
+{
+	const IGLUBVH    *bvh;
+	const IGLURay    *rays;
+	IGLURayHit       *hits;
+	bool             *occluded;
+	uint              numRays;
+};
+
+// A ray, set up for traversal.  Zero direction components are nudged away from zero,
+//    so the slab tests never compute 0 * infinity.
+struct IGLUBVHRayData
+{
+	float org[3], dir[3], invDir[3];
+	int   nearIdx[3], farIdx[3];          // Which of a node's bounds[] each axis enters & exits through
+};
+
+static inline float BoxArea( const float bMin[3], const float bMax[3] )
+{
+	float dx = bMax[0]-bMin[0], dy = bMax[1]-bMin[1], dz = bMax[2]-bMin[2];
+	if (dx < 0 || dy < 0 || dz < 0) return 0.0f;
+	return 2.0f * (dx*dy + dy*dz + dz*dx);
+}
+
+static inline void EmptyBox( float bMin[3], float bMax[3] )
+{
+	bMin[0] = bMin[1] = bMin[2] = FLT_MAX;
+	bMax[0] = bMax[1] = bMax[2] = -FLT_MAX;
+}
+
+static inline void GrowBox( float bMin[3], float bMax[3], const float oMin[3], const float oMax[3] )
+{
+	for (int a=0; a<3; a++)
+	{
+		bMin[a] = std::min( bMin[a], oMin[a] );
+		bMax[a] = std::max( bMax[a], oMax[a] );
+	}
+}
+
+static inline int GetBinIndex( float c, float cMin, float binScale )
+{
+	int bin = int( (c - cMin) * binScale );
+	return bin < 0 ? 0 : (bin >= IGLU_BVH_NUM_BINS ? IGLU_BVH_NUM_BINS-1 : bin);
+}
+
+static void ClearRangeInfo( IGLUBVHRangeInfo &info, bool binning )
+{
+	if (!binning)
+	{
+		EmptyBox( info.bMin, info.bMax );
+		EmptyBox( info.cMin, info.cMax );
+		return;
+	}
+	for (int a=0; a<3; a++)
+		for (int i=0; i<IGLU_BVH_NUM_BINS; i++)
+		{
+			EmptyBox( info.bins[a][i].bMin, info.bins[a][i].bMax );
+			info.bins[a][i].count = 0;
+		}
+}
+
+// Computes the bounds (or, when binning, the bins) of one chunk of a range
+static void ComputeRangeChunk( int chunkIdx, void *data )
+{
+	IGLUBVHRangeJob *job = (IGLUBVHRangeJob *)data;
+	IGLUBVHRangeInfo &info = job->chunks[chunkIdx];
+	const IGLUBVHBuilder *b = job->builder;
+	uint start = job->first + uint(chunkIdx) * job->chunkSize;
+	uint end   = std::min( start + job->chunkSize, job->first + job->count );
+
+	ClearRangeInfo( info, job->binning );
+	for (uint i=start; i<end; i++)
+	{
+		const float *tb = b->triBounds + 6*size_t( b->refs[i] );
+		const float *c  = b->centroids + 3*size_t( b->refs[i] );
+		if (!job->binning)
+		{
+			GrowBox( info.bMin, info.bMax, tb, tb+3 );
+			GrowBox( info.cMin, info.cMax, c, c );
+			continue;
+		}
+		for (int a=0; a<3; a++)
+		{
+			IGLUBVHBin &bin = info.bins[a][ GetBinIndex( c[a], job->cMin[a], job->binScale[a] ) ];
+			GrowBox( bin.bMin, bin.bMax, tb, tb+3 );
+			bin.count++;
+		}
+	}
+}
+
+// Computes the bounds (or bins) of builder refs[first .. first+count-1], on numThreads threads
+static void ComputeRangeInfo( const IGLUBVHBuilder &b, uint first, uint count, int numThreads,
+	                          bool binning, IGLUBVHRangeInfo &result )
+{
+	IGLUBVHRangeJob job;
+	job.builder = &b;
+	job.first   = first;
+	job.count   = count;
+	job.binning = binning;
+	for (int a=0; a<3; a++)
+	{
+		// (Binning uses the centroid bounds found by an earlier call)
+		float extent    = binning ? result.cMax[a] - result.cMin[a] : 0.0f;
+		job.cMin[a]     = binning ? result.cMin[a] : 0.0f;
+		job.binScale[a] = (extent > 0) ? IGLU_BVH_NUM_BINS / extent : 0.0f;
+	}
+
+	// Small ranges aren't worth the threads
+	if (numThreads <= 1 || count <= IGLU_BVH_PARALLEL_BINS)
+	{
+		job.chunkSize = count;
+		job.chunks    = &result;
+		ComputeRangeChunk( 0, &job );
+		return;
+	}
+
+	uint numChunks = 4 * uint(numThreads);
+	job.chunkSize  = (count + numChunks - 1) / numChunks;
+	numChunks      = (count + job.chunkSize - 1) / job.chunkSize;
+	std::vector<IGLUBVHRangeInfo> chunks( numChunks );
+	job.chunks     = &chunks[0];
+	IGLUParallel::For( int(numChunks), ComputeRangeChunk, &job, numThreads );
+
+	// Merge the chunks
+	ClearRangeInfo( result, binning );
+	for (uint i=0; i<numChunks; i++)
+	{
+		if (!binning)
+		{
+			GrowBox( result.bMin, result.bMax, chunks[i].bMin, chunks[i].bMax );
+			GrowBox( result.cMin, result.cMax, chunks[i].cMin, chunks[i].cMax );
+			continue;
+		}
+		for (int a=0; a<3; a++)
+			for (int j=0; j<IGLU_BVH_NUM_BINS; j++)
+			{
+				IGLUBVHBin &bin = result.bins[a][j];
+				GrowBox( bin.bMin, bin.bMax, chunks[i].bins[a][j].bMin, chunks[i].bins[a][j].bMax );
+				bin.count += chunks[i].bins[a][j].count;
+			}
+	}
+}
+
+// Orders triangle refs by their centroids along one axis
+struct IGLUBVHCentroidLess
+{
+	const float *centroids;
+	int          axis;
+	bool operator()( uint a, uint b ) const    { return centroids[3*size_t(a)+axis] < centroids[3*size_t(b)+axis]; }
+};
+
+// Is a triangle ref's centroid in one of bins 0..splitBin?
+struct IGLUBVHInLeftBins
+{
+	const float *centroids;
+	int          axis, splitBin;
+	float        cMin, binScale;
+	bool operator()( uint ref ) const
+	{
+		return GetBinIndex( centroids[3*size_t(ref)+axis], cMin, binScale ) <= splitBin;
+	}
+};
+
+// Splits the range at the median centroid along its widest centroid axis
+static uint SplitAtMedian( IGLUBVHBuilder &b, uint first, uint count, const IGLUBVHRangeInfo &info )
+{
+	int axis = 0;
+	for (int a=1; a<3; a++)
+		if (info.cMax[a]-info.cMin[a] > info.cMax[axis]-info.cMin[axis]) axis = a;
+	IGLUBVHCentroidLess less = { b.centroids, axis };
+	std::nth_element( b.refs + first, b.refs + first + count/2, b.refs + first + count, less );
+	return first + count/2;
+}
+
+// Decides whether (and where) to split a range.  Partitions refs and returns the first ref of
+//    the right half, or returns first if the range should be a leaf.
+static uint SplitRange( IGLUBVHBuilder &b, uint first, uint count, uint depth, int numThreads, IGLUBVHRangeInfo &info )
+{
+	if (count <= 1) return first;
+
+	// If all the centroids are in one spot, or we're too deep, we can't (or won't) split by SAH
+	bool canBin = false;
+	for (int a=0; a<3; a++)
+		canBin = canBin || (info.cMax[a] > info.cMin[a]);
+	if (!canBin || depth >= IGLU_BVH_MAX_SAH_DEPTH)
+		return count <= IGLU_BVH_MAX_LEAF_SIZE ? first : SplitAtMedian( b, first, count, info );
+
+	// Find the cheapest split between bins, sweeping from both ends
+	ComputeRangeInfo( b, first, count, numThreads, true, info );
+	float bestCost = FLT_MAX;
+	int   bestAxis = -1, bestBin = 0;
+	for (int a=0; a<3; a++)
+	{
+		if (info.cMax[a] <= info.cMin[a]) continue;
+
+		float rightArea[IGLU_BVH_NUM_BINS];
+		uint  rightCount[IGLU_BVH_NUM_BINS];
+		float bMin[3], bMax[3];
+		uint  n = 0;
+		EmptyBox( bMin, bMax );
+		for (int i=IGLU_BVH_NUM_BINS-1; i>0; i--)
+		{
+			GrowBox( bMin, bMax, info.bins[a][i].bMin, info.bins[a][i].bMax );
+			n += info.bins[a][i].count;
+			rightArea[i]  = BoxArea( bMin, bMax );
+			rightCount[i] = n;
+		}
+
+		EmptyBox( bMin, bMax );
+		n = 0;
+		for (int i=0; i<IGLU_BVH_NUM_BINS-1; i++)
+		{
+			GrowBox( bMin, bMax, info.bins[a][i].bMin, info.bins[a][i].bMax );
+			n += info.bins[a][i].count;
+			if (n == 0 || rightCount[i+1] == 0) continue;
+			float cost = BoxArea( bMin, bMax ) * n + rightArea[i+1] * rightCount[i+1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = a;
+				bestBin  = i;
+			}
+		}
+	}
+
+	// Is splitting better than making a leaf?
+	float area = BoxArea( info.bMin, info.bMax );
+	if (bestAxis < 0)
+		return count <= IGLU_BVH_MAX_LEAF_SIZE ? first : SplitAtMedian( b, first, count, info );
+	float splitCost = IGLU_BVH_TRAVERSAL_COST + (area > 0 ? bestCost / area : 0.0f);
+	if (count <= IGLU_BVH_MAX_LEAF_SIZE && float(count) <= splitCost)
+		return first;
+
+	IGLUBVHInLeftBins inLeft = { b.centroids, bestAxis, bestBin, info.cMin[bestAxis],
+		                         IGLU_BVH_NUM_BINS / (info.cMax[bestAxis] - info.cMin[bestAxis]) };
+	uint mid = uint( std::partition( b.refs + first, b.refs + first + count, inLeft ) - b.refs );
+	return (mid > first && mid < first + count) ? mid : SplitAtMedian( b, first, count, info );
+}
+
+// Builds the subtree over refs[first .. first+count-1] into nodes[nodeIdx] and nodes appended
+//    after it.  When deferSmall is set (only on the top-level, single-threaded pass), small
+//    subtrees are left as placeholders and queued in b.tasks.
+static void BuildNode( IGLUBVHBuilder &b, std::vector<IGLUBVHBuildNode> &nodes, uint nodeIdx,
+	                   uint first, uint count, uint depth, bool deferSmall )
+{
+	int numThreads = deferSmall ? b.numThreads : 1;
+
+	IGLUBVHRangeInfo info;
+	ComputeRangeInfo( b, first, count, numThreads, false, info );
+	IGLUBVHBuildNode &node = nodes[nodeIdx];
+	for (int a=0; a<3; a++)
+	{
+		node.bMin[a] = info.bMin[a];
+		node.bMax[a] = info.bMax[a];
+	}
+	node.left  = node.right = 0;
+	node.first = first;
+	node.count = count;
+
+	if (deferSmall && count <= b.taskSize)
+	{
+		IGLUBVHBuildTask task;
+		task.nodeIdx = nodeIdx;
+		task.first   = first;
+		task.count   = count;
+		task.depth   = depth;
+		b.tasks.push_back( task );
+		return;
+	}
+
+	uint mid = SplitRange( b, first, count, depth, numThreads, info );
+	if (mid == first) return;
+
+	// (Appending may move nodes[], so we don't use node after this)
+	uint left = uint( nodes.size() );
+	nodes.resize( left + 2 );
+	nodes[nodeIdx].left  = left;
+	nodes[nodeIdx].right = left + 1;
+	nodes[nodeIdx].count = 0;
+	BuildNode( b, nodes, left,   first, mid - first,         depth+1, deferSmall );
+	BuildNode( b, nodes, left+1, mid,   first + count - mid, depth+1, deferSmall );
+}
+
+// Called by IGLUParallel::For() to build one of the subtrees the top-level pass left
+static void BuildTaskCallback( int taskIdx, void *data )
+{
+	IGLUBVHBuilder *b = (IGLUBVHBuilder *)data;
+	IGLUBVHBuildTask &task = b->tasks[taskIdx];
+	task.nodes.resize( 1 );
+	BuildNode( *b, task.nodes, 0, task.first, task.count, task.depth, false );
+}
+
+// Converts the binary subtree at bin[binIdx] into 4-wide nodes, appended to out[] (parents
+//    before children).  Each node takes the four largest descendants of its binary node
+//    (or fewer, if it runs out of inner nodes to open).  Only the structure is set up here;
+//    the bounds are filled in afterwards by refitting.
+static uint CollapseNode( const std::vector<IGLUBVHBuildNode> &bin, uint binIdx, std::vector<IGLUBVHNode> &out )
+{
+	uint kids[4], numKids = 0;
+	if (bin[binIdx].count > 0)
+		kids[numKids++] = binIdx;                 // Only happens if the root is a leaf
+	else
+	{
+		kids[numKids++] = bin[binIdx].left;
+		kids[numKids++] = bin[binIdx].right;
+	}
+	while (numKids < 4)
+	{
+		int   open = -1;
+		float openArea = -1.0f;
+		for (uint i=0; i<numKids; i++)
+		{
+			const IGLUBVHBuildNode &kid = bin[ kids[i] ];
+			float area = BoxArea( kid.bMin, kid.bMax );
+			if (kid.count == 0 && area > openArea)
+			{
+				open     = int(i);
+				openArea = area;
+			}
+		}
+		if (open < 0) break;
+		uint opened = kids[open];
+		kids[open] = bin[opened].left;
+		kids[numKids++] = bin[opened].right;
+	}
+
+	uint outIdx = uint( out.size() );
+	IGLUBVHNode empty;
+	memset( &empty, 0, sizeof( empty ) );
+	out.push_back( empty );
+	for (uint i=0; i<numKids; i++)
+	{
+		const IGLUBVHBuildNode &kid = bin[ kids[i] ];
+		uint child = (kid.count > 0) ? kid.first : CollapseNode( bin, kids[i], out );
+		out[outIdx].child[i] = child;
+		out[outIdx].count[i] = kid.count;
+	}
+	return outIdx;
+}
+
+// Tests a ray against all four of a node's children.  Returns a bit mask of the children
+//    hit (within [tMin, tMax]), and the distance at which the ray enters each.
+static inline int IntersectNodeChildren( const IGLUBVHNode &node, const IGLUBVHRayData &r,
+	                                     float tMin, float tMax, float tEnter[4] )
+{
+#ifdef IGLU_BVH_USE_SSE
+	__m128 tNear = _mm_set1_ps( tMin );
+	__m128 tFar  = _mm_set1_ps( tMax );
+	for (int a=0; a<3; a++)
+	{
+		__m128 org    = _mm_set1_ps( r.org[a] );
+		__m128 invDir = _mm_set1_ps( r.invDir[a] );
+		__m128 t0     = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.bounds[ r.nearIdx[a] ] ), org ), invDir );
+		__m128 t1     = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.bounds[ r.farIdx[a] ] ), org ), invDir );
+		tNear = _mm_max_ps( tNear, t0 );
+		tFar  = _mm_min_ps( tFar, t1 );
+	}
+	_mm_storeu_ps( tEnter, tNear );
+	return _mm_movemask_ps( _mm_cmple_ps( tNear, tFar ) );
+#else
+	int mask = 0;
+	for (int i=0; i<4; i++)
+	{
+		float tNear = tMin, tFar = tMax;
+		for (int a=0; a<3; a++)
+		{
+			tNear = std::max( tNear, (node.bounds[ r.nearIdx[a] ][i] - r.org[a]) * r.invDir[a] );
+			tFar  = std::min( tFar,  (node.bounds[ r.farIdx[a] ][i]  - r.org[a]) * r.invDir[a] );
+		}
+		tEnter[i] = tNear;
+		if (tNear <= tFar) mask |= (1 << i);
+	}
+	return mask;
+#endif
+}
+
+// Moller-Trumbore ray-triangle intersection.  v[] is the three vertices, 3 floats each.
+static inline bool IntersectTriangle( const float *v, const IGLUBVHRayData &r, float tMin, float tMax,
+	                                  float *t, float *u, float *w )
+{
+	float e1[3] = { v[3]-v[0], v[4]-v[1], v[5]-v[2] };
+	float e2[3] = { v[6]-v[0], v[7]-v[1], v[8]-v[2] };
+	float p[3]  = { r.dir[1]*e2[2] - r.dir[2]*e2[1], r.dir[2]*e2[0] - r.dir[0]*e2[2], r.dir[0]*e2[1] - r.dir[1]*e2[0] };
+	float det   = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+	if (det == 0.0f) return false;
+	float invDet = 1.0f / det;
+
+	float s[3] = { r.org[0]-v[0], r.org[1]-v[1], r.org[2]-v[2] };
+	float uu = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) * invDet;
+	if (uu < 0.0f || uu > 1.0f) return false;
+
+	float q[3] = { s[1]*e1[2] - s[2]*e1[1], s[2]*e1[0] - s[0]*e1[2], s[0]*e1[1] - s[1]*e1[0] };
+	float ww = (r.dir[0]*q[0] + r.dir[1]*q[1] + r.dir[2]*q[2]) * invDet;
+	if (ww < 0.0f || uu + ww > 1.0f) return false;
+
+	float tt = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) * invDet;
+	if (tt <= tMin || tt >= tMax) return false;
+	*t = tt;  *u = uu;  *w = ww;
+	return true;
+}
+
+static void SetupRay( const IGLURay &ray, IGLUBVHRayData &r )
+{
+	for (int a=0; a<3; a++)
+	{
+		float d = ray.direction[a];
+		if (fabs( d ) < 1.0e-30f) d = (d < 0.0f) ? -1.0e-30f : 1.0e-30f;
+		r.org[a]     = ray.origin[a];
+		r.dir[a]     = ray.direction[a];
+		r.invDir[a]  = 1.0f / d;
+		r.nearIdx[a] = (r.invDir[a] >= 0.0f) ? a : a+3;
+		r.farIdx[a]  = (r.invDir[a] >= 0.0f) ? a+3 : a;
+	}
+}
+
+// Called by IGLUParallel::For() to run a batch of closest-hit (or any-hit) queries
+#define IGLU_BVH_RAYS_PER_ITEM   64
+static void ClosestHitCallback( int itemIdx, void *data )
+{
+	IGLUBVHRayJob *job = (IGLUBVHRayJob *)data;
+	uint end = std::min( uint(itemIdx+1) * IGLU_BVH_RAYS_PER_ITEM, job->numRays );
+	for (uint i=uint(itemIdx) * IGLU_BVH_RAYS_PER_ITEM; i<end; i++)
+		job->bvh->IntersectClosest( job->rays[i], &job->hits[i] );
+}
+static void AnyHitCallback( int itemIdx, void *data )
+{
+	IGLUBVHRayJob *job = (IGLUBVHRayJob *)data;
+	uint end = std::min( uint(itemIdx+1) * IGLU_BVH_RAYS_PER_ITEM, job->numRays );
+	for (uint i=uint(itemIdx) * IGLU_BVH_RAYS_PER_ITEM; i<end; i++)
+		job->occluded[i] = job->bvh->IntersectAny( job->rays[i] );
+}
+
+// };  End: anonymous namespace
+
+
+IGLUBVH::IGLUBVH()
+{
+}
+
+IGLUBVH::~IGLUBVH()
+{
+}
+
+void IGLUBVH::Clear( void )
+{
+	m_nodes.clear();
+	m_triIDs.clear();
+	m_triIndices.clear();
+	m_triVerts.clear();
+	m_positions.clear();
+}
+
+void IGLUBVH::Build( const float *positions, uint posStride, uint numVerts,
+	                 const uint *indices, uint numTris, int numThreads )
+{
+	Clear();
+	if (!positions || !indices || numTris == 0 || numVerts == 0) return;
+	if (numThreads <= 0) numThreads = IGLUParallel::GetProcessorCount();
+
+	m_positions.resize( 3*size_t(numVerts) );
+	for (uint i=0; i<numVerts; i++)
+	{
+		const float *pos = (const float *)((const char *)positions + size_t(i)*posStride);
+		m_positions[3*i+0] = pos[0];
+		m_positions[3*i+1] = pos[1];
+		m_positions[3*i+2] = pos[2];
+	}
+
+	// Find each triangle's bounds and centroid (and throw out bad indices, so they can't hurt us later)
+	std::vector<uint>  triIndices( indices, indices + 3*size_t(numTris) );
+	std::vector<float> triBounds( 6*size_t(numTris) ), centroids( 3*size_t(numTris) );
+	for (uint t=0; t<numTris; t++)
+	{
+		uint *tri = &triIndices[3*t];
+		if (tri[0] >= numVerts || tri[1] >= numVerts || tri[2] >= numVerts)
+			tri[0] = tri[1] = tri[2] = 0;
+
+		float *tb = &triBounds[6*t];
+		EmptyBox( tb, tb+3 );
+		for (int k=0; k<3; k++)
+			GrowBox( tb, tb+3, &m_positions[3*tri[k]], &m_positions[3*tri[k]] );
+		for (int a=0; a<3; a++)
+			centroids[3*t+a] = 0.5f * (tb[a] + tb[a+3]);
+	}
+
+	// Build the top of the tree here, then the subtrees below it in parallel
+	m_triIDs.resize( numTris );
+	for (uint t=0; t<numTris; t++)
+		m_triIDs[t] = t;
+	IGLUBVHBuilder b;
+	b.triBounds  = &triBounds[0];
+	b.centroids  = &centroids[0];
+	b.refs       = &m_triIDs[0];
+	b.numThreads = numThreads;
+	b.taskSize   = std::max( numTris / (8*uint(numThreads)), 1024u );
+
+	std::vector<IGLUBVHBuildNode> nodes( 1 );
+	BuildNode( b, nodes, 0, 0, numTris, 0, numThreads > 1 );
+	if (!b.tasks.empty())
+	{
+		IGLUParallel::For( int(b.tasks.size()), BuildTaskCallback, &b, numThreads );
+
+		// Stitch each subtree in place of its placeholder
+		for (uint i=0; i<b.tasks.size(); i++)
+		{
+			std::vector<IGLUBVHBuildNode> &sub = b.tasks[i].nodes;
+			uint offset = uint( nodes.size() ) - 1;     // sub[k] becomes nodes[offset+k], except sub[0]
+			for (uint k=0; k<sub.size(); k++)
+			{
+				if (sub[k].count == 0)
+				{
+					sub[k].left  += offset;
+					sub[k].right += offset;
+				}
+				if (k > 0) nodes.push_back( sub[k] );
+			}
+			nodes[ b.tasks[i].nodeIdx ] = sub[0];
+			std::vector<IGLUBVHBuildNode>().swap( sub );
+		}
+	}
+
+	// Store the triangles in leaf order, and make the 4-wide tree
+	m_triIndices.resize( 3*size_t(numTris) );
+	for (uint t=0; t<numTris; t++)
+	{
+		m_triIndices[3*t+0] = triIndices[ 3*m_triIDs[t]+0 ];
+		m_triIndices[3*t+1] = triIndices[ 3*m_triIDs[t]+1 ];
+		m_triIndices[3*t+2] = triIndices[ 3*m_triIDs[t]+2 ];
+	}
+	m_nodes.reserve( nodes.size() / 2 + 1 );
+	CollapseNode( nodes, 0, m_nodes );
+	UpdateTriangleVerts( 0 );
+}
+
+bool IGLUBVH::Build( IGLUOBJReader *model, int numThreads )
+{
+	std::vector<vec3> &verts = model->GetVertecies();
+	IGLUOBJTriArray   &tris  = model->GetTriangles();
+	if (verts.empty() || tris.size() == 0)
+	{
+		printf("*** Warning: IGLUBVH::Build() given an OBJ model with no triangle data!\n");
+		Clear();
+		return false;
+	}
+
+	// Triangles with bad indices are made degenerate (and are never hit)
+	std::vector<uint> indices( 3*size_t(tris.size()) );
+	for (uint t=0; t<tris.size(); t++)
+	{
+		bool valid = true;
+		for (int k=0; k<3; k++)
+			valid = valid && tris.vIdx[3*t+k] >= 0 && uint( tris.vIdx[3*t+k] ) < verts.size();
+		for (int k=0; k<3; k++)
+			indices[3*t+k] = valid ? uint( tris.vIdx[3*t+k] ) : 0;
+	}
+
+	Build( verts[0].GetConstDataPtr(), sizeof( vec3 ), uint( verts.size() ), &indices[0], tris.size(), numThreads );
+	return true;
+}
+
+void IGLUBVH::Refit( const float *positions, uint posStride )
+{
+	if (!positions) return;
+	uint numVerts = uint( m_positions.size() / 3 );
+	for (uint i=0; i<numVerts; i++)
+	{
+		const float *pos = (const float *)((const char *)positions + size_t(i)*posStride);
+		m_positions[3*i+0] = pos[0];
+		m_positions[3*i+1] = pos[1];
+		m_positions[3*i+2] = pos[2];
+	}
+	UpdateTriangleVerts( 0 );
+}
+
+void IGLUBVH::Refit( const IGLUMatrix4x4 &xform )
+{
+	UpdateTriangleVerts( &xform );
+}
+
+void IGLUBVH::UpdateTriangleVerts( const IGLUMatrix4x4 *xform )
+{
+	m_triVerts.resize( 3*m_triIndices.size() );
+	for (size_t i=0; i<m_triIndices.size(); i++)
+	{
+		const float *pos = &m_positions[ 3*size_t(m_triIndices[i]) ];
+		float *vert = &m_triVerts[3*i];
+		if (!xform)
+		{
+			vert[0] = pos[0];  vert[1] = pos[1];  vert[2] = pos[2];
+			continue;
+		}
+		vec4 xformed = (*xform) * vec4( pos[0], pos[1], pos[2], 1.0f );
+		float invW = (xformed.W() != 0.0f) ? 1.0f / xformed.W() : 1.0f;
+		vert[0] = xformed.X() * invW;
+		vert[1] = xformed.Y() * invW;
+		vert[2] = xformed.Z() * invW;
+	}
+	RefitNodes();
+}
+
+void IGLUBVH::RefitNodes( void )
+{
+	// Children always come after their parents, so walking backwards handles children first
+	for (size_t n=m_nodes.size(); n>0; n--)
+	{
+		IGLUBVHNode &node = m_nodes[n-1];
+		for (int i=0; i<4; i++)
+		{
+			float bMin[3], bMax[3];
+			EmptyBox( bMin, bMax );
+			if (node.count[i] > 0)
+			{
+				const float *vert = &m_triVerts[ 9*size_t(node.child[i]) ];
+				for (uint k=0; k<3*node.count[i]; k++, vert += 3)
+					GrowBox( bMin, bMax, vert, vert );
+			}
+			else if (node.child[i] > 0)
+			{
+				const IGLUBVHNode &child = m_nodes[ node.child[i] ];
+				for (int j=0; j<4; j++)
+				{
+					float cMin[3] = { child.bounds[0][j], child.bounds[1][j], child.bounds[2][j] };
+					float cMax[3] = { child.bounds[3][j], child.bounds[4][j], child.bounds[5][j] };
+					GrowBox( bMin, bMax, cMin, cMax );
+				}
+			}
+			for (int a=0; a<3; a++)
+			{
+				node.bounds[a][i]   = bMin[a];
+				node.bounds[a+3][i] = bMax[a];
+			}
+		}
+	}
+}
+
+void IGLUBVH::GetBounds( float bMin[3], float bMax[3] ) const
+{
+	EmptyBox( bMin, bMax );
+	if (m_nodes.empty()) return;
+	for (int i=0; i<4; i++)
+	{
+		float cMin[3] = { m_nodes[0].bounds[0][i], m_nodes[0].bounds[1][i], m_nodes[0].bounds[2][i] };
+		float cMax[3] = { m_nodes[0].bounds[3][i], m_nodes[0].bounds[4][i], m_nodes[0].bounds[5][i] };
+		GrowBox( bMin, bMax, cMin, cMax );
+	}
+}
+
+bool IGLUBVH::IntersectClosest( const IGLURay &ray, IGLURayHit *hit ) const
+{
+	hit->t     = ray.tMax;
+	hit->u     = hit->v = 0.0f;
+	hit->triID = IGLU_BVH_NO_HIT;
+	if (m_nodes.empty()) return false;
+
+	IGLUBVHRayData r;
+	SetupRay( ray, r );
+
+	// The stack holds nodes to visit, and where the ray enters them (so we can skip those
+	//    beyond the closest hit found since they were pushed)
+	uint  stack[IGLU_BVH_STACK_SIZE];
+	float stackT[IGLU_BVH_STACK_SIZE];
+	int   sp = 0;
+	stack[sp] = 0;  stackT[sp++] = ray.tMin;
+	while (sp > 0)
+	{
+		sp--;
+		if (stackT[sp] > hit->t) continue;
+		const IGLUBVHNode &node = m_nodes[ stack[sp] ];
+
+		float tEnter[4];
+		int mask = IntersectNodeChildren( node, r, ray.tMin, hit->t, tEnter );
+
+		// Test leaves right away (shortening the ray), and push inner children far-to-near
+		int inner[4], numInner = 0;
+		for (int i=0; i<4; i++)
+		{
+			if (!(mask & (1 << i))) continue;
+			if (node.count[i] == 0)
+			{
+				int j = numInner++;
+				for ( ; j > 0 && tEnter[ inner[j-1] ] < tEnter[i]; j-- )
+					inner[j] = inner[j-1];
+				inner[j] = i;
+				continue;
+			}
+			for (uint k=node.child[i]; k<node.child[i]+node.count[i]; k++)
+			{
+				float t, u, v;
+				if (IntersectTriangle( &m_triVerts[9*size_t(k)], r, ray.tMin, hit->t, &t, &u, &v ))
+				{
+					hit->t = t;  hit->u = u;  hit->v = v;
+					hit->triID = m_triIDs[k];
+				}
+			}
+		}
+		for (int j=0; j<numInner; j++)
+		{
+			stack[sp]  = node.child[ inner[j] ];
+			stackT[sp] = tEnter[ inner[j] ];
+			sp++;
+		}
+	}
+	return hit->triID != IGLU_BVH_NO_HIT;
+}
+
+bool IGLUBVH::IntersectAny( const IGLURay &ray ) const
+{
+	if (m_nodes.empty()) return false;
+
+	IGLUBVHRayData r;
+	SetupRay( ray, r );
+
+	uint stack[IGLU_BVH_STACK_SIZE];
+	int  sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0)
+	{
+		const IGLUBVHNode &node = m_nodes[ stack[--sp] ];
+
+		float tEnter[4];
+		int mask = IntersectNodeChildren( node, r, ray.tMin, ray.tMax, tEnter );
+		for (int i=0; i<4; i++)
+		{
+			if (!(mask & (1 << i))) continue;
+			if (node.count[i] == 0)
+			{
+				stack[sp++] = node.child[i];
+				continue;
+			}
+			for (uint k=node.child[i]; k<node.child[i]+node.count[i]; k++)
+			{
+				float t, u, v;
+				if (IntersectTriangle( &m_triVerts[9*size_t(k)], r, ray.tMin, ray.tMax, &t, &u, &v ))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void IGLUBVH::IntersectClosest( const IGLURay *rays, IGLURayHit *hits, uint numRays, int numThreads ) const
+{
+	IGLUBVHRayJob job = { this, rays, hits, 0, numRays };
+	int numItems = int( (numRays + IGLU_BVH_RAYS_PER_ITEM - 1) / IGLU_BVH_RAYS_PER_ITEM );
+	IGLUParallel::For( numItems, ClosestHitCallback, &job, numThreads );
+}
+
+void IGLUBVH::IntersectAny( const IGLURay *rays, bool *occluded, uint numRays, int numThreads ) const
+{
+	IGLUBVHRayJob job = { this, rays, 0, occluded, numRays };
+	int numItems = int( (numRays + IGLU_BVH_RAYS_PER_ITEM - 1) / IGLU_BVH_RAYS_PER_ITEM );
+	IGLUParallel::For( numItems, AnyHitCallback, &job, numThreads );
+}
+
+bool IGLUBVH::Validate( void ) const
+{
+	const float eps = 1.0e-5f;
+	std::vector<unsigned char> seen( m_triIDs.size(), 0 );
+	for (size_t n=0; n<m_nodes.size(); n++)
+	{
+		const IGLUBVHNode &node = m_nodes[n];
+		for (int i=0; i<4; i++)
+		{
+			float bMin[3] = { node.bounds[0][i], node.bounds[1][i], node.bounds[2][i] };
+			float bMax[3] = { node.bounds[3][i], node.bounds[4][i], node.bounds[5][i] };
+			float tol[3];
+			for (int a=0; a<3; a++)
+				tol[a] = eps * (1.0f + std::max( fabs( bMin[a] ), fabs( bMax[a] ) ));
+
+			if (node.count[i] > 0)
+			{
+				for (uint k=node.child[i]; k<node.child[i]+node.count[i]; k++)
+				{
+					if (k >= seen.size() || seen[k]++)
+					{
+						printf("*** Warning: IGLUBVH::Validate() found triangle %u in more than one leaf!\n", k);
+						return false;
+					}
+					for (int v=0; v<3; v++)
+						for (int a=0; a<3; a++)
+						{
+							float x = m_triVerts[9*size_t(k)+3*v+a];
+							if (x < bMin[a]-tol[a] || x > bMax[a]+tol[a])
+							{
+								printf("*** Warning: IGLUBVH::Validate() found triangle %u outside its leaf!\n", k);
+								return false;
+							}
+						}
+				}
+			}
+			else if (node.child[i] > 0)
+			{
+				if (node.child[i] <= n || node.child[i] >= m_nodes.size())
+				{
+					printf("*** Warning: IGLUBVH::Validate() found a bad child index in node %u!\n", uint(n));
+					return false;
+				}
+				const IGLUBVHNode &child = m_nodes[ node.child[i] ];
+				for (int j=0; j<4; j++)
+					for (int a=0; a<3; a++)
+						if (child.bounds[a][j] <= child.bounds[a+3][j] &&
+							(child.bounds[a][j] < bMin[a]-tol[a] || child.bounds[a+3][j] > bMax[a]+tol[a]))
+						{
+							printf("*** Warning: IGLUBVH::Validate() found node %u outside its parent!\n", node.child[i]);
+							return false;
+						}
+			}
+		}
+	}
+
+	for (size_t k=0; k<seen.size(); k++)
+		if (!seen[k])
+		{
+			printf("*** Warning: IGLUBVH::Validate() found triangle %u in no leaf!\n", uint(k));
+			return false;
+		}
+	return true;
+}
@@ -0,0 +1,499 @@
+/******************************************************************/
+/* igluMeshOptimizer.cpp                                          */
+/* -----------------------                                        */
+/*                                                                */
+/* CPU-side vertex cache, overdraw, and vertex fetch reordering   */
+/*    for indexed triangle meshes, plus triangle clustering.      */
+/*                                                                */
+/* The vertex cache & overdraw passes follow:                     */
+/*    P. Sander, D. Nehab, and J. Barczak, "Fast Triangle         */
+/*    Reordering for Vertex Locality and Reduced Overdraw,"       */
+/*    ACM Transactions on Graphics 26(3), 2007.                   */
+/******************************************************************/
+
+#include "iglu.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace iglu;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// Vertex -> triangle adjacency, stored compactly.  Triangles using vertex v are
+//    triList[ offset[v] .. offset[v+1]-1 ].
+struct IGLUMeshAdjacency
+{
+	uint *offset, *triList;
+
+	IGLUMeshAdjacency( const uint *indices, uint numIndices, uint numVerts )
+	{
+		offset  = (uint *)calloc( numVerts+1, sizeof( uint ) );
+		triList = (uint *)malloc( (numIndices > 0 ? numIndices : 1) * sizeof( uint ) );
+		assert( offset && triList );
+		for (uint i=0; i<numIndices; i++)
+			offset[ indices[i]+1 ]++;
+		for (uint v=0; v<numVerts; v++)
+			offset[v+1] += offset[v];
+
+		// Fill in the lists, using offset[v] as a cursor (then shift back afterwards)
+		for (uint i=0; i<numIndices; i++)
+			triList[ offset[ indices[i] ]++ ] = i/3;
+		for (uint v=numVerts; v>0; v--)
+			offset[v] = offset[v-1];
+		offset[0] = 0;
+	}
+	~IGLUMeshAdjacency() { free( offset ); free( triList ); }
+};
+
+// Gets vertex v's position from an array of positions with the given byte stride
+static inline const float *IGLUVertexPosition( const float *positions, uint posStride, uint v )
+{
+	return (const float *)((const char *)positions + size_t(v)*posStride);
+}
+
+// Computes the bounding box, bounding sphere, and normal cone of the triangles
+//    indices[ cluster.firstIndex .. cluster.firstIndex+cluster.indexCount-1 ]
+static void ComputeClusterBounds( IGLUMeshCluster &cluster, const uint *indices,
+								  const float *positions, uint posStride )
+{
+	const uint *clusterIdx = indices + cluster.firstIndex;
+	uint numTris = cluster.indexCount / 3;
+
+	// Bounding box
+	for (int k=0; k<3; k++)
+	{
+		cluster.aabbMin[k] =  FLT_MAX;
+		cluster.aabbMax[k] = -FLT_MAX;
+	}
+	for (uint i=0; i<cluster.indexCount; i++)
+	{
+		const float *p = IGLUVertexPosition( positions, posStride, clusterIdx[i] );
+		for (int k=0; k<3; k++)
+		{
+			cluster.aabbMin[k] = p[k] < cluster.aabbMin[k] ? p[k] : cluster.aabbMin[k];
+			cluster.aabbMax[k] = p[k] > cluster.aabbMax[k] ? p[k] : cluster.aabbMax[k];
+		}
+	}
+
+	// Bounding sphere, centered in the box
+	float radiusSqr = 0;
+	for (int k=0; k<3; k++)
+		cluster.sphereCenter[k] = 0.5f * (cluster.aabbMin[k] + cluster.aabbMax[k]);
+	for (uint i=0; i<cluster.indexCount; i++)
+	{
+		const float *p = IGLUVertexPosition( positions, posStride, clusterIdx[i] );
+		float dx = p[0]-cluster.sphereCenter[0], dy = p[1]-cluster.sphereCenter[1], dz = p[2]-cluster.sphereCenter[2];
+		float distSqr = dx*dx + dy*dy + dz*dz;
+		radiusSqr = distSqr > radiusSqr ? distSqr : radiusSqr;
+	}
+	cluster.sphereRadius = sqrtf( radiusSqr );
+
+	// Normal cone:  the axis is the average facet normal, and the cone must include
+	//    every (non-degenerate) facet normal.
+	std::vector<float> triNorms( 3*numTris );
+	float axis[3] = { 0, 0, 0 };
+	uint numValid = 0;
+	for (uint t=0; t<numTris; t++)
+	{
+		const float *p0 = IGLUVertexPosition( positions, posStride, clusterIdx[3*t+0] );
+		const float *p1 = IGLUVertexPosition( positions, posStride, clusterIdx[3*t+1] );
+		const float *p2 = IGLUVertexPosition( positions, posStride, clusterIdx[3*t+2] );
+		float e1[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+		float e2[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+		float n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+		float len   = sqrtf( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+		if (len <= 0) continue;
+		for (int k=0; k<3; k++)
+		{
+			triNorms[3*numValid+k] = n[k] / len;
+			axis[k] += n[k] / len;
+		}
+		numValid++;
+	}
+
+	float axisLen = sqrtf( axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2] );
+	float minDot  = 1.0f;
+	for (int k=0; k<3; k++)
+		cluster.coneAxis[k] = axisLen > 0 ? axis[k] / axisLen : 0.0f;
+	for (uint t=0; t<numValid; t++)
+	{
+		float d = triNorms[3*t+0]*cluster.coneAxis[0] + triNorms[3*t+1]*cluster.coneAxis[1] + triNorms[3*t+2]*cluster.coneAxis[2];
+		minDot = d < minDot ? d : minDot;
+	}
+
+	// If the normals span a hemisphere (or more), or there are none, we can't cull.
+	cluster.coneCutoff = (axisLen <= 0 || minDot <= 0) ? 1.0f : sqrtf( 1.0f - minDot*minDot );
+}
+
+// Used to sort overdraw clusters from most to least likely to occlude the rest of the mesh
+struct IGLUClusterSortLess
+{
+	const float *sortKey;
+	IGLUClusterSortLess( const float *key ) : sortKey( key ) {}
+	bool operator()( uint a, uint b ) const { return sortKey[a] > sortKey[b]; }
+};
+
+// Splits the (already Tipsify-ordered) triangles into clusters and sorts those clusters
+//    so that the outward facing parts of the mesh get drawn first.  Clusters start at each
+//    of Tipsify's hard boundaries (where it had to jump to an unconnected vertex), plus
+//    wherever a freshly started cluster's ACMR has already dropped below threshold times
+//    the overall ACMR (since restarting there costs little cache efficiency).
+static void SortClustersForOverdraw( uint *indices, uint numTris, uint numVerts, uint cacheSize,
+									 const std::vector<uint> &hardBoundaries,
+									 const float *positions, uint posStride, float threshold )
+{
+	if (numTris == 0) return;
+	IGLUVertexCacheStats stats = IGLUMeshOptimizer::AnalyzeVertexCache( indices, 3*numTris, numVerts, cacheSize );
+	float targetACMR = stats.acmr * threshold;
+
+	// Find the cluster boundaries by simulating the cache, restarting it for each cluster
+	std::vector<uint> clusterStart;
+	uint *cacheTime = (uint *)calloc( numVerts, sizeof( uint ) );
+	uint time = cacheSize+1, misses = 0, nextHard = 0;
+	for (uint t=0; t<numTris; t++)
+	{
+		bool hardStart = (nextHard < hardBoundaries.size() && hardBoundaries[nextHard] == t);
+		bool softStart = (!clusterStart.empty() && t > clusterStart.back() &&
+		                  float(misses) <= targetACMR * float(t - clusterStart.back()));
+		if (hardStart) nextHard++;
+		if (t == 0 || hardStart || softStart)
+		{
+			clusterStart.push_back( t );
+			time  += cacheSize+1;   // Everything is now out of the cache.
+			misses = 0;
+		}
+		for (int k=0; k<3; k++)
+		{
+			uint v = indices[3*t+k];
+			if (time - cacheTime[v] > cacheSize)
+			{
+				cacheTime[v] = time++;
+				misses++;
+			}
+		}
+	}
+	free( cacheTime );
+	uint numClusters = uint( clusterStart.size() );
+	clusterStart.push_back( numTris );
+
+	// Compute the mesh centroid, and each cluster's centroid & area-weighted normal
+	std::vector<float> clusterCtr( 3*numClusters, 0.0f ), clusterNorm( 3*numClusters, 0.0f );
+	double meshCtr[3] = { 0, 0, 0 };
+	for (uint c=0; c<numClusters; c++)
+	{
+		for (uint t=clusterStart[c]; t<clusterStart[c+1]; t++)
+		{
+			const float *p0 = IGLUVertexPosition( positions, posStride, indices[3*t+0] );
+			const float *p1 = IGLUVertexPosition( positions, posStride, indices[3*t+1] );
+			const float *p2 = IGLUVertexPosition( positions, posStride, indices[3*t+2] );
+			float e1[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+			float e2[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+			clusterNorm[3*c+0] += e1[1]*e2[2] - e1[2]*e2[1];
+			clusterNorm[3*c+1] += e1[2]*e2[0] - e1[0]*e2[2];
+			clusterNorm[3*c+2] += e1[0]*e2[1] - e1[1]*e2[0];
+			for (int k=0; k<3; k++)
+			{
+				float ctr = (p0[k] + p1[k] + p2[k]) / 3.0f;
+				clusterCtr[3*c+k] += ctr;
+				meshCtr[k] += ctr;
+			}
+		}
+		uint clusterTris = clusterStart[c+1] - clusterStart[c];
+		for (int k=0; k<3; k++)
+			clusterCtr[3*c+k] /= float(clusterTris);
+	}
+	for (int k=0; k<3; k++)
+		meshCtr[k] /= double(numTris);
+
+	// Clusters whose normals point away from the mesh center are more likely to occlude
+	//    other parts of the mesh, so they should be drawn first.
+	std::vector<float> sortKey( numClusters );
+	std::vector<uint>  order( numClusters );
+	for (uint c=0; c<numClusters; c++)
+	{
+		sortKey[c] = float( (clusterCtr[3*c+0]-meshCtr[0]) * clusterNorm[3*c+0] +
+			                (clusterCtr[3*c+1]-meshCtr[1]) * clusterNorm[3*c+1] +
+							(clusterCtr[3*c+2]-meshCtr[2]) * clusterNorm[3*c+2] );
+		order[c] = c;
+	}
+	std::stable_sort( order.begin(), order.end(), IGLUClusterSortLess( &sortKey[0] ) );
+
+	// Copy the triangles out in sorted cluster order
+	uint *sorted = (uint *)malloc( 3 * numTris * sizeof( uint ) );
+	assert( sorted );
+	for (uint c=0, outIdx=0; c<numClusters; c++)
+	{
+		uint first = clusterStart[order[c]], count = clusterStart[order[c]+1] - first;
+		memcpy( &sorted[outIdx], &indices[3*first], 3 * count * sizeof( uint ) );
+		outIdx += 3*count;
+	}
+	memcpy( indices, sorted, 3 * numTris * sizeof( uint ) );
+	free( sorted );
+}
+
+// };  End: anonymous namespace
+
+
+void IGLUMeshOptimizer::OptimizeVertexCache( uint *indices, uint numIndices, uint numVerts, uint cacheSize,
+											 const float *positions, uint posStride, float overdrawThreshold )
+{
+	uint numTris = numIndices / 3;
+	if (numTris == 0 || numVerts == 0) return;
+
+	IGLUMeshAdjacency adj( indices, 3*numTris, numVerts );
+
+	// Per-vertex state:  the number of unemitted triangles using it (its "liveness"), and
+	//    the time it last entered the (simulated) cache.
+	uint *live      = (uint *)malloc( numVerts * sizeof( uint ) );
+	uint *cacheTime = (uint *)calloc( numVerts, sizeof( uint ) );
+	bool *emitted   = (bool *)calloc( numTris, sizeof( bool ) );
+	uint *output    = (uint *)malloc( 3 * numTris * sizeof( uint ) );
+	assert( live && cacheTime && emitted && output );
+	for (uint v=0; v<numVerts; v++)
+		live[v] = adj.offset[v+1] - adj.offset[v];
+
+	// Tipsify keeps a stack of recently used vertices to restart from at dead ends, and
+	//    remembers where it had to jump to an unconnected part of the mesh (for overdraw sorting)
+	std::vector<uint> deadEnd, candidates, hardBoundaries;
+	deadEnd.reserve( 3*numTris );
+	uint time = cacheSize+1, cursor = 0, numOutput = 0;
+	int  fanVert = 0;
+	while (live[fanVert] == 0 && ++fanVert < int(numVerts)) ;   // Find the first used vertex
+	cursor = fanVert;
+
+	while (fanVert >= 0 && fanVert < int(numVerts))
+	{
+		// Emit all of the remaining triangles around the current fanning vertex
+		candidates.clear();
+		for (uint i=adj.offset[fanVert]; i<adj.offset[fanVert+1]; i++)
+		{
+			uint t = adj.triList[i];
+			if (emitted[t]) continue;
+			for (int k=0; k<3; k++)
+			{
+				uint v = indices[3*t+k];
+				output[numOutput++] = v;
+				deadEnd.push_back( v );
+				candidates.push_back( v );
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = true;
+		}
+
+		// Pick the next fanning vertex:  one of the vertices we just touched that's still
+		//    going to be in the cache after emitting its remaining triangles, preferring the
+		//    one that's been in the cache longest.
+		int bestVert = -1, bestPriority = -1;
+		for (uint i=0; i<candidates.size(); i++)
+		{
+			uint v = candidates[i];
+			if (live[v] == 0) continue;
+			int priority = 0;
+			if (time - cacheTime[v] + 2*live[v] <= cacheSize)
+				priority = int(time - cacheTime[v]);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVert     = int(v);
+			}
+		}
+
+		// If none of the candidates work, we've hit a dead end.  Try recently used vertices
+		//    first, then just walk through the vertex list for anything still unemitted.
+		if (bestVert < 0)
+		{
+			while (!deadEnd.empty() && bestVert < 0)
+			{
+				uint v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0) bestVert = int(v);
+			}
+			while (bestVert < 0 && cursor < numVerts)
+			{
+				if (live[cursor] > 0)
+				{
+					bestVert = int(cursor);
+					hardBoundaries.push_back( numOutput/3 );
+				}
+				cursor++;
+			}
+		}
+		fanVert = bestVert;
+	}
+
+	// Group & sort the result to reduce overdraw, if requested
+	if (positions)
+		SortClustersForOverdraw( output, numTris, numVerts, cacheSize, hardBoundaries,
+		                         positions, posStride, overdrawThreshold < 1.0f ? 1.0f : overdrawThreshold );
+
+	memcpy( indices, output, 3 * numTris * sizeof( uint ) );
+	free( output );
+	free( emitted );
+	free( cacheTime );
+	free( live );
+}
+
+uint IGLUMeshOptimizer::OptimizeVertexFetch( uint *indices, uint numIndices, uint numVerts, uint *remap )
+{
+	memset( remap, 0xFF, numVerts * sizeof( uint ) );
+	uint numUsed = 0;
+	for (uint i=0; i<numIndices; i++)
+	{
+		uint v = indices[i];
+		if (remap[v] == 0xFFFFFFFF)
+			remap[v] = numUsed++;
+		indices[i] = remap[v];
+	}
+	return numUsed;
+}
+
+uint IGLUMeshOptimizer::OptimizeVertexFetch( uint *indices, uint numIndices, void *vertData,
+											 uint numVerts, uint vertStride )
+{
+	uint *remap = (uint *)malloc( (numVerts > 0 ? numVerts : 1) * sizeof( uint ) );
+	char *tmpData = (char *)malloc( (numVerts > 0 ? numVerts : 1) * size_t(vertStride) );
+	assert( remap && tmpData );
+
+	uint numUsed = OptimizeVertexFetch( indices, numIndices, numVerts, remap );
+	for (uint v=0; v<numVerts; v++)
+		if (remap[v] != 0xFFFFFFFF)
+			memcpy( tmpData + size_t(remap[v])*vertStride, (char *)vertData + size_t(v)*vertStride, vertStride );
+	memcpy( vertData, tmpData, size_t(numUsed)*vertStride );
+
+	free( tmpData );
+	free( remap );
+	return numUsed;
+}
+
+uint IGLUMeshOptimizer::BuildClusters( uint *indices, uint numIndices, uint numVerts,
+									   const float *positions, uint posStride, uint maxTris,
+									   std::vector<IGLUMeshCluster> &clusters )
+{
+	clusters.clear();
+	uint numTris = numIndices / 3;
+	if (numTris == 0 || numVerts == 0) return 0;
+	if (maxTris == 0) maxTris = 1;
+
+	IGLUMeshAdjacency adj( indices, 3*numTris, numVerts );
+
+	// For each triangle, whether it's been assigned to a cluster, and (for candidates of 
+	//    the current cluster) how many vertices it shares with the cluster.  For vertices, 
+	//    which cluster most recently included them.
+	bool *assigned     = (bool *)calloc( numTris, sizeof( bool ) );
+	uint *sharedVerts  = (uint *)calloc( numTris, sizeof( uint ) );
+	uint *vertCluster  = (uint *)malloc( numVerts * sizeof( uint ) );
+	uint *output       = (uint *)malloc( 3 * numTris * sizeof( uint ) );
+	assert( assigned && sharedVerts && vertCluster && output );
+	memset( vertCluster, 0xFF, numVerts * sizeof( uint ) );
+
+	std::vector<uint> candidates;
+	uint cursor = 0, numOutput = 0;
+	while (numOutput < 3*numTris)
+	{
+		IGLUMeshCluster cluster;
+		uint clusterID = uint( clusters.size() );
+		cluster.firstIndex = numOutput;
+		candidates.clear();
+
+		// Grow the cluster, one triangle at a time
+		for (uint clusterTris = 0; clusterTris < maxTris; clusterTris++)
+		{
+			// Prefer the candidate sharing the most vertices with the cluster (ties go to the 
+			//    earlier triangle, to keep the existing order as much as possible).  If there 
+			//    are no connected triangles left, take the next one in order.
+			int best = -1;
+			for (uint i=0; i<candidates.size(); )
+			{
+				uint t = candidates[i];
+				if (assigned[t]) 
+				{
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				if ( best < 0 || sharedVerts[t] > sharedVerts[best] || 
+					 (sharedVerts[t] == sharedVerts[best] && t < uint(best)) )
+					best = int(t);
+				i++;
+			}
+			if (best < 0)
+			{
+				while (cursor < numTris && assigned[cursor]) cursor++;
+				if (cursor >= numTris) break;
+				best = int(cursor);
+			}
+
+			// Add it, and make any unassigned triangles touching its new vertices candidates
+			assigned[best] = true;
+			for (int k=0; k<3; k++)
+			{
+				uint v = indices[3*best+k];
+				output[numOutput++] = v;
+				if (vertCluster[v] == clusterID) continue;
+				vertCluster[v] = clusterID;
+				for (uint j=adj.offset[v]; j<adj.offset[v+1]; j++)
+				{
+					uint t = adj.triList[j];
+					if (assigned[t]) continue;
+					if (sharedVerts[t] == 0) candidates.push_back( t );
+					sharedVerts[t]++;
+				}
+			}
+		}
+
+		// Reset the shared counts for the leftover candidates
+		for (uint i=0; i<candidates.size(); i++)
+			sharedVerts[ candidates[i] ] = 0;
+
+		cluster.indexCount = numOutput - cluster.firstIndex;
+		clusters.push_back( cluster );
+	}
+
+	memcpy( indices, output, 3 * numTris * sizeof( uint ) );
+	for (uint c=0; c<clusters.size(); c++)
+		ComputeClusterBounds( clusters[c], indices, positions, posStride );
+
+	free( output );
+	free( vertCluster );
+	free( sharedVerts );
+	free( assigned );
+	return uint( clusters.size() );
+}
+
+IGLUVertexCacheStats IGLUMeshOptimizer::AnalyzeVertexCache( const uint *indices, uint numIndices,
+														    uint numVerts, uint cacheSize )
+{
+	IGLUVertexCacheStats stats;
+	stats.numTris  = numIndices / 3;
+	stats.numVerts = 0;
+	stats.numTransformed = 0;
+
+	// A vertex is in a FIFO cache if fewer than cacheSize other vertices entered since it did
+	uint *cacheTime = (uint *)calloc( (numVerts > 0 ? numVerts : 1), sizeof( uint ) );
+	bool *used      = (bool *)calloc( (numVerts > 0 ? numVerts : 1), sizeof( bool ) );
+	uint  time      = cacheSize+1;
+	for (uint i=0; i<3*stats.numTris; i++)
+	{
+		uint v = indices[i];
+		if (time - cacheTime[v] > cacheSize)
+		{
+			cacheTime[v] = time++;
+			stats.numTransformed++;
+		}
+		if (!used[v])
+		{
+			used[v] = true;
+			stats.numVerts++;
+		}
+	}
+	free( used );
+	free( cacheTime );
+
+	stats.acmr = stats.numTris  > 0 ? float(stats.numTransformed) / float(stats.numTris) : 0.0f;
+	stats.atvr = stats.numVerts > 0 ? float(stats.numTransformed) / float(stats.numVerts) : 0.0f;
+	return stats;
+}
+
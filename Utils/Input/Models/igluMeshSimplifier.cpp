@@ -0,0 +1,409 @@
+/******************************************************************/
+/* igluMeshSimplifier.cpp                                         */
+/* -----------------------                                        */
+/*                                                                */
+/* Quadric error metric edge-collapse simplification.  Rather     */
+/*    than keeping a priority queue up to date, each pass sorts   */
+/*    all legal collapses by cost and greedily applies the        */
+/*    cheapest ones whose neighborhoods don't overlap, repeating  */
+/*    until the target size (or error) is reached.                */
+/******************************************************************/
+
+#include "iglu.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace iglu;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// How vertices (well, positions) are allowed to move
+enum { IGLU_VERT_MANIFOLD = 0,   // Interior vertex; can collapse along any edge
+       IGLU_VERT_BORDER,         // On an open border; can collapse along the border
+	   IGLU_VERT_SEAM,           // Two copies along an attribute seam; collapse along the seam
+	   IGLU_VERT_LOCKED };       // Never moves
+
+// Borders & seams get extra planes perpendicular to the surface, scaled by this, so they
+//    keep their shape.
+#define IGLU_SIMPLIFY_EDGE_WEIGHT  10.0
+
+// A symmetric 4x4 quadric (plus the total weight of the planes summed into it)
+struct IGLUQuadric
+{
+	double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33, weight;
+
+	IGLUQuadric() : a00(0), a01(0), a02(0), a03(0), a11(0), a12(0), a13(0), a22(0), a23(0), a33(0), weight(0) {}
+
+	// Adds the plane n.x + d = 0 (n normalized) with the given weight
+	void AddPlane( const double *n, double d, double w )
+	{
+		a00 += w*n[0]*n[0];  a01 += w*n[0]*n[1];  a02 += w*n[0]*n[2];  a03 += w*n[0]*d;
+		a11 += w*n[1]*n[1];  a12 += w*n[1]*n[2];  a13 += w*n[1]*d;
+		a22 += w*n[2]*n[2];  a23 += w*n[2]*d;
+		a33 += w*d*d;
+		weight += w;
+	}
+
+	void Add( const IGLUQuadric &q )
+	{
+		a00 += q.a00;  a01 += q.a01;  a02 += q.a02;  a03 += q.a03;
+		a11 += q.a11;  a12 += q.a12;  a13 += q.a13;
+		a22 += q.a22;  a23 += q.a23;  a33 += q.a33;
+		weight += q.weight;
+	}
+
+	// The (weighted average) squared distance from p to the planes
+	double Error( const float *p ) const
+	{
+		double x = p[0], y = p[1], z = p[2];
+		double err = a00*x*x + a11*y*y + a22*z*z + 2.0*(a01*x*y + a02*x*z + a12*y*z)
+			       + 2.0*(a03*x + a13*y + a23*z) + a33;
+		err = err > 0 ? err : 0;
+		return weight > 0 ? err / weight : 0;
+	}
+};
+
+// A possible collapse of position 'from' onto position 'to', found along the edge
+//    between vertices fromVert and toVert.
+struct IGLUCollapse
+{
+	uint from, to, fromVert, toVert;
+	double cost;
+	bool operator<( const IGLUCollapse &other ) const { return cost < other.cost; }
+};
+
+static inline const float *IGLUSimplifyPosition( const float *positions, uint posStride, uint v )
+{
+	return (const float *)((const char *)positions + size_t(v)*posStride);
+}
+
+static inline unsigned long long IGLUEdgeKey( uint a, uint b )
+{
+	return ((unsigned long long)a << 32) | b;
+}
+
+static inline bool IGLUHasEdge( const std::vector<unsigned long long> &edges, uint a, uint b )
+{
+	return std::binary_search( edges.begin(), edges.end(), IGLUEdgeKey( a, b ) );
+}
+
+// Builds sorted lists of the directed edges in the mesh, both between vertices and
+//    between positions (i.e., the vertices' canonical IDs)
+static void IGLUBuildEdgeLists( const uint *indices, uint numIndices, const uint *canon,
+							    std::vector<unsigned long long> &vertEdges,
+								std::vector<unsigned long long> &posEdges )
+{
+	vertEdges.resize( numIndices );
+	posEdges.resize( numIndices );
+	for (uint i=0; i<numIndices; i++)
+	{
+		uint a = indices[i], b = indices[ (i%3 == 2) ? i-2 : i+1 ];
+		vertEdges[i] = IGLUEdgeKey( a, b );
+		posEdges[i]  = IGLUEdgeKey( canon[a], canon[b] );
+	}
+	std::sort( vertEdges.begin(), vertEdges.end() );
+	std::sort( posEdges.begin(), posEdges.end() );
+}
+
+// Position -> triangle adjacency (like the vertex -> triangle adjacency used in
+//    igluMeshOptimizer.cpp, but keyed by each vertex's canonical ID)
+static void IGLUBuildPositionAdjacency( const uint *indices, uint numIndices, uint numVerts, const uint *canon,
+									    std::vector<uint> &offset, std::vector<uint> &triList )
+{
+	offset.assign( numVerts+1, 0 );
+	triList.resize( numIndices );
+	for (uint i=0; i<numIndices; i++)
+		offset[ canon[indices[i]]+1 ]++;
+	for (uint v=0; v<numVerts; v++)
+		offset[v+1] += offset[v];
+	for (uint i=0; i<numIndices; i++)
+		triList[ offset[ canon[indices[i]] ]++ ] = i/3;
+	for (uint v=numVerts; v>0; v--)
+		offset[v] = offset[v-1];
+	offset[0] = 0;
+}
+
+// Would moving position 'from' to position 'to' flip (or collapse to nothing) any
+//    triangle around 'from' that survives the collapse?
+static bool IGLUCollapseFlips( uint from, uint to, const uint *indices, const uint *canon,
+							   const std::vector<uint> &offset, const std::vector<uint> &triList,
+							   const float *positions, uint posStride )
+{
+	const float *newPos = IGLUSimplifyPosition( positions, posStride, to );
+	for (uint i=offset[from]; i<offset[from+1]; i++)
+	{
+		const uint *tri = indices + 3*triList[i];
+		uint c[3] = { canon[tri[0]], canon[tri[1]], canon[tri[2]] };
+		if (c[0] == to || c[1] == to || c[2] == to) continue;   // Removed by the collapse
+
+		const float *p[3], *q[3];
+		for (int k=0; k<3; k++)
+		{
+			p[k] = IGLUSimplifyPosition( positions, posStride, tri[k] );
+			q[k] = (c[k] == from) ? newPos : p[k];
+		}
+		double e1[3] = { p[1][0]-p[0][0], p[1][1]-p[0][1], p[1][2]-p[0][2] };
+		double e2[3] = { p[2][0]-p[0][0], p[2][1]-p[0][1], p[2][2]-p[0][2] };
+		double f1[3] = { q[1][0]-q[0][0], q[1][1]-q[0][1], q[1][2]-q[0][2] };
+		double f2[3] = { q[2][0]-q[0][0], q[2][1]-q[0][1], q[2][2]-q[0][2] };
+		double n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+		double m[3]  = { f1[1]*f2[2] - f1[2]*f2[1], f1[2]*f2[0] - f1[0]*f2[2], f1[0]*f2[1] - f1[1]*f2[0] };
+		double nLen  = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+		double mLen  = sqrt( m[0]*m[0] + m[1]*m[1] + m[2]*m[2] );
+		if (n[0]*m[0] + n[1]*m[1] + n[2]*m[2] <= 0.01 * nLen * mLen)
+			return true;
+	}
+	return false;
+}
+
+// Finds the copy of position 'to' that shares a triangle with vertex fromVert (whose
+//    position is 'from').  Returns 0xFFFFFFFF if there isn't one.
+static uint IGLUFindCollapseTarget( uint fromVert, uint from, uint to, const uint *indices, const uint *canon,
+								    const std::vector<uint> &offset, const std::vector<uint> &triList )
+{
+	for (uint i=offset[from]; i<offset[from+1]; i++)
+	{
+		const uint *tri = indices + 3*triList[i];
+		if (tri[0] != fromVert && tri[1] != fromVert && tri[2] != fromVert) continue;
+		for (int k=0; k<3; k++)
+			if (canon[tri[k]] == to) return tri[k];
+	}
+	return 0xFFFFFFFF;
+}
+
+// };  End: anonymous namespace
+
+
+uint IGLUMeshSimplifier::Simplify( uint *outIndices, const uint *indices, uint numIndices,
+								   const float *positions, uint posStride, uint numVerts,
+								   uint targetIndexCount, float maxError, float *resultError )
+{
+	if (resultError) *resultError = 0;
+	if (outIndices != indices)
+		memcpy( outIndices, indices, numIndices * sizeof( uint ) );
+	numIndices -= numIndices % 3;
+	if (numIndices <= targetIndexCount || numVerts == 0)
+		return numIndices;
+
+	// Find which vertices share a position.  canon[v] is the first vertex at v's position,
+	//    and nextCopy[] links all vertices at a position into a circular list.
+	std::vector<uint> canon( numVerts ), nextCopy( numVerts );
+	{
+		uint hashSize = 1;
+		while (hashSize < 2*numVerts) hashSize <<= 1;
+		std::vector<uint> table( hashSize, 0xFFFFFFFF );
+		for (uint v=0; v<numVerts; v++)
+		{
+			// Hash the bits of the position (adding 0 turns -0 into +0, so they hash the same)
+			const float *pos = IGLUSimplifyPosition( positions, posStride, v );
+			union { float f[3]; uint u[3]; } bits;
+			for (int k=0; k<3; k++)
+				bits.f[k] = pos[k] + 0.0f;
+			uint h = (bits.u[0] * 73856093u) ^ (bits.u[1] * 19349663u) ^ (bits.u[2] * 83492791u);
+			uint slot = h & (hashSize-1);
+			canon[v] = nextCopy[v] = v;
+			while (table[slot] != 0xFFFFFFFF)
+			{
+				const float *other = IGLUSimplifyPosition( positions, posStride, table[slot] );
+				if (other[0] == pos[0] && other[1] == pos[1] && other[2] == pos[2]) break;
+				slot = (slot+1) & (hashSize-1);
+			}
+			if (table[slot] == 0xFFFFFFFF)
+				table[slot] = v;
+			else
+			{
+				uint first = table[slot];
+				canon[v]        = first;
+				nextCopy[v]     = nextCopy[first];
+				nextCopy[first] = v;
+			}
+		}
+	}
+
+	// Remove triangles that are already degenerate, so they don't confuse the analysis
+	uint curCount = 0;
+	for (uint i=0; i<numIndices; i+=3)
+	{
+		uint c0 = canon[outIndices[i]], c1 = canon[outIndices[i+1]], c2 = canon[outIndices[i+2]];
+		if (c0 == c1 || c1 == c2 || c0 == c2) continue;
+		for (int k=0; k<3; k++)
+			outIndices[curCount+k] = outIndices[i+k];
+		curCount += 3;
+	}
+
+	// Classify each position.  An edge is "open" if no triangle uses it in the other
+	//    direction, and a "seam" if the reverse exists between positions but not vertices.
+	std::vector<unsigned long long> vertEdges, posEdges;
+	IGLUBuildEdgeLists( outIndices, curCount, &canon[0], vertEdges, posEdges );
+	std::vector<unsigned char> hasOpen( numVerts, 0 ), hasSeam( numVerts, 0 ), kind( numVerts, IGLU_VERT_LOCKED );
+	std::vector<IGLUQuadric> quadric( numVerts );
+	float minPt[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxPt[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint i=0; i<curCount; i+=3)
+	{
+		const uint *tri = outIndices + i;
+		const float *p[3];
+		for (int k=0; k<3; k++)
+		{
+			p[k] = IGLUSimplifyPosition( positions, posStride, tri[k] );
+			for (int j=0; j<3; j++)
+			{
+				minPt[j] = p[k][j] < minPt[j] ? p[k][j] : minPt[j];
+				maxPt[j] = p[k][j] > maxPt[j] ? p[k][j] : maxPt[j];
+			}
+		}
+
+		// The triangle's plane, weighted by its area
+		double e1[3] = { p[1][0]-p[0][0], p[1][1]-p[0][1], p[1][2]-p[0][2] };
+		double e2[3] = { p[2][0]-p[0][0], p[2][1]-p[0][1], p[2][2]-p[0][2] };
+		double n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+		double len   = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+		if (len <= 0) continue;
+		n[0] /= len;  n[1] /= len;  n[2] /= len;
+		IGLUQuadric triQ;
+		triQ.AddPlane( n, -(n[0]*p[0][0] + n[1]*p[0][1] + n[2]*p[0][2]), 0.5*len );
+		for (int k=0; k<3; k++)
+			quadric[ canon[tri[k]] ].Add( triQ );
+
+		// Planes along borders and seams, perpendicular to the triangle
+		for (int k=0; k<3; k++)
+		{
+			uint va = tri[k], vb = tri[(k+1)%3], a = canon[va], b = canon[vb];
+			bool open = !IGLUHasEdge( posEdges, b, a );
+			bool seam = !open && !IGLUHasEdge( vertEdges, vb, va );
+			if (!open && !seam) continue;
+			if (open) hasOpen[a] = hasOpen[b] = 1;
+			if (seam) hasSeam[a] = hasSeam[b] = 1;
+
+			const float *pa = p[k], *pb = p[(k+1)%3];
+			double e[3] = { pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2] };
+			double m[3] = { e[1]*n[2] - e[2]*n[1], e[2]*n[0] - e[0]*n[2], e[0]*n[1] - e[1]*n[0] };
+			double mLen = sqrt( m[0]*m[0] + m[1]*m[1] + m[2]*m[2] );
+			if (mLen <= 0) continue;
+			m[0] /= mLen;  m[1] /= mLen;  m[2] /= mLen;
+			IGLUQuadric edgeQ;
+			edgeQ.AddPlane( m, -(m[0]*pa[0] + m[1]*pa[1] + m[2]*pa[2]),
+				            IGLU_SIMPLIFY_EDGE_WEIGHT * (e[0]*e[0] + e[1]*e[1] + e[2]*e[2]) );
+			quadric[a].Add( edgeQ );
+			quadric[b].Add( edgeQ );
+		}
+	}
+	for (uint v=0; v<numVerts; v++)
+	{
+		if (canon[v] != v) continue;
+		uint copies = 1;
+		for (uint c=nextCopy[v]; c != v; c=nextCopy[c]) copies++;
+		if (copies == 1 && !hasOpen[v] && !hasSeam[v])      kind[v] = IGLU_VERT_MANIFOLD;
+		else if (copies == 1 && hasOpen[v] && !hasSeam[v])  kind[v] = IGLU_VERT_BORDER;
+		else if (copies == 2 && hasSeam[v] && !hasOpen[v])  kind[v] = IGLU_VERT_SEAM;
+	}
+
+	float extent = 0;
+	for (int k=0; k<3; k++)
+		extent = (maxPt[k]-minPt[k]) > extent ? (maxPt[k]-minPt[k]) : extent;
+	extent = extent > 0 ? extent : 1.0f;
+	double maxCost = double(maxError) * extent;
+	maxCost *= maxCost;
+
+	// Now collapse edges, one batch at a time
+	std::vector<uint> offset, triList, collapseTo( numVerts );
+	std::vector<unsigned char> locked( numVerts );
+	std::vector<IGLUCollapse> collapses;
+	double worstCost = 0;
+	while (curCount > targetIndexCount)
+	{
+		IGLUBuildEdgeLists( outIndices, curCount, &canon[0], vertEdges, posEdges );
+		IGLUBuildPositionAdjacency( outIndices, curCount, numVerts, &canon[0], offset, triList );
+
+		// Find all legal collapses (in both directions along each edge)
+		collapses.clear();
+		for (uint i=0; i<curCount; i++)
+		{
+			uint va = outIndices[i], vb = outIndices[ (i%3 == 2) ? i-2 : i+1 ];
+			for (int dir=0; dir<2; dir++)
+			{
+				uint fromVert = dir ? vb : va, toVert = dir ? va : vb;
+				uint from = canon[fromVert], to = canon[toVert];
+				bool open = !IGLUHasEdge( posEdges, to, from ) || !IGLUHasEdge( posEdges, from, to );
+				bool seam = !IGLUHasEdge( vertEdges, toVert, fromVert ) || !IGLUHasEdge( vertEdges, fromVert, toVert );
+				if (kind[from] == IGLU_VERT_LOCKED) continue;
+				if (kind[from] == IGLU_VERT_BORDER && !open) continue;
+				if (kind[from] == IGLU_VERT_SEAM && (open || !seam)) continue;
+
+				IGLUCollapse col;
+				col.from = from;      col.to = to;
+				col.fromVert = fromVert;   col.toVert = toVert;
+				col.cost = quadric[from].Error( IGLUSimplifyPosition( positions, posStride, to ) );
+				if (col.cost <= maxCost)
+					collapses.push_back( col );
+			}
+		}
+		std::sort( collapses.begin(), collapses.end() );
+
+		// Apply the cheapest collapses that don't touch each other's neighborhoods
+		for (uint v=0; v<numVerts; v++)
+		{
+			collapseTo[v] = v;
+			locked[v]     = 0;
+		}
+		uint estimatedCount = curCount, numApplied = 0;
+		for (size_t c=0; c<collapses.size() && estimatedCount > targetIndexCount; c++)
+		{
+			const IGLUCollapse &col = collapses[c];
+			if (locked[col.from] || locked[col.to]) continue;
+			if (IGLUCollapseFlips( col.from, col.to, outIndices, &canon[0], offset, triList, positions, posStride ))
+				continue;
+
+			// Every copy of 'from' must have a matching copy of 'to' to move onto
+			bool ok = true;
+			uint fromVert = col.fromVert;
+			do {
+				uint target = (fromVert == col.fromVert) ? col.toVert :
+					IGLUFindCollapseTarget( fromVert, col.from, col.to, outIndices, &canon[0], offset, triList );
+				if (target == 0xFFFFFFFF) { ok = false; break; }
+				fromVert = nextCopy[fromVert];
+			} while (fromVert != col.fromVert);
+			if (!ok) continue;
+
+			fromVert = col.fromVert;
+			do {
+				collapseTo[fromVert] = (fromVert == col.fromVert) ? col.toVert :
+					IGLUFindCollapseTarget( fromVert, col.from, col.to, outIndices, &canon[0], offset, triList );
+				fromVert = nextCopy[fromVert];
+			} while (fromVert != col.fromVert);
+
+			// Lock the whole 1-ring, so no other collapse this pass changes our triangles
+			for (uint i=offset[col.from]; i<offset[col.from+1]; i++)
+			{
+				const uint *tri = outIndices + 3*triList[i];
+				bool removed = false;
+				for (int k=0; k<3; k++)
+				{
+					locked[ canon[tri[k]] ] = 1;
+					removed = removed || (canon[tri[k]] == col.to);
+				}
+				if (removed) estimatedCount -= 3;
+			}
+			quadric[col.to].Add( quadric[col.from] );
+			worstCost = col.cost > worstCost ? col.cost : worstCost;
+			numApplied++;
+		}
+		if (numApplied == 0) break;
+
+		// Rewrite the triangles, dropping the ones that collapsed
+		uint newCount = 0;
+		for (uint i=0; i<curCount; i+=3)
+		{
+			uint v0 = collapseTo[outIndices[i]], v1 = collapseTo[outIndices[i+1]], v2 = collapseTo[outIndices[i+2]];
+			if (canon[v0] == canon[v1] || canon[v1] == canon[v2] || canon[v0] == canon[v2]) continue;
+			outIndices[newCount+0] = v0;
+			outIndices[newCount+1] = v1;
+			outIndices[newCount+2] = v2;
+			newCount += 3;
+		}
+		curCount = newCount;
+	}
+
+	if (resultError) *resultError = float( sqrt( worstCost ) / extent );
+	return curCount;
+}
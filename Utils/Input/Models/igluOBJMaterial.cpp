@@ -8,6 +8,7 @@
 /******************************************************************/
 
 
+#include <deque>
 #include "iglu.h"
 
 using namespace iglu;
@@ -43,8 +44,14 @@ void iglu::InitializeMaterial( IGLUOBJMaterial *mtl )
 	mtl->m_shininess     = 1;
 }
 
+// Material files may be read on several threads at once (see IGLUAsyncLoader), so everything
+//    touching the material & texture lists takes this (recursive) lock.
+static IGLUMutex matlLock;
+
 void iglu::AddDefaultMaterial( void )
 {
+	IGLUMutexLock lock( matlLock );
+
 	// Only want to add a default material at the beginning
 	if (IGLUOBJMaterialReader::s_matl.Size() > 0)
 		return;
@@ -52,7 +59,7 @@ void iglu::AddDefaultMaterial( void )
 	// Create a new material for our default
 	IGLUOBJMaterialReader::s_matl.Add( new IGLUOBJMaterial() );
 	iglu::InitializeMaterial( IGLUOBJMaterialReader::s_matl[0] );
-	IGLUOBJMaterialReader::s_matl[0]->m_matlName = strdup( "__DEFAULT__" );	
+	IGLUOBJMaterialReader::s_matl[0]->m_matlName = InternMaterialName( "__DEFAULT__" );	
 	IGLUOBJMaterialReader::s_matl[0]->m_amb      = vec3(0.1);
 	IGLUOBJMaterialReader::s_matl[0]->m_dif      = vec3(0.9);
 }
@@ -62,28 +69,159 @@ IGLUFramebuffer::Ptr    matlArrFBO      = 0;    // A FBO to contain 's_matlTexAr
 IGLUShaderProgram::Ptr  createTexArray  = 0;    // The shader used to create 's_matlTexArray'
 IGLUBuffer::Ptr         mtlBuf          = 0;    // A buffer used as the storage for 's_matlCoefBuf'
 
+// Material names are interned here, and matlIdForName[] maps a name's ID to the first material
+//    with that name (or -1).  Materials are added to s_matl from a few places (including 
+//    directly by IGLUOBJReader), so we index any new ones when they're first looked up.
+IGLUStringTable         matlNames;
+std::vector<int>        matlIdForName;
+uint                    matlNamesIndexed = 0;   // Materials [0..matlNamesIndexed-1] are in matlIdForName[]
+
+// A texture referenced by the material file.  We collect these while parsing, so the images
+//    can be decoded in parallel once the whole file has been read.
+struct IGLUOBJMaterialTexture
+{
+	char          *filename;
+	int           *texId;      // Where to store the texture's index in s_matlTexture
+	IGLUTexture2D *tex;        // The texture, if it was already in the texture cache
+	IGLUImage     *image;      // The decoded image, if we need to create a texture
+	bool           duplicate;  // Does an earlier texture in this file have the same path?
+};
+
+static void QueueMaterialTexture( std::vector<IGLUOBJMaterialTexture> &textures, int *texId, const char *filename )
+{
+	IGLUOBJMaterialTexture tex;
+	tex.filename  = strdup( filename );
+	tex.texId     = texId;
+	tex.tex       = 0;
+	tex.image     = 0;
+	tex.duplicate = false;
+	textures.push_back( tex );
+}
+
+// Textures decoded by material files read with deferTextures, waiting for the GL thread
+static std::deque<IGLUOBJMaterialTexture> pendingTextures;
+
+// Called by IGLUParallel::For() to decode one of the textures.  This must not touch GL.
+static void DecodeMaterialTexture( int texIdx, void *data )
+{
+	IGLUOBJMaterialTexture *tex = ((IGLUOBJMaterialTexture *)data) + texIdx;
+	if (!tex->tex && !tex->duplicate)
+		tex->image = new IGLUImage( tex->filename );
+}
+
+// Where is this texture in s_matlTexture?  (Textures from the cache may have been used
+//    by an earlier material file, so they may be there already.)
+static int MaterialTextureIndex( IGLUTexture2D *tex )
+{
+	for (uint i=0; i<IGLUOBJMaterialReader::s_matlTexture.Size(); i++)
+		if (IGLUOBJMaterialReader::s_matlTexture[i] == tex)
+			return int(i);
+	return IGLUOBJMaterialReader::s_matlTexture.Add( tex );
+}
+
+// Creates the texture for a decoded image (on the GL thread), unless one was found in the cache,
+//    and points the material at it.  Deferred textures check the cache again, in case another
+//    file with the same texture was uploaded while we were decoding.  (Those were already
+//    looked up once, so the second check doesn't count as another miss.)
+static void FinishMaterialTexture( IGLUOBJMaterialTexture &tex, bool deferred )
+{
+	if (tex.duplicate)
+		tex.tex = IGLUTextureCache::Find( tex.filename );
+	else if (deferred && !tex.tex)
+		tex.tex = IGLUTextureCache::FindByPath( tex.filename );
+	if (!tex.tex && tex.image)
+	{
+		tex.tex = new IGLUTexture2D( tex.image, tex.filename );
+		IGLUTextureCache::Add( tex.filename, tex.tex );
+	}
+	else if (tex.image)
+		delete tex.image;
+	if (tex.tex)
+		*tex.texId = MaterialTextureIndex( tex.tex );
+	free( tex.filename );
+}
+
+static void IndexMaterialNames( void )
+{
+	for ( ; matlNamesIndexed < IGLUOBJMaterialReader::s_matl.Size(); matlNamesIndexed++ )
+	{
+		const char *name = IGLUOBJMaterialReader::s_matl[matlNamesIndexed]->m_matlName;
+		if (!name) continue;
+		uint nameID = matlNames.Add( name );
+		if (nameID >= matlIdForName.size())
+			matlIdForName.resize( matlNames.Size(), -1 );
+		if (matlIdForName[nameID] < 0)
+			matlIdForName[nameID] = int( matlNamesIndexed );
+	}
+}
+
 //};   End: anonymous namespace to hide globals inside this file
 
 
 IGLUOBJMaterial *IGLUOBJMaterialReader::GetNamedMaterial( char *mtlName )
 {
-	for (uint i=0; i < s_matl.Size(); i++)
-		if (!strcmp(mtlName, s_matl[i]->m_matlName)) 
-			return s_matl[i];
-
-	return NULL;
+	int id = GetNamedMaterialId( mtlName );
+	return (id >= 0) ? s_matl[id] : NULL;
 }
 
 int IGLUOBJMaterialReader::GetNamedMaterialId( char *mtlName )
 {
-	for (uint i=0; i < s_matl.Size(); i++)
-		if (!strcmp(mtlName, s_matl[i]->m_matlName)) 
-			return int(i);
-	return -1;
+	IGLUMutexLock lock( matlLock );
+	IndexMaterialNames();
+	uint nameID = matlNames.Find( mtlName );
+	return (nameID > 0 && nameID < matlIdForName.size()) ? matlIdForName[nameID] : -1;
+}
+
+int iglu::AddMaterialTexture( char *filename )
+{
+	IGLUMutexLock lock( matlLock );
+	IGLUTexture2D *tex = IGLUTextureCache::Find( filename );
+	if (!tex)
+	{
+		tex = new IGLUTexture2D( filename );
+		IGLUTextureCache::Add( filename, tex );
+	}
+	return MaterialTextureIndex( tex );
+}
+
+char *iglu::InternMaterialName( const char *name )
+{
+	IGLUMutexLock lock( matlLock );
+	return (char *)matlNames.GetString( matlNames.Add( name ) );
+}
+
+int IGLUOBJMaterialReader::UploadPendingTextures( int maxTextures )
+{
+	IGLUMutexLock lock( matlLock );
+	int count = 0;
+	for ( ; !pendingTextures.empty() && (maxTextures < 0 || count < maxTextures); count++ )
+	{
+		FinishMaterialTexture( pendingTextures.front(), true );
+		pendingTextures.pop_front();
+	}
+	return count;
+}
+
+int IGLUOBJMaterialReader::GetPendingTextureCount( void )
+{
+	IGLUMutexLock lock( matlLock );
+	return int( pendingTextures.size() );
 }
 
 bool IGLUOBJMaterialReader::FinalizeMaterialsForRendering( GLuint textureFormat )
 {
+	IGLUMutexLock lock( matlLock );
+
+	// If we've been called before, throw away what we made last time.  (The FBO goes
+	//    first, since it still has the old texture array attached.)
+	matlArrFBO = 0;
+	delete s_matlTexArray;
+	delete s_matlCoefBuf;
+	delete mtlBuf;
+	s_matlTexArray = 0;
+	s_matlCoefBuf  = 0;
+	mtlBuf         = 0;
+
 	// Create a Texture2DArray to hold all of our material textures...  We'll create it by rendering into it.
 	if (s_matlTexture.Size() > 0)
 	{
@@ -92,8 +230,11 @@ bool IGLUOBJMaterialReader::FinalizeMaterialsForRendering( GLuint textureFormat
 		matlArrFBO->AttachTexture( IGLU_COLOR0, (IGLURenderTexture *)s_matlTexArray );
 
 		// Load the shader that will create our texture array out of the individual textures.
-		createTexArray = new IGLUShaderProgram( "shaders/toArray.vert.glsl", "shaders/toArray.geom.glsl", "shaders/toArray.frag.glsl" );
-		createTexArray->SetProgramDisables( IGLU_GLSL_DEPTH_TEST | IGLU_GLSL_BLEND ); 
+		if (createTexArray.IsNull())
+		{
+			createTexArray = new IGLUShaderProgram( "shaders/toArray.vert.glsl", "shaders/toArray.geom.glsl", "shaders/toArray.frag.glsl" );
+			createTexArray->SetProgramDisables( IGLU_GLSL_DEPTH_TEST | IGLU_GLSL_BLEND ); 
+		}
 
 		// Store our textures into the texture array
 		matlArrFBO->Bind();
@@ -137,12 +278,14 @@ bool IGLUOBJMaterialReader::FinalizeMaterialsForRendering( GLuint textureFormat
 }
 
 
-IGLUOBJMaterialReader::IGLUOBJMaterialReader( char *filename ) : 
+IGLUOBJMaterialReader::IGLUOBJMaterialReader( char *filename, bool deferTextures ) : 
 	IGLUFileParser( filename )
 {
 	// Some vars needed during our loop through the material file
 	char keyword[64], token[512];
 	int curMtl = -1;
+	std::vector<IGLUOBJMaterialTexture> textures;
+	matlLock.Lock();
 
 	// If this is our first material file, make sure to add a default material
 	if (s_matl.Size()<=0) 
@@ -163,7 +306,7 @@ IGLUOBJMaterialReader::IGLUOBJMaterialReader( char *filename ) :
 
 			// Grab the material name.
 			this->GetToken( token );
-			s_matl[curMtl]->m_matlName = strdup(token);
+			s_matl[curMtl]->m_matlName = InternMaterialName( token );
 		}
 		// We found the ambient term for the current material
 		else if (!strcmp("ka", keyword ) && curMtl>=0 )
@@ -196,7 +339,7 @@ IGLUOBJMaterialReader::IGLUOBJMaterialReader( char *filename ) :
 			//        options between the keyword and filename.  We're ignoring 
 			//        that possibility here...
 			char *texFile = this->GetCurrentLinePointer();
-			s_matl[curMtl]->m_ambTexId = s_matlTexture.Add( new IGLUTexture2D( texFile ) );
+			QueueMaterialTexture( textures, &s_matl[curMtl]->m_ambTexId, texFile );
 		}
 		// We found the texture for the diffuse component of the current texture
 		else if (!strcmp("map_kd", keyword ) && curMtl>=0 )
@@ -205,7 +348,7 @@ IGLUOBJMaterialReader::IGLUOBJMaterialReader( char *filename ) :
 			//        options between the keyword and filename.  We're ignoring 
 			//        that possibility here...
 			char *texFile = this->GetCurrentLinePointer();
-			s_matl[curMtl]->m_difTexId = s_matlTexture.Add( new IGLUTexture2D( texFile ) );
+			QueueMaterialTexture( textures, &s_matl[curMtl]->m_difTexId, texFile );
 		}
 		// We found the texture for the ambient component of the current texture
 		else if (!strcmp("map_ks", keyword ) && curMtl>=0 )
@@ -214,12 +357,50 @@ IGLUOBJMaterialReader::IGLUOBJMaterialReader( char *filename ) :
 			//        options between the keyword and filename.  We're ignoring 
 			//        that possibility here...
 			char *texFile = this->GetCurrentLinePointer();
-			s_matl[curMtl]->m_specTexId = s_matlTexture.Add( new IGLUTexture2D( texFile ) );
+			QueueMaterialTexture( textures, &s_matl[curMtl]->m_specTexId, texFile );
 		}
 
 
 		
 	}
+
+	// Textures already in the texture cache (e.g., from another material file) are simply
+	//    reused, as are textures used more than once in this file.
+	if (textures.empty()) 
+	{
+		matlLock.Unlock();
+		return;
+	}
+	std::vector<char *> paths;
+	for (uint i=0; i<textures.size(); i++)
+	{
+		char path[1024];
+		IGLUTextureCache::GetCanonicalPath( path, textures[i].filename );
+		for (uint j=0; j<paths.size() && !textures[i].duplicate; j++)
+			textures[i].duplicate = !strcmp( path, paths[j] );
+		if (textures[i].duplicate) continue;
+		paths.push_back( strdup( path ) );
+		textures[i].tex = IGLUTextureCache::Find( textures[i].filename );
+	}
+
+	// Decoding the remaining images is the slow part, so do that in parallel.  The GL textures are
+	//    then created here (on the thread with the GL context) in the order they appear in the file,
+	//    or if we're not on that thread, later by UploadPendingTextures().  (Other threads may use
+	//    the material lists while we decode;  our materials stay put, so texId remains valid.)
+	matlLock.Unlock();
+	IGLUParallel::For( int(textures.size()), DecodeMaterialTexture, &textures[0] );
+	matlLock.Lock();
+	for (uint i=0; i<textures.size(); i++)
+	{
+		if (deferTextures)
+			pendingTextures.push_back( textures[i] );
+		else
+			FinishMaterialTexture( textures[i], false );
+	}
+	matlLock.Unlock();
+
+	for (uint i=0; i<paths.size(); i++)
+		free( paths[i] );
 }
 
 
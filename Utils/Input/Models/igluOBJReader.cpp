@@ -9,38 +9,149 @@
 
 #include "iglu.h"
 #include <float.h>
+#include <math.h>
+#include <ctype.h>
 
 using namespace iglu;
 #define   s_matlTexture  IGLUOBJMaterialReader::s_matlTexture
 #define	s_matl  IGLUOBJMaterialReader::s_matl
 
 
-IGLUOBJReader::IGLUOBJReader( char *filename, int params ) :
-	IGLUFileParser( filename ), IGLUModel(), m_vertArr(0),
-	m_hasTexCoords(false), m_hasNormals(false), m_hasVertices(false), m_shaderID(0),
-	m_hasMatlID(true), m_curMatlId(0), m_curObjectId(0), m_hasObjectID(true)
+void IGLUOBJTriArray::Resize( uint numTris )
+{
+	vIdx.resize( 3*numTris, -1 );
+	nIdx.resize( 3*numTris, -1 );
+	tIdx.resize( 3*numTris, -1 );
+	matlID.resize( numTris, 0 );
+	objectID.resize( numTris, 0 );
+	mtlNameID.resize( numTris, 0 );
+	grpNameID.resize( numTris, 0 );
+	objNameID.resize( numTris, 0 );
+}
+
+void IGLUOBJTriArray::Reserve( uint numTris )
+{
+	vIdx.reserve( 3*numTris );
+	nIdx.reserve( 3*numTris );
+	tIdx.reserve( 3*numTris );
+	matlID.reserve( numTris );
+	objectID.reserve( numTris );
+	mtlNameID.reserve( numTris );
+	grpNameID.reserve( numTris );
+	objNameID.reserve( numTris );
+}
+
+uint IGLUOBJTriArray::Add( int matl, int object, uint mtlName, uint grpName, uint objName )
+{
+	for (int i=0; i<3; i++)
+	{
+		vIdx.push_back( -1 );
+		nIdx.push_back( -1 );
+		tIdx.push_back( -1 );
+	}
+	matlID.push_back( matl );
+	objectID.push_back( object );
+	mtlNameID.push_back( mtlName );
+	grpNameID.push_back( grpName );
+	objNameID.push_back( objName );
+	return size()-1;
+}
+
+
+
+IGLUOBJReader::IGLUOBJReader( char *filename, int params, IGLUOBJBatchCallback batchFunc, void *batchData ) :
+	IGLUFileParser( filename, true, (params & (IGLU_OBJ_MEMORY_MAPPED|IGLU_OBJ_PARALLEL_PARSE|IGLU_OBJ_STREAMING)) ? true : false ), IGLUModel(),
+	m_curMatlId(0), m_curObjectId(0), m_shaderID(0), m_vertArr(0),
+	m_elementArray(0), m_numTris(0), m_numArrayVerts(0), m_cacheFile(0), m_loadedFromCache(false),
+	m_hasVertices(false), m_hasNormals(false), m_hasTexCoords(false), m_hasMatlID(true), m_hasObjectID(true),
+	m_deferUpload(false), m_deferredVerts(0), m_deferredVertBytes(0)
 {
 	// Check the parameters
 	m_resize        = params & IGLU_OBJ_UNITIZE ? true : false;
 	m_center        = params & IGLU_OBJ_CENTER ? true : false;
-	m_compactFormat = params & IGLU_OBJ_COMPACT_STORAGE ? true : false;
+	m_compactFormat = params & (IGLU_OBJ_COMPACT_STORAGE|IGLU_OBJ_OPTIMIZE|IGLU_OBJ_OPTIMIZE_OVERDRAW|IGLU_OBJ_CLUSTERS|
+	                            IGLU_OBJ_LODS) ? true : false;
 	m_loadMtlFile   = params & IGLU_OBJ_NO_MATERIALS ? false : true;
 	m_assignObjects = params & IGLU_OBJ_NO_OBJECTS ? true : false ;
+	m_optimize      = params & (IGLU_OBJ_OPTIMIZE|IGLU_OBJ_OPTIMIZE_OVERDRAW) ? true : false;
+	m_optimizeOverdraw = params & IGLU_OBJ_OPTIMIZE_OVERDRAW ? true : false;
+	memset( &m_unoptimizedStats, 0, sizeof( m_unoptimizedStats ) );
+	m_packing       = params & (IGLU_OBJ_HALF_POSITIONS|IGLU_OBJ_UNORM16_POSITIONS|IGLU_OBJ_OCT_NORMALS|
+		                        IGLU_OBJ_HALF_TEXCOORDS|IGLU_OBJ_INTEGER_IDS|IGLU_OBJ_SHORT_INDICES);
+	m_idType        = GL_FLOAT;
+	m_posScale      = vec3( 1, 1, 1 );
+	m_posOffset     = vec3( 0, 0, 0 );
+	m_buildClusters = params & IGLU_OBJ_CLUSTERS ? true : false;
+	m_clusterBuf    = 0;
+	m_buildLods     = params & IGLU_OBJ_LODS ? true : false;
+	m_drawLod       = 0;
+	m_buildDrawRanges = params & IGLU_OBJ_DRAW_RANGES ? true : false;
+	m_indirectBuf   = 0;
+
+	// Create the data structure to interface with OpenGL for drawing this object.  (When deferring
+	//    uploads, we may be on a thread without a GL context, so this waits for UploadToGPU().)
+	m_deferUpload   = (params & IGLU_OBJ_DEFER_UPLOAD) && !((params & IGLU_OBJ_STREAMING) && IsMemoryMapped());
+	if (!m_deferUpload)
+		m_vertArr = new IGLUVertexArray();
+
+	// Streamed files go straight into the vertex array (or the callback) a batch at a time,
+	//    so none of the whole-mesh processing applies.
+	if ((params & IGLU_OBJ_STREAMING) && IsMemoryMapped())
+	{
+		m_compactFormat = m_optimize = m_optimizeOverdraw = false;
+		m_buildClusters = m_buildLods = m_buildDrawRanges = false;
+		m_packing       = 0;
+		StreamMappedFile( batchFunc, batchData );
+		CloseFile();
+		return;
+	}
 
-	// Create the data structure to interface with OpenGL for drawing this object.
-	m_vertArr = new IGLUVertexArray();
+	// If we have an up-to-date binary cache, we can skip parsing the OBJ entirely.
+	if (params & IGLU_OBJ_USE_CACHE)
+	{
+		m_cacheFile = (char *)malloc( strlen(fileName)+16 );
+		sprintf( m_cacheFile, "%s.iglucache", fileName );
+		if (LoadCache())
+		{
+			CloseFile();
+			return;
+		}
+	}
 
+	// OK, we have a parser.  Now parse through the file
+	if (IsMemoryMapped() && (params & IGLU_OBJ_PARALLEL_PARSE))
+		ParseMappedFileInParallel();
+	else if (IsMemoryMapped())
+		ParseMappedFile();
+	else
+		ParseFile();
+
+	// No need to keep the file hanging around open.
+	CloseFile();
+
+	// Create the GPU buffers for this object, so we have them laying around later.
+	//    (The element array comes first, so it's ready if GetArrayBuffer() saves a cache.)
+	if (m_compactFormat)
+		GetCompactArrayBuffer();
+	else
+	{
+		GetElementArrayBuffer();
+		GetArrayBuffer();
+	}
+}
+
+void IGLUOBJReader::ParseFile( void )
+{
 	// For clarity (later), we have a pointer to the Read_???_Token() method we will
 	//    use when reading a facet.  This will be set when we first see a 'f' line.
 	FnParserPtr fnFacetParsePtr = NULL;
 
-	// OK, we have a parser.  Now parse through the file
-	IGLUOBJTri *curTri = 0;
+	uint curTri = 0;
 	char *linePtr = 0, *mtlFilePtr = 0;
 	char keyword[64], vertToken[128];
 	char fname[256];
-	char *currentObj = 0, *currentGrp = 0, *currentMtl = 0;
-	int tmpMatlId, tmpObjId;
+	uint currentObj = 0, currentGrp = 0, currentMtl = 0;
+	int tmpMatlId;
 	
 	/*std::vector<IGLUOBJTri *> _objTris;*/
 	while ( (linePtr = this->ReadNextLine()) != NULL )
@@ -66,30 +177,22 @@ IGLUOBJReader::IGLUOBJReader( char *filename, int params ) :
 			m_objMtlFiles.push_back( mtlFilePtr ); 
 			if (m_loadMtlFile) { 
 				// Should be able to do as a local...  but not inside switch?  Do it the hard way.
-				delete( new IGLUOBJMaterialReader( mtlFilePtr ));  // Load it.
+				delete( new IGLUOBJMaterialReader( mtlFilePtr, m_deferUpload ));  // Load it.
 			}
 			break;
 		case 'o': // We found a name for the object following this flag
 			this->GetToken( fname );
-			currentObj = strdup( fname );
-			
-			//Check if we have already found this object name
-			tmpObjId = GetObjectID(currentObj);
-			if(-1 != tmpObjId){
-				m_curObjectId = uint(tmpObjId);
-			}else{ //It is a new object. push_back it to the list. 
-				m_objObjectNames.push_back(currentObj);
-				m_curObjectId = m_objObjectNames.size() - 1;
-			}
+			currentObj = m_objTris.AddName( fname );
+			m_curObjectId = GetObjectIDForName( currentObj );
 			
 			break;
 		case 'g': // We found a name for the group following this flag
 			this->GetToken( fname );
-			currentGrp = strdup( fname );
+			currentGrp = m_objTris.AddName( fname );
 			break;
 		case 'u': // We found the name of the material we'll be using
 			this->GetToken( fname );
-			currentMtl = strdup( fname );
+			currentMtl = m_objTris.AddName( fname );
 			tmpMatlId = IGLUOBJMaterialReader::GetNamedMaterialId( fname );
 			if (tmpMatlId >= 0)
 				m_curMatlId = uint(tmpMatlId);
@@ -98,10 +201,6 @@ IGLUOBJReader::IGLUOBJReader( char *filename, int params ) :
 			// There's a smoothing command.  We're ignoring these.
 			break;
 		case 'f': // We found a facet!
-			curTri = new IGLUOBJTri( currentMtl, currentGrp, currentObj);
-			curTri->matlID = m_curMatlId;
-			curTri->objectID = m_curObjectId;
-			
 			//Ensure the 'f' line has at least three entries. 
 			if(!IsValidFLine(&fnFacetParsePtr)){
 				continue;
@@ -114,25 +213,20 @@ IGLUOBJReader::IGLUOBJReader( char *filename, int params ) :
 		
 
 			// Read first three set of indices on this line
+			curTri = m_objTris.Add( m_curMatlId, m_curObjectId, currentMtl, currentGrp, currentObj );
 			((*this).*(fnFacetParsePtr))( curTri, 0, NULL );
 			((*this).*(fnFacetParsePtr))( curTri, 1, NULL );
 			((*this).*(fnFacetParsePtr))( curTri, 2, NULL );
-			m_objTris.push_back( curTri );
-			//_objTris.push_back( curTri );
+
 			// Do we have more vertices in this facet?  Check to see if the 
 			//    next token is non-empty (if empty the [0]'th char == 0)
 			//    If we do, we'll have to triangulate the facet, so make a new tri
 			this->GetToken( vertToken );
 			while ( vertToken[0] ) 
 			{
-				curTri = new IGLUOBJTri( currentMtl, currentGrp, currentObj);
-				curTri->matlID = m_curMatlId;
-				curTri->objectID = m_curObjectId;
+				curTri = m_objTris.Add( m_curMatlId, m_curObjectId, currentMtl, currentGrp, currentObj );
 				CopyForTriangleFan( curTri );
-				//CopyForTriangleFan( _objTris[_objTris.size()-1],curTri );
 				((*this).*(fnFacetParsePtr))( curTri, 2, vertToken );
-				m_objTris.push_back( curTri );
-			    //_objTris.push_back( curTri );
 				this->GetToken( vertToken );
 			}
 			break;
@@ -141,17 +235,127 @@ IGLUOBJReader::IGLUOBJReader( char *filename, int params ) :
 			this->WarningMessage("Found corrupt line in OBJ.  Unknown keyword '%s'", keyword);
 		}
 	}
+}
 
-	// No need to keep the file hanging around open.
-	CloseFile();
+// Parses the OBJ file in place from the memory-mapped data.  Each case below mirrors
+//    the corresponding case in ParseFile(), but numbers are parsed straight out of
+//    the mapping without copying lines or tokens into temporary buffers.
+void IGLUOBJReader::ParseMappedFile( void )
+{
+	uint curTri = 0;
+	const char *linePtr = 0, *lineEnd = 0, *tokEnd = 0, *ptr = 0;
+	char *mtlFilePtr = 0;
+	char keyword[64];
+	char fname[256];
+	uint currentObj = 0, currentGrp = 0, currentMtl = 0;
+	int tmpMatlId, facetFormat;
+	double x, y, z;
 
-	// Create the GPU buffers for this object, so we have them laying around later.
-	if (m_compactFormat)
-		GetCompactArrayBuffer();
-	else
+	while ( (linePtr = this->ReadNextLineInPlace( &lineEnd )) != NULL )
 	{
-		GetArrayBuffer();
-		GetElementArrayBuffer();
+		// Each OBJ line starts with a keyword/keyletter
+		tokEnd = SkipTokenInPlace( linePtr, lineEnd );
+		ptr    = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+		char key0 = (char)tolower( linePtr[0] );
+		char key1 = (tokEnd-linePtr > 1) ? (char)tolower( linePtr[1] ) : 0;
+
+		switch( key0 )
+		{
+		case 'v': 
+			if (key1 == 'n')        // We found a normal!
+			{
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &x );
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &y );
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &z );
+				m_objNorms.push_back( vec3( float(x), float(y), float(z) ) );
+			}
+			else if (key1 == 't')   // We found a texture coordinate!
+			{
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &x );
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &y );
+				m_objTexCoords.push_back( vec2( float(x), float(y) ) );
+			}
+			else if (key1 == 0 )    // We found a vertex!
+			{
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &x );
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &y );
+				ptr = ParseNumericalTokenInPlace( ptr, lineEnd, &z );
+				m_objVerts.push_back( vec3( float(x), float(y), float(z) ) );
+			}
+			break;
+		case 'm': // We found the name of a material file!
+			CopyStringInPlace( fname, 256, ptr, SkipTokenInPlace( ptr, lineEnd ) );
+			mtlFilePtr = (char *)malloc( strlen(fname)+strlen(fileDirectory)+1 );
+			sprintf( mtlFilePtr, "%s%s", fileDirectory, fname );
+			m_objMtlFiles.push_back( mtlFilePtr ); 
+			if (m_loadMtlFile)
+				delete( new IGLUOBJMaterialReader( mtlFilePtr, m_deferUpload ));  // Load it.
+			break;
+		case 'o': // We found a name for the object following this flag
+			CopyStringInPlace( fname, 256, ptr, SkipTokenInPlace( ptr, lineEnd ) );
+			currentObj = m_objTris.AddName( fname );
+			m_curObjectId = GetObjectIDForName( currentObj );
+			break;
+		case 'g': // We found a name for the group following this flag
+			CopyStringInPlace( fname, 256, ptr, SkipTokenInPlace( ptr, lineEnd ) );
+			currentGrp = m_objTris.AddName( fname );
+			break;
+		case 'u': // We found the name of the material we'll be using
+			CopyStringInPlace( fname, 256, ptr, SkipTokenInPlace( ptr, lineEnd ) );
+			currentMtl = m_objTris.AddName( fname );
+			tmpMatlId = IGLUOBJMaterialReader::GetNamedMaterialId( fname );
+			if (tmpMatlId >= 0)
+				m_curMatlId = uint(tmpMatlId);
+			break;
+		case 's':
+			// There's a smoothing command.  We're ignoring these.
+			break;
+		case 'f': // We found a facet!
+			{
+				// Find the first three vertex tokens on the line
+				const char *tok[3], *tokEnds[3], *cur = ptr;
+				int numTokens = 0;
+				for ( ; numTokens < 3 && cur < lineEnd; numTokens++ )
+				{
+					tok[numTokens]     = cur;
+					tokEnds[numTokens] = SkipTokenInPlace( cur, lineEnd );
+					cur = SkipWhiteSpaceInPlace( tokEnds[numTokens], lineEnd );
+				}
+
+				//Ensure the 'f' line has at least three entries. 
+				if (numTokens < 3)
+				{
+					CopyStringInPlace( fname, 256, ptr, lineEnd );
+					this->WarningMessage("Corrupt 'f': %s", fname);
+					continue;
+				}
+
+				// There are multiple different formats for 'f' lines.  Decide which it is.
+				facetFormat = SelectFacetFormatInPlace( tok[0], tokEnds[0] );
+
+				// Read first three set of indices on this line
+				curTri = m_objTris.Add( m_curMatlId, m_curObjectId, currentMtl, currentGrp, currentObj );
+				ReadFacetTokenInPlace( facetFormat, curTri, 0, tok[0], tokEnds[0] );
+				ReadFacetTokenInPlace( facetFormat, curTri, 1, tok[1], tokEnds[1] );
+				ReadFacetTokenInPlace( facetFormat, curTri, 2, tok[2], tokEnds[2] );
+
+				// Do we have more vertices in this facet?  If so, triangulate it as a fan.
+				while ( cur < lineEnd ) 
+				{
+					tokEnd = SkipTokenInPlace( cur, lineEnd );
+					curTri = m_objTris.Add( m_curMatlId, m_curObjectId, currentMtl, currentGrp, currentObj );
+					CopyForTriangleFan( curTri );
+					ReadFacetTokenInPlace( facetFormat, curTri, 2, cur, tokEnd );
+					cur = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+				}
+			}
+			break;
+
+		default:  // We have no clue what to do with this line....
+			CopyStringInPlace( keyword, 64, linePtr, tokEnd );
+			MakeLower( keyword );
+			this->WarningMessage("Found corrupt line in OBJ.  Unknown keyword '%s'", keyword);
+		}
 	}
 }
 
@@ -170,7 +374,7 @@ uint AddGLMmaterial(GLMmaterial* matl)
 	InitializeMaterial( s_matl[curMtl] );
 
 	
-	s_matl[curMtl]->m_matlName = matl->name;
+	s_matl[curMtl]->m_matlName = InternMaterialName( matl->name );
 	for(int i=0; i<3; i++)
 	{
 		s_matl[curMtl]->m_amb[i] = matl->ambient[i];
@@ -184,31 +388,45 @@ uint AddGLMmaterial(GLMmaterial* matl)
 	s_matl[curMtl]->m_idxRefract = matl->refraction;
 	// We found the illumination model for the current material		
 	s_matl[curMtl]->m_illumModel = matl->shader;	
+	// Textures are shared (through IGLUTextureCache) with other materials and models
 	if ( strlen(matl->ambient_map ) > 0)
-	{
-		s_matl[curMtl]->m_ambTexId = s_matlTexture.Add( new IGLUTexture2D( matl->ambient_map ) );
-	}
+		s_matl[curMtl]->m_ambTexId = AddMaterialTexture( matl->ambient_map );
 	if ( strlen(matl->diffuse_map) > 0)
-	{
-		s_matl[curMtl]->m_difTexId = s_matlTexture.Add( new IGLUTexture2D( matl->diffuse_map ) );
-	}
+		s_matl[curMtl]->m_difTexId = AddMaterialTexture( matl->diffuse_map );
 	if ( strlen(matl->specular_map) >0 )
-		s_matl[curMtl]->m_specTexId = s_matlTexture.Add( new IGLUTexture2D( matl->specular_map ) );
+		s_matl[curMtl]->m_specTexId = AddMaterialTexture( matl->specular_map );
 		
 	return curMtl;
 }
 
 
-IGLUOBJReader::IGLUOBJReader( GLMmodel* model, int params):IGLUFileParser( model->pathname ), IGLUModel(), m_vertArr(0),
-	m_hasTexCoords(false), m_hasNormals(false), m_hasVertices(false), m_shaderID(0),
-	m_hasMatlID(true), m_curMatlId(0), m_curObjectId(0), m_hasObjectID(true)
+IGLUOBJReader::IGLUOBJReader( GLMmodel* model, int params):IGLUFileParser( model->pathname ), IGLUModel(),
+	m_curMatlId(0), m_curObjectId(0), m_shaderID(0), m_vertArr(0),
+	m_elementArray(0), m_numTris(0), m_numArrayVerts(0), m_cacheFile(0), m_loadedFromCache(false),
+	m_hasVertices(false), m_hasNormals(false), m_hasTexCoords(false), m_hasMatlID(true), m_hasObjectID(true),
+	m_deferUpload(false), m_deferredVerts(0), m_deferredVertBytes(0)
 {
 	// Check the parameters
 	m_resize        = params & IGLU_OBJ_UNITIZE ? true : false;
 	m_center        = params & IGLU_OBJ_CENTER ? true : false;
-	m_compactFormat = params & IGLU_OBJ_COMPACT_STORAGE ? true : false;
+	m_compactFormat = params & (IGLU_OBJ_COMPACT_STORAGE|IGLU_OBJ_OPTIMIZE|IGLU_OBJ_OPTIMIZE_OVERDRAW|IGLU_OBJ_CLUSTERS|
+	                            IGLU_OBJ_LODS) ? true : false;
 	m_loadMtlFile   = params & IGLU_OBJ_NO_MATERIALS ? false : true;
 	m_assignObjects = params & IGLU_OBJ_NO_OBJECTS ? true : false ;
+	m_optimize      = params & (IGLU_OBJ_OPTIMIZE|IGLU_OBJ_OPTIMIZE_OVERDRAW) ? true : false;
+	m_optimizeOverdraw = params & IGLU_OBJ_OPTIMIZE_OVERDRAW ? true : false;
+	memset( &m_unoptimizedStats, 0, sizeof( m_unoptimizedStats ) );
+	m_packing       = params & (IGLU_OBJ_HALF_POSITIONS|IGLU_OBJ_UNORM16_POSITIONS|IGLU_OBJ_OCT_NORMALS|
+		                        IGLU_OBJ_HALF_TEXCOORDS|IGLU_OBJ_INTEGER_IDS|IGLU_OBJ_SHORT_INDICES);
+	m_idType        = GL_FLOAT;
+	m_posScale      = vec3( 1, 1, 1 );
+	m_posOffset     = vec3( 0, 0, 0 );
+	m_buildClusters = params & IGLU_OBJ_CLUSTERS ? true : false;
+	m_clusterBuf    = 0;
+	m_buildLods     = params & IGLU_OBJ_LODS ? true : false;
+	m_drawLod       = 0;
+	m_buildDrawRanges = false;   // (Our arrays are built in the opposite order, so we can't sort them)
+	m_indirectBuf   = 0;
 
 	m_hasVertices = model->numvertices > 0  ? true : false;
 	m_hasNormals = model->numnormals > 0 ? true : false;
@@ -254,7 +472,7 @@ IGLUOBJReader::IGLUOBJReader( GLMmodel* model, int params):IGLUFileParser( model
 	// Basic geometric triangles definitions
 	unsigned int triangle_count = 0u;
 	unsigned int group_count = 0u;
-	m_objTris.reserve(model->numtriangles);
+	m_objTris.Reserve(model->numtriangles);
 	 for ( GLMgroup* obj_group = model->groups;
         obj_group != 0;
         obj_group = obj_group->next, group_count++ )
@@ -265,19 +483,19 @@ IGLUOBJReader::IGLUOBJReader( GLMmodel* model, int params):IGLUFileParser( model
 
 		 //inti mtl
 		 uint materialId = AddGLMmaterial(&model->materials[obj_group->material]);
+		 uint mtlNameId = m_objTris.AddName(obj_group->mtlname);
+		 uint grpNameId = m_objTris.AddName(obj_group->name);
 
 		  for ( unsigned int i = 0; i < obj_group->numtriangles; ++i, ++triangle_count ) 
 		  {
-			  IGLUOBJTri * tri = new IGLUOBJTri(obj_group->mtlname,obj_group->name,obj_group->name);
+			  uint tri = m_objTris.Add(materialId, 0, mtlNameId, grpNameId, grpNameId);
 			  unsigned int tindex = obj_group->triangles[i];     
 			  for(int k=0; k<3; k++)
 			  {
-				  tri->vIdx[k] = model->triangles[ tindex ].vindices[k] - 1; 
-				  tri->nIdx[k] = model->triangles[ tindex ].nindices[k] - 1; 
-				  tri->tIdx[k] =  model->triangles[ tindex ].tindices[k] - 1; 
+				  m_objTris.vIdx[3*tri+k] = model->triangles[ tindex ].vindices[k] - 1; 
+				  m_objTris.nIdx[3*tri+k] = model->triangles[ tindex ].nindices[k] - 1; 
+				  m_objTris.tIdx[3*tri+k] =  model->triangles[ tindex ].tindices[k] - 1; 
 			  }	
-			  tri->matlID = materialId;
-			  m_objTris.push_back(tri);
 		  }
 	 }
 
@@ -297,8 +515,12 @@ IGLUOBJReader::~IGLUOBJReader()
 
 	// Get rid of our vertex array
 	delete m_vertArr;
+	delete m_clusterBuf;
+	delete m_indirectBuf;
 
 	free(m_elementArray);
+	free(m_cacheFile);
+	free(m_deferredVerts);
 }
 
 unsigned int IGLUOBJReader::GetVertexIndex( int relativeIdx )
@@ -324,19 +546,25 @@ unsigned int IGLUOBJReader::GetTextureIndex( int relativeIdx )
 
 int IGLUOBJReader::GetObjectID( char *objName )
 {
-	//Search the array of objects for one with the same name.
-	//If found return the index to that object
-	//Otherwise push_back the new name to the list
-
-	for(uint i = 0; i < m_objObjectNames.size(); i++){
-		if (!strcmp(objName, m_objObjectNames[i])) 
-			return int(i);
-	} 
+	// Object names are all in our name table, so if the name isn't there we haven't seen it
+	uint nameID = m_objTris.names.Find( objName );
+	return (nameID > 0 && nameID < m_objectIdForName.size()) ? m_objectIdForName[nameID] : -1;
+}
 
-	return -1;
+uint IGLUOBJReader::GetObjectIDForName( uint nameID )
+{
+	if (nameID >= m_objectIdForName.size())
+		m_objectIdForName.resize( m_objTris.names.Size(), -1 );
 
+	// Is this a new object?  If so, add it to the list.
+	if (m_objectIdForName[nameID] < 0)
+	{
+		m_objectIdForName[nameID] = int( m_objObjectNames.size() );
+		m_objObjectNames.push_back( nameID );
+	}
+	return uint( m_objectIdForName[nameID] );
 }
-void IGLUOBJReader::Read_V_Token( IGLUOBJTri *tri, int idx, char *token )
+void IGLUOBJReader::Read_V_Token( uint tri, int idx, char *token )
 {
 	char vertToken[128], *tPtr = vertToken;
 	int vIdx;
@@ -351,12 +579,12 @@ void IGLUOBJReader::Read_V_Token( IGLUOBJTri *tri, int idx, char *token )
 	sscanf( tPtr, "%d", &vIdx );
 
 	// Resolve these into indicies in our data structure (not the OBJ file)
-	tri->vIdx[idx] = GetVertexIndex( vIdx );
-	tri->nIdx[idx] = -1;
-	tri->tIdx[idx] = -1;
+	m_objTris.vIdx[3*tri+idx] = GetVertexIndex( vIdx );
+	m_objTris.nIdx[3*tri+idx] = -1;
+	m_objTris.tIdx[3*tri+idx] = -1;
 }
 
-void IGLUOBJReader::Read_VN_Token( IGLUOBJTri *tri, int idx, char *token )
+void IGLUOBJReader::Read_VN_Token( uint tri, int idx, char *token )
 {
 	char vertToken[128], *tPtr = vertToken;
 	int vIdx, nIdx;
@@ -371,12 +599,12 @@ void IGLUOBJReader::Read_VN_Token( IGLUOBJTri *tri, int idx, char *token )
 	sscanf( tPtr, "%d//%d", &vIdx, &nIdx );
 
 	// Resolve these into indicies in our data structure (not the OBJ file)
-	tri->vIdx[idx] = GetVertexIndex( vIdx );
-	tri->nIdx[idx] = GetNormalIndex( nIdx );
-	tri->tIdx[idx] = -1;
+	m_objTris.vIdx[3*tri+idx] = GetVertexIndex( vIdx );
+	m_objTris.nIdx[3*tri+idx] = GetNormalIndex( nIdx );
+	m_objTris.tIdx[3*tri+idx] = -1;
 }
 
-void IGLUOBJReader::Read_VT_Token( IGLUOBJTri *tri, int idx, char *token )
+void IGLUOBJReader::Read_VT_Token( uint tri, int idx, char *token )
 {
 	char vertToken[128], *tPtr = vertToken;
 	int vIdx, tIdx;
@@ -391,12 +619,12 @@ void IGLUOBJReader::Read_VT_Token( IGLUOBJTri *tri, int idx, char *token )
 	sscanf( tPtr, "%d/%d", &vIdx, &tIdx );
 
 	// Resolve these into indicies in our data structure (not the OBJ file)
-	tri->vIdx[idx] = GetVertexIndex( vIdx );
-	tri->nIdx[idx] = -1;
-	tri->tIdx[idx] = GetTextureIndex( tIdx );
+	m_objTris.vIdx[3*tri+idx] = GetVertexIndex( vIdx );
+	m_objTris.nIdx[3*tri+idx] = -1;
+	m_objTris.tIdx[3*tri+idx] = GetTextureIndex( tIdx );
 }
 
-void IGLUOBJReader::Read_VTN_Token( IGLUOBJTri *tri, int idx, char *token )
+void IGLUOBJReader::Read_VTN_Token( uint tri, int idx, char *token )
 {
 	char vertToken[128], *tPtr = vertToken;
 	int vIdx, tIdx, nIdx;
@@ -411,28 +639,19 @@ void IGLUOBJReader::Read_VTN_Token( IGLUOBJTri *tri, int idx, char *token )
 	sscanf( tPtr, "%d/%d/%d", &vIdx, &tIdx, &nIdx );
 
 	// Resolve these into indicies in our data structure (not the OBJ file)
-	tri->vIdx[idx] = GetVertexIndex( vIdx );
-	tri->nIdx[idx] = GetNormalIndex( nIdx );
-	tri->tIdx[idx] = GetTextureIndex( tIdx );
+	m_objTris.vIdx[3*tri+idx] = GetVertexIndex( vIdx );
+	m_objTris.nIdx[3*tri+idx] = GetNormalIndex( nIdx );
+	m_objTris.tIdx[3*tri+idx] = GetTextureIndex( tIdx );
 }
-void IGLUOBJReader::CopyForTriangleFan( const IGLUOBJTri * lastTri, IGLUOBJTri* newTri)
+void IGLUOBJReader::CopyForTriangleFan( uint newTri )
 {
-	newTri->vIdx[0] = lastTri->vIdx[0]; 
-	newTri->nIdx[0] = lastTri->nIdx[0];
-	newTri->tIdx[0] = lastTri->tIdx[0];
-	newTri->vIdx[1] = lastTri->vIdx[2];
-	newTri->nIdx[1] = lastTri->nIdx[2];
-	newTri->tIdx[1] = lastTri->tIdx[2];
-
-}
-void IGLUOBJReader::CopyForTriangleFan( IGLUOBJTri *newTri )
-{
-	newTri->vIdx[0] = m_objTris[m_objTris.size()-1]->vIdx[0]; 
-	newTri->nIdx[0] = m_objTris[m_objTris.size()-1]->nIdx[0];
-	newTri->tIdx[0] = m_objTris[m_objTris.size()-1]->tIdx[0];
-	newTri->vIdx[1] = m_objTris[m_objTris.size()-1]->vIdx[2];
-	newTri->nIdx[1] = m_objTris[m_objTris.size()-1]->nIdx[2];
-	newTri->tIdx[1] = m_objTris[m_objTris.size()-1]->tIdx[2];
+	uint lastTri = newTri-1;
+	m_objTris.vIdx[3*newTri+0] = m_objTris.vIdx[3*lastTri+0]; 
+	m_objTris.nIdx[3*newTri+0] = m_objTris.nIdx[3*lastTri+0];
+	m_objTris.tIdx[3*newTri+0] = m_objTris.tIdx[3*lastTri+0];
+	m_objTris.vIdx[3*newTri+1] = m_objTris.vIdx[3*lastTri+2];
+	m_objTris.nIdx[3*newTri+1] = m_objTris.nIdx[3*lastTri+2];
+	m_objTris.tIdx[3*newTri+1] = m_objTris.tIdx[3*lastTri+2];
 }
 
 void IGLUOBJReader::SelectReadMethod( FnParserPtr *pPtr )
@@ -465,6 +684,78 @@ void IGLUOBJReader::SelectReadMethod( FnParserPtr *pPtr )
 		m_hasVertices = true;
 	}
 	
+int IGLUOBJReader::GetFacetFormatInPlace( const char *token, const char *tokenEnd )
+{
+	int v, t, n; // garbage vars
+	const char *ptr;
+
+	// Look for a "//" in the token
+	for (ptr = token; ptr+1 < tokenEnd; ptr++)
+		if (ptr[0] == '/' && ptr[1] == '/')                      // Then it has the v//n format
+			return IGLU_OBJ_FACET_VN;
+
+	// Otherwise, see how many '/'-separated integers we can read (as sscanf would)
+	int numInts = 0;
+	ptr = ParseIntegerInPlace( token, tokenEnd, &v );
+	if (ptr) 
+	{
+		numInts++;
+		if (ptr < tokenEnd && ptr[0] == '/' && (ptr = ParseIntegerInPlace( ptr+1, tokenEnd, &t )))
+		{
+			numInts++;
+			if (ptr < tokenEnd && ptr[0] == '/' && ParseIntegerInPlace( ptr+1, tokenEnd, &n ))
+				numInts++;
+		}
+	}
+
+	if (numInts == 3)                                            // Then it has the v/t/n format
+		return IGLU_OBJ_FACET_VTN;
+	else if (numInts == 2)                                       // Then it has the v/t format
+		return IGLU_OBJ_FACET_VT;
+	return IGLU_OBJ_FACET_V;                                     // Then it has the v format
+}
+
+void IGLUOBJReader::GetFacetIndicesInPlace( int format, const char *token, const char *tokenEnd, int *vIdx, int *tIdx, int *nIdx )
+{
+	*vIdx = *tIdx = *nIdx = 0;
+
+	// Parse the indices from the token, matching the sscanf() formats of the Read_???_Token() methods
+	const char *ptr = ParseIntegerInPlace( token, tokenEnd, vIdx );
+	if (ptr && format == IGLU_OBJ_FACET_VN)
+	{
+		if (ptr+1 < tokenEnd && ptr[0] == '/' && ptr[1] == '/')
+			ParseIntegerInPlace( ptr+2, tokenEnd, nIdx );
+	}
+	else if (ptr && (format == IGLU_OBJ_FACET_VT || format == IGLU_OBJ_FACET_VTN))
+	{
+		if (ptr < tokenEnd && ptr[0] == '/' && (ptr = ParseIntegerInPlace( ptr+1, tokenEnd, tIdx )) &&
+			format == IGLU_OBJ_FACET_VTN && ptr < tokenEnd && ptr[0] == '/')
+			ParseIntegerInPlace( ptr+1, tokenEnd, nIdx );
+	}
+}
+
+int IGLUOBJReader::SelectFacetFormatInPlace( const char *token, const char *tokenEnd )
+{
+	int format = GetFacetFormatInPlace( token, tokenEnd );
+	m_hasVertices = true;
+	if (format == IGLU_OBJ_FACET_VN || format == IGLU_OBJ_FACET_VTN)
+		m_hasNormals = true;
+	if (format == IGLU_OBJ_FACET_VT || format == IGLU_OBJ_FACET_VTN)
+		m_hasTexCoords = true;
+	return format;
+}
+
+void IGLUOBJReader::ReadFacetTokenInPlace( int format, uint tri, int idx, const char *token, const char *tokenEnd )
+{
+	int vIdx, tIdx, nIdx;
+	GetFacetIndicesInPlace( format, token, tokenEnd, &vIdx, &tIdx, &nIdx );
+
+	// Resolve these into indicies in our data structure (not the OBJ file)
+	m_objTris.vIdx[3*tri+idx] = GetVertexIndex( vIdx );
+	m_objTris.nIdx[3*tri+idx] = (format == IGLU_OBJ_FACET_VN || format == IGLU_OBJ_FACET_VTN) ? GetNormalIndex( nIdx ) : -1;
+	m_objTris.tIdx[3*tri+idx] = (format == IGLU_OBJ_FACET_VT || format == IGLU_OBJ_FACET_VTN) ? GetTextureIndex( tIdx ) : -1;
+}
+
 bool IGLUOBJReader::IsValidFLine(FnParserPtr *pPtr)
 {
 
@@ -580,26 +871,85 @@ void IGLUOBJReader::CenterAndResize( float *arr, int numVerts )
 	}
 }
 
-void IGLUOBJReader::GetCompactArrayBuffer( void )
+// namespace {  anonymous namespace for stuff used by GetCompactArrayBuffer()
+
+// An open-addressing hash table mapping a unique (vert, norm, texcoord, material, object)
+//    tuple to the index of the vertex we emitted for it in the compacted array buffer.
+//    Keys for each emitted vertex are stored (in emitted order) in 'keys', the table itself
+//    only stores indices into that list (or 0xFFFFFFFF for empty slots).
+struct IGLUOBJVertexHash
 {
-	// Create an OBJ vert ID -> element array vert ID map.  Init all entries to 0xFFFFFFFF.
-	//    Also, create mapping vertID -> last normal ID used for this vertex
-	//          create mapping vertID -> last tex coord used for this vertex
-	uint *vertMapping = (uint *)malloc( m_objVerts.size() * sizeof( uint ) );
-	uint *normMapping = (uint *)malloc( m_objVerts.size() * sizeof( uint ) );
-	uint *texMapping  = (uint *)malloc( m_objVerts.size() * sizeof( uint ) );
-	assert( vertMapping );
-	memset( vertMapping, 0xFF, m_objVerts.size() * sizeof( uint ) );
-	memset( normMapping, 0xFF, m_objVerts.size() * sizeof( uint ) );
-	memset( texMapping, 0xFF, m_objVerts.size() * sizeof( uint ) );
+	uint *table, *keys;
+	uint  tableSize, numKeys;
+
+	IGLUOBJVertexHash( uint maxKeys, uint expectedKeys ) : tableSize( 64 ), numKeys( 0 )
+	{
+		while (tableSize < 2*expectedKeys) tableSize *= 2;
+		table = (uint *)malloc( tableSize * sizeof( uint ) );
+		keys  = (uint *)malloc( 5 * (maxKeys > 0 ? maxKeys : 1) * sizeof( uint ) );
+		assert( table && keys );
+		memset( table, 0xFF, tableSize * sizeof( uint ) );
+	}
+	~IGLUOBJVertexHash() { free( table ); free( keys ); }
+
+	static uint Hash( const uint *key )
+	{
+		uint h = 2166136261u;
+		for (int i=0; i<5; i++)
+			h = (h ^ key[i]) * 16777619u;
+		return h ^ (h >> 15);
+	}
 
+	// Returns the index of an existing entry identical to key, or inserts key (as index
+	//    numKeys) and returns it.  'added' tells the caller which case happened.
+	uint FindOrAdd( const uint *key, bool *added )
+	{
+		uint slot = Hash( key ) & (tableSize-1);
+		while ( table[slot] != 0xFFFFFFFF )
+		{
+			const uint *cur = &keys[5*table[slot]];
+			if ( cur[0] == key[0] && cur[1] == key[1] && cur[2] == key[2] && cur[3] == key[3] && cur[4] == key[4] )
+			{
+				*added = false;
+				return table[slot];
+			}
+			slot = (slot+1) & (tableSize-1);
+		}
+		memcpy( &keys[5*numKeys], key, 5*sizeof( uint ) );
+		table[slot] = numKeys;
+		*added = true;
+		if ( 2*(++numKeys) > tableSize ) Grow();
+		return numKeys-1;
+	}
+
+	// Double the table size and reinsert all the keys
+	void Grow( void )
+	{
+		free( table );
+		tableSize *= 2;
+		table = (uint *)malloc( tableSize * sizeof( uint ) );
+		assert( table );
+		memset( table, 0xFF, tableSize * sizeof( uint ) );
+		for (uint i=0; i<numKeys; i++)
+		{
+			uint slot = Hash( &keys[5*i] ) & (tableSize-1);
+			while ( table[slot] != 0xFFFFFFFF ) slot = (slot+1) & (tableSize-1);
+			table[slot] = i;
+		}
+	}
+};
+
+// };  End: anonymous namespace
+
+void IGLUOBJReader::GetCompactArrayBuffer( void )
+{
 	//   We'll have 1 float for a material ID
+	//   We'll have 1 float for an object ID
 	//   We'll have 3 floats (x,y,z) for each of the 3 verts of each triangle 
 	//   We'll have 3 floats (x,y,z) for each of the 3 normals of each triangle
 	//   We'll have 2 floats (u,v) for each of the 3 texture coordinates of each triangle
 	uint  numComponents = 1 + 1 + 3 + (m_hasNormals ? 3 : 0) + (m_hasTexCoords ? 2 : 0);
 
-	float bufSz  = numComponents * sizeof( float ) * (3 * m_objTris.size());
 	m_vertStride = numComponents * sizeof( float );
 	m_matlIdOff  = 0 * sizeof( float );
 	m_objectIdOff = 1 * sizeof(float); 
@@ -607,88 +957,104 @@ void IGLUOBJReader::GetCompactArrayBuffer( void )
 	m_normOff    = (m_hasNormals ? 5 : 0) * sizeof( float );
 	m_texOff     = (m_hasTexCoords ? (m_hasNormals ? 8 : 5) : 0) * sizeof( float );
 
-	// Create a vertex buffer for us to fill up.
-	float *tmpBuf = (float *)malloc( bufSz );
+	// We'll need to know the size of our two arrays
+	uint numArrayElements = 3 * m_objTris.size();  // Known in advance
+	uint numArrayVerts    = 0;                     // Depends on how many verts are reused.  We'll compute
+
+	// Each unique (vertex, normal, texcoord, material, object) combination becomes exactly one 
+	//    vertex in our array buffer.  (Anything AddDataToArray() doesn't store is ignored.)  We 
+	//    expect roughly as many unique combinations as there are OBJ vertices.
+	IGLUOBJVertexHash vertHash( numArrayElements, m_objVerts.size() );
 
 	// Create an element array buffer to fill up
 	uint elembufSz = 3 * sizeof( unsigned int ) * m_objTris.size();
 	uint *tmpElemBuf = m_elementArray = (uint *)malloc( elembufSz );
 
-	// We'll need to know the size of our two arrays
-	int numArrayElements = 3 * m_objTris.size();  // Known in advance
-	int numArrayVerts    = 0;                     // Depends on how many verts are reused.  We'll compute
-
-	for (uint i=0, triNum=0; triNum < m_objTris.size(); i+=3,triNum++ )
+	for (uint i=0; i < numArrayElements; i++)
 	{
-		int i0 = m_objTris[triNum]->vIdx[0];
-		int i1 = m_objTris[triNum]->vIdx[1];
-		int i2 = m_objTris[triNum]->vIdx[2];
+		uint key[5] = { uint( m_objTris.vIdx[i] ), 
+			            m_hasNormals ? uint( m_objTris.nIdx[i] ) : 0, 
+						m_hasTexCoords ? uint( m_objTris.tIdx[i] ) : 0,
+						m_loadMtlFile ? uint( m_objTris.matlID[i/3] ) : 0,
+						m_assignObjects ? uint( m_objTris.objectID[i/3] ) : 0 };
+		bool added;
+		tmpElemBuf[i] = vertHash.FindOrAdd( key, &added );
+	}
+	numArrayVerts = vertHash.numKeys;
 
-		if (    (vertMapping[i0] == 0xFFFFFFFF) // We haven't seen this vertex yet.  push_back to list
-		     || (m_hasNormals && normMapping[i0] != m_objTris[triNum]->nIdx[0])     // We saw this vertex...  but w/different normal
-			 || (m_hasTexCoords && texMapping[i0] != m_objTris[triNum]->tIdx[0]) )  // We saw this vertex...  but w/different texcoord
-		{
-			AddDataToArray( tmpBuf, numArrayVerts*numComponents, m_objTris[triNum]->matlID, 
-							m_objTris[triNum]->objectID,
-							&m_objVerts[m_objTris[triNum]->vIdx[0]], 
-							m_hasNormals ? &m_objNorms[m_objTris[triNum]->nIdx[0]] : 0, 
-							m_hasTexCoords ? &m_objTexCoords[m_objTris[triNum]->tIdx[0]] : 0 );
-			tmpElemBuf[i]   = numArrayVerts;
-			vertMapping[i0] = numArrayVerts++;
-			normMapping[i0] = m_objTris[triNum]->nIdx[0];
-			texMapping[i0]  = m_objTris[triNum]->tIdx[0];
-		}
-		else                               // We've already seen vertex; reuse it.
-			tmpElemBuf[i] = vertMapping[i0];
+	// If asked, reorder the triangles for the vertex cache, then renumber the vertices in the
+	//    order they're used (by shuffling the keys, since we haven't created vertices yet).
+	if (m_optimize)
+	{
+		m_unoptimizedStats = IGLUMeshOptimizer::AnalyzeVertexCache( tmpElemBuf, numArrayElements, numArrayVerts );
 
-		if (    (vertMapping[i1] == 0xFFFFFFFF) // We haven't seen this vertex yet.  push_back to list
-		     || (m_hasNormals && normMapping[i1] != m_objTris[triNum]->nIdx[1])     // We saw this vertex...  but w/different normal
-			 || (m_hasTexCoords && texMapping[i1] != m_objTris[triNum]->tIdx[1]) )  // We saw this vertex...  but w/different texcoord
+		float *positions = 0;
+		if (m_optimizeOverdraw)
 		{
-			AddDataToArray( tmpBuf, numArrayVerts*numComponents, m_objTris[triNum]->matlID, 
-							m_objTris[triNum]->objectID,
-							&m_objVerts[m_objTris[triNum]->vIdx[1]], 
-							m_hasNormals ? &m_objNorms[m_objTris[triNum]->nIdx[1]] : 0, 
-							m_hasTexCoords ? &m_objTexCoords[m_objTris[triNum]->tIdx[1]] : 0 );
-			tmpElemBuf[i+1]   = numArrayVerts;
-			vertMapping[i1] = numArrayVerts++;
-			normMapping[i1] = m_objTris[triNum]->nIdx[1];
-			texMapping[i1]  = m_objTris[triNum]->tIdx[1];
+			positions = (float *)malloc( 3 * sizeof( float ) * (numArrayVerts > 0 ? numArrayVerts : 1) );
+			for (uint i=0; i < numArrayVerts; i++)
+			{
+				vec3 &pos = m_objVerts[ int( vertHash.keys[5*i] ) ];
+				positions[3*i+0] = pos.X();
+				positions[3*i+1] = pos.Y();
+				positions[3*i+2] = pos.Z();
+			}
 		}
-		else                               // We've already seen vertex; reuse it.
-			tmpElemBuf[i+1] = vertMapping[i1];
+		IGLUMeshOptimizer::OptimizeVertexCache( tmpElemBuf, numArrayElements, numArrayVerts, 
+			                                    IGLU_VERTEX_CACHE_SIZE, positions );
+		IGLUMeshOptimizer::OptimizeVertexFetch( tmpElemBuf, numArrayElements, vertHash.keys, 
+			                                    numArrayVerts, 5*sizeof( uint ) );
+		free( positions );
+	}
 
-		if (    (vertMapping[i2] == 0xFFFFFFFF) // We haven't seen this vertex yet.  push_back to list
-		     || (m_hasNormals && normMapping[i2] != m_objTris[triNum]->nIdx[2])     // We saw this vertex...  but w/different normal
-			 || (m_hasTexCoords && texMapping[i2] != m_objTris[triNum]->tIdx[2]) )  // We saw this vertex...  but w/different texcoord
-		{
-			AddDataToArray( tmpBuf, numArrayVerts*numComponents, m_objTris[triNum]->matlID, 
-							m_objTris[triNum]->objectID,
-							&m_objVerts[m_objTris[triNum]->vIdx[2]], 
-							m_hasNormals ? &m_objNorms[m_objTris[triNum]->nIdx[2]] : 0, 
-							m_hasTexCoords ? &m_objTexCoords[m_objTris[triNum]->tIdx[2]] : 0 );
-			tmpElemBuf[i+2]   = numArrayVerts;
-			vertMapping[i2] = numArrayVerts++;
-			normMapping[i2] = m_objTris[triNum]->nIdx[2];
-			texMapping[i2]  = m_objTris[triNum]->tIdx[2];
-		}
-		else                               // We've already seen vertex; reuse it.
-			tmpElemBuf[i+2] = vertMapping[i2];
+	// Create a vertex buffer for us to fill up (now that we know how big it is), then copy
+	//    the data for each unique vertex into it.
+	float *tmpBuf = (float *)malloc( numComponents * sizeof( float ) * (numArrayVerts > 0 ? numArrayVerts : 1) );
+	for (uint i=0; i < numArrayVerts; i++)
+	{
+		uint *key = &vertHash.keys[5*i];
+		AddDataToArray( tmpBuf, i*numComponents, int( key[3] ), int( key[4] ),
+						&m_objVerts[int( key[0] )], 
+						m_hasNormals ? &m_objNorms[int( key[1] )] : 0, 
+						m_hasTexCoords ? &m_objTexCoords[int( key[2] )] : 0 );
 	}
 
 	// If the user asked us to resize & center the object, do that.
 	if (m_resize || m_center)
 		CenterAndResize( tmpBuf, numArrayVerts );
 
+	// Group the triangles into clusters, if asked.  (This needs the final positions.)
+	m_numTris       = m_objTris.size();
+	m_numArrayVerts = numArrayVerts;
+	if (m_buildDrawRanges)
+		SortIntoDrawRanges( tmpBuf );
+	if (m_buildClusters)
+		BuildClusters( tmpBuf );
+
+	// Append coarser levels of detail to the element array, if asked
+	if (m_buildLods)
+		BuildLODs( tmpBuf );
+
+	// Convert to any compact encodings the user asked for
+	void *vertData = PackVertexArray( tmpBuf, numArrayVerts );
+
 	// Copy our arrays into their GPU buffers
-	m_vertArr->SetVertexArray( numArrayVerts * m_vertStride, tmpBuf, IGLU_STATIC|IGLU_DRAW );
-	m_vertArr->SetElementArray( GL_UNSIGNED_INT, elembufSz, tmpElemBuf, IGLU_STATIC|IGLU_DRAW );
+	UploadVertexArray( numArrayVerts * m_vertStride, vertData );
+	UploadElementArray();
+
+	// Save everything to our binary cache, if we're using one
+	if (m_cacheFile)
+		SaveCache( vertData, numArrayVerts );
 
 	// Free our temporary copy of the data
+	if (vertData != tmpBuf) free( vertData );
 	free( tmpBuf );
 	//free( tmpElemBuf );
-	free( vertMapping );
-	
+}
+
+IGLUVertexCacheStats IGLUOBJReader::GetVertexCacheStats( uint cacheSize ) const
+{
+	return IGLUMeshOptimizer::AnalyzeVertexCache( m_elementArray, 3*m_numTris, m_numArrayVerts, cacheSize );
 }
 
 void IGLUOBJReader::GetArrayBuffer( void )
@@ -715,33 +1081,48 @@ void IGLUOBJReader::GetArrayBuffer( void )
 	// For our very, very early reader, we'll use the MOST NAIVE approach
 	for (uint i=0, triNum=0; i<3*numComponents*m_objTris.size(); i+=3*numComponents,triNum++ )
 	{
-		AddDataToArray( tmpBuf, i, m_objTris[triNum]->matlID,
-						m_objTris[triNum]->objectID,
-			            &m_objVerts[m_objTris[triNum]->vIdx[0]], 
-						m_hasNormals ? &m_objNorms[m_objTris[triNum]->nIdx[0]] : 0, 
-						m_hasTexCoords ? &m_objTexCoords[m_objTris[triNum]->tIdx[0]] : 0 );
+		AddDataToArray( tmpBuf, i, m_objTris.matlID[triNum],
+						m_objTris.objectID[triNum],
+			            &m_objVerts[m_objTris.vIdx[3*triNum+0]], 
+						m_hasNormals ? &m_objNorms[m_objTris.nIdx[3*triNum+0]] : 0, 
+						m_hasTexCoords ? &m_objTexCoords[m_objTris.tIdx[3*triNum+0]] : 0 );
 		
-		AddDataToArray( tmpBuf, i+numComponents, m_objTris[triNum]->matlID,
-						m_objTris[triNum]->objectID,
-			            &m_objVerts[m_objTris[triNum]->vIdx[1]], 
-						m_hasNormals ? &m_objNorms[m_objTris[triNum]->nIdx[1]] : 0, 
-						m_hasTexCoords ? &m_objTexCoords[m_objTris[triNum]->tIdx[1]] : 0 );
+		AddDataToArray( tmpBuf, i+numComponents, m_objTris.matlID[triNum],
+						m_objTris.objectID[triNum],
+			            &m_objVerts[m_objTris.vIdx[3*triNum+1]], 
+						m_hasNormals ? &m_objNorms[m_objTris.nIdx[3*triNum+1]] : 0, 
+						m_hasTexCoords ? &m_objTexCoords[m_objTris.tIdx[3*triNum+1]] : 0 );
 		
-		AddDataToArray( tmpBuf, i+2*numComponents, m_objTris[triNum]->matlID,
-						m_objTris[triNum]->objectID,
-			            &m_objVerts[m_objTris[triNum]->vIdx[2]], 
-						m_hasNormals ? &m_objNorms[m_objTris[triNum]->nIdx[2]] : 0, 
-						m_hasTexCoords ? &m_objTexCoords[m_objTris[triNum]->tIdx[2]] : 0 );
+		AddDataToArray( tmpBuf, i+2*numComponents, m_objTris.matlID[triNum],
+						m_objTris.objectID[triNum],
+			            &m_objVerts[m_objTris.vIdx[3*triNum+2]], 
+						m_hasNormals ? &m_objNorms[m_objTris.nIdx[3*triNum+2]] : 0, 
+						m_hasTexCoords ? &m_objTexCoords[m_objTris.tIdx[3*triNum+2]] : 0 );
 	}
 
 	// If the user asked us to resize & center the object, do that.
 	if (m_resize || m_center)
 		CenterAndResize( tmpBuf, 3 * m_objTris.size() );
 
+	// Sort the element array by material & object (see GetElementArrayBuffer()), if asked
+	if (m_buildDrawRanges)
+	{
+		SortIntoDrawRanges( tmpBuf );
+		UploadElementArray();
+	}
+
+	// Convert to any compact encodings the user asked for
+	void *vertData = PackVertexArray( tmpBuf, 3 * m_objTris.size() );
+
 	// Copy our element array into the buffer
-	m_vertArr->SetVertexArray( bufSz, tmpBuf, IGLU_STATIC|IGLU_DRAW );
+	UploadVertexArray( 3 * m_objTris.size() * m_vertStride, vertData );
+
+	// Save everything to our binary cache, if we're using one
+	if (m_cacheFile)
+		SaveCache( vertData, 3 * m_objTris.size() );
 
 	// Free our temporary copy of the data
+	if (vertData != tmpBuf) free( vertData );
 	free( tmpBuf );
 }
 
@@ -762,33 +1143,194 @@ void IGLUOBJReader::GetElementArrayBuffer( void )
 	for (uint i=0; i<3*m_objTris.size(); i++)
 		tmpBuf[i] = i;
 
-	// Copy our element array into the buffer
-	m_vertArr->SetElementArray( GL_UNSIGNED_INT, bufSz, tmpBuf, IGLU_STATIC|IGLU_DRAW );
+	// Copy our element array into the buffer.  (With draw ranges, GetArrayBuffer() first sorts it
+	//    using the material & object IDs in the vertex array.)
+	m_numTris       = m_objTris.size();
+	m_numArrayVerts = 3 * m_objTris.size();
+	if (!m_buildDrawRanges)
+		UploadElementArray();
 
 	// Free our temporary copy of the data
 	//free( tmpBuf );
 }
+void IGLUOBJReader::BuildClusters( const float *floatBuf )
+{
+	if (m_drawRanges.empty())
+	{
+		IGLUMeshOptimizer::BuildClusters( m_elementArray, 3*m_numTris, m_numArrayVerts, 
+			                              floatBuf + m_vertOff/sizeof(float), m_vertStride,
+										  IGLU_OBJ_CLUSTER_TRIANGLES, m_clusters );
+		UploadClusters();
+		return;
+	}
+
+	// Cluster each draw range separately, so a cluster never mixes materials or objects
+	std::vector<IGLUMeshCluster> rangeClusters;
+	m_clusters.clear();
+	for (uint i=0; i<m_drawRanges.size(); i++)
+	{
+		const IGLUOBJDrawRange &range = m_drawRanges[i];
+		IGLUMeshOptimizer::BuildClusters( m_elementArray + range.firstIndex, range.indexCount, m_numArrayVerts, 
+			                              floatBuf + m_vertOff/sizeof(float), m_vertStride,
+										  IGLU_OBJ_CLUSTER_TRIANGLES, rangeClusters );
+		for (uint j=0; j<rangeClusters.size(); j++)
+		{
+			rangeClusters[j].firstIndex += range.firstIndex;
+			m_clusters.push_back( rangeClusters[j] );
+		}
+	}
+	UploadClusters();
+}
+
+void IGLUOBJReader::BuildLODs( const float *floatBuf )
+{
+	// Each level is simplified from the one before it, so we need room for the new level
+	//    after all the existing ones.
+	std::vector<uint> indices( m_elementArray, m_elementArray + 3*m_numTris );
+	IGLUOBJLod lod = { 0, 3*m_numTris, 0.0f };
+	m_lods.clear();
+	m_lods.push_back( lod );
+	while (m_lods.size() < IGLU_OBJ_LOD_LEVELS)
+	{
+		IGLUOBJLod prev = m_lods.back();
+		uint target = (prev.indexCount / 6) * 3;
+		indices.resize( prev.firstIndex + 2*prev.indexCount );
+
+		float error;
+		uint *newLevel = &indices[ prev.firstIndex + prev.indexCount ];
+		uint count = IGLUMeshSimplifier::Simplify( newLevel, &indices[ prev.firstIndex ], prev.indexCount,
+			                                       floatBuf + m_vertOff/sizeof(float), m_vertStride, 
+												   m_numArrayVerts, target, 1.0f, &error );
+
+		// Stop once simplification stalls (e.g., everything left is on seams or borders)
+		if (count == 0 || count > prev.indexCount - prev.indexCount/10)
+			break;
+		if (m_optimize)
+			IGLUMeshOptimizer::OptimizeVertexCache( newLevel, count, m_numArrayVerts );
+
+		lod.firstIndex = prev.firstIndex + prev.indexCount;
+		lod.indexCount = count;
+		lod.error      = error > prev.error ? error : prev.error;
+		m_lods.push_back( lod );
+	}
+	indices.resize( m_lods.back().firstIndex + m_lods.back().indexCount );
+
+	free( m_elementArray );
+	m_elementArray = (uint *)malloc( indices.size() * sizeof( uint ) );
+	memcpy( m_elementArray, &indices[0], indices.size() * sizeof( uint ) );
+}
+
+uint IGLUOBJReader::GetElementCount( void ) const
+{
+	return m_lods.empty() ? 3*m_numTris : m_lods.back().firstIndex + m_lods.back().indexCount;
+}
+
+IGLUOBJLod IGLUOBJReader::GetLOD( uint lod ) const
+{
+	if (m_lods.empty())
+	{
+		IGLUOBJLod full = { 0, 3*m_numTris, 0.0f };
+		return full;
+	}
+	return m_lods[ lod < m_lods.size() ? lod : m_lods.size()-1 ];
+}
+
+uint IGLUOBJReader::SelectLOD( float projectedSize, float maxPixelError ) const
+{
+	uint lod = 0;
+	for (uint i=1; i<m_lods.size(); i++)
+		if (m_lods[i].error * projectedSize <= maxPixelError)
+			lod = i;
+	return lod;
+}
+
+float IGLUOBJReader::GetProjectedSize( float size, float distance, float fovy, float viewportHeight )
+{
+	if (distance <= 0) return FLT_MAX;
+	return size * viewportHeight / (2.0f * distance * tanf( fovy * 0.5f * 3.14159265f / 180.0f ));
+}
+
+void IGLUOBJReader::GetDrawRange( uint *count, uint *offsetBytes ) const
+{
+	IGLUOBJLod lod = GetLOD( m_drawLod );
+	*count       = lod.indexCount;
+	*offsetBytes = lod.firstIndex * (UseShortIndices() ? sizeof( unsigned short ) : sizeof( uint ));
+}
+
+void IGLUOBJReader::UploadClusters( void )
+{
+	if (m_deferUpload) return;   // UploadToGPU() will do it
+	if (!m_clusterBuf)
+		m_clusterBuf = new IGLUBuffer( IGLU_TEXTURE );
+	m_clusterBuf->SetBufferData( m_clusters.size() * sizeof( IGLUMeshCluster ), 
+		                         m_clusters.size() ? &m_clusters[0] : 0, IGLU_STATIC|IGLU_DRAW );
+}
+
+void IGLUOBJReader::UploadVertexArray( size_t bytes, const void *data )
+{
+	if (!m_deferUpload)
+	{
+		m_vertArr->SetVertexArray( GLsizeiptr( bytes ), (void *)data, IGLU_STATIC|IGLU_DRAW );
+		return;
+	}
+
+	free( m_deferredVerts );
+	m_deferredVerts     = malloc( bytes > 0 ? bytes : 1 );
+	m_deferredVertBytes = bytes;
+	memcpy( m_deferredVerts, data, bytes );
+}
+
+bool IGLUOBJReader::UploadToGPU( void )
+{
+	if (!m_deferUpload) return false;
+
+	// Everything below checks m_deferUpload to decide whether to upload or wait, so stop waiting
+	m_deferUpload = false;
+	m_vertArr = new IGLUVertexArray();
+	if (m_deferredVerts)
+		UploadVertexArray( m_deferredVertBytes, m_deferredVerts );
+	if (m_elementArray)
+		UploadElementArray();
+	if (m_buildClusters)
+		UploadClusters();
+
+	free( m_deferredVerts );
+	m_deferredVerts     = 0;
+	m_deferredVertBytes = 0;
+	return true;
+}
+
+void IGLUOBJReader::EnableVertexAttributes( void )
+{
+	// What format is each of our attributes in?  (See PackVertexArray().)  Packed positions,
+	//    normals and texcoords are converted to floats by OpenGL;  IDs are passed as (unnormalized)
+	//    integers, so they reach the shader as the same float values as unpacked IDs.
+	GLenum vertType = (m_packing & IGLU_OBJ_UNORM16_POSITIONS) ? GL_UNSIGNED_SHORT : 
+		              ((m_packing & IGLU_OBJ_HALF_POSITIONS) ? GL_HALF_FLOAT : GL_FLOAT);
+	bool   octNorms = (m_packing & IGLU_OBJ_OCT_NORMALS) ? true : false;
+	GLenum texType  = (m_packing & IGLU_OBJ_HALF_TEXCOORDS) ? GL_HALF_FLOAT : GL_FLOAT;
+
+	m_vertArr->EnableAttribute( IGLU_ATTRIB_VERTEX, 3, vertType, m_vertStride, BUFFER_OFFSET(m_vertOff),
+		                        -1, vertType == GL_UNSIGNED_SHORT );
+	if (HasNormals())   m_vertArr->EnableAttribute( IGLU_ATTRIB_NORMAL, octNorms ? 2 : 3, octNorms ? GL_SHORT : GL_FLOAT, 
+		                                            m_vertStride, BUFFER_OFFSET(m_normOff), -1, octNorms );
+	if (HasTexCoords()) m_vertArr->EnableAttribute( IGLU_ATTRIB_TEXCOORD, 
+		                                            2, texType, m_vertStride, BUFFER_OFFSET(m_texOff));
+	if (HasMatlID())    m_vertArr->EnableAttribute( IGLU_ATTRIB_MATL_ID, 
+		                                            1, m_idType, m_vertStride, BUFFER_OFFSET(m_matlIdOff));
+	if (HasObjectID())  m_vertArr->EnableAttribute( IGLU_ATTRIB_OBJECT_ID, 
+                                                    1, m_idType, m_vertStride, BUFFER_OFFSET(m_objectIdOff));
+}
+
 int IGLUOBJReader::SetupVertexArrayForGI( IGLUShaderProgram::Ptr & shader, IGLUBuffer::Ptr &InstanceBO)
 {
 	bool vertAvail = HasVertices();   // && (shader[ iglu::IGLU_ATTRIB_VERTEX ] != 0);
-	bool normAvail = HasNormals();    // && (shader[ iglu::IGLU_ATTRIB_NORMAL ] != 0);
-	bool texAvail  = HasTexCoords();  // && (shader[ iglu::IGLU_ATTRIB_TEXCOORD ] != 0);
-	bool matlAvail = HasMatlID();     // && (shader[ iglu::IGLU_ATTRIB_MATL_ID ] != 0);
-	bool objectAvail = HasObjectID(); // && (shader[iglu::IGLU_ATTRIB_OBJECT_ID] != 0);
 
 	// We need *at least* a vertex semantic
 	if (!vertAvail) return IGLU_ERROR_NO_GLSL_VERTEX_SEMANTIC;
 
 	// Setup the attributes needed for this geometry
-	m_vertArr->EnableAttribute( IGLU_ATTRIB_VERTEX, 3, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_vertOff));
-	if (normAvail)  m_vertArr->EnableAttribute( IGLU_ATTRIB_NORMAL, 
-		                                        3, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_normOff));
-	if (texAvail)   m_vertArr->EnableAttribute( IGLU_ATTRIB_TEXCOORD, 
-		                                        2, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_texOff));
-	if (matlAvail)  m_vertArr->EnableAttribute( IGLU_ATTRIB_MATL_ID, 
-		                                        1, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_matlIdOff));
-	if(objectAvail) m_vertArr->EnableAttribute( IGLU_ATTRIB_OBJECT_ID, 
-                                                1, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_objectIdOff));
+	EnableVertexAttributes();
 	// we bind here the instance data buffer
 	m_vertArr->Bind();
 	InstanceBO->Bind();
@@ -810,24 +1352,12 @@ int IGLUOBJReader::SetupVertexArrayForGI( IGLUShaderProgram::Ptr & shader, IGLUB
 int IGLUOBJReader::SetupVertexArrayForGI( IGLUShaderProgram::Ptr & shader, GLuint bufferId)
 {
 	bool vertAvail = HasVertices();   // && (shader[ iglu::IGLU_ATTRIB_VERTEX ] != 0);
-	bool normAvail = HasNormals();    // && (shader[ iglu::IGLU_ATTRIB_NORMAL ] != 0);
-	bool texAvail  = HasTexCoords();  // && (shader[ iglu::IGLU_ATTRIB_TEXCOORD ] != 0);
-	bool matlAvail = HasMatlID();     // && (shader[ iglu::IGLU_ATTRIB_MATL_ID ] != 0);
-	bool objectAvail = HasObjectID(); // && (shader[iglu::IGLU_ATTRIB_OBJECT_ID] != 0);
 
 	// We need *at least* a vertex semantic
 	if (!vertAvail) return IGLU_ERROR_NO_GLSL_VERTEX_SEMANTIC;
 
 	// Setup the attributes needed for this geometry
-	m_vertArr->EnableAttribute( IGLU_ATTRIB_VERTEX, 3, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_vertOff));
-	if (normAvail)  m_vertArr->EnableAttribute( IGLU_ATTRIB_NORMAL, 
-		                                        3, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_normOff));
-	if (texAvail)   m_vertArr->EnableAttribute( IGLU_ATTRIB_TEXCOORD, 
-		                                        2, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_texOff));
-	if (matlAvail)  m_vertArr->EnableAttribute( IGLU_ATTRIB_MATL_ID, 
-		                                        1, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_matlIdOff));
-	if(objectAvail) m_vertArr->EnableAttribute( IGLU_ATTRIB_OBJECT_ID, 
-                                                1, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_objectIdOff));
+	EnableVertexAttributes();
 		// we bind here the instance data buffer
 	//InstanceBO->Bind();
 	m_vertArr->Bind();
@@ -860,24 +1390,12 @@ int IGLUOBJReader::SetupVertexArray( IGLUShaderProgram::Ptr & )//shader )
 	//      *always* pass down all attributes enabled by the geometry to their assigned
 	//      attribute slot.  If there's no such attribute, GLSL simply won't use it!
 	bool vertAvail = HasVertices();   // && (shader[ iglu::IGLU_ATTRIB_VERTEX ] != 0);
-	bool normAvail = HasNormals();    // && (shader[ iglu::IGLU_ATTRIB_NORMAL ] != 0);
-	bool texAvail  = HasTexCoords();  // && (shader[ iglu::IGLU_ATTRIB_TEXCOORD ] != 0);
-	bool matlAvail = HasMatlID();     // && (shader[ iglu::IGLU_ATTRIB_MATL_ID ] != 0);
-	bool objectAvail = HasObjectID(); // && (shader[iglu::IGLU_ATTRIB_OBJECT_ID] != 0);
 
 	// We need *at least* a vertex semantic
 	if (!vertAvail) return IGLU_ERROR_NO_GLSL_VERTEX_SEMANTIC;
 
 	// Setup the attributes needed for this geometry
-	m_vertArr->EnableAttribute( IGLU_ATTRIB_VERTEX, 3, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_vertOff));
-	if (normAvail)  m_vertArr->EnableAttribute( IGLU_ATTRIB_NORMAL, 
-		                                        3, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_normOff));
-	if (texAvail)   m_vertArr->EnableAttribute( IGLU_ATTRIB_TEXCOORD, 
-		                                        2, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_texOff));
-	if (matlAvail)  m_vertArr->EnableAttribute( IGLU_ATTRIB_MATL_ID, 
-		                                        1, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_matlIdOff));
-	if(objectAvail) m_vertArr->EnableAttribute( IGLU_ATTRIB_OBJECT_ID, 
-                                                1, GL_FLOAT, m_vertStride, BUFFER_OFFSET(m_objectIdOff));
+	EnableVertexAttributes();
 	return IGLU_NO_ERROR;
 }
 
@@ -900,7 +1418,9 @@ int IGLUOBJReader::DrawMultipleInstances(IGLUShaderProgram::Ptr & shader,  IGLUB
 			return err;
 	}
 
-	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, 3* GetTriangleCount(),numOfInstances);
+	uint count, offsetBytes;
+	GetDrawRange( &count, &offsetBytes );
+	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, count, numOfInstances, offsetBytes);
 	// If we started with the shader disabled, disable it again now.
 	if (!wasShaderBound)
 		shader->Disable();
@@ -927,7 +1447,9 @@ int IGLUOBJReader::DrawMultipleInstances(IGLUShaderProgram::Ptr & shader,  GLuin
 			return err;
 	}
 
-	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, 3* GetTriangleCount(),numOfInstances);
+	uint count, offsetBytes;
+	GetDrawRange( &count, &offsetBytes );
+	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, count, numOfInstances, offsetBytes);
 	// If we started with the shader disabled, disable it again now.
 	if (!wasShaderBound)
 		shader->Disable();
@@ -955,7 +1477,9 @@ int IGLUOBJReader::DrawMultipleInstances(IGLUShaderProgram::Ptr & shader, IGLUTe
 			return err;
 	}
 	
-	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, 3* GetTriangleCount(),numOfInstances);
+	uint count, offsetBytes;
+	GetDrawRange( &count, &offsetBytes );
+	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, count, numOfInstances, offsetBytes);
 	// If we started with the shader disabled, disable it again now.
 	if (!wasShaderBound)
 		shader->Disable();
@@ -982,7 +1506,9 @@ int IGLUOBJReader::DrawMultipleInstances(IGLUShaderProgram::Ptr & shader,  int n
 		if (err != IGLU_NO_ERROR)
 			return err;
 	}
-	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, 3* GetTriangleCount(),numOfInstances);
+	uint count, offsetBytes;
+	GetDrawRange( &count, &offsetBytes );
+	m_vertArr->DrawElementsInstanced(GL_TRIANGLES, count, numOfInstances, offsetBytes);
 	// If we started with the shader disabled, disable it again now.
 	if (!wasShaderBound)
 		shader->Disable();
@@ -1007,7 +1533,9 @@ int IGLUOBJReader::Draw( IGLUShaderProgram::Ptr &shader )
 			return err;
 	}
 
-	m_vertArr->DrawElements( GL_TRIANGLES, 3* GetTriangleCount() );
+	uint count, offsetBytes;
+	GetDrawRange( &count, &offsetBytes );
+	m_vertArr->DrawElements( GL_TRIANGLES, count, offsetBytes );
 
 	// If we started with the shader disabled, disable it again now.
 	if (!wasShaderBound)
@@ -0,0 +1,354 @@
+/******************************************************************/
+/* igluOBJReaderCache.cpp                                         */
+/* -----------------------                                        */
+/*                                                                */
+/* A binary cache for IGLUOBJReader.  The cache holds the final,  */
+/*    GPU-ready vertex and element arrays, so later runs can map  */
+/*    the cache and upload it directly without parsing the OBJ.   */
+/*                                                                */
+/******************************************************************/
+
+#include "iglu.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace iglu;
+#define s_matl  IGLUOBJMaterialReader::s_matl
+
+// Bump this whenever the cache layout (or the way our buffers are built) changes
+#define IGLU_OBJ_CACHE_VERSION   5
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// The header at the start of each cache file.  Offsets are from the start of the file.
+struct IGLUOBJCacheHeader
+{
+	char               magic[8];          // "IGLUOBJ"
+	unsigned int       version;           // IGLU_OBJ_CACHE_VERSION
+	unsigned int       options;           // Reader options that change the buffers (see CacheOptions())
+	unsigned long long fileSize;          // Size of the entire cache (catches partially written files)
+
+	// Identifies the OBJ file this cache was built from
+	unsigned long long srcSize;
+	long long          srcModTime;
+	unsigned long long srcHash;
+
+	// Describes the cached data
+	unsigned int       hasFlags;          // Bit 0: vertices, bit 1: normals, bit 2: texture coords
+	unsigned int       vertStride, vertOff, normOff, texOff, matlIdOff, objectIdOff;
+	unsigned int       numArrayVerts, numTris, numVaoFloats;
+	unsigned int       numMtlFiles, numMatlNames;
+	unsigned int       idType;            // GL type of the material & object IDs
+	float              posScale[3], posOffset[3];
+	unsigned int       numClusters;
+	unsigned int       numLods, numIndices;
+
+	// Where the data lives.  The string tables are lists of null-terminated strings.
+	unsigned long long mtlFilesOff, matlNamesOff, vertDataOff, elemDataOff, vaoVertsOff, clustersOff, lodsOff;
+};
+
+// Bits identifying the reader options that affect what ends up in the buffers
+static unsigned int CacheOptions( bool resize, bool center, bool compact, bool loadMtl, bool assignObjects,
+								  bool optimize, bool optimizeOverdraw, unsigned int packing, bool clusters,
+								  bool lods, bool drawRanges )
+{
+	return (resize ? 0x01 : 0) | (center ? 0x02 : 0) | (compact ? 0x04 : 0) |
+		   (loadMtl ? 0x08 : 0) | (assignObjects ? 0x10 : 0) | (optimize ? 0x20 : 0) |
+		   (optimizeOverdraw ? 0x40 : 0) | (clusters ? 0x80 : 0) | (lods ? 0x100 : 0) | packing |  // (Packing flags are all above 0x100)
+		   (drawRanges ? 0x80000000u : 0);                                                        //    (and well below this one)
+}
+
+// Gets the size & modification time of a file.  Returns false if the file doesn't exist.
+static bool GetSourceFileInfo( const char *filename, unsigned long long *size, long long *modTime )
+{
+#if defined(_MSC_VER)
+	struct _stat64 info;
+	if (_stat64( filename, &info ) != 0) return false;
+#else
+	struct stat info;
+	if (stat( filename, &info ) != 0) return false;
+#endif
+	*size    = (unsigned long long) info.st_size;
+	*modTime = (long long) info.st_mtime;
+	return true;
+}
+
+// A 64-bit FNV-1a hash of a file's contents.  We only need this when the OBJ's timestamp
+//    changes (e.g., it was copied or checked out again), to see if its contents did too.
+static unsigned long long HashFileContents( const char *filename )
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	IGLUMappedFile file( filename );
+	if (!file.IsValid()) return 0;
+
+	const unsigned char *ptr = (const unsigned char *)file.GetData();
+	const unsigned char *end = (const unsigned char *)file.GetEnd();
+	for ( ; ptr < end; ptr++ )
+	{
+		hash ^= *ptr;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Rounds a file offset up, so the arrays in the file are nicely aligned
+static unsigned long long AlignCacheOffset( unsigned long long offset )
+{
+	return (offset + 15) & ~15ULL;
+}
+
+// Writes data to the cache, first padding with zeros until the file reaches offset 'where'.
+static bool WriteCacheData( FILE *f, unsigned long long *curOffset, unsigned long long where,
+						    const void *data, size_t bytes )
+{
+	static const char zeros[16] = { 0 };
+	if (where > *curOffset && fwrite( zeros, 1, size_t(where - *curOffset), f ) != size_t(where - *curOffset))
+		return false;
+	if (bytes > 0 && fwrite( data, 1, bytes, f ) != bytes)
+		return false;
+	*curOffset = where + bytes;
+	return true;
+}
+
+// Checks the string table at [str, end) has (at least) numStrings null-terminated strings
+static bool IsValidStringTable( const char *str, const char *end, unsigned int numStrings )
+{
+	for (unsigned int i=0; i<numStrings; i++)
+	{
+		const char *strEnd = (str < end) ? (const char *)memchr( str, 0, end-str ) : 0;
+		if (!strEnd) return false;
+		str = strEnd+1;
+	}
+	return true;
+}
+
+// };  End: anonymous namespace
+
+
+void IGLUOBJReader::SaveCache( const void *vertBuf, uint numArrayVerts )
+{
+	IGLUOBJCacheHeader hdr;
+	memset( &hdr, 0, sizeof( hdr ) );
+	if (!GetSourceFileInfo( fileName, &hdr.srcSize, &hdr.srcModTime ))
+		return;
+
+	strcpy( hdr.magic, "IGLUOBJ" );
+	hdr.version       = IGLU_OBJ_CACHE_VERSION;
+	hdr.options       = CacheOptions( m_resize, m_center, m_compactFormat, m_loadMtlFile, m_assignObjects,
+	                                  m_optimize, m_optimizeOverdraw, m_packing, m_buildClusters, m_buildLods,
+	                                  m_buildDrawRanges );
+	hdr.srcHash       = HashFileContents( fileName );
+	hdr.hasFlags      = (m_hasVertices ? 0x1 : 0) | (m_hasNormals ? 0x2 : 0) | (m_hasTexCoords ? 0x4 : 0);
+	hdr.vertStride    = m_vertStride;
+	hdr.vertOff       = m_vertOff;
+	hdr.normOff       = m_normOff;
+	hdr.texOff        = m_texOff;
+	hdr.matlIdOff     = m_matlIdOff;
+	hdr.objectIdOff   = m_objectIdOff;
+	hdr.numArrayVerts = numArrayVerts;
+	hdr.numTris       = m_numTris;
+	hdr.numVaoFloats  = uint( m_vaoVerts.size() );
+	hdr.numMtlFiles   = uint( m_objMtlFiles.size() );
+	hdr.idType        = m_idType;
+	hdr.numClusters   = uint( m_clusters.size() );
+	hdr.numLods       = uint( m_lods.size() );
+	hdr.numIndices    = GetElementCount();
+	hdr.posScale[0]   = m_posScale.X();   hdr.posOffset[0] = m_posOffset.X();
+	hdr.posScale[1]   = m_posScale.Y();   hdr.posOffset[1] = m_posOffset.Y();
+	hdr.posScale[2]   = m_posScale.Z();   hdr.posOffset[2] = m_posOffset.Z();
+
+	// Material IDs index into the global material list, which depends on what was loaded
+	//    before us.  Store the names of the materials we use, so we can remap IDs on load.
+	uint maxMatlID = 0;
+	for (uint i=0; m_loadMtlFile && i<m_objTris.size(); i++)
+		if (uint(m_objTris.matlID[i]) > maxMatlID)
+			maxMatlID = uint(m_objTris.matlID[i]);
+	hdr.numMatlNames  = (m_loadMtlFile && m_objTris.size() > 0) ? maxMatlID+1 : 0;
+
+	// Material files are stored relative to the OBJ's directory, so the cache can move with the OBJ
+	size_t dirLen = strlen( fileDirectory ), mtlFilesSz = 0, matlNamesSz = 0;
+	for (uint i=0; i<hdr.numMtlFiles; i++)
+		mtlFilesSz += strlen( m_objMtlFiles[i] + dirLen ) + 1;
+	for (uint i=0; i<hdr.numMatlNames; i++)
+		matlNamesSz += (i < s_matl.Size() ? strlen( s_matl[i]->m_matlName ) : 0) + 1;
+
+	// Lay out the file
+	size_t vertDataSz = size_t(numArrayVerts) * m_vertStride;
+	size_t elemDataSz = sizeof( uint ) * size_t(hdr.numIndices);
+	size_t vaoVertsSz = sizeof( float ) * m_vaoVerts.size();
+	size_t clustersSz = sizeof( IGLUMeshCluster ) * m_clusters.size();
+	size_t lodsSz     = sizeof( IGLUOBJLod ) * m_lods.size();
+	hdr.mtlFilesOff   = sizeof( hdr );
+	hdr.matlNamesOff  = hdr.mtlFilesOff + mtlFilesSz;
+	hdr.vertDataOff   = AlignCacheOffset( hdr.matlNamesOff + matlNamesSz );
+	hdr.elemDataOff   = AlignCacheOffset( hdr.vertDataOff + vertDataSz );
+	hdr.vaoVertsOff   = AlignCacheOffset( hdr.elemDataOff + elemDataSz );
+	hdr.clustersOff   = AlignCacheOffset( hdr.vaoVertsOff + vaoVertsSz );
+	hdr.lodsOff       = AlignCacheOffset( hdr.clustersOff + clustersSz );
+	hdr.fileSize      = hdr.lodsOff + lodsSz;
+
+	FILE *f = fopen( m_cacheFile, "wb" );
+	if (!f)
+	{
+		this->WarningMessage( "Unable to create OBJ cache file '%s'", m_cacheFile );
+		return;
+	}
+
+	unsigned long long curOff = 0;
+	bool ok = WriteCacheData( f, &curOff, 0, &hdr, sizeof( hdr ) );
+	for (uint i=0; ok && i<hdr.numMtlFiles; i++)
+		ok = WriteCacheData( f, &curOff, curOff, m_objMtlFiles[i] + dirLen, strlen( m_objMtlFiles[i] + dirLen ) + 1 );
+	for (uint i=0; ok && i<hdr.numMatlNames; i++)
+	{
+		const char *name = (i < s_matl.Size()) ? s_matl[i]->m_matlName : "";
+		ok = WriteCacheData( f, &curOff, curOff, name, strlen( name ) + 1 );
+	}
+	ok = ok && WriteCacheData( f, &curOff, hdr.vertDataOff, vertBuf, vertDataSz );
+	ok = ok && WriteCacheData( f, &curOff, hdr.elemDataOff, m_elementArray, elemDataSz );
+	ok = ok && WriteCacheData( f, &curOff, hdr.vaoVertsOff, vaoVertsSz ? &m_vaoVerts[0] : 0, vaoVertsSz );
+	ok = ok && WriteCacheData( f, &curOff, hdr.clustersOff, clustersSz ? &m_clusters[0] : 0, clustersSz );
+	ok = ok && WriteCacheData( f, &curOff, hdr.lodsOff, lodsSz ? &m_lods[0] : 0, lodsSz );
+	fclose( f );
+
+	// Don't leave a partial cache lying around
+	if (!ok)
+	{
+		remove( m_cacheFile );
+		this->WarningMessage( "Unable to write OBJ cache file '%s'", m_cacheFile );
+	}
+}
+
+bool IGLUOBJReader::LoadCache( void )
+{
+	IGLUMappedFile cache( m_cacheFile );
+	if (!cache.IsValid() || cache.GetSize() < sizeof( IGLUOBJCacheHeader ))
+		return false;
+
+	// Make sure this cache was created with the same options, and is complete
+	IGLUOBJCacheHeader hdr;
+	const char *data = cache.GetData();
+	memcpy( &hdr, data, sizeof( hdr ) );
+	if ( memcmp( hdr.magic, "IGLUOBJ", 8 ) || hdr.version != IGLU_OBJ_CACHE_VERSION ||
+		 hdr.options != CacheOptions( m_resize, m_center, m_compactFormat, m_loadMtlFile, m_assignObjects,
+		                              m_optimize, m_optimizeOverdraw, m_packing, m_buildClusters, m_buildLods,
+		                              m_buildDrawRanges ) ||
+		 hdr.fileSize != (unsigned long long) cache.GetSize() )
+		return false;
+
+	// Make sure the OBJ hasn't changed since we built the cache.  If its timestamp changed,
+	//    check the contents; OBJs that are copied or checked out again are often identical.
+	unsigned long long srcSize;
+	long long srcModTime;
+	if (!GetSourceFileInfo( fileName, &srcSize, &srcModTime ) || srcSize != hdr.srcSize)
+		return false;
+	if (srcModTime != hdr.srcModTime && HashFileContents( fileName ) != hdr.srcHash)
+		return false;
+
+	// Sanity check the layout, in case the cache is corrupt
+	size_t vertDataSz = size_t(hdr.numArrayVerts) * hdr.vertStride;
+	size_t elemDataSz = sizeof( uint ) * size_t(hdr.numIndices);
+	size_t vaoVertsSz = sizeof( float ) * size_t(hdr.numVaoFloats);
+	size_t clustersSz = sizeof( IGLUMeshCluster ) * size_t(hdr.numClusters);
+	size_t lodsSz     = sizeof( IGLUOBJLod ) * size_t(hdr.numLods);
+	uint idSize = (hdr.idType == GL_UNSIGNED_SHORT) ? sizeof( unsigned short ) : sizeof( float );
+	if ( (hdr.idType != GL_FLOAT && hdr.idType != GL_UNSIGNED_SHORT && hdr.idType != GL_UNSIGNED_INT) ||
+		 hdr.vertStride == 0 || hdr.matlIdOff+idSize > hdr.vertStride || hdr.objectIdOff+idSize > hdr.vertStride ||
+		 hdr.vertDataOff + vertDataSz > hdr.fileSize || hdr.elemDataOff + elemDataSz > hdr.fileSize ||
+		 hdr.vaoVertsOff + vaoVertsSz > hdr.fileSize || hdr.clustersOff + clustersSz > hdr.fileSize || 
+		 hdr.lodsOff + lodsSz > hdr.fileSize || hdr.numIndices < 3*size_t(hdr.numTris) ||
+		 hdr.matlNamesOff > hdr.vertDataOff ||
+		 !IsValidStringTable( data + hdr.mtlFilesOff, data + hdr.matlNamesOff, hdr.numMtlFiles ) ||
+		 !IsValidStringTable( data + hdr.matlNamesOff, data + hdr.vertDataOff, hdr.numMatlNames ) )
+		return false;
+
+	// Make sure the levels of detail all lie within the element array
+	const IGLUOBJLod *lods = (const IGLUOBJLod *)(data + hdr.lodsOff);
+	for (uint i=0; i<hdr.numLods; i++)
+		if (size_t(lods[i].firstIndex) + lods[i].indexCount > hdr.numIndices)
+			return false;
+
+	// Load the material files, just as parsing the OBJ would have
+	const char *str = data + hdr.mtlFilesOff;
+	for (uint i=0; i<hdr.numMtlFiles; i++, str += strlen(str)+1)
+	{
+		char *mtlFilePtr = (char *)malloc( strlen(str)+strlen(fileDirectory)+1 );
+		sprintf( mtlFilePtr, "%s%s", fileDirectory, str );
+		m_objMtlFiles.push_back( mtlFilePtr );
+		if (m_loadMtlFile)
+			delete( new IGLUOBJMaterialReader( mtlFilePtr, m_deferUpload ));  // Load it.
+	}
+
+	// Find the current IDs of the materials used in the cache
+	std::vector<float> matlIDs( hdr.numMatlNames );
+	bool remapMaterials = false;
+	str = data + hdr.matlNamesOff;
+	for (uint i=0; i<hdr.numMatlNames; i++, str += strlen(str)+1)
+	{
+		int id = IGLUOBJMaterialReader::GetNamedMaterialId( (char *)str );
+		matlIDs[i] = float( id >= 0 ? id : 0 );
+		remapMaterials = remapMaterials || (id != int(i));
+	}
+
+	// Copy the vertex data straight from the cache to the GPU, unless we need to change
+	//    material IDs (in which case, we need a modified copy).  IDs may be stored as floats,
+	//    or as 16- or 32-bit integers (see PackVertexArray()).
+	const char *vertData = data + hdr.vertDataOff;
+	char *tmpBuf = 0;
+	if (!remapMaterials)
+		UploadVertexArray( vertDataSz, vertData );
+	else
+	{
+		tmpBuf = (char *)malloc( vertDataSz > 0 ? vertDataSz : 1 );
+		memcpy( tmpBuf, vertData, vertDataSz );
+		for (uint i=0; i<hdr.numArrayVerts; i++)
+		{
+			char *idPtr = tmpBuf + size_t(i)*hdr.vertStride + hdr.matlIdOff;
+			uint oldID = (hdr.idType == GL_UNSIGNED_SHORT) ? uint( *(unsigned short *)idPtr ) :
+				         ((hdr.idType == GL_UNSIGNED_INT) ? *(unsigned int *)idPtr : uint( *(float *)idPtr ));
+			if (oldID >= hdr.numMatlNames) continue;
+			if (hdr.idType == GL_UNSIGNED_SHORT)    *(unsigned short *)idPtr = (unsigned short)( matlIDs[oldID] );
+			else if (hdr.idType == GL_UNSIGNED_INT) *(unsigned int *)idPtr   = (unsigned int)( matlIDs[oldID] );
+			else                                    *(float *)idPtr          = matlIDs[oldID];
+		}
+		UploadVertexArray( vertDataSz, tmpBuf );
+	}
+
+	// We keep a copy of the element array, as when we parse the OBJ
+	m_numTris       = hdr.numTris;
+	m_numArrayVerts = hdr.numArrayVerts;
+	m_lods.assign( lods, lods + hdr.numLods );
+	m_elementArray  = (uint *)malloc( elemDataSz > 0 ? elemDataSz : sizeof(uint) );
+	memcpy( m_elementArray, data + hdr.elemDataOff, elemDataSz );
+	UploadElementArray();
+
+	const float *vaoVerts = (const float *)(data + hdr.vaoVertsOff);
+	m_vaoVerts.assign( vaoVerts, vaoVerts + hdr.numVaoFloats );
+
+	const IGLUMeshCluster *clusters = (const IGLUMeshCluster *)(data + hdr.clustersOff);
+	m_clusters.assign( clusters, clusters + hdr.numClusters );
+	if (m_buildClusters)
+		UploadClusters();
+
+	// Remember everything else we need to draw the buffers
+	m_hasVertices     = (hdr.hasFlags & 0x1) ? true : false;
+	m_hasNormals      = (hdr.hasFlags & 0x2) ? true : false;
+	m_hasTexCoords    = (hdr.hasFlags & 0x4) ? true : false;
+	m_vertStride      = hdr.vertStride;
+	m_vertOff         = hdr.vertOff;
+	m_normOff         = hdr.normOff;
+	m_texOff          = hdr.texOff;
+	m_matlIdOff       = hdr.matlIdOff;
+	m_objectIdOff     = hdr.objectIdOff;
+	m_idType          = hdr.idType;
+	m_posScale        = vec3( hdr.posScale[0], hdr.posScale[1], hdr.posScale[2] );
+	m_posOffset       = vec3( hdr.posOffset[0], hdr.posOffset[1], hdr.posOffset[2] );
+	m_loadedFromCache = true;
+
+	// The cached element array is already sorted by material & object (if asked), but the 
+	//    material IDs may have changed, so we look for the ranges in the final vertex data.
+	if (m_buildDrawRanges)
+		FindDrawRanges( tmpBuf ? tmpBuf : vertData );
+	free( tmpBuf );
+	return true;
+}
+
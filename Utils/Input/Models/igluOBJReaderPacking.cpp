@@ -0,0 +1,217 @@
+/******************************************************************/
+/* igluOBJReaderPacking.cpp                                       */
+/* -----------------------                                        */
+/*                                                                */
+/* Converts the interleaved float vertex array built by the OBJ   */
+/*    reader into more compact encodings (half-float or 16-bit    */
+/*    fixed point positions, octahedral normals, half-float tex   */
+/*    coordinates, and integer IDs), and sends the element array  */
+/*    down as 16-bit indices where possible.                      */
+/*                                                                */
+/* All the packed attributes start on 4-byte boundaries.          */
+/******************************************************************/
+
+#include "iglu.h"
+#include <float.h>
+#include <math.h>
+
+using namespace iglu;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// Converts a float to a 16-bit (IEEE 754 half precision) float, with rounding to nearest.
+//    Values too large become infinity, values too small become (signed) zero or denormals.
+static unsigned short FloatToHalf( float value )
+{
+	union { float f; unsigned int u; } bits;
+	bits.f = value;
+	unsigned int   sign = (bits.u >> 16) & 0x8000;
+	int            exp  = int((bits.u >> 23) & 0xFF) - 127 + 15;
+	unsigned int   mant = bits.u & 0x007FFFFF;
+
+	if (((bits.u >> 23) & 0xFF) == 0xFF)                 // Inf or NaN
+		return (unsigned short)(sign | 0x7C00 | (mant ? 0x200 : 0));
+	if (exp >= 31)                                        // Too big; becomes infinity
+		return (unsigned short)(sign | 0x7C00);
+	if (exp <= 0)                                         // Denormal (or zero) as a half
+	{
+		if (exp < -10) return (unsigned short)sign;
+		mant |= 0x00800000;
+		unsigned int shift = (unsigned int)(14 - exp);
+		unsigned int half  = mant >> shift;
+		if ((mant >> (shift-1)) & 1) half++;              // Round (may carry into the exponent; that's correct)
+		return (unsigned short)(sign | half);
+	}
+
+	unsigned int half = sign | ((unsigned int)exp << 10) | (mant >> 13);
+	if (mant & 0x00001000) half++;                        // Round (again, carries are correct)
+	return (unsigned short)half;
+}
+
+// Converts a value in [-1..1] into a signed, normalized 16-bit value
+static short FloatToSnorm16( float value )
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return short( value >= 0 ? value * 32767.0f + 0.5f : value * 32767.0f - 0.5f );
+}
+
+// Encodes a normal using the octahedral mapping (see igluOBJReader.h for the decoding)
+static void EncodeOctahedral( const float *norm, short *enc )
+{
+	float len = fabs( norm[0] ) + fabs( norm[1] ) + fabs( norm[2] );
+	float x = len > 0 ? norm[0] / len : 0.0f;
+	float y = len > 0 ? norm[1] / len : 0.0f;
+	if (norm[2] < 0)
+	{
+		float tmpX = (1.0f - fabs( y )) * (x >= 0 ? 1.0f : -1.0f);
+		y          = (1.0f - fabs( x )) * (y >= 0 ? 1.0f : -1.0f);
+		x          = tmpX;
+	}
+	enc[0] = FloatToSnorm16( x );
+	enc[1] = FloatToSnorm16( y );
+}
+
+// };  End: anonymous namespace
+
+
+void *IGLUOBJReader::PackVertexArray( const float *floatBuf, uint numVerts )
+{
+	m_idType    = GL_FLOAT;
+	m_posScale  = vec3( 1, 1, 1 );
+	m_posOffset = vec3( 0, 0, 0 );
+	if (!(m_packing & (IGLU_OBJ_HALF_POSITIONS|IGLU_OBJ_UNORM16_POSITIONS|IGLU_OBJ_OCT_NORMALS|
+		               IGLU_OBJ_HALF_TEXCOORDS|IGLU_OBJ_INTEGER_IDS)))
+		return (void *)floatBuf;
+
+	uint floatStride = m_vertStride / sizeof( float );
+	uint matlIdx = m_matlIdOff / sizeof( float ), objIdx = m_objectIdOff / sizeof( float );
+	uint vertIdx = m_vertOff / sizeof( float );
+	uint normIdx = m_normOff / sizeof( float ),   texIdx = m_texOff / sizeof( float );
+
+	// Integer IDs use 16 bits, unless we have too many materials or objects
+	bool shortPos = (m_packing & (IGLU_OBJ_HALF_POSITIONS|IGLU_OBJ_UNORM16_POSITIONS)) ? true : false;
+	if (m_packing & IGLU_OBJ_INTEGER_IDS)
+	{
+		m_idType = GL_UNSIGNED_SHORT;
+		for (uint i=0; i<numVerts && m_idType == GL_UNSIGNED_SHORT; i++)
+			if (floatBuf[i*floatStride+matlIdx] > 65535.0f || floatBuf[i*floatStride+objIdx] > 65535.0f)
+				m_idType = GL_UNSIGNED_INT;
+	}
+
+	// For fixed-point positions, find the bounding box we're quantizing within
+	if (m_packing & IGLU_OBJ_UNORM16_POSITIONS)
+	{
+		float minPt[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxPt[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint i=0; i<numVerts; i++)
+			for (int k=0; k<3; k++)
+			{
+				float val = floatBuf[i*floatStride+vertIdx+k];
+				minPt[k] = val < minPt[k] ? val : minPt[k];
+				maxPt[k] = val > maxPt[k] ? val : maxPt[k];
+			}
+		if (numVerts == 0)
+			minPt[0] = minPt[1] = minPt[2] = maxPt[0] = maxPt[1] = maxPt[2] = 0;
+		m_posOffset = vec3( minPt[0], minPt[1], minPt[2] );
+		m_posScale  = vec3( maxPt[0] > minPt[0] ? maxPt[0]-minPt[0] : 1.0f,
+			                maxPt[1] > minPt[1] ? maxPt[1]-minPt[1] : 1.0f,
+							maxPt[2] > minPt[2] ? maxPt[2]-minPt[2] : 1.0f );
+	}
+
+	// Lay out the packed vertex:  IDs, position, normal, texture coordinate (as before).
+	//    16-bit positions are padded to 4 values so everything stays 4-byte aligned.
+	uint idSize = (m_idType == GL_UNSIGNED_SHORT) ? 2 : 4;
+	m_matlIdOff   = 0;
+	m_objectIdOff = idSize;
+	m_vertOff     = 2*idSize;
+	uint curOff   = m_vertOff + (shortPos ? 4*sizeof(short) : 3*sizeof(float));
+	if (m_hasNormals)
+	{
+		m_normOff = curOff;
+		curOff   += (m_packing & IGLU_OBJ_OCT_NORMALS) ? 2*sizeof(short) : 3*sizeof(float);
+	}
+	if (m_hasTexCoords)
+	{
+		m_texOff  = curOff;
+		curOff   += (m_packing & IGLU_OBJ_HALF_TEXCOORDS) ? 2*sizeof(short) : 2*sizeof(float);
+	}
+	m_vertStride = curOff;
+
+	// Now actually convert all our vertices
+	char *packed = (char *)malloc( (numVerts > 0 ? numVerts : 1) * m_vertStride );
+	assert( packed );
+	for (uint i=0; i<numVerts; i++)
+	{
+		const float *in  = floatBuf + i*floatStride;
+		char        *out = packed + i*m_vertStride;
+
+		if (m_idType == GL_UNSIGNED_SHORT)
+		{
+			((unsigned short *)(out + m_matlIdOff))[0]   = (unsigned short)( in[matlIdx] );
+			((unsigned short *)(out + m_objectIdOff))[0] = (unsigned short)( in[objIdx] );
+		}
+		else if (m_idType == GL_UNSIGNED_INT)
+		{
+			((unsigned int *)(out + m_matlIdOff))[0]     = (unsigned int)( in[matlIdx] );
+			((unsigned int *)(out + m_objectIdOff))[0]   = (unsigned int)( in[objIdx] );
+		}
+		else
+		{
+			((float *)(out + m_matlIdOff))[0]            = in[matlIdx];
+			((float *)(out + m_objectIdOff))[0]          = in[objIdx];
+		}
+
+		if (m_packing & IGLU_OBJ_UNORM16_POSITIONS)
+		{
+			unsigned short *pos = (unsigned short *)(out + m_vertOff);
+			float offset[3] = { m_posOffset.X(), m_posOffset.Y(), m_posOffset.Z() };
+			float scale[3]  = { m_posScale.X(),  m_posScale.Y(),  m_posScale.Z() };
+			for (int k=0; k<3; k++)
+				pos[k] = (unsigned short)( (in[vertIdx+k] - offset[k]) / scale[k] * 65535.0f + 0.5f );
+			pos[3] = 0;
+		}
+		else if (m_packing & IGLU_OBJ_HALF_POSITIONS)
+		{
+			unsigned short *pos = (unsigned short *)(out + m_vertOff);
+			for (int k=0; k<3; k++)
+				pos[k] = FloatToHalf( in[vertIdx+k] );
+			pos[3] = FloatToHalf( 1.0f );
+		}
+		else
+			memcpy( out + m_vertOff, in + vertIdx, 3*sizeof(float) );
+
+		if (m_hasNormals && (m_packing & IGLU_OBJ_OCT_NORMALS))
+			EncodeOctahedral( in + normIdx, (short *)(out + m_normOff) );
+		else if (m_hasNormals)
+			memcpy( out + m_normOff, in + normIdx, 3*sizeof(float) );
+
+		if (m_hasTexCoords && (m_packing & IGLU_OBJ_HALF_TEXCOORDS))
+		{
+			((unsigned short *)(out + m_texOff))[0] = FloatToHalf( in[texIdx+0] );
+			((unsigned short *)(out + m_texOff))[1] = FloatToHalf( in[texIdx+1] );
+		}
+		else if (m_hasTexCoords)
+			memcpy( out + m_texOff, in + texIdx, 2*sizeof(float) );
+	}
+
+	return packed;
+}
+
+void IGLUOBJReader::UploadElementArray( void )
+{
+	if (m_deferUpload) return;   // UploadToGPU() will do it
+
+	uint numIndices = GetElementCount();
+	if (!UseShortIndices())
+	{
+		m_vertArr->SetElementArray( GL_UNSIGNED_INT, numIndices * sizeof( uint ), m_elementArray, IGLU_STATIC|IGLU_DRAW );
+		return;
+	}
+
+	unsigned short *shortBuf = (unsigned short *)malloc( (numIndices > 0 ? numIndices : 1) * sizeof( unsigned short ) );
+	assert( shortBuf );
+	for (uint i=0; i<numIndices; i++)
+		shortBuf[i] = (unsigned short)( m_elementArray[i] );
+	m_vertArr->SetElementArray( GL_UNSIGNED_SHORT, numIndices * sizeof( unsigned short ), shortBuf, IGLU_STATIC|IGLU_DRAW );
+	free( shortBuf );
+}
+
@@ -0,0 +1,431 @@
+/******************************************************************/
+/* igluOBJReaderParallel.cpp                                      */
+/* -----------------------                                        */
+/*                                                                */
+/* Parallel parsing of memory-mapped OBJ files.  The mapped file  */
+/*    is split into line-aligned chunks that are parsed on many   */
+/*    threads at once, then stitched back together in file order */
+/*    so the result is identical to a serial parse.               */
+/*                                                                */
+/******************************************************************/
+
+#include "iglu.h"
+#include <ctype.h>
+#include <algorithm>
+
+using namespace iglu;
+
+// We don't bother splitting files into chunks much smaller than this
+#define IGLU_OBJ_MIN_CHUNK_SIZE   (1<<20)
+
+// Chunks per thread.  Lines vary a lot in cost, so having a few chunks per thread
+//    helps balance the load.
+#define IGLU_OBJ_CHUNKS_PER_THREAD   8
+
+namespace iglu {
+
+// A line whose effect depends on what came before it in the file ('mtllib', 'o', 'g',
+//    'usemtl'), or a warning about a bad line.  These are rare, so chunks simply record
+//    them, and they are all handled in file order after the chunks are parsed.
+struct IGLUOBJChunkEvent
+{
+	char        type;          // 'm', 'o', 'g', 'u', or 'w' (a warning)
+	int         line;          // Line number, relative to the start of the chunk
+	uint        firstTri;      // Index (in the chunk) of the first triangle after this line
+	const char *msg;           // For warnings, the message (with a %s if str is non-NULL)
+	const char *str, *strEnd;  // Name or warning parameter (inside the mapped file, NOT null-terminated)
+	int         strMax;        // Truncate str to this many chars (as the serial parser's buffers do)
+	bool        lowerCase;     // Print str in lower case?
+};
+
+// The current material/group/object when some triangle in a chunk was read
+struct IGLUOBJChunkState
+{
+	uint  firstTri;
+	uint  mtlName, grpName, objName;   // Name IDs, in the reader's IGLUOBJTriArray
+	uint  matlID, objectID;
+};
+
+// Everything we learned from one chunk of the file.  Facet indices are stored 9 per
+//    triangle (3 vertex, 3 normal, then 3 texture indices).  Positive
+//    OBJ indices are absolute, so they're resolved immediately.  Relative (negative) indices
+//    depend on how much data precedes the chunk, so they are resolved relative to the start
+//    of the chunk and flagged (in triRelative) so the chunk's offset can be added later.
+struct IGLUOBJChunk
+{
+	const char *begin, *end;
+	int numLines;
+	bool hasVertices, hasNormals, hasTexCoords;
+	std::vector<vec3> verts, norms;
+	std::vector<vec2> texCoords;
+	std::vector<int> triIdx;
+	std::vector<unsigned short> triRelative;
+	std::vector<IGLUOBJChunkEvent> events;
+
+	// Set when stitching the chunks together.
+	uint vertOffset, normOffset, texOffset, triOffset;
+	int  lineOffset;
+	std::vector<IGLUOBJChunkState> states;
+};
+
+}
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// What we pass to the IGLUParallel::For() callbacks
+struct IGLUOBJChunkJob
+{
+	IGLUOBJReader *reader;
+	IGLUOBJChunk  *chunks;
+};
+
+static void AddChunkEvent( IGLUOBJChunk *chunk, char type, int line, const char *msg,
+						   const char *str=0, const char *strEnd=0, int strMax=256, bool lowerCase=false )
+{
+	IGLUOBJChunkEvent evt;
+	evt.type      = type;
+	evt.line      = line;
+	evt.firstTri  = uint( chunk->triRelative.size() );
+	evt.msg       = msg;
+	evt.str       = str;
+	evt.strEnd    = strEnd;
+	evt.strMax    = strMax;
+	evt.lowerCase = lowerCase;
+	chunk->events.push_back( evt );
+}
+
+// The equivalent of IGLUOBJReader::GetVertexIndex(), et al, for chunk-relative indices.
+static int ResolveChunkIndex( IGLUOBJChunk *chunk, int line, int objIdx, size_t numInChunk,
+							  const char *zeroMsg, unsigned short *relFlags, unsigned short relBit )
+{
+	if (objIdx == 0)
+		AddChunkEvent( chunk, 'w', line, zeroMsg );
+	if (objIdx > 0)
+		return objIdx-1;
+	*relFlags |= relBit;
+	return int( uint(numInChunk) + uint(objIdx) );
+}
+
+// Stores one facet vertex (given the raw indices from the file) into a corner of the
+//    last triangle in the chunk.  Mirrors IGLUOBJReader::ReadFacetTokenInPlace().
+static void SetChunkCorner( IGLUOBJChunk *chunk, int line, int corner, bool hasNorm, bool hasTex,
+						    int vIdx, int tIdx, int nIdx )
+{
+	size_t tri = chunk->triRelative.size()-1;
+	int *idx = &chunk->triIdx[ 9*tri ];
+	unsigned short *rel = &chunk->triRelative[ tri ];
+	*rel &= ~((1<<corner) | (1<<(corner+3)) | (1<<(corner+6)));
+
+	idx[corner]   = ResolveChunkIndex( chunk, line, vIdx, chunk->verts.size(),
+		                               "Unexpected OBJ vertex index of 0!", rel, 1<<corner );
+	idx[corner+3] = !hasNorm ? -1 : ResolveChunkIndex( chunk, line, nIdx, chunk->norms.size(),
+		                               "Unexpected OBJ normal index of 0!", rel, 1<<(corner+3) );
+	idx[corner+6] = !hasTex  ? -1 : ResolveChunkIndex( chunk, line, tIdx, chunk->texCoords.size(),
+		                               "Unexpected OBJ texture coord index of 0!", rel, 1<<(corner+6) );
+}
+
+// Starts a new triangle in the chunk.  If fan is true, the first two corners are copied
+//    from the last triangle (as in IGLUOBJReader::CopyForTriangleFan()).
+static void AddChunkTriangle( IGLUOBJChunk *chunk, bool fan )
+{
+	size_t last = chunk->triRelative.size()-1;
+	chunk->triIdx.resize( chunk->triIdx.size() + 9, -1 );
+	chunk->triRelative.push_back( 0 );
+	if (!fan) return;
+
+	int *prev = &chunk->triIdx[ 9*last ], *cur = prev + 9;
+	unsigned short prevRel = chunk->triRelative[ last ];
+	for (int i=0; i<9; i+=3)
+	{
+		cur[i]   = prev[i];
+		cur[i+1] = prev[i+2];
+	}
+	chunk->triRelative[ last+1 ] = (prevRel & 0x49) | ((prevRel & 0x124) >> 1);
+}
+
+// };  End: anonymous namespace
+
+
+void IGLUOBJReader::ParseMappedChunkCallback( int chunkIdx, void *chunkData )
+{
+	IGLUOBJChunkJob *job = (IGLUOBJChunkJob *)chunkData;
+	job->reader->ParseMappedChunk( &job->chunks[chunkIdx] );
+}
+
+// Parses one chunk of the mapped file.  This mirrors ParseMappedFile(), but touches only
+//    the chunk (never the reader), so many chunks can be parsed simultaneously.
+void IGLUOBJReader::ParseMappedChunk( IGLUOBJChunk *chunk ) const
+{
+	const char *ptr = chunk->begin, *linePtr, *lineEnd, *tokEnd, *cur, *eol;
+	int line = 0, facetFormat, vIdx, tIdx, nIdx;
+	double x, y, z;
+
+	chunk->hasVertices = chunk->hasNormals = chunk->hasTexCoords = false;
+	while (ptr < chunk->end)
+	{
+		// Find the next line, exactly as ReadNextLineInPlace() would, skipping blanks & comments
+		eol     = (const char *)memchr( ptr, '\n', chunk->end-ptr );
+		lineEnd = eol ? eol : chunk->end;
+		linePtr = SkipWhiteSpaceInPlace( ptr, lineEnd );
+		ptr     = eol ? eol+1 : chunk->end;
+		line++;
+		if (linePtr >= lineEnd || linePtr[0] == '#' || linePtr[0] == 0)
+			continue;
+
+		// Each OBJ line starts with a keyword/keyletter
+		tokEnd = SkipTokenInPlace( linePtr, lineEnd );
+		cur    = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+		char key0 = (char)tolower( linePtr[0] );
+		char key1 = (tokEnd-linePtr > 1) ? (char)tolower( linePtr[1] ) : 0;
+
+		switch( key0 )
+		{
+		case 'v':
+			if (key1 == 'n')        // We found a normal!
+			{
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &x );
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &y );
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &z );
+				chunk->norms.push_back( vec3( float(x), float(y), float(z) ) );
+			}
+			else if (key1 == 't')   // We found a texture coordinate!
+			{
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &x );
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &y );
+				chunk->texCoords.push_back( vec2( float(x), float(y) ) );
+			}
+			else if (key1 == 0 )    // We found a vertex!
+			{
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &x );
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &y );
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &z );
+				chunk->verts.push_back( vec3( float(x), float(y), float(z) ) );
+			}
+			break;
+		case 'm': // Material files, object/group names, and materials are handled later
+		case 'o':
+		case 'g':
+		case 'u':
+			AddChunkEvent( chunk, key0, line, 0, cur, SkipTokenInPlace( cur, lineEnd ) );
+			break;
+		case 's':
+			// There's a smoothing command.  We're ignoring these.
+			break;
+		case 'f': // We found a facet!
+			{
+				// Find the first three vertex tokens on the line
+				const char *tok[3], *tokEnds[3], *fPtr = cur;
+				int numTokens = 0;
+				for ( ; numTokens < 3 && fPtr < lineEnd; numTokens++ )
+				{
+					tok[numTokens]     = fPtr;
+					tokEnds[numTokens] = SkipTokenInPlace( fPtr, lineEnd );
+					fPtr = SkipWhiteSpaceInPlace( tokEnds[numTokens], lineEnd );
+				}
+
+				//Ensure the 'f' line has at least three entries.
+				if (numTokens < 3)
+				{
+					AddChunkEvent( chunk, 'w', line, "Corrupt 'f': %s", cur, lineEnd );
+					continue;
+				}
+
+				// There are multiple different formats for 'f' lines.  Decide which it is.
+				facetFormat = GetFacetFormatInPlace( tok[0], tokEnds[0] );
+				bool hasNorm = (facetFormat == IGLU_OBJ_FACET_VN || facetFormat == IGLU_OBJ_FACET_VTN);
+				bool hasTex  = (facetFormat == IGLU_OBJ_FACET_VT || facetFormat == IGLU_OBJ_FACET_VTN);
+				chunk->hasVertices = true;
+				chunk->hasNormals   = chunk->hasNormals || hasNorm;
+				chunk->hasTexCoords = chunk->hasTexCoords || hasTex;
+
+				// Read first three set of indices on this line
+				AddChunkTriangle( chunk, false );
+				for (int i=0; i<3; i++)
+				{
+					GetFacetIndicesInPlace( facetFormat, tok[i], tokEnds[i], &vIdx, &tIdx, &nIdx );
+					SetChunkCorner( chunk, line, i, hasNorm, hasTex, vIdx, tIdx, nIdx );
+				}
+
+				// Do we have more vertices in this facet?  If so, triangulate it as a fan.
+				while ( fPtr < lineEnd )
+				{
+					tokEnd = SkipTokenInPlace( fPtr, lineEnd );
+					AddChunkTriangle( chunk, true );
+					GetFacetIndicesInPlace( facetFormat, fPtr, tokEnd, &vIdx, &tIdx, &nIdx );
+					SetChunkCorner( chunk, line, 2, hasNorm, hasTex, vIdx, tIdx, nIdx );
+					fPtr = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+				}
+			}
+			break;
+
+		default:  // We have no clue what to do with this line....
+			AddChunkEvent( chunk, 'w', line, "Found corrupt line in OBJ.  Unknown keyword '%s'",
+				           linePtr, tokEnd, 64, true );
+		}
+	}
+	chunk->numLines = line;
+}
+
+void IGLUOBJReader::StitchMappedChunkCallback( int chunkIdx, void *chunkData )
+{
+	IGLUOBJChunkJob *job = (IGLUOBJChunkJob *)chunkData;
+	IGLUOBJReader *reader = job->reader;
+	IGLUOBJChunk *chunk = &job->chunks[chunkIdx];
+
+	// Copy the chunk's geometry to its spot in the final arrays
+	std::copy( chunk->verts.begin(), chunk->verts.end(), reader->m_objVerts.begin() + chunk->vertOffset );
+	std::copy( chunk->norms.begin(), chunk->norms.end(), reader->m_objNorms.begin() + chunk->normOffset );
+	std::copy( chunk->texCoords.begin(), chunk->texCoords.end(), reader->m_objTexCoords.begin() + chunk->texOffset );
+
+	// Fill in the triangles, with their final indices and material/object data
+	IGLUOBJTriArray &tris = reader->m_objTris;
+	uint numTris = uint( chunk->triRelative.size() ), curState = 0;
+	for (uint i=0; i<numTris; i++)
+	{
+		while (curState+1 < chunk->states.size() && chunk->states[curState+1].firstTri <= i)
+			curState++;
+		const IGLUOBJChunkState &state = chunk->states[curState];
+		const int *idx = &chunk->triIdx[ 9*i ];
+		unsigned short rel = chunk->triRelative[ i ];
+
+		uint tri = chunk->triOffset + i;
+		tris.matlID[tri]    = state.matlID;
+		tris.objectID[tri]  = state.objectID;
+		tris.mtlNameID[tri] = state.mtlName;
+		tris.grpNameID[tri] = state.grpName;
+		tris.objNameID[tri] = state.objName;
+		for (int j=0; j<3; j++)
+		{
+			tris.vIdx[3*tri+j] = int( uint(idx[j])   + ((rel & (1<<j))     ? chunk->vertOffset : 0u) );
+			tris.nIdx[3*tri+j] = int( uint(idx[j+3]) + ((rel & (1<<(j+3))) ? chunk->normOffset : 0u) );
+			tris.tIdx[3*tri+j] = int( uint(idx[j+6]) + ((rel & (1<<(j+6))) ? chunk->texOffset : 0u) );
+		}
+	}
+
+	// We're done with the chunk's temporary data
+	std::vector<vec3>().swap( chunk->verts );
+	std::vector<vec3>().swap( chunk->norms );
+	std::vector<vec2>().swap( chunk->texCoords );
+	std::vector<int>().swap( chunk->triIdx );
+	std::vector<unsigned short>().swap( chunk->triRelative );
+}
+
+void IGLUOBJReader::ParseMappedFileInParallel( void )
+{
+	const char *data = m_mapPtr, *end = m_mapEnd;
+	size_t size = size_t( end - data );
+
+	// Decide how many chunks to split the file into
+	int numThreads = IGLUParallel::GetProcessorCount();
+	size_t maxChunks = size_t( numThreads * IGLU_OBJ_CHUNKS_PER_THREAD );
+	size_t numChunks = size / IGLU_OBJ_MIN_CHUNK_SIZE + 1;
+	if (numChunks > maxChunks) numChunks = maxChunks;
+
+	// Split the file, moving each split point forward to the start of the next line.
+	IGLUOBJChunk *chunks = new IGLUOBJChunk[ numChunks ];
+	const char *ptr = data;
+	for (size_t i=0; i<numChunks; i++)
+	{
+		const char *split = (i+1 == numChunks) ? end : data + (size / numChunks) * (i+1);
+		if (split < ptr) split = ptr;
+		const char *eol = (split < end) ? (const char *)memchr( split, '\n', end-split ) : 0;
+		chunks[i].begin = ptr;
+		chunks[i].end   = ptr = ((i+1 == numChunks) || !eol) ? end : eol+1;
+	}
+
+	// Parse all the chunks
+	IGLUOBJChunkJob job = { this, chunks };
+	IGLUParallel::For( int(numChunks), ParseMappedChunkCallback, &job, numThreads );
+
+	// Now walk through the chunks in order, finding where each chunk's data ends up and
+	//    handling the order-dependent lines (exactly as in ParseMappedFile()).
+	char *mtlFilePtr = 0;
+	char fname[256];
+	uint currentObj = 0, currentGrp = 0, currentMtl = 0;
+	int tmpMatlId;
+	uint numVerts = uint( m_objVerts.size() ), numNorms = uint( m_objNorms.size() );
+	uint numTexCoords = uint( m_objTexCoords.size() ), numTris = uint( m_objTris.size() );
+	int numLines = lineNum;
+	for (size_t i=0; i<numChunks; i++)
+	{
+		IGLUOBJChunk *chunk = &chunks[i];
+		chunk->vertOffset = numVerts;
+		chunk->normOffset = numNorms;
+		chunk->texOffset  = numTexCoords;
+		chunk->triOffset  = numTris;
+		chunk->lineOffset = numLines;
+		m_hasVertices  = m_hasVertices || chunk->hasVertices;
+		m_hasNormals   = m_hasNormals || chunk->hasNormals;
+		m_hasTexCoords = m_hasTexCoords || chunk->hasTexCoords;
+
+		IGLUOBJChunkState state = { 0, currentMtl, currentGrp, currentObj, m_curMatlId, m_curObjectId };
+		chunk->states.push_back( state );
+
+		for (uint j=0; j<chunk->events.size(); j++)
+		{
+			const IGLUOBJChunkEvent &evt = chunk->events[j];
+			lineNum = chunk->lineOffset + evt.line;    // So warnings report the right line
+			if (evt.str)
+				CopyStringInPlace( fname, evt.strMax, evt.str, evt.strEnd );
+
+			switch( evt.type )
+			{
+			case 'm': // We found the name of a material file!
+				mtlFilePtr = (char *)malloc( strlen(fname)+strlen(fileDirectory)+1 );
+				sprintf( mtlFilePtr, "%s%s", fileDirectory, fname );
+				m_objMtlFiles.push_back( mtlFilePtr );
+				if (m_loadMtlFile)
+					delete( new IGLUOBJMaterialReader( mtlFilePtr, m_deferUpload ));  // Load it.
+				break;
+			case 'o': // We found a name for the object following this flag
+				currentObj = m_objTris.AddName( fname );
+				m_curObjectId = GetObjectIDForName( currentObj );
+				break;
+			case 'g': // We found a name for the group following this flag
+				currentGrp = m_objTris.AddName( fname );
+				break;
+			case 'u': // We found the name of the material we'll be using
+				currentMtl = m_objTris.AddName( fname );
+				tmpMatlId = IGLUOBJMaterialReader::GetNamedMaterialId( fname );
+				if (tmpMatlId >= 0)
+					m_curMatlId = uint(tmpMatlId);
+				break;
+			default:  // A warning found while parsing the chunk
+				if (evt.lowerCase)
+					MakeLower( fname );
+				if (evt.str)
+					this->WarningMessage( evt.msg, fname );
+				else
+					this->WarningMessage( evt.msg );
+				continue;
+			}
+
+			// The material/group/object may have changed for the following triangles
+			IGLUOBJChunkState newState = { evt.firstTri, currentMtl, currentGrp, currentObj, m_curMatlId, m_curObjectId };
+			if (chunk->states.back().firstTri == evt.firstTri)
+				chunk->states.back() = newState;
+			else
+				chunk->states.push_back( newState );
+		}
+
+		numVerts     += uint( chunk->verts.size() );
+		numNorms     += uint( chunk->norms.size() );
+		numTexCoords += uint( chunk->texCoords.size() );
+		numTris      += uint( chunk->triRelative.size() );
+		numLines     += chunk->numLines;
+	}
+
+	// We've used up the whole file
+	lineNum  = numLines;
+	m_mapPtr = m_mapEnd;
+
+	// Copy the chunks' data into place and create the triangles
+	m_objVerts.resize( numVerts );
+	m_objNorms.resize( numNorms );
+	m_objTexCoords.resize( numTexCoords );
+	m_objTris.Resize( numTris );
+	IGLUParallel::For( int(numChunks), StitchMappedChunkCallback, &job, numThreads );
+
+	delete [] chunks;
+}
+
@@ -0,0 +1,170 @@
+/******************************************************************/
+/* igluOBJReaderRanges.cpp                                        */
+/* -----------------------                                        */
+/*                                                                */
+/* Sorts the OBJ reader's triangles into contiguous ranges by     */
+/*    material and object (IGLU_OBJ_DRAW_RANGES), and draws any   */
+/*    subset of those ranges with a single multi-draw call.       */
+/*                                                                */
+/******************************************************************/
+
+#include "iglu.h"
+#include <algorithm>
+
+using namespace iglu;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// Reads a material or object ID from a vertex, in whichever type PackVertexArray() stored it
+static uint ReadVertexID( const char *ptr, GLenum idType )
+{
+	if (idType == GL_UNSIGNED_SHORT) return uint( *(const unsigned short *)ptr );
+	if (idType == GL_UNSIGNED_INT)   return *(const unsigned int *)ptr;
+	return uint( *(const float *)ptr );
+}
+
+// Orders triangles by their keys.  (Used with std::stable_sort(), so triangles with the same
+//    key stay in the order the vertex cache optimizer left them.)
+struct IGLUDrawRangeLess
+{
+	const unsigned long long *keys;
+	bool operator()( uint a, uint b ) const    { return keys[a] < keys[b]; }
+};
+
+// };  End: anonymous namespace
+
+
+void IGLUOBJReader::GetDrawRangeKeys( const void *vertBuf, std::vector<unsigned long long> &keys ) const
+{
+	// Each triangle's key is its (material, object) pair, taken from its first vertex
+	const char *verts = (const char *)vertBuf;
+	keys.resize( m_numTris );
+	for (uint i=0; i<m_numTris; i++)
+	{
+		const char *vert = verts + size_t( m_elementArray[3*i] ) * m_vertStride;
+		keys[i] = ( (unsigned long long)( ReadVertexID( vert + m_matlIdOff, m_idType ) ) << 32 ) |
+			      ReadVertexID( vert + m_objectIdOff, m_idType );
+	}
+}
+
+void IGLUOBJReader::SortIntoDrawRanges( const void *vertBuf )
+{
+	std::vector<unsigned long long> keys;
+	GetDrawRangeKeys( vertBuf, keys );
+
+	IGLUDrawRangeLess less = { keys.empty() ? 0 : &keys[0] };
+	std::vector<uint> order( m_numTris );
+	for (uint i=0; i<m_numTris; i++)
+		order[i] = i;
+	std::stable_sort( order.begin(), order.end(), less );
+
+	// Shuffle the triangles (of LOD 0;  nothing else has been added to the element array yet)
+	std::vector<uint> sorted( 3*m_numTris );
+	for (uint i=0; i<m_numTris; i++)
+	{
+		sorted[3*i+0] = m_elementArray[3*order[i]+0];
+		sorted[3*i+1] = m_elementArray[3*order[i]+1];
+		sorted[3*i+2] = m_elementArray[3*order[i]+2];
+	}
+	if (m_numTris > 0)
+		memcpy( m_elementArray, &sorted[0], 3*m_numTris*sizeof( uint ) );
+
+	FindDrawRanges( vertBuf );
+}
+
+void IGLUOBJReader::FindDrawRanges( const void *vertBuf )
+{
+	std::vector<unsigned long long> keys;
+	GetDrawRangeKeys( vertBuf, keys );
+
+	m_drawRanges.clear();
+	for (uint i=0; i<m_numTris; i++)
+	{
+		if (i > 0 && keys[i] == keys[i-1])
+		{
+			m_drawRanges.back().indexCount += 3;
+			continue;
+		}
+		IGLUOBJDrawRange range = { uint( keys[i] >> 32 ), uint( keys[i] & 0xFFFFFFFFu ), 3*i, 3 };
+		m_drawRanges.push_back( range );
+	}
+}
+
+int IGLUOBJReader::DrawRanges( IGLUShaderProgram::Ptr &shader, const uint *ranges, uint numRanges )
+{
+	// If the shader in question is not already enabled, enable it!
+	bool wasShaderBound = shader->IsEnabled();
+	if (!wasShaderBound)
+		shader->Enable();
+
+	// We may already have the vertex array setup to work with this shader.
+	//    Check that.  If not, re-set up the vertex array.
+	if (m_shaderID == 0)
+	{
+		m_shaderID = shader->GetProgramID();
+		int err = SetupVertexArray( shader );
+		if (err != IGLU_NO_ERROR)
+			return err;
+	}
+
+	// Gather up the ranges (ignoring any that don't exist), and draw them all at once
+	uint indexSize = UseShortIndices() ? sizeof( unsigned short ) : sizeof( uint );
+	std::vector<GLsizei> counts;
+	std::vector<const GLvoid *> offsets;
+	for (uint i=0; i<numRanges; i++)
+	{
+		if (ranges[i] >= m_drawRanges.size()) continue;
+		const IGLUOBJDrawRange &range = m_drawRanges[ ranges[i] ];
+		counts.push_back( GLsizei( range.indexCount ) );
+		offsets.push_back( BUFFER_OFFSET( range.firstIndex * indexSize ) );
+	}
+	if (!counts.empty())
+		m_vertArr->MultiDrawElements( GL_TRIANGLES, &counts[0], &offsets[0], GLsizei( counts.size() ) );
+
+	// If we started with the shader disabled, disable it again now.
+	if (!wasShaderBound)
+		shader->Disable();
+
+	return IGLU_NO_ERROR;
+}
+
+int IGLUOBJReader::DrawRangesIndirect( IGLUShaderProgram::Ptr &shader, const uint *ranges, uint numRanges )
+{
+	// If the shader in question is not already enabled, enable it!
+	bool wasShaderBound = shader->IsEnabled();
+	if (!wasShaderBound)
+		shader->Enable();
+
+	// We may already have the vertex array setup to work with this shader.
+	//    Check that.  If not, re-set up the vertex array.
+	if (m_shaderID == 0)
+	{
+		m_shaderID = shader->GetProgramID();
+		int err = SetupVertexArray( shader );
+		if (err != IGLU_NO_ERROR)
+			return err;
+	}
+
+	// Build the list of draw commands, and send it to the GPU
+	std::vector<IGLUDrawElementsCommand> cmds;
+	for (uint i=0; i<numRanges; i++)
+	{
+		if (ranges[i] >= m_drawRanges.size()) continue;
+		const IGLUOBJDrawRange &range = m_drawRanges[ ranges[i] ];
+		IGLUDrawElementsCommand cmd = { range.indexCount, 1, range.firstIndex, 0, ranges[i] };
+		cmds.push_back( cmd );
+	}
+	if (!cmds.empty())
+	{
+		if (!m_indirectBuf)
+			m_indirectBuf = new IGLUBuffer( IGLU_DRAW_INDIRECT );
+		m_indirectBuf->SetBufferData( cmds.size() * sizeof( IGLUDrawElementsCommand ), &cmds[0], IGLU_STREAM|IGLU_DRAW );
+		m_vertArr->MultiDrawElementsIndirect( GL_TRIANGLES, m_indirectBuf, GLsizei( cmds.size() ) );
+	}
+
+	// If we started with the shader disabled, disable it again now.
+	if (!wasShaderBound)
+		shader->Disable();
+
+	return IGLU_NO_ERROR;
+}
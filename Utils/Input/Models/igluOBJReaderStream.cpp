@@ -0,0 +1,432 @@
+/******************************************************************/
+/* igluOBJReaderStream.cpp                                        */
+/* -----------------------                                        */
+/*                                                                */
+/* Streaming (IGLU_OBJ_STREAMING) loads of memory-mapped OBJ      */
+/*    files, for meshes too big to hold in memory all at once.    */
+/*                                                                */
+/* The first pass spills the vertices, normals and texture coords */
+/*    to binary files next to the OBJ, then maps them back in.    */
+/*    The second pass builds fixed-size batches of triangles      */
+/*    (with their own deduplicated vertices), each of which is    */
+/*    handed to a callback or uploaded straight to the GPU.  Only */
+/*    the current batch lives on the heap;  everything else is in */
+/*    mapped files, which the OS can page out as needed.          */
+/*                                                                */
+/******************************************************************/
+
+#include "iglu.h"
+#include <float.h>
+#include <ctype.h>
+
+using namespace iglu;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// Values written to a binary spill file in the first pass, then mapped back in so the
+//    second pass can look up any of them without keeping them all in memory.
+struct IGLUOBJSpill
+{
+	char           *name;
+	FILE           *f;
+	IGLUMappedFile *map;
+	uint            count, numFloats;
+};
+
+static bool OpenSpill( IGLUOBJSpill *spill, const char *objFile, const char *suffix, uint numFloats )
+{
+	spill->name = (char *)malloc( strlen(objFile)+strlen(suffix)+1 );
+	sprintf( spill->name, "%s%s", objFile, suffix );
+	spill->f         = fopen( spill->name, "wb" );
+	spill->map       = 0;
+	spill->count     = 0;
+	spill->numFloats = numFloats;
+	return spill->f != NULL;
+}
+
+static void WriteSpill( IGLUOBJSpill *spill, const float *vals )
+{
+	fwrite( vals, sizeof(float), spill->numFloats, spill->f );
+	spill->count++;
+}
+
+static bool MapSpill( IGLUOBJSpill *spill )
+{
+	fclose( spill->f );
+	spill->f   = 0;
+	spill->map = new IGLUMappedFile( spill->name );
+	return spill->map->IsValid() && spill->map->GetSize() == size_t(spill->count)*spill->numFloats*sizeof(float);
+}
+
+// Returns the values for element idx, or NULL if there's no such element
+static const float *GetSpill( const IGLUOBJSpill *spill, uint idx )
+{
+	if (idx >= spill->count) return 0;
+	return (const float *)spill->map->GetData() + size_t(idx)*spill->numFloats;
+}
+
+static void CloseSpill( IGLUOBJSpill *spill )
+{
+	if (spill->f) fclose( spill->f );
+	delete spill->map;
+	remove( spill->name );
+	free( spill->name );
+}
+
+namespace iglu {
+
+// The batch we're building in the second pass.  Vertices are deduplicated within the batch
+//    using an open-addressing hash on their (vert, norm, texcoord, material, object) indices.
+struct IGLUOBJStreamBatch
+{
+	IGLUOBJBatch         batch;
+	IGLUOBJBatchCallback func;
+	void                *userData;
+	uint                 maxTris, numComponents, tableSize;
+	uint                *keys;      // 5 per vertex
+	uint                *table;     // A vertex index+1, or 0 for empty slots
+	float               *verts;     // numComponents floats per vertex
+	uint                *indices;   // 3 per triangle
+	bool                 fill;      // If false, we only count vertices and triangles
+	bool                 loadMtls;  // Load material files?  (Only on the first run through the file.)
+	const IGLUOBJSpill  *spills;    // Vertices, normals and texture coordinates
+	float                ctr[3], scale;
+};
+
+}
+
+static uint HashStreamKey( const uint *key )
+{
+	uint h = 2166136261u;
+	for (int i=0; i<5; i++)
+		h = (h ^ key[i]) * 16777619u;
+	return h ^ (h >> 15);
+}
+
+// Finds (or adds) the batch vertex for the given key, returning its index in the batch
+static uint AddStreamVertex( IGLUOBJStreamBatch *b, const uint *key )
+{
+	uint slot = HashStreamKey( key ) & (b->tableSize-1);
+	while (b->table[slot])
+	{
+		uint idx = b->table[slot]-1;
+		if (!memcmp( &b->keys[5*idx], key, 5*sizeof(uint) ))
+			return idx;
+		slot = (slot+1) & (b->tableSize-1);
+	}
+
+	uint idx = b->batch.numVerts++;
+	b->table[slot] = idx+1;
+	memcpy( &b->keys[5*idx], key, 5*sizeof(uint) );
+	if (!b->fill) return idx;
+
+	// Fill in the vertex, in the same layout as IGLUOBJReader::AddDataToArray()
+	float *v = &b->verts[ idx*b->numComponents ];
+	const float *vert = GetSpill( &b->spills[0], key[0] );
+	const float *norm = GetSpill( &b->spills[1], key[1] );
+	const float *tex  = GetSpill( &b->spills[2], key[2] );
+	*(v++) = float( key[3] );
+	*(v++) = float( key[4] );
+	for (int i=0; i<3; i++)
+		*(v++) = (vert[i] - b->ctr[i]) / b->scale;
+	if (b->batch.normOff)
+		for (int i=0; i<3; i++) *(v++) = norm ? norm[i] : 0.0f;
+	if (b->batch.texOff)
+		for (int i=0; i<2; i++) *(v++) = tex ? tex[i] : 0.0f;
+	return idx;
+}
+
+// Hands the current batch to the callback and starts a new (empty) one
+static void FlushStreamBatch( IGLUOBJStreamBatch *b )
+{
+	if (b->batch.numTris > 0 && b->func)
+		b->func( b->batch, b->userData );
+	b->batch.firstVert += b->batch.numVerts;
+	b->batch.firstTri  += b->batch.numTris;
+	b->batch.numVerts   = 0;
+	b->batch.numTris    = 0;
+	memset( b->table, 0, b->tableSize*sizeof(uint) );
+}
+
+// What we need to upload batches to an IGLUVertexArray
+struct IGLUOBJStreamUpload
+{
+	IGLUVertexArray *vertArr;
+	uint            *indices;
+};
+
+// The batch callback used when there's no user callback:  copies each batch into the next
+//    part of the vertex array's buffers, making its indices relative to the whole buffer.
+static void UploadStreamBatch( const IGLUOBJBatch &batch, void *userData )
+{
+	IGLUOBJStreamUpload *upload = (IGLUOBJStreamUpload *)userData;
+	for (uint i=0; i<3*batch.numTris; i++)
+		upload->indices[i] = batch.indices[i] + batch.firstVert;
+	upload->vertArr->SetVertexArraySubset( GLintptr(batch.firstVert)*batch.stride,
+		                                   GLsizeiptr(batch.numVerts)*batch.stride, (void *)batch.verts );
+	upload->vertArr->SetElementArraySubset( GLintptr(batch.firstTri)*3*sizeof(uint),
+		                                    GLsizeiptr(batch.numTris)*3*sizeof(uint), upload->indices );
+}
+
+// };  End: anonymous namespace
+
+
+// Runs the second pass:  reads the facets (and the lines that change the material or object),
+//    handing batches of triangles to b->func.  Returns the total number of vertices.
+uint IGLUOBJReader::StreamMappedFacets( IGLUOBJStreamBatch *b )
+{
+	const char *ptr = m_mapPtr, *eol, *lineEnd, *linePtr, *tokEnd, *cur;
+	char fname[256], keyword[64];
+	char *mtlFilePtr = 0;
+	uint numVerts = 0, numNorms = 0, numTexCoords = 0;
+	int vIdx, tIdx, nIdx, tmpMatlId;
+	uint first[5], prev[5], key[5];
+
+	b->batch.numVerts = b->batch.numTris = b->batch.firstVert = b->batch.firstTri = 0;
+	memset( b->table, 0, b->tableSize*sizeof(uint) );
+	m_curMatlId = m_curObjectId = 0;
+	lineNum = 0;
+
+	while (ptr < m_mapEnd)
+	{
+		// Find the next line, skipping blanks & comments
+		eol     = (const char *)memchr( ptr, '\n', m_mapEnd-ptr );
+		lineEnd = eol ? eol : m_mapEnd;
+		linePtr = SkipWhiteSpaceInPlace( ptr, lineEnd );
+		ptr     = eol ? eol+1 : m_mapEnd;
+		lineNum++;
+		if (linePtr >= lineEnd || linePtr[0] == '#' || linePtr[0] == 0)
+			continue;
+
+		tokEnd = SkipTokenInPlace( linePtr, lineEnd );
+		cur    = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+		char key0 = (char)tolower( linePtr[0] );
+		char key1 = (tokEnd-linePtr > 1) ? (char)tolower( linePtr[1] ) : 0;
+
+		switch( key0 )
+		{
+		case 'v': // We only need to count these;  their values are in the spill files
+			if (key1 == 'n')      numNorms++;
+			else if (key1 == 't') numTexCoords++;
+			else if (key1 == 0)   numVerts++;
+			break;
+		case 'm': // We found the name of a material file!  (Only load it once.)
+			if (!b->loadMtls) break;
+			CopyStringInPlace( fname, 256, cur, SkipTokenInPlace( cur, lineEnd ) );
+			mtlFilePtr = (char *)malloc( strlen(fname)+strlen(fileDirectory)+1 );
+			sprintf( mtlFilePtr, "%s%s", fileDirectory, fname );
+			m_objMtlFiles.push_back( mtlFilePtr );
+			if (m_loadMtlFile)
+				delete( new IGLUOBJMaterialReader( mtlFilePtr, m_deferUpload ));  // Load it.
+			break;
+		case 'o': // We found a name for the object following this flag
+			CopyStringInPlace( fname, 256, cur, SkipTokenInPlace( cur, lineEnd ) );
+			m_curObjectId = GetObjectIDForName( m_objTris.AddName( fname ) );
+			break;
+		case 'u': // We found the name of the material we'll be using
+			CopyStringInPlace( fname, 256, cur, SkipTokenInPlace( cur, lineEnd ) );
+			tmpMatlId = IGLUOBJMaterialReader::GetNamedMaterialId( fname );
+			if (tmpMatlId >= 0)
+				m_curMatlId = uint(tmpMatlId);
+			break;
+		case 'g': // Groups and smoothing commands don't affect the vertex array
+		case 's':
+			break;
+		case 'f': // We found a facet!
+			{
+				int format = GetFacetFormatInPlace( cur, SkipTokenInPlace( cur, lineEnd ) );
+				int corner = 0;
+				bool valid = true;
+				while (cur < lineEnd)
+				{
+					// Resolve this corner's indices, exactly as ReadFacetTokenInPlace() does
+					tokEnd = SkipTokenInPlace( cur, lineEnd );
+					GetFacetIndicesInPlace( format, cur, tokEnd, &vIdx, &tIdx, &nIdx );
+					cur = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+					key[0] = uint( vIdx > 0 ? vIdx-1 : int(numVerts)+vIdx );
+					key[1] = (format == IGLU_OBJ_FACET_VN || format == IGLU_OBJ_FACET_VTN) ?
+						     uint( nIdx > 0 ? nIdx-1 : int(numNorms)+nIdx ) : uint(-1);
+					key[2] = (format == IGLU_OBJ_FACET_VT || format == IGLU_OBJ_FACET_VTN) ?
+						     uint( tIdx > 0 ? tIdx-1 : int(numTexCoords)+tIdx ) : uint(-1);
+					key[3] = m_loadMtlFile ? m_curMatlId : 0;
+					key[4] = m_assignObjects ? m_curObjectId : 0;
+					if (key[0] >= numVerts) valid = false;
+
+					// Corners after the third add another triangle to the fan
+					if (corner < 2)
+						memcpy( corner ? prev : first, key, sizeof(key) );
+					else if (valid)
+					{
+						if (b->batch.numTris == b->maxTris)
+							FlushStreamBatch( b );
+						uint *tri = &b->indices[ 3*b->batch.numTris++ ];
+						tri[0] = AddStreamVertex( b, first );
+						tri[1] = AddStreamVertex( b, prev );
+						tri[2] = AddStreamVertex( b, key );
+						memcpy( prev, key, sizeof(key) );
+					}
+					corner++;
+				}
+
+				if (corner < 3 && b->fill)
+				{
+					CopyStringInPlace( fname, 256, linePtr, lineEnd );
+					this->WarningMessage("Corrupt 'f': %s", fname);
+				}
+				else if (!valid && b->fill)
+					this->WarningMessage("Facet uses a vertex that isn't in the file (yet)!");
+			}
+			break;
+
+		default:  // We have no clue what to do with this line....
+			if (!b->fill) break;
+			CopyStringInPlace( keyword, 64, linePtr, tokEnd );
+			MakeLower( keyword );
+			this->WarningMessage("Found corrupt line in OBJ.  Unknown keyword '%s'", keyword);
+		}
+	}
+
+	FlushStreamBatch( b );
+	return b->batch.firstVert;
+}
+
+#ifdef min
+#undef min
+#endif
+#ifdef max
+#undef max
+#endif
+
+void IGLUOBJReader::StreamMappedFile( IGLUOBJBatchCallback batchFunc, void *batchData )
+{
+	const char *ptr = m_mapPtr, *eol, *lineEnd, *linePtr, *tokEnd, *cur;
+	float minPt[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxPt[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float vals[3];
+	double x;
+	uint numTris = 0;
+
+	// Pass one:  spill the vertices, normals and texture coordinates to binary files, and
+	//    count triangles.
+	IGLUOBJSpill spills[3];
+	bool ok = OpenSpill( &spills[0], fileName, ".iglustream.v",  3 );
+	ok = OpenSpill( &spills[1], fileName, ".iglustream.vn", 3 ) && ok;
+	ok = OpenSpill( &spills[2], fileName, ".iglustream.vt", 2 ) && ok;
+	while (ok && ptr < m_mapEnd)
+	{
+		eol     = (const char *)memchr( ptr, '\n', m_mapEnd-ptr );
+		lineEnd = eol ? eol : m_mapEnd;
+		linePtr = SkipWhiteSpaceInPlace( ptr, lineEnd );
+		ptr     = eol ? eol+1 : m_mapEnd;
+		if (linePtr >= lineEnd || (linePtr[0] != 'v' && linePtr[0] != 'V' && linePtr[0] != 'f' && linePtr[0] != 'F'))
+			continue;
+
+		tokEnd = SkipTokenInPlace( linePtr, lineEnd );
+		cur    = SkipWhiteSpaceInPlace( tokEnd, lineEnd );
+		char key1 = (tokEnd-linePtr > 1) ? (char)tolower( linePtr[1] ) : 0;
+		if (tolower( linePtr[0] ) == 'f')
+		{
+			int format = GetFacetFormatInPlace( cur, SkipTokenInPlace( cur, lineEnd ) );
+			int corners = 0;
+			for ( ; cur < lineEnd; corners++ )
+				cur = SkipWhiteSpaceInPlace( SkipTokenInPlace( cur, lineEnd ), lineEnd );
+			if (corners < 3) continue;
+			numTris += corners-2;
+			m_hasVertices = true;
+			m_hasNormals   = m_hasNormals || format == IGLU_OBJ_FACET_VN || format == IGLU_OBJ_FACET_VTN;
+			m_hasTexCoords = m_hasTexCoords || format == IGLU_OBJ_FACET_VT || format == IGLU_OBJ_FACET_VTN;
+		}
+		else if (key1 == 0 || key1 == 'n' || key1 == 't')
+		{
+			IGLUOBJSpill *spill = &spills[ key1 == 0 ? 0 : (key1 == 'n' ? 1 : 2) ];
+			for (uint i=0; i<spill->numFloats; i++)
+			{
+				cur = ParseNumericalTokenInPlace( cur, lineEnd, &x );
+				vals[i] = float(x);
+			}
+			WriteSpill( spill, vals );
+			if (key1 == 0)
+				for (int i=0; i<3; i++)
+				{
+					minPt[i] = iglu::min( minPt[i], vals[i] );
+					maxPt[i] = iglu::max( maxPt[i], vals[i] );
+				}
+		}
+	}
+	for (int i=0; i<3; i++)
+		ok = MapSpill( &spills[i] ) && ok;
+	if (!ok)
+	{
+		this->WarningMessage("Unable to write temporary files for streaming '%s'!", fileName);
+		for (int i=0; i<3; i++)
+			CloseSpill( &spills[i] );
+		return;
+	}
+
+	// Our vertex layout is the same as GetArrayBuffer()'s
+	uint numComponents = 1 + 1 + 3 + (m_hasNormals ? 3 : 0) + (m_hasTexCoords ? 2 : 0);
+	m_vertStride  = numComponents * sizeof( float );
+	m_matlIdOff   = 0 * sizeof( float );
+	m_objectIdOff = 1 * sizeof( float );
+	m_vertOff     = 2 * sizeof( float );
+	m_normOff     = (m_hasNormals ? 5 : 0) * sizeof( float );
+	m_texOff      = (m_hasTexCoords ? (m_hasNormals ? 8 : 5) : 0) * sizeof( float );
+
+	// Set up the batch.  Centering & resizing use the bounds of all the vertices in the file.
+	IGLUOBJStreamBatch b;
+	memset( &b, 0, sizeof(b) );
+	b.maxTris       = IGLU_OBJ_STREAM_BATCH_TRIANGLES;
+	b.numComponents = numComponents;
+	for (b.tableSize = 1; b.tableSize < 6*b.maxTris; b.tableSize *= 2) ;
+	b.keys          = (uint *)malloc( 3*b.maxTris*5*sizeof(uint) );
+	b.table         = (uint *)malloc( b.tableSize*sizeof(uint) );
+	b.verts         = (float *)malloc( 3*b.maxTris*m_vertStride );
+	b.indices       = (uint *)malloc( 3*b.maxTris*sizeof(uint) );
+	b.spills        = spills;
+	b.batch.verts   = b.verts;
+	b.batch.indices = b.indices;
+	b.batch.stride  = m_vertStride;
+	b.batch.vertOff = m_vertOff;
+	b.batch.normOff = m_normOff;
+	b.batch.texOff  = m_texOff;
+	b.batch.matlIdOff   = m_matlIdOff;
+	b.batch.objectIdOff = m_objectIdOff;
+	float delta = 0;
+	for (int i=0; i<3; i++)
+	{
+		bool any = spills[0].count > 0;
+		b.ctr[i] = (any && (m_resize || m_center)) ? 0.5f*(minPt[i]+maxPt[i]) : 0.0f;
+		delta    = any ? iglu::max( delta, 0.5f*(maxPt[i]-minPt[i]) ) : 0.0f;
+	}
+	b.scale = (m_resize && delta > 0) ? delta : 1.0f;
+
+	// Pass two:  build the batches and send them where they need to go.  If they're going into
+	//    our vertex array, we first need a (cheaper) run that just counts the vertices, so we
+	//    know how big to make the buffers.
+	IGLUOBJStreamUpload upload = { m_vertArr, 0 };
+	b.loadMtls = true;
+	if (!batchFunc)
+	{
+		b.fill = false;
+		uint numArrayVerts = StreamMappedFacets( &b );
+		b.loadMtls = false;
+		m_vertArr->SetVertexArray( GLsizeiptr(numArrayVerts)*m_vertStride, 0, IGLU_STATIC|IGLU_DRAW );
+		m_vertArr->SetElementArray( GL_UNSIGNED_INT, GLsizeiptr(numTris)*3*sizeof(uint), 0, IGLU_STATIC|IGLU_DRAW );
+		upload.indices = (uint *)malloc( 3*b.maxTris*sizeof(uint) );
+		batchFunc = UploadStreamBatch;
+		batchData = &upload;
+	}
+	b.fill     = true;
+	b.func     = batchFunc;
+	b.userData = batchData;
+	m_numArrayVerts = StreamMappedFacets( &b );
+	m_numTris       = b.batch.firstTri;
+	m_mapPtr        = m_mapEnd;
+
+	free( upload.indices );
+	free( b.keys );
+	free( b.table );
+	free( b.verts );
+	free( b.indices );
+	for (int i=0; i<3; i++)
+		CloseSpill( &spills[i] );
+}
@@ -15,15 +15,45 @@ using namespace iglu;
 
 #pragma warning( disable : 4996 )
 
-IGLUFileParser::IGLUFileParser( char *filename, bool verbose) : 
-	f(NULL), lineNum(0), fileName(0), m_closed(false)
-{
-	f = fopen( filename, "r" );
-	if (!f)
+IGLUFileParser::IGLUFileParser( char *filename, bool verbose, bool memoryMapped ) : 
+	f(NULL), lineNum(0), fileName(0), m_closed(false),
+	m_mappedFile(0), m_mapPtr(0), m_mapEnd(0)
+{
+	// Mounted I/O providers get the first chance at the file.  Otherwise we only map 
+	//    disk files if asked to.
+	m_mappedFile = IGLUFileSystem::Open( filename, memoryMapped );
+	if (m_mappedFile)
+	{
+		m_mapPtr = m_mappedFile->GetData();
+		m_mapEnd = m_mappedFile->GetEnd();
+	}
+	else if (!memoryMapped)
+		f = fopen( filename, "r" );
+
+	if (!f && !m_mappedFile)
 	{
 		printf("*** Error: IGLUFileParser unable to open '%s'...\n", filename);
 		exit(-1);
 	}
+	SetFileName( filename );
+}
+
+IGLUFileParser::IGLUFileParser( IGLUFileData *data, char *filename, bool verbose ) : 
+	f(NULL), lineNum(0), fileName(0), m_closed(false),
+	m_mappedFile(data), m_mapPtr(0), m_mapEnd(0)
+{
+	if (!m_mappedFile || !m_mappedFile->IsValid())
+	{
+		printf("*** Error: IGLUFileParser given invalid data for '%s'...\n", filename);
+		exit(-1);
+	}
+	m_mapPtr = m_mappedFile->GetData();
+	m_mapEnd = m_mappedFile->GetEnd();
+	SetFileName( filename );
+}
+
+void IGLUFileParser::SetFileName( const char *filename )
+{
 	fileName = strdup( filename );
 	char *fptr = strrchr( fileName, '/' );
 	char *rptr = strrchr( fileName, '\\' );
@@ -43,13 +73,17 @@ IGLUFileParser::IGLUFileParser( char *filename, bool verbose) :
 
 IGLUFileParser::~IGLUFileParser()
 {
-	if (!m_closed) fclose( f );
+	if (!m_closed) CloseFile();
 	if (fileName) free( fileName );
 }
 
 void IGLUFileParser::CloseFile( void )
 {
-	fclose( f );
+	if (f) fclose( f );
+	delete m_mappedFile;
+	f = NULL;
+	m_mappedFile = 0;
+	m_mapPtr = m_mapEnd = 0;
 	m_closed = true;
 }
 
@@ -84,11 +118,54 @@ char *IGLUFileParser::__ReadLine( void )
 {
 	if (m_closed) 
 		return 0;
+
+	// When memory-mapped, copy (at most) a buffer's worth of the next line, 
+	//    exactly as fgets() would.
+	if (m_mappedFile)
+	{
+		if (m_mapPtr >= m_mapEnd) 
+			return 0;
+		size_t maxLen = size_t(m_mapEnd-m_mapPtr);
+		if (maxLen > sizeof(internalBuf)-1) maxLen = sizeof(internalBuf)-1;
+		const char *eol = (const char *)memchr( m_mapPtr, '\n', maxLen );
+		size_t lineLen = eol ? (eol-m_mapPtr)+1 : maxLen;
+		memcpy( internalBuf, m_mapPtr, lineLen );
+		internalBuf[lineLen] = 0;
+		m_mapPtr += lineLen;
+		lineNum++;
+		return internalBuf;
+	}
+
 	char *ptr = fgets(internalBuf, 2048, f);
 	if (ptr) lineNum++;
 	return ptr;
 }
 
+const char *IGLUFileParser::ReadNextLineInPlace( const char **lineEnd, bool discardBlanks )
+{
+	if (m_closed || !m_mappedFile) 
+		return 0;
+
+	while (m_mapPtr < m_mapEnd)
+	{
+		// Find the extent of the next line, and move past it
+		const char *lineStart = m_mapPtr;
+		const char *eol = (const char *)memchr( m_mapPtr, '\n', m_mapEnd-m_mapPtr );
+		*lineEnd = eol ? eol : m_mapEnd;
+		m_mapPtr = eol ? eol+1 : m_mapEnd;
+		lineNum++;
+
+		// When we start looking through the line, we'll want the first non-whitespace
+		const char *ptr = SkipWhiteSpaceInPlace( lineStart, *lineEnd );
+
+		// If we start with a comment or have no non-blank characters read a new line.
+		if (discardBlanks && (ptr >= *lineEnd || ptr[0] == '#' || ptr[0] == 0))
+			continue;
+		return ptr;
+	}
+	return 0;
+}
+
 char *IGLUFileParser::GetToken( char *token )
 {
 	internalBufPtr = StripLeadingTokenToBuffer( internalBufPtr, token );
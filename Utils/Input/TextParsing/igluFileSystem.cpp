@@ -0,0 +1,416 @@
+/******************************************************************/
+/* igluFileSystem.cpp                                             */
+/* -----------------------                                        */
+/*                                                                */
+/* Pluggable I/O providers for IGLU's file loaders, plus the two  */
+/*    standard ones (blocks of memory and pack files).            */
+/*                                                                */
+/******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "iglu/parsing/igluFileSystem.h"
+#include "iglu/parsing/igluMappedFile.h"
+
+using namespace iglu;
+
+#pragma warning( disable : 4996 )
+
+// Bump this whenever the pack layout changes
+#define IGLU_PACK_VERSION   1
+
+std::vector< IGLUIOProvider * > IGLUFileSystem::s_providers;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// The header at the start of each pack file.  Offsets are from the start of the file.
+struct IGLUPackHeader
+{
+	char               magic[8];          // "IGLUPAK"
+	unsigned int       version;           // IGLU_PACK_VERSION
+	unsigned int       numFiles;
+	unsigned long long fileSize;          // Size of the entire pack (catches partially written files)
+	unsigned long long namesOff;          // Where the (null-terminated) names start
+};
+
+// One directory entry.  The directory immediately follows the header.
+struct IGLUPackDirEntry
+{
+	unsigned long long offset, size;      // The file contents
+	unsigned long long nameOff;           // The file's name (relative to the header's namesOff)
+};
+
+// A file inside a mapped pack.  Read-ahead hints are passed on to the pack's mapping.
+class IGLUPackFileData : public IGLUFileData
+{
+public:
+	IGLUPackFileData( IGLUMappedFile *pack, size_t offset, size_t size ) :
+		IGLUFileData( pack->GetData() + offset, size ), m_pack( pack ), m_offset( offset ) {}
+	virtual void WillNeed( size_t offset, size_t size )  { m_pack->WillNeed( m_offset + offset, size ); }
+private:
+	IGLUMappedFile *m_pack;
+	size_t m_offset;
+};
+
+// Normalizes a name into a malloc()'d buffer
+static char *NormalizedCopy( const char *filename )
+{
+	char *result = (char *)malloc( strlen( filename ) + 1 );
+	IGLUFileSystem::NormalizeName( result, filename );
+	return result;
+}
+
+// Rounds a file offset up, so files in the pack are nicely aligned
+static unsigned long long AlignPackOffset( unsigned long long offset )
+{
+	return (offset + 15) & ~15ULL;
+}
+
+// Writes data to the pack, first padding with zeros until the file reaches offset 'where'.
+static bool WritePackData( FILE *f, unsigned long long *curOffset, unsigned long long where,
+						   const void *data, size_t bytes )
+{
+	static const char zeros[16] = { 0 };
+	if (where > *curOffset && fwrite( zeros, 1, size_t(where - *curOffset), f ) != size_t(where - *curOffset))
+		return false;
+	if (bytes > 0 && fwrite( data, 1, bytes, f ) != bytes)
+		return false;
+	*curOffset = where + bytes;
+	return true;
+}
+
+// };  End: anonymous namespace
+
+
+void IGLUFileSystem::NormalizeName( char *result, const char *filename )
+{
+	char *out = result;
+	for (const char *ptr = filename; *ptr; ptr++)
+	{
+		char c = (*ptr == '\\') ? '/' : *ptr;
+
+		// Skip "./" at the start of the name (or of the name after another "./")
+		if (out == result && c == '.' && (ptr[1] == '/' || ptr[1] == '\\'))
+		{
+			ptr++;
+			continue;
+		}
+
+		// Collapse repeated slashes (but keep a leading one, which means an absolute path)
+		if (c == '/' && out > result && out[-1] == '/')
+			continue;
+		*(out++) = c;
+	}
+	*out = 0;
+}
+
+void IGLUFileSystem::Mount( IGLUIOProvider *provider )
+{
+	if (!provider) return;
+	Unmount( provider );
+	s_providers.push_back( provider );
+}
+
+void IGLUFileSystem::Unmount( IGLUIOProvider *provider )
+{
+	for (size_t i=0; i<s_providers.size(); i++)
+		if (s_providers[i] == provider)
+		{
+			s_providers.erase( s_providers.begin() + i );
+			return;
+		}
+}
+
+IGLUFileData *IGLUFileSystem::Open( const char *filename, bool mapDiskFiles )
+{
+	if (!filename) return 0;
+
+	if (!s_providers.empty())
+	{
+		char *name = NormalizedCopy( filename );
+		for (int i=(int)s_providers.size()-1; i>=0; i--)
+		{
+			IGLUFileData *data = s_providers[i]->Open( name );
+			if (data)
+			{
+				free( name );
+				return data;
+			}
+		}
+		free( name );
+	}
+
+	if (!mapDiskFiles) return 0;
+	IGLUMappedFile *file = new IGLUMappedFile( filename );
+	if (file->IsValid()) return file;
+	delete file;
+	return 0;
+}
+
+char *IGLUFileSystem::ReadFile( const char *filename, size_t *size )
+{
+	IGLUFileData *data = Open( filename );
+	if (!data) return 0;
+
+	char *result = (char *)malloc( data->GetSize() + 1 );
+	if (result)
+	{
+		memcpy( result, data->GetData(), data->GetSize() );
+		result[ data->GetSize() ] = 0;
+		if (size) *size = data->GetSize();
+	}
+	delete data;
+	return result;
+}
+
+void IGLUFileSystem::Prefetch( const char *filename )
+{
+	// Files on disk are left to the OS's own read-ahead.
+	if (!filename || s_providers.empty()) return;
+	char *name = NormalizedCopy( filename );
+	for (int i=(int)s_providers.size()-1; i>=0; i--)
+		if (s_providers[i]->Prefetch( name ))
+			break;
+	free( name );
+}
+
+
+IGLUMemoryIOProvider::~IGLUMemoryIOProvider()
+{
+	for (size_t i=0; i<m_files.size(); i++)
+	{
+		free( m_files[i].name );
+		if (m_files[i].owned) free( (void *)m_files[i].data );
+	}
+}
+
+int IGLUMemoryIOProvider::FindFile( const char *normalizedName )
+{
+	for (int i=0; i<(int)m_files.size(); i++)
+		if (!strcmp( m_files[i].name, normalizedName ))
+			return i;
+	return -1;
+}
+
+void IGLUMemoryIOProvider::AddFile( const char *filename, const char *data, size_t size, bool copyData )
+{
+	RemoveFile( filename );
+
+	MemoryFile file;
+	file.name  = NormalizedCopy( filename );
+	file.data  = data;
+	file.size  = size;
+	file.owned = copyData;
+	if (copyData)
+	{
+		char *copy = (char *)malloc( size ? size : 1 );
+		memcpy( copy, data, size );
+		file.data = copy;
+	}
+	m_files.push_back( file );
+}
+
+void IGLUMemoryIOProvider::RemoveFile( const char *filename )
+{
+	char *name = NormalizedCopy( filename );
+	int idx = FindFile( name );
+	free( name );
+	if (idx < 0) return;
+
+	free( m_files[idx].name );
+	if (m_files[idx].owned) free( (void *)m_files[idx].data );
+	m_files.erase( m_files.begin() + idx );
+}
+
+IGLUFileData *IGLUMemoryIOProvider::Open( const char *filename )
+{
+	int idx = FindFile( filename );
+	return (idx < 0) ? 0 : new IGLUFileData( m_files[idx].data, m_files[idx].size );
+}
+
+bool IGLUMemoryIOProvider::Prefetch( const char *filename )
+{
+	return FindFile( filename ) >= 0;
+}
+
+
+IGLUPackIOProvider::IGLUPackIOProvider( const char *packFile, const char *mountDir ) :
+	m_pack(0), m_mountDir(0)
+{
+	// Store the mount directory normalized, with a trailing '/' (or empty)
+	m_mountDir = (char *)malloc( (mountDir ? strlen( mountDir ) : 0) + 2 );
+	IGLUFileSystem::NormalizeName( m_mountDir, mountDir ? mountDir : "" );
+	size_t dirLen = strlen( m_mountDir );
+	if (dirLen > 0 && m_mountDir[dirLen-1] != '/')
+		strcat( m_mountDir, "/" );
+
+	IGLUMappedFile *pack = new IGLUMappedFile( packFile );
+	IGLUPackHeader hdr;
+	if (!pack->IsValid() || pack->GetSize() < sizeof( hdr ))
+	{
+		printf("*** Warning: Unable to open pack file '%s'\n", packFile);
+		delete pack;
+		return;
+	}
+
+	// Check the header and the directory, in case the pack is corrupt
+	const char *data = pack->GetData();
+	memcpy( &hdr, data, sizeof( hdr ) );
+	bool ok = !memcmp( hdr.magic, "IGLUPAK", 8 ) && hdr.version == IGLU_PACK_VERSION &&
+		      hdr.fileSize == (unsigned long long) pack->GetSize() &&
+			  hdr.namesOff >= sizeof( hdr ) + hdr.numFiles * (unsigned long long) sizeof( IGLUPackDirEntry ) &&
+			  hdr.namesOff <= hdr.fileSize;
+	for (unsigned int i=0; ok && i<hdr.numFiles; i++)
+	{
+		IGLUPackDirEntry dir;
+		memcpy( &dir, data + sizeof( hdr ) + i*sizeof( dir ), sizeof( dir ) );
+		ok = dir.offset <= hdr.fileSize && dir.size <= hdr.fileSize - dir.offset &&
+			 dir.nameOff < hdr.fileSize - hdr.namesOff &&
+			 memchr( data + hdr.namesOff + dir.nameOff, 0, size_t(hdr.fileSize - hdr.namesOff - dir.nameOff) ) != 0;
+
+		PackEntry entry;
+		entry.name   = data + hdr.namesOff + dir.nameOff;
+		entry.offset = size_t(dir.offset);
+		entry.size   = size_t(dir.size);
+		if (ok) m_entries.push_back( entry );
+	}
+	if (!ok)
+	{
+		printf("*** Warning: Pack file '%s' is corrupt or from a different IGLU version\n", packFile);
+		m_entries.clear();
+		delete pack;
+		return;
+	}
+
+	std::sort( m_entries.begin(), m_entries.end(), EntryLess );
+	m_pack = pack;
+}
+
+IGLUPackIOProvider::~IGLUPackIOProvider()
+{
+	delete m_pack;
+	free( m_mountDir );
+}
+
+bool IGLUPackIOProvider::EntryLess( const PackEntry &a, const PackEntry &b )
+{
+	return strcmp( a.name, b.name ) < 0;
+}
+
+int IGLUPackIOProvider::FindEntry( const char *normalizedName )
+{
+	// Only names inside our mount directory can be in the pack
+	size_t dirLen = strlen( m_mountDir );
+	if (!m_pack || strncmp( normalizedName, m_mountDir, dirLen )) return -1;
+	normalizedName += dirLen;
+
+	int lo = 0, hi = (int)m_entries.size()-1;
+	while (lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+		int cmp = strcmp( normalizedName, m_entries[mid].name );
+		if (cmp == 0) return mid;
+		if (cmp < 0) hi = mid-1;
+		else         lo = mid+1;
+	}
+	return -1;
+}
+
+IGLUFileData *IGLUPackIOProvider::Open( const char *filename )
+{
+	int idx = FindEntry( filename );
+	return (idx < 0) ? 0 : new IGLUPackFileData( m_pack, m_entries[idx].offset, m_entries[idx].size );
+}
+
+bool IGLUPackIOProvider::Prefetch( const char *filename )
+{
+	int idx = FindEntry( filename );
+	if (idx < 0) return false;
+	m_pack->WillNeed( m_entries[idx].offset, m_entries[idx].size );
+	return true;
+}
+
+bool IGLUPackIOProvider::WritePack( const char *packFile, const char **files, int numFiles, const char *baseDir )
+{
+	char *base = NormalizedCopy( baseDir ? baseDir : "" );
+	size_t baseLen = strlen( base );
+
+	// Work out the names each file is stored under
+	std::vector< char * > names;
+	unsigned long long namesSz = 0;
+	for (int i=0; i<numFiles; i++)
+	{
+		char *name = NormalizedCopy( files[i] );
+		if (baseLen > 0 && !strncmp( name, base, baseLen ))
+		{
+			size_t skip = baseLen + (name[baseLen] == '/' ? 1 : 0);
+			memmove( name, name + skip, strlen( name + skip ) + 1 );
+		}
+		names.push_back( name );
+		namesSz += strlen( name ) + 1;
+	}
+	free( base );
+
+	IGLUPackHeader hdr;
+	memset( &hdr, 0, sizeof( hdr ) );
+	memcpy( hdr.magic, "IGLUPAK", 8 );
+	hdr.version  = IGLU_PACK_VERSION;
+	hdr.numFiles = (unsigned int) numFiles;
+	hdr.namesOff = sizeof( hdr ) + numFiles * (unsigned long long) sizeof( IGLUPackDirEntry );
+
+	// Lay out the directory.  We need each file's size up front, so map them all.
+	std::vector< IGLUMappedFile * > srcs;
+	std::vector< IGLUPackDirEntry > dir( numFiles > 0 ? numFiles : 1 );
+	unsigned long long nameOff = 0, dataOff = AlignPackOffset( hdr.namesOff + namesSz );
+	bool ok = true;
+	for (int i=0; i<numFiles; i++)
+	{
+		IGLUMappedFile *src = new IGLUMappedFile( files[i] );
+		srcs.push_back( src );
+		if (!src->IsValid())
+		{
+			printf("*** Warning: Unable to read '%s' when building pack file '%s'\n", files[i], packFile);
+			ok = false;
+			break;
+		}
+		dir[i].offset  = dataOff;
+		dir[i].size    = src->GetSize();
+		dir[i].nameOff = nameOff;
+		nameOff += strlen( names[i] ) + 1;
+		dataOff  = AlignPackOffset( dataOff + src->GetSize() );
+	}
+	hdr.fileSize = numFiles > 0 ? dir[numFiles-1].offset + dir[numFiles-1].size : hdr.namesOff;
+
+	FILE *f = ok ? fopen( packFile, "wb" ) : 0;
+	if (ok && !f)
+		printf("*** Warning: Unable to create pack file '%s'\n", packFile);
+	if (f)
+	{
+		unsigned long long curOff = 0;
+		ok = WritePackData( f, &curOff, 0, &hdr, sizeof( hdr ) );
+		for (int i=0; ok && i<numFiles; i++)
+			ok = WritePackData( f, &curOff, curOff, &dir[i], sizeof( IGLUPackDirEntry ) );
+		for (int i=0; ok && i<numFiles; i++)
+			ok = WritePackData( f, &curOff, curOff, names[i], strlen( names[i] ) + 1 );
+		for (int i=0; ok && i<numFiles; i++)
+			ok = WritePackData( f, &curOff, dir[i].offset, srcs[i]->GetData(), srcs[i]->GetSize() );
+		fclose( f );
+
+		// Don't leave a partial pack lying around
+		if (!ok)
+		{
+			remove( packFile );
+			printf("*** Warning: Unable to write pack file '%s'\n", packFile);
+		}
+	}
+	else
+		ok = false;
+
+	for (size_t i=0; i<srcs.size(); i++)
+		delete srcs[i];
+	for (size_t i=0; i<names.size(); i++)
+		free( names[i] );
+	return ok;
+}
@@ -0,0 +1,179 @@
+/******************************************************************/
+/* igluMappedFile.cpp                                             */
+/* -----------------------                                        */
+/*                                                                */
+/* A class that maps a file read-only into memory, so parsers can */
+/*    scan the file contents in place rather than copying them    */
+/*    through stdio buffers.                                      */
+/*                                                                */
+/******************************************************************/
+
+#include <stdio.h>
+#include "iglu/parsing/igluMappedFile.h"
+
+/************************************************************************/
+/*  First, identify which OS we're using.                               */
+/*      (May need to be tweaked, esp on Windows if not using MS VC++)   */
+/************************************************************************/
+
+#if defined(WIN32) && defined(_MSC_VER) && !defined(USING_MSVC)
+	#define USING_MSVC
+#endif
+
+#if defined(__APPLE__) && !defined(USING_MACOSX) && !defined(USING_LINUX)
+	#define USING_MACOSX
+#endif
+
+#if defined(__GNUC__) && !defined(USING_MACOSX) && !defined(USING_LINUX)
+	#define USING_LINUX
+#endif
+
+#if defined(USING_MSVC)
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace iglu;
+
+// Mapped data for empty files (which cannot actually be mapped)
+static const char s_emptyFileData[1] = { 0 };
+
+#if defined(USING_MSVC)
+
+IGLUMappedFile::IGLUMappedFile( const char *filename ) :
+	IGLUFileData(), m_fileHandle(0), m_mapHandle(0)
+{
+	HANDLE hFile = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if (hFile == INVALID_HANDLE_VALUE)
+		return;
+	m_fileHandle = (void *)hFile;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx( hFile, &fileSize ))
+	{
+		Close();
+		return;
+	}
+
+	m_size = (size_t)fileSize.QuadPart;
+	if (m_size == 0)
+	{
+		m_data  = s_emptyFileData;
+		m_valid = true;
+		return;
+	}
+
+	HANDLE hMap = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	if (!hMap)
+	{
+		Close();
+		return;
+	}
+	m_mapHandle = (void *)hMap;
+
+	m_data = (const char *)MapViewOfFile( hMap, FILE_MAP_READ, 0, 0, 0 );
+	if (!m_data)
+	{
+		Close();
+		return;
+	}
+	m_valid = true;
+}
+
+void IGLUMappedFile::Close( void )
+{
+	if (m_data && m_data != s_emptyFileData)
+		UnmapViewOfFile( (LPCVOID)m_data );
+	if (m_mapHandle)
+		CloseHandle( (HANDLE)m_mapHandle );
+	if (m_fileHandle)
+		CloseHandle( (HANDLE)m_fileHandle );
+	m_data = 0;
+	m_size = 0;
+	m_mapHandle = m_fileHandle = 0;
+	m_valid = false;
+}
+
+void IGLUMappedFile::WillNeed( size_t /*offset*/, size_t /*size*/ )
+{
+	// PrefetchVirtualMemory() only exists on Windows 8+, and touching the pages here would
+	//    block until they are read.  We opened with FILE_FLAG_SEQUENTIAL_SCAN, so the cache
+	//    manager already reads ahead of front-to-back parsers.
+}
+
+#else
+
+IGLUMappedFile::IGLUMappedFile( const char *filename ) :
+	IGLUFileData(), m_fileHandle(0), m_mapHandle(0)
+{
+	int fd = open( filename, O_RDONLY );
+	if (fd < 0)
+		return;
+
+	// We store (fd+1) so a NULL handle still means "not open"
+	m_fileHandle = (void *)(size_t)(fd+1);
+
+	struct stat fileInfo;
+	if (fstat( fd, &fileInfo ) < 0)
+	{
+		Close();
+		return;
+	}
+
+	m_size = (size_t)fileInfo.st_size;
+	if (m_size == 0)
+	{
+		m_data  = s_emptyFileData;
+		m_valid = true;
+		return;
+	}
+
+	void *ptr = mmap( 0, m_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	if (ptr == MAP_FAILED)
+	{
+		Close();
+		return;
+	}
+	m_data = (const char *)ptr;
+
+	// We (almost) always walk through the file front-to-back, so tell the OS
+	madvise( ptr, m_size, MADV_SEQUENTIAL );
+	m_valid = true;
+}
+
+void IGLUMappedFile::Close( void )
+{
+	if (m_data && m_data != s_emptyFileData)
+		munmap( (void *)m_data, m_size );
+	if (m_fileHandle)
+		close( int((size_t)m_fileHandle) - 1 );
+	m_data = 0;
+	m_size = 0;
+	m_mapHandle = m_fileHandle = 0;
+	m_valid = false;
+}
+
+void IGLUMappedFile::WillNeed( size_t offset, size_t size )
+{
+	if (!m_valid || offset >= m_size || m_data == s_emptyFileData) return;
+	if (size > m_size - offset) size = m_size - offset;
+
+	// madvise() needs a page-aligned start address
+	size_t pageSize = (size_t)sysconf( _SC_PAGESIZE );
+	size_t start = offset - (offset % pageSize);
+	madvise( (void *)(m_data + start), size + (offset-start), MADV_WILLNEED );
+}
+
+#endif
+
+IGLUMappedFile::~IGLUMappedFile()
+{
+	Close();
+}
+
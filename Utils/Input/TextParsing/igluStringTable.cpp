@@ -0,0 +1,148 @@
+/******************************************************************/
+/* igluStringTable.cpp                                            */
+/* -----------------------                                        */
+/*                                                                */
+/* An interned string table, with strings identified by an ID and */
+/*    looked up via an open-addressed hash table.                 */
+/*                                                                */
+/******************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "iglu/parsing/igluStringTable.h"
+
+using namespace iglu;
+
+// Strings are packed into blocks at least this large
+#define IGLU_STRING_BLOCK_SIZE   65536
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// A 32-bit FNV-1a hash of the string
+static unsigned int HashString( const char *str, size_t len )
+{
+	unsigned int hash = 2166136261u;
+	for (size_t i=0; i<len; i++)
+	{
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// };  End: anonymous namespace
+
+
+IGLUStringTable::IGLUStringTable() : m_blockPtr(0), m_blockLeft(0)
+{
+	Clear();
+}
+
+IGLUStringTable::~IGLUStringTable()
+{
+	for (size_t i=0; i<m_blocks.size(); i++)
+		free( m_blocks[i] );
+}
+
+void IGLUStringTable::Clear( void )
+{
+	for (size_t i=0; i<m_blocks.size(); i++)
+		free( m_blocks[i] );
+	m_blocks.clear();
+	m_blockPtr  = 0;
+	m_blockLeft = 0;
+
+	m_strings.assign( 1, (char *)0 );
+	m_hashes.assign( 1, 0u );
+	m_buckets.assign( 64, 0u );
+}
+
+unsigned int IGLUStringTable::FindBucket( const char *str, size_t len, unsigned int hash ) const
+{
+	unsigned int mask = (unsigned int)m_buckets.size() - 1;
+	unsigned int bucket = hash & mask;
+	while (m_buckets[bucket])
+	{
+		unsigned int id = m_buckets[bucket];
+		if (m_hashes[id] == hash && !strncmp( m_strings[id], str, len ) && m_strings[id][len] == 0)
+			break;
+		bucket = (bucket + 1) & mask;
+	}
+	return bucket;
+}
+
+char *IGLUStringTable::CopyString( const char *str, size_t len )
+{
+	// Long strings get a block to themselves.  Otherwise, start a new block when this one's full.
+	if (len+1 > m_blockLeft)
+	{
+		size_t blockSize = (len+1 > IGLU_STRING_BLOCK_SIZE/4) ? len+1 : IGLU_STRING_BLOCK_SIZE;
+		char *block = (char *)malloc( blockSize );
+		m_blocks.push_back( block );
+		if (blockSize != IGLU_STRING_BLOCK_SIZE)
+		{
+			memcpy( block, str, len );
+			block[len] = 0;
+			return block;
+		}
+		m_blockPtr  = block;
+		m_blockLeft = blockSize;
+	}
+
+	char *copy = m_blockPtr;
+	memcpy( copy, str, len );
+	copy[len] = 0;
+	m_blockPtr  += len+1;
+	m_blockLeft -= len+1;
+	return copy;
+}
+
+void IGLUStringTable::Rehash( size_t numBuckets )
+{
+	m_buckets.assign( numBuckets, 0u );
+	unsigned int mask = (unsigned int)numBuckets - 1;
+	for (unsigned int id=1; id<m_strings.size(); id++)
+	{
+		unsigned int bucket = m_hashes[id] & mask;
+		while (m_buckets[bucket])
+			bucket = (bucket + 1) & mask;
+		m_buckets[bucket] = id;
+	}
+}
+
+unsigned int IGLUStringTable::Add( const char *str, const char *strEnd )
+{
+	if (!str) return 0;
+	size_t len = size_t(strEnd - str);
+	unsigned int hash = HashString( str, len );
+	unsigned int bucket = FindBucket( str, len, hash );
+	if (m_buckets[bucket])
+		return m_buckets[bucket];
+
+	unsigned int id = (unsigned int)m_strings.size();
+	m_strings.push_back( CopyString( str, len ) );
+	m_hashes.push_back( hash );
+	m_buckets[bucket] = id;
+
+	// Keep the hash table no more than half full
+	if (2*m_strings.size() > m_buckets.size())
+		Rehash( 2*m_buckets.size() );
+	return id;
+}
+
+unsigned int IGLUStringTable::Add( const char *str )
+{
+	return str ? Add( str, str + strlen( str ) ) : 0;
+}
+
+unsigned int IGLUStringTable::Find( const char *str, const char *strEnd ) const
+{
+	if (!str) return 0;
+	size_t len = size_t(strEnd - str);
+	return m_buckets[ FindBucket( str, len, HashString( str, len ) ) ];
+}
+
+unsigned int IGLUStringTable::Find( const char *str ) const
+{
+	return str ? Find( str, str + strlen( str ) ) : 0;
+}
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 
 #pragma warning( disable: 4996 )
 
@@ -241,6 +242,162 @@ char *StripLeadingNumericalToken( char *string, char *result )
   return tmp;
 }
 
+/*
+** Returns a ptr to the first non-whitespace character at
+** or after 'string' in a (not null-terminated) buffer.
+*/
+const char *SkipWhiteSpaceInPlace( const char *string, const char *end )
+{
+  const char *tmp = string;
+  while ( tmp < end &&
+	  ( (tmp[0] == ' ') ||
+	    (tmp[0] == '\t') ||
+	    (tmp[0] == '\n') ||
+	    (tmp[0] == '\r') ) )
+    tmp++;
+  return tmp;
+}
+
+/*
+** Returns a ptr to the first whitespace character at or
+** after 'string' in a (not null-terminated) buffer.
+*/
+const char *SkipTokenInPlace( const char *string, const char *end )
+{
+  const char *tmp = string;
+  while ( tmp < end &&
+	  (tmp[0] != ' ') &&
+	  (tmp[0] != '\t') &&
+	  (tmp[0] != '\n') &&
+	  (tmp[0] != '\r') &&
+	  (tmp[0] != 0) )
+    tmp++;
+  return tmp;
+}
+
+/* 
+** Exact powers of ten representable as doubles.  Dividing an integer
+** mantissa below 2^53 by one of these gives a correctly rounded result
+** (i.e., the same as atof()).
+*/
+static const double s_exactPowersOf10[] = { 
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11, 
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/*
+** works the same ways as atof( StripLeadingNumericalToken ),
+** but in place on a (not null-terminated) buffer.  Most 
+** numbers in model files are short and are converted 
+** directly;  others fall back to atof() on a copy.
+*/
+const char *ParseNumericalTokenInPlace( const char *string, const char *end, double *result )
+{
+  const char *tmp, *tokEnd, *ptr, *ptr2;
+
+  // If there are any commas or ( before the next number, skip them.
+  tmp = string;
+  while ( tmp < end &&
+	  ( (tmp[0] == ' ') || (tmp[0] == '\t') || (tmp[0] == '\n') ||
+	    (tmp[0] == '\r') || (tmp[0] == ',') || (tmp[0] == '(') ) )
+    tmp++;
+  tokEnd = SkipTokenInPlace( tmp, end );
+
+  /* find the beginning of the number */
+  ptr = tmp;
+  while( ptr < tokEnd &&
+	 (ptr[0] != '-') &&
+	 (ptr[0] != '.') &&
+	 ((ptr[0]-'0' < 0) ||
+	  (ptr[0]-'9' > 0)) )
+    ptr++;
+
+  /* find the end of the number */
+  ptr2 = ptr;
+  while( ptr2 < tokEnd &&
+	 ( (ptr2[0] == '-') ||
+	   (ptr2[0] == '.') ||
+	   ((ptr2[0]-'0' >= 0) && (ptr2[0]-'9' <= 0)) ) )
+    ptr2++;
+
+  /* convert [ptr, ptr2) as atof() would */
+  const char *cur = ptr;
+  bool negative = false;
+  if (cur < ptr2 && cur[0] == '-') { negative = true; cur++; }
+
+  unsigned long long mantissa = 0;
+  int numDigits = 0, sigDigits = 0, fracDigits = 0;
+  while (cur < ptr2 && cur[0] >= '0' && cur[0] <= '9')
+  {
+    mantissa = mantissa*10 + (cur[0]-'0');
+    if (mantissa) sigDigits++;
+    numDigits++; cur++;
+  }
+  if (cur < ptr2 && cur[0] == '.')
+  {
+    cur++;
+    while (cur < ptr2 && cur[0] >= '0' && cur[0] <= '9')
+    {
+      mantissa = mantissa*10 + (cur[0]-'0');
+      if (mantissa) sigDigits++;
+      numDigits++; fracDigits++; cur++;
+    }
+  }
+
+  if (numDigits == 0)
+    *result = 0.0;
+  else if (sigDigits <= 15 && fracDigits <= 22)
+  {
+    double val = double(mantissa) / s_exactPowersOf10[fracDigits];
+    *result = negative ? -val : val;
+  }
+  else
+  {
+    char buf[128];
+    int len = int(ptr2-ptr) < 127 ? int(ptr2-ptr) : 127;
+    for (int i=0; i<len; i++) buf[i] = ptr[i];
+    buf[len] = 0;
+    *result = atof( buf );
+  }
+
+  return SkipWhiteSpaceInPlace( tokEnd, end );
+}
+
+/*
+** Parses a decimal integer as sscanf( "%d" ) would.  Returns 
+** a ptr just past the integer, or NULL if none was found.
+*/
+const char *ParseIntegerInPlace( const char *string, const char *end, int *result )
+{
+  const char *tmp = string;
+  bool negative = false;
+  if (tmp < end && (tmp[0] == '-' || tmp[0] == '+'))
+  {
+    negative = (tmp[0] == '-');
+    tmp++;
+  }
+  if (tmp >= end || tmp[0] < '0' || tmp[0] > '9')
+    return 0;
+
+  unsigned int val = 0;
+  while (tmp < end && tmp[0] >= '0' && tmp[0] <= '9')
+    val = val*10 + (tmp++[0]-'0');
+
+  *result = negative ? -int(val) : int(val);
+  return tmp;
+}
+
+/*
+** Copies a (not null-terminated) string into a fixed-size
+** buffer, truncating it if needed.
+*/
+char *CopyStringInPlace( char *buf, int bufSize, const char *string, const char *end )
+{
+  int len = int(end-string) < bufSize-1 ? int(end-string) : bufSize-1;
+  memcpy( buf, string, len );
+  buf[len] = 0;
+  return buf;
+}
+
 // End namespace iglu
 }
 
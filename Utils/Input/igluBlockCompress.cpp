@@ -0,0 +1,722 @@
+/******************************************************************/
+/* igluBlockCompress.cpp                                          */
+/* -----------------------                                        */
+/*                                                                */
+/* CPU encoders for the BC1, BC3, BC4, BC5, and BC7 block         */
+/*    formats.  Every format fits a line (two endpoints) through  */
+/*    a block's pixels, so they share the same steps:  start from */
+/*    the principal axis, quantize the endpoints, pick the best   */
+/*    palette entry for each pixel, then refit the endpoints by   */
+/*    least squares and keep the result if it is better.  BC7     */
+/*    blocks are all written in mode 6 (one subset, RGBA, 16      */
+/*    palette entries), which suits most textures well.           */
+/*                                                                */
+/******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GL/glew.h>
+#include "iglu/igluBlockCompress.h"
+#include "iglu/igluParallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define IGLU_BC_USE_SSE
+#endif
+
+using namespace iglu;
+
+// Rows of blocks per parallel work item
+#define IGLU_BC_BAND_BLOCKS      8
+
+// Endpoint refinements to try per block (each stops early once it stops helping)
+#define IGLU_BC_REFINE_STEPS     2
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// A 4x4 block of pixels, stored a channel at a time (so SSE can work on four pixels at once).
+//    Values are in [0..255].  Pixels with zero weight (e.g., transparent BC1 pixels) don't
+//    affect the endpoints.
+struct IGLUBCBlock
+{
+	float px[4][16];
+	float weight[16];
+};
+
+// Everything a band of block rows needs to know
+struct IGLUBCJob
+{
+	unsigned char       *dst;
+	const unsigned char *src;
+	int                  width, height, channels, blocksX, blocksY;
+	IGLUBlockFormat      format;
+	size_t               blockBytes;
+};
+
+// Where each palette index lies between endpoint 0 (t = 0) and endpoint 1 (t = 1)
+static const float bc1FourT[4]  = { 0.0f, 1.0f, 1.0f/3.0f, 2.0f/3.0f };
+static const float bc1ThreeT[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+static const float bc4EightT[8] = { 0.0f, 1.0f, 1.0f/7.0f, 2.0f/7.0f, 3.0f/7.0f, 4.0f/7.0f, 5.0f/7.0f, 6.0f/7.0f };
+
+// BC7's interpolation weights (out of 64) for 4-bit indices, and the same as fractions
+static const int   bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static const float bc7T[16]       = { 0.0f, 0.0625f, 0.140625f, 0.203125f, 0.265625f, 0.328125f, 0.40625f, 0.46875f,
+                                      0.53125f, 0.59375f, 0.671875f, 0.734375f, 0.796875f, 0.859375f, 0.9375f, 1.0f };
+
+// For each byte value, the 5- and 6-bit endpoint pairs whose 1/3 point comes closest to
+//    it.  Blocks of a single color use these, as rounding both endpoints to 5 or 6 bits
+//    is often visibly off in flat regions.
+struct IGLUBC1SingleColor
+{
+	unsigned char end5[256][2], end6[256][2];
+
+	IGLUBC1SingleColor()
+	{
+		FindPairs( end5, 31 );
+		FindPairs( end6, 63 );
+	}
+
+	static void FindPairs( unsigned char (*ends)[2], int maxVal )
+	{
+		int bits = (maxVal == 31) ? 5 : 6;
+		for (int v=0; v<256; v++)
+		{
+			float bestError = 1e30f;
+			for (int a=0; a<=maxVal; a++)
+				for (int b=0; b<=maxVal; b++)
+				{
+					int ea = (a << (8-bits)) | (a >> (2*bits-8)), eb = (b << (8-bits)) | (b >> (2*bits-8));
+					float error = fabsf( (2.0f*ea + eb) / 3.0f - v ) + 0.001f * abs( ea - eb );
+					if (error < bestError)
+					{
+						bestError = error;
+						ends[v][0] = (unsigned char) a;
+						ends[v][1] = (unsigned char) b;
+					}
+				}
+		}
+	}
+};
+static IGLUBC1SingleColor bc1SingleColor;
+
+// Writes bits into a (zeroed) block, least significant bit first
+struct IGLUBCBits
+{
+	unsigned char *out;
+	int            pos;
+};
+
+static inline void PutBits( IGLUBCBits *bits, unsigned int value, int count )
+{
+	for (int i=0; i<count; i++, bits->pos++)
+		if ((value >> i) & 1)
+			bits->out[bits->pos >> 3] |= (unsigned char)( 1 << (bits->pos & 7) );
+}
+
+static inline float ClampByte( float v )
+{
+	return (v < 0.0f) ? 0.0f : ((v > 255.0f) ? 255.0f : v);
+}
+
+static inline int Quantize( float v, int maxVal )
+{
+	int q = int( v * maxVal / 255.0f + 0.5f );
+	return (q < 0) ? 0 : ((q > maxVal) ? maxVal : q);
+}
+
+static inline unsigned short PackRGB565( const float *rgb )
+{
+	return (unsigned short)( (Quantize( rgb[0], 31 ) << 11) | (Quantize( rgb[1], 63 ) << 5) | Quantize( rgb[2], 31 ) );
+}
+
+static inline void UnpackRGB565( unsigned short color, float *rgba )
+{
+	int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+	rgba[0] = float( (r << 3) | (r >> 2) );
+	rgba[1] = float( (g << 2) | (g >> 4) );
+	rgba[2] = float( (b << 3) | (b >> 2) );
+	rgba[3] = 0.0f;
+}
+
+// Copies block (bx,by) out of the image.  Pixels past the right or bottom edge repeat the
+//    last column or row, so partial blocks fit only the pixels that are really there.
+static void LoadBlock( IGLUBCBlock *blk, const IGLUBCJob *job, int bx, int by )
+{
+	for (int y=0; y<4; y++)
+	{
+		int sy = (4*by + y < job->height) ? 4*by + y : job->height - 1;
+		const unsigned char *row = job->src + size_t(sy) * job->width * job->channels;
+		for (int x=0; x<4; x++)
+		{
+			int sx = (4*bx + x < job->width) ? 4*bx + x : job->width - 1;
+			const unsigned char *p = row + sx * job->channels;
+			int i = 4*y + x;
+			blk->px[0][i]  = p[0];
+			blk->px[1][i]  = p[1];
+			blk->px[2][i]  = p[2];
+			blk->px[3][i]  = (job->channels == 4) ? p[3] : 255.0f;
+			blk->weight[i] = 1.0f;
+		}
+	}
+}
+
+// Picks the closest of numEntries palette colors for each pixel (comparing only channels
+//    [firstChannel..firstChannel+numChannels-1]).  Returns the total weighted squared error.
+static float FindIndices( const IGLUBCBlock *blk, const float (*palette)[4], int numEntries,
+						  int firstChannel, int numChannels, int *indices )
+{
+	int lastChannel = firstChannel + numChannels;
+	float error = 0.0f;
+#ifdef IGLU_BC_USE_SSE
+	for (int i=0; i<16; i+=4)
+	{
+		__m128  best    = _mm_set1_ps( 1e30f );
+		__m128i bestIdx = _mm_setzero_si128();
+		for (int k=0; k<numEntries; k++)
+		{
+			__m128 dist = _mm_setzero_ps();
+			for (int c=firstChannel; c<lastChannel; c++)
+			{
+				__m128 d = _mm_sub_ps( _mm_loadu_ps( blk->px[c] + i ), _mm_set1_ps( palette[k][c] ) );
+				dist = _mm_add_ps( dist, _mm_mul_ps( d, d ) );
+			}
+			__m128i closer = _mm_castps_si128( _mm_cmplt_ps( dist, best ) );
+			best    = _mm_min_ps( dist, best );
+			bestIdx = _mm_or_si128( _mm_and_si128( closer, _mm_set1_epi32( k ) ), _mm_andnot_si128( closer, bestIdx ) );
+		}
+		_mm_storeu_si128( (__m128i *)(indices + i), bestIdx );
+
+		float err[4];
+		_mm_storeu_ps( err, _mm_mul_ps( best, _mm_loadu_ps( blk->weight + i ) ) );
+		error += (err[0] + err[1]) + (err[2] + err[3]);
+	}
+#else
+	for (int i=0; i<16; i++)
+	{
+		float best = 1e30f;
+		indices[i] = 0;
+		for (int k=0; k<numEntries; k++)
+		{
+			float dist = 0.0f;
+			for (int c=firstChannel; c<lastChannel; c++)
+			{
+				float d = blk->px[c][i] - palette[k][c];
+				dist += d*d;
+			}
+			if (dist < best)
+			{
+				best = dist;
+				indices[i] = k;
+			}
+		}
+		error += best * blk->weight[i];
+	}
+#endif
+	return error;
+}
+
+// Finds the line through the block's (weighted) pixels, and returns where the pixels start
+//    and end along it as the endpoints e0 & e1
+static void FindPrincipalEndpoints( const IGLUBCBlock *blk, int firstChannel, int numChannels, float *e0, float *e1 )
+{
+	int lastChannel = firstChannel + numChannels;
+	float mean[4] = { 0, 0, 0, 0 }, total = 0.0f;
+	for (int i=0; i<16; i++)
+	{
+		total += blk->weight[i];
+		for (int c=firstChannel; c<lastChannel; c++)
+			mean[c] += blk->weight[i] * blk->px[c][i];
+	}
+	if (total <= 0.0f)
+	{
+		for (int c=firstChannel; c<lastChannel; c++)
+			e0[c] = e1[c] = 0.0f;
+		return;
+	}
+	for (int c=firstChannel; c<lastChannel; c++)
+		mean[c] /= total;
+
+	float cov[4][4];
+	memset( cov, 0, sizeof( cov ) );
+	for (int i=0; i<16; i++)
+		for (int a=firstChannel; a<lastChannel; a++)
+			for (int b=firstChannel; b<lastChannel; b++)
+				cov[a][b] += blk->weight[i] * (blk->px[a][i] - mean[a]) * (blk->px[b][i] - mean[b]);
+
+	// Power iteration, starting from the covariance column with the most variance
+	float axis[4] = { 0, 0, 0, 0 };
+	int start = firstChannel;
+	for (int c=firstChannel; c<lastChannel; c++)
+		if (cov[c][c] > cov[start][start]) start = c;
+	for (int c=firstChannel; c<lastChannel; c++)
+		axis[c] = cov[c][start];
+	for (int iter=0; iter<8; iter++)
+	{
+		float next[4] = { 0, 0, 0, 0 }, biggest = 0.0f;
+		for (int a=firstChannel; a<lastChannel; a++)
+		{
+			for (int b=firstChannel; b<lastChannel; b++)
+				next[a] += cov[a][b] * axis[b];
+			biggest = (fabsf( next[a] ) > biggest) ? fabsf( next[a] ) : biggest;
+		}
+		if (biggest <= 0.0f) break;
+		for (int c=firstChannel; c<lastChannel; c++)
+			axis[c] = next[c] / biggest;
+	}
+
+	float len = 0.0f;
+	for (int c=firstChannel; c<lastChannel; c++)
+		len += axis[c] * axis[c];
+	if (len < 1e-12f)
+	{
+		// Every pixel is the same
+		for (int c=firstChannel; c<lastChannel; c++)
+			e0[c] = e1[c] = mean[c];
+		return;
+	}
+	len = 1.0f / sqrtf( len );
+	for (int c=firstChannel; c<lastChannel; c++)
+		axis[c] *= len;
+
+	float tMin = 1e30f, tMax = -1e30f;
+	for (int i=0; i<16; i++)
+	{
+		if (blk->weight[i] <= 0.0f) continue;
+		float t = 0.0f;
+		for (int c=firstChannel; c<lastChannel; c++)
+			t += (blk->px[c][i] - mean[c]) * axis[c];
+		tMin = (t < tMin) ? t : tMin;
+		tMax = (t > tMax) ? t : tMax;
+	}
+	for (int c=firstChannel; c<lastChannel; c++)
+	{
+		e0[c] = ClampByte( mean[c] + tMin * axis[c] );
+		e1[c] = ClampByte( mean[c] + tMax * axis[c] );
+	}
+}
+
+// The least squares endpoints for the pixels' current indices, where index k lies t[k] of the
+//    way from e0 to e1.  Returns false if the indices don't pin down two distinct endpoints.
+static bool FitEndpoints( const IGLUBCBlock *blk, const int *indices, const float *t,
+						  int firstChannel, int numChannels, float *e0, float *e1 )
+{
+	int lastChannel = firstChannel + numChannels;
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = { 0, 0, 0, 0 }, bx[4] = { 0, 0, 0, 0 };
+	for (int i=0; i<16; i++)
+	{
+		float w = blk->weight[i];
+		if (w <= 0.0f) continue;
+		float b = t[indices[i]], a = 1.0f - b;
+		aa += w * a * a;
+		ab += w * a * b;
+		bb += w * b * b;
+		for (int c=firstChannel; c<lastChannel; c++)
+		{
+			ax[c] += w * a * blk->px[c][i];
+			bx[c] += w * b * blk->px[c][i];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if (fabsf( det ) < 1e-6f) return false;
+	det = 1.0f / det;
+	for (int c=firstChannel; c<lastChannel; c++)
+	{
+		e0[c] = ClampByte( (bb * ax[c] - ab * bx[c]) * det );
+		e1[c] = ClampByte( (aa * bx[c] - ab * ax[c]) * det );
+	}
+	return true;
+}
+
+// Quantizes BC1 endpoints and finds the best indices for them.  Four-color blocks need
+//    color 0 > color 1;  three-color blocks (whose index 3 is transparent) need color 0 <= color 1.
+static float TryBC1( const IGLUBCBlock *blk, const float *e0, const float *e1, bool fourColor,
+					 unsigned short *c0, unsigned short *c1, int *indices )
+{
+	*c0 = PackRGB565( e0 );
+	*c1 = PackRGB565( e1 );
+	if (fourColor ? (*c0 < *c1) : (*c0 > *c1))
+	{
+		unsigned short tmp = *c0;
+		*c0 = *c1;
+		*c1 = tmp;
+	}
+
+	float pal[4][4];
+	UnpackRGB565( *c0, pal[0] );
+	UnpackRGB565( *c1, pal[1] );
+	int numEntries = 1;                 // If c0 == c1, index 0 means the same thing in either mode
+	if (*c0 != *c1 && fourColor)
+	{
+		for (int c=0; c<4; c++)
+		{
+			pal[2][c] = (2.0f*pal[0][c] + pal[1][c]) / 3.0f;
+			pal[3][c] = (pal[0][c] + 2.0f*pal[1][c]) / 3.0f;
+		}
+		numEntries = 4;
+	}
+	else if (*c0 != *c1)
+	{
+		for (int c=0; c<4; c++)
+			pal[2][c] = 0.5f * (pal[0][c] + pal[1][c]);
+		numEntries = 3;
+	}
+
+	float error = FindIndices( blk, pal, numEntries, 0, 3, indices );
+	if (!fourColor)
+		for (int i=0; i<16; i++)
+			if (blk->weight[i] <= 0.0f) indices[i] = 3;
+	return error;
+}
+
+// An 8-byte BC1 color block.  With allowTransparent, pixels with alpha < 128 become transparent.
+static void EncodeBC1( IGLUBCBlock *blk, unsigned char *out, bool allowTransparent )
+{
+	bool transparent = false;
+	for (int i=0; i<16; i++)
+	{
+		blk->weight[i] = (allowTransparent && blk->px[3][i] < 128.0f) ? 0.0f : 1.0f;
+		transparent = transparent || (blk->weight[i] <= 0.0f);
+	}
+
+	// Is every (opaque) pixel the same color?
+	bool singleColor = !transparent;
+	for (int i=1; singleColor && i<16; i++)
+		singleColor = blk->px[0][i] == blk->px[0][0] && blk->px[1][i] == blk->px[1][0] &&
+		              blk->px[2][i] == blk->px[2][0];
+
+	float e0[4], e1[4];
+	unsigned short c0, c1;
+	int idx[16];
+	if (singleColor)
+	{
+		// Use the 1/3 point (index 2) between endpoints from the lookup tables
+		int r = int( blk->px[0][0] ), g = int( blk->px[1][0] ), b = int( blk->px[2][0] );
+		c0 = (unsigned short)( (bc1SingleColor.end5[r][0] << 11) | (bc1SingleColor.end6[g][0] << 5) | bc1SingleColor.end5[b][0] );
+		c1 = (unsigned short)( (bc1SingleColor.end5[r][1] << 11) | (bc1SingleColor.end6[g][1] << 5) | bc1SingleColor.end5[b][1] );
+		int index = 2;
+		if (c0 < c1)
+		{
+			unsigned short tmp = c0;
+			c0 = c1;
+			c1 = tmp;
+			index = 3;
+		}
+		else if (c0 == c1)
+			index = 0;
+		for (int i=0; i<16; i++)
+			idx[i] = index;
+	}
+	else
+	{
+		FindPrincipalEndpoints( blk, 0, 3, e0, e1 );
+		float error = TryBC1( blk, e0, e1, !transparent, &c0, &c1, idx );
+
+		for (int step=0; step<IGLU_BC_REFINE_STEPS && error > 0.0f && c0 != c1; step++)
+		{
+			unsigned short n0, n1;
+			int nIdx[16];
+			if (!FitEndpoints( blk, idx, transparent ? bc1ThreeT : bc1FourT, 0, 3, e0, e1 )) break;
+			float nError = TryBC1( blk, e0, e1, !transparent, &n0, &n1, nIdx );
+			if (nError >= error) break;
+			error = nError;
+			c0 = n0;
+			c1 = n1;
+			memcpy( idx, nIdx, sizeof( idx ) );
+		}
+	}
+
+	unsigned int bits = 0;
+	for (int i=0; i<16; i++)
+		bits |= (unsigned int)( idx[i] ) << (2*i);
+	out[0] = (unsigned char)( c0 & 0xFF );   out[1] = (unsigned char)( c0 >> 8 );
+	out[2] = (unsigned char)( c1 & 0xFF );   out[3] = (unsigned char)( c1 >> 8 );
+	out[4] = (unsigned char)( bits );        out[5] = (unsigned char)( bits >> 8 );
+	out[6] = (unsigned char)( bits >> 16 );  out[7] = (unsigned char)( bits >> 24 );
+}
+
+// Finds the best indices for BC4 endpoints (in channel ch).  a0 > a1 gives eight interpolated
+//    values;  otherwise, six, plus exactly 0 and 255.
+static float TryBC4( const IGLUBCBlock *blk, int ch, int a0, int a1, int *indices )
+{
+	float pal[8][4];
+	memset( pal, 0, sizeof( pal ) );
+	pal[0][ch] = float( a0 );
+	pal[1][ch] = float( a1 );
+	if (a0 > a1)
+		for (int k=2; k<8; k++)
+			pal[k][ch] = ((8-k)*a0 + (k-1)*a1) / 7.0f;
+	else
+	{
+		for (int k=2; k<6; k++)
+			pal[k][ch] = ((6-k)*a0 + (k-1)*a1) / 5.0f;
+		pal[6][ch] = 0.0f;
+		pal[7][ch] = 255.0f;
+	}
+	return FindIndices( blk, pal, 8, ch, 1, indices );
+}
+
+// An 8-byte BC4 block for one channel (also BC3's alpha, and each half of BC5)
+static void EncodeBC4( IGLUBCBlock *blk, int ch, unsigned char *out )
+{
+	const float *v = blk->px[ch];
+	float lo = 255.0f, hi = 0.0f, innerLo = 255.0f, innerHi = 0.0f;
+	for (int i=0; i<16; i++)
+	{
+		blk->weight[i] = 1.0f;
+		lo = (v[i] < lo) ? v[i] : lo;
+		hi = (v[i] > hi) ? v[i] : hi;
+		if (v[i] > 0.0f && v[i] < 255.0f)
+		{
+			innerLo = (v[i] < innerLo) ? v[i] : innerLo;
+			innerHi = (v[i] > innerHi) ? v[i] : innerHi;
+		}
+	}
+
+	// Eight values spanning the block's range, refined if that helps
+	int a0 = int( hi + 0.5f ), a1 = int( lo + 0.5f ), idx[16];
+	float error = TryBC4( blk, ch, a0, a1, idx );
+	for (int step=0; step<IGLU_BC_REFINE_STEPS && error > 0.0f && a0 > a1; step++)
+	{
+		float e0[4], e1[4];
+		int nIdx[16];
+		if (!FitEndpoints( blk, idx, bc4EightT, ch, 1, e0, e1 )) break;
+		int n0 = int( e0[ch] + 0.5f ), n1 = int( e1[ch] + 0.5f );
+		if (n0 < n1)
+		{
+			int tmp = n0;
+			n0 = n1;
+			n1 = tmp;
+		}
+		if (n0 == n1) break;
+		float nError = TryBC4( blk, ch, n0, n1, nIdx );
+		if (nError >= error) break;
+		error = nError;
+		a0 = n0;
+		a1 = n1;
+		memcpy( idx, nIdx, sizeof( idx ) );
+	}
+
+	// Blocks touching 0 or 255 may do better spending the range on the values in between
+	if (error > 0.0f && (lo <= 0.0f || hi >= 255.0f))
+	{
+		int n0 = (innerLo <= innerHi) ? int( innerLo + 0.5f ) : 0;
+		int n1 = (innerLo <= innerHi) ? int( innerHi + 0.5f ) : 255;
+		int nIdx[16];
+		float nError = TryBC4( blk, ch, n0, n1, nIdx );
+		if (nError < error)
+		{
+			a0 = n0;
+			a1 = n1;
+			memcpy( idx, nIdx, sizeof( idx ) );
+		}
+	}
+
+	unsigned long long bits = 0;
+	for (int i=0; i<16; i++)
+		bits |= (unsigned long long)( idx[i] ) << (3*i);
+	out[0] = (unsigned char)( a0 );
+	out[1] = (unsigned char)( a1 );
+	for (int i=0; i<6; i++)
+		out[2+i] = (unsigned char)( bits >> (8*i) );
+}
+
+// BC7 mode 6 endpoints have 7 bits per channel, plus a low bit (the p-bit) shared by all
+//    four channels.  Picks whichever p-bit fits the endpoint better.
+static void QuantizeBC7Endpoint( const float *e, int *q, int *p )
+{
+	float bestError = 1e30f;
+	for (int pBit=0; pBit<2; pBit++)
+	{
+		int tq[4];
+		float error = 0.0f;
+		for (int c=0; c<4; c++)
+		{
+			int v = int( (e[c] - pBit) * 0.5f + 0.5f );
+			tq[c] = (v < 0) ? 0 : ((v > 127) ? 127 : v);
+			float d = float( 2*tq[c] + pBit ) - e[c];
+			error += d*d;
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			*p = pBit;
+			memcpy( q, tq, sizeof( tq ) );
+		}
+	}
+}
+
+static float TryBC7( const IGLUBCBlock *blk, const float *e0, const float *e1, int (*q)[4], int *p, int *indices )
+{
+	QuantizeBC7Endpoint( e0, q[0], &p[0] );
+	QuantizeBC7Endpoint( e1, q[1], &p[1] );
+
+	float pal[16][4];
+	for (int c=0; c<4; c++)
+	{
+		int a = 2*q[0][c] + p[0], b = 2*q[1][c] + p[1];
+		for (int k=0; k<16; k++)
+			pal[k][c] = float( ((64 - bc7Weights[k])*a + bc7Weights[k]*b + 32) >> 6 );
+	}
+	return FindIndices( blk, pal, 16, 0, 4, indices );
+}
+
+// A 16-byte BC7 block, in mode 6
+static void EncodeBC7( IGLUBCBlock *blk, unsigned char *out )
+{
+	for (int i=0; i<16; i++)
+		blk->weight[i] = 1.0f;
+
+	float e0[4], e1[4];
+	int q[2][4], p[2], idx[16];
+	FindPrincipalEndpoints( blk, 0, 4, e0, e1 );
+	float error = TryBC7( blk, e0, e1, q, p, idx );
+
+	for (int step=0; step<IGLU_BC_REFINE_STEPS && error > 0.0f; step++)
+	{
+		int nq[2][4], np[2], nIdx[16];
+		if (!FitEndpoints( blk, idx, bc7T, 0, 4, e0, e1 )) break;
+		float nError = TryBC7( blk, e0, e1, nq, np, nIdx );
+		if (nError >= error) break;
+		error = nError;
+		memcpy( q, nq, sizeof( q ) );
+		memcpy( p, np, sizeof( p ) );
+		memcpy( idx, nIdx, sizeof( idx ) );
+	}
+
+	// The first pixel's index is stored without its high bit, so it must be < 8.  Swapping the
+	//    endpoints (and reversing the indices) gives the same palette the other way round.
+	if (idx[0] >= 8)
+	{
+		for (int c=0; c<4; c++)
+		{
+			int tmp = q[0][c];
+			q[0][c] = q[1][c];
+			q[1][c] = tmp;
+		}
+		int tmp = p[0];
+		p[0] = p[1];
+		p[1] = tmp;
+		for (int i=0; i<16; i++)
+			idx[i] = 15 - idx[i];
+	}
+
+	memset( out, 0, 16 );
+	IGLUBCBits bits = { out, 0 };
+	PutBits( &bits, 1 << 6, 7 );                   // Mode 6
+	for (int c=0; c<4; c++)
+	{
+		PutBits( &bits, q[0][c], 7 );
+		PutBits( &bits, q[1][c], 7 );
+	}
+	PutBits( &bits, p[0], 1 );
+	PutBits( &bits, p[1], 1 );
+	PutBits( &bits, idx[0], 3 );
+	for (int i=1; i<16; i++)
+		PutBits( &bits, idx[i], 4 );
+}
+
+// Called by IGLUParallel::For() to compress one band of block rows
+static void CompressBand( int band, void *jobPtr )
+{
+	const IGLUBCJob *job = (const IGLUBCJob *)jobPtr;
+	int by0 = band * IGLU_BC_BAND_BLOCKS;
+	int by1 = (by0 + IGLU_BC_BAND_BLOCKS < job->blocksY) ? by0 + IGLU_BC_BAND_BLOCKS : job->blocksY;
+
+	IGLUBCBlock blk;
+	for (int by=by0; by<by1; by++)
+		for (int bx=0; bx<job->blocksX; bx++)
+		{
+			unsigned char *out = job->dst + (size_t(by) * job->blocksX + bx) * job->blockBytes;
+			LoadBlock( &blk, job, bx, by );
+			switch (job->format)
+			{
+			case IGLU_BLOCK_BC1:
+				EncodeBC1( &blk, out, job->channels == 4 );
+				break;
+			case IGLU_BLOCK_BC3:
+				EncodeBC4( &blk, 3, out );
+				EncodeBC1( &blk, out + 8, false );
+				break;
+			case IGLU_BLOCK_BC4:
+				EncodeBC4( &blk, 0, out );
+				break;
+			case IGLU_BLOCK_BC5:
+				EncodeBC4( &blk, 0, out );
+				EncodeBC4( &blk, 1, out + 8 );
+				break;
+			case IGLU_BLOCK_BC7:
+				EncodeBC7( &blk, out );
+				break;
+			default:
+				break;
+			}
+		}
+}
+
+// };  End: anonymous namespace
+
+
+size_t IGLUBlockCompressor::GetBlockBytes( IGLUBlockFormat format )
+{
+	switch (format)
+	{
+	case IGLU_BLOCK_BC1:
+	case IGLU_BLOCK_BC4:
+		return 8;
+	case IGLU_BLOCK_BC3:
+	case IGLU_BLOCK_BC5:
+	case IGLU_BLOCK_BC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+size_t IGLUBlockCompressor::GetCompressedSize( IGLUBlockFormat format, int width, int height )
+{
+	return size_t( (width + 3) / 4 ) * size_t( (height + 3) / 4 ) * GetBlockBytes( format );
+}
+
+unsigned int IGLUBlockCompressor::GetGLFormat( IGLUBlockFormat format, int channels )
+{
+	switch (format)
+	{
+	case IGLU_BLOCK_BC1: return (channels == 4) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case IGLU_BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case IGLU_BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+	case IGLU_BLOCK_BC5: return GL_COMPRESSED_RG_RGTC2;
+	case IGLU_BLOCK_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+	default:             return (channels == 4) ? GL_RGBA : GL_RGB;
+	}
+}
+
+bool IGLUBlockCompressor::Compress( unsigned char *dst, const unsigned char *src, int width, int height, int channels,
+									IGLUBlockFormat format, int numThreads )
+{
+	size_t blockBytes = GetBlockBytes( format );
+	if (!dst || !src || !blockBytes || width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+		return false;
+
+	IGLUBCJob job;
+	job.dst        = dst;
+	job.src        = src;
+	job.width      = width;
+	job.height     = height;
+	job.channels   = channels;
+	job.blocksX    = (width  + 3) / 4;
+	job.blocksY    = (height + 3) / 4;
+	job.format     = format;
+	job.blockBytes = blockBytes;
+
+	// Small images aren't worth handing to other threads
+	int numBands = (job.blocksY + IGLU_BC_BAND_BLOCKS - 1) / IGLU_BC_BAND_BLOCKS;
+	if (numBands > 1 && size_t(width) * height >= 16384)
+		IGLUParallel::For( numBands, CompressBand, &job, numThreads );
+	else
+		for (int b=0; b<numBands; b++)
+			CompressBand( b, &job );
+	return true;
+}
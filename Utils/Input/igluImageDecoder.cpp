@@ -0,0 +1,269 @@
+/******************************************************************/
+/* igluImageDecoder.cpp                                           */
+/* -----------------------                                        */
+/*                                                                */
+/* Finds an image file's format, maps it through IGLUFileSystem,  */
+/*    and hands it to the right format's decoder.  Also includes  */
+/*    the pool of aligned buffers decoded images go into.         */
+/*                                                                */
+/******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+#include "iglu/igluImageDecoder.h"
+#include "iglu/igluParallel.h"
+#include "iglu/parsing/igluFileSystem.h"
+#include "Images/igluPPM.h"
+#include "Images/igluBMP.h"
+#include "Images/igluRGB.h"
+#include "Images/igluJPEG.h"
+
+using namespace iglu;
+
+#pragma warning( disable : 4996 )
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// Every pooled buffer is preceded by one of these (just before the aligned start)
+struct IGLUImageBufferHeader
+{
+	void  *rawPtr;
+	size_t capacity;
+};
+
+static IGLUMutex                   poolLock;
+static std::vector<unsigned char*> pooledBuffers;
+static size_t                      pooledBytes    = 0;
+static size_t                      maxPooledBytes = 64*1024*1024;
+
+static inline IGLUImageBufferHeader *GetBufferHeader( unsigned char *buffer )
+{
+	return ((IGLUImageBufferHeader *)buffer) - 1;
+}
+
+static void FreePooledBuffer( unsigned char *buffer )
+{
+	free( GetBufferHeader( buffer )->rawPtr );
+}
+
+// Is the filename's extension (lower cased) one of the null-terminated list?
+static bool HasExtension( const char *filename, const char **exts )
+{
+	const char *dot = strrchr( filename, '.' );
+	if (!dot || strlen( dot ) >= 16) return false;
+	char ext[16];
+	int len = 0;
+	for ( ; dot[len]; len++)
+		ext[len] = char( tolower( dot[len] ) );
+	ext[len] = 0;
+	for ( ; *exts; exts++)
+		if (!strcmp( ext, *exts )) return true;
+	return false;
+}
+
+// };  End: anonymous namespace
+
+
+unsigned char *IGLUImageBufferPool::Acquire( size_t size )
+{
+	if (size == 0) size = 1;
+
+	// Use the smallest pooled buffer that fits, as long as it isn't wastefully big
+	{
+		IGLUMutexLock lock( poolLock );
+		int best = -1;
+		for (size_t i=0; i<pooledBuffers.size(); i++)
+		{
+			size_t capacity = GetBufferHeader( pooledBuffers[i] )->capacity;
+			if (capacity < size || capacity > 2*size + 65536) continue;
+			if (best < 0 || capacity < GetBufferHeader( pooledBuffers[best] )->capacity)
+				best = int(i);
+		}
+		if (best >= 0)
+		{
+			unsigned char *buffer = pooledBuffers[best];
+			pooledBuffers.erase( pooledBuffers.begin() + best );
+			pooledBytes -= GetBufferHeader( buffer )->capacity;
+			return buffer;
+		}
+	}
+
+	// Nothing suitable.  Allocate a new one (rounding up, so it is easier to reuse).
+	size_t capacity = (size + 65535) & ~size_t(65535);
+	unsigned char *raw = (unsigned char *)malloc( capacity + sizeof( IGLUImageBufferHeader ) + 64 );
+	if (!raw) return 0;
+	size_t start = (size_t(raw) + sizeof( IGLUImageBufferHeader ) + 63) & ~size_t(63);
+	unsigned char *buffer = (unsigned char *)start;
+	GetBufferHeader( buffer )->rawPtr   = raw;
+	GetBufferHeader( buffer )->capacity = capacity;
+	return buffer;
+}
+
+void IGLUImageBufferPool::Release( unsigned char *buffer )
+{
+	if (!buffer) return;
+
+	IGLUMutexLock lock( poolLock );
+	pooledBuffers.push_back( buffer );
+	pooledBytes += GetBufferHeader( buffer )->capacity;
+
+	// Too much sitting around?  Free the oldest buffers first.
+	while (pooledBytes > maxPooledBytes && !pooledBuffers.empty())
+	{
+		pooledBytes -= GetBufferHeader( pooledBuffers[0] )->capacity;
+		FreePooledBuffer( pooledBuffers[0] );
+		pooledBuffers.erase( pooledBuffers.begin() );
+	}
+}
+
+void IGLUImageBufferPool::SetMaxPooledBytes( size_t maxBytes )
+{
+	IGLUMutexLock lock( poolLock );
+	maxPooledBytes = maxBytes;
+	if (pooledBytes > maxBytes)
+		Trim();
+}
+
+void IGLUImageBufferPool::Trim( void )
+{
+	IGLUMutexLock lock( poolLock );
+	for (size_t i=0; i<pooledBuffers.size(); i++)
+		FreePooledBuffer( pooledBuffers[i] );
+	pooledBuffers.clear();
+	pooledBytes = 0;
+}
+
+
+IGLUImageFormat IGLUImageDecoder::GetFormat( const char *filename, const unsigned char *data, size_t size )
+{
+	static const char *ppmExts[]  = { ".ppm", ".pgm", ".pbm", 0 };
+	static const char *rgbExts[]  = { ".rgb", ".rgba", ".sgi", ".bw", 0 };
+	static const char *bmpExts[]  = { ".bmp", 0 };
+	static const char *jpegExts[] = { ".jpg", ".jpeg", 0 };
+
+	if (filename && HasExtension( filename, ppmExts ))  return IGLU_IMAGE_PPM;
+	if (filename && HasExtension( filename, rgbExts ))  return IGLU_IMAGE_RGB;
+	if (filename && HasExtension( filename, bmpExts ))  return IGLU_IMAGE_BMP;
+	if (filename && HasExtension( filename, jpegExts )) return IGLU_IMAGE_JPEG;
+
+	// Unknown extension.  Try the magic numbers at the start of the file.
+	if (!data || size < 2) return IGLU_IMAGE_UNKNOWN;
+	if ((data[0] == 'P' || data[0] == 'p') && data[1] >= '1' && data[1] <= '6') return IGLU_IMAGE_PPM;
+	if (data[0] == 0x01 && data[1] == 0xDA) return IGLU_IMAGE_RGB;
+	if (data[0] == 'B'  && data[1] == 'M')  return IGLU_IMAGE_BMP;
+	if (data[0] == 0xFF && data[1] == 0xD8) return IGLU_IMAGE_JPEG;
+	return IGLU_IMAGE_UNKNOWN;
+}
+
+bool IGLUImageDecoder::GetInfo( const char *filename, const unsigned char *data, size_t size, IGLUImageInfo *info )
+{
+	info->width = info->height = -1;
+	info->channels = 0;
+	info->format = GetFormat( filename, data, size );
+
+	bool ok = false;
+	switch (info->format)
+	{
+	case IGLU_IMAGE_PPM:  ok = ReadPPMInfo ( data, size, info ); break;
+	case IGLU_IMAGE_RGB:  ok = ReadRGBInfo ( data, size, info ); break;
+	case IGLU_IMAGE_BMP:  ok = ReadBMPInfo ( data, size, info ); break;
+	case IGLU_IMAGE_JPEG: ok = ReadJPEGInfo( data, size, info ); break;
+	default:
+		printf("IGLUImage:  Unable to load image '%s'...  Unknown file format.\n", filename ? filename : "(memory)");
+		return false;
+	}
+
+	if (!ok || info->width <= 0 || info->height <= 0)
+	{
+		printf("IGLUImage:  Unable to load image '%s'...  Bad or unsupported header.\n", filename ? filename : "(memory)");
+		return false;
+	}
+	return true;
+}
+
+bool IGLUImageDecoder::Decode( const char *filename, const unsigned char *data, size_t size,
+	                           unsigned char *dst, size_t dstSize, IGLUImageInfo *info, int channels, bool bottomUp )
+{
+	if (!GetInfo( filename, data, size, info )) return false;
+	if (channels == 0) channels = info->channels;
+	if (channels != 3 && channels != 4)
+	{
+		printf("IGLUImage:  Can only decode to 3 or 4 channels (not %d)!\n", channels);
+		return false;
+	}
+	if (!dst || dstSize < size_t(info->width) * size_t(info->height) * size_t(channels))
+	{
+		printf("IGLUImage:  Buffer too small to decode '%s'!\n", filename ? filename : "(memory)");
+		return false;
+	}
+
+	bool ok = false;
+	switch (info->format)
+	{
+	case IGLU_IMAGE_PPM:  ok = DecodePPM ( data, size, dst, channels, bottomUp ); break;
+	case IGLU_IMAGE_RGB:  ok = DecodeRGB ( data, size, dst, channels, bottomUp ); break;
+	case IGLU_IMAGE_BMP:  ok = DecodeBMP ( data, size, dst, channels, bottomUp ); break;
+	case IGLU_IMAGE_JPEG: ok = DecodeJPEG( data, size, dst, channels, bottomUp ); break;
+	default: break;
+	}
+	if (!ok)
+		printf("IGLUImage:  Unable to decode image '%s'...  Corrupt or truncated data.\n", filename ? filename : "(memory)");
+	return ok;
+}
+
+bool IGLUImageDecoder::GetInfo( const char *filename, IGLUImageInfo *info )
+{
+	IGLUFileData *file = IGLUFileSystem::Open( filename );
+	if (!file)
+	{
+		printf("IGLUImage:  Unable to open image '%s'!\n", filename);
+		return false;
+	}
+	bool ok = GetInfo( filename, (const unsigned char *)file->GetData(), file->GetSize(), info );
+	delete file;
+	return ok;
+}
+
+bool IGLUImageDecoder::Decode( const char *filename, unsigned char *dst, size_t dstSize, IGLUImageInfo *info,
+	                           int channels, bool bottomUp )
+{
+	IGLUFileData *file = IGLUFileSystem::Open( filename );
+	if (!file)
+	{
+		printf("IGLUImage:  Unable to open image '%s'!\n", filename);
+		return false;
+	}
+	bool ok = Decode( filename, (const unsigned char *)file->GetData(), file->GetSize(),
+		              dst, dstSize, info, channels, bottomUp );
+	delete file;
+	return ok;
+}
+
+unsigned char *IGLUImageDecoder::Decode( const char *filename, IGLUImageInfo *info, int channels, bool bottomUp )
+{
+	IGLUFileData *file = IGLUFileSystem::Open( filename );
+	if (!file)
+	{
+		printf("IGLUImage:  Unable to open image '%s'!\n", filename);
+		return 0;
+	}
+
+	// Find the size first, so we know how big a buffer to get
+	const unsigned char *data = (const unsigned char *)file->GetData();
+	unsigned char *buffer = 0;
+	if (GetInfo( filename, data, file->GetSize(), info ))
+	{
+		size_t bytes = size_t(info->width) * size_t(info->height) * size_t(channels ? channels : info->channels);
+		buffer = IGLUImageBufferPool::Acquire( bytes );
+		if (buffer && !Decode( filename, data, file->GetSize(), buffer, bytes, info, channels, bottomUp ))
+		{
+			IGLUImageBufferPool::Release( buffer );
+			buffer = 0;
+		}
+	}
+	delete file;
+	return buffer;
+}
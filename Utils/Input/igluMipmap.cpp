@@ -0,0 +1,624 @@
+/******************************************************************/
+/* igluMipmap.cpp                                                 */
+/* -----------------------                                        */
+/*                                                                */
+/* CPU mipmap generation.  Each level is reduced 2:1 with a       */
+/*    separable filter:  a band of source rows is filtered        */
+/*    horizontally into a scratch buffer, then the band's output  */
+/*    rows are filtered vertically from it.  Bands are processed  */
+/*    in parallel, and pixels are kept as four floats so SSE can  */
+/*    filter all their channels at once.                          */
+/*                                                                */
+/******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+#include "iglu/igluMipmap.h"
+#include "iglu/igluParallel.h"
+#include "iglu/parsing/igluMappedFile.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define IGLU_MIP_USE_SSE
+#endif
+
+using namespace iglu;
+
+#pragma warning( disable : 4996 )
+
+// Bump this whenever the cache layout changes
+#define IGLU_MIP_CACHE_VERSION   2
+
+// Destination rows per parallel work item, and the most filter taps we use
+#define IGLU_MIP_BAND_ROWS       32
+#define IGLU_MIP_MAX_TAPS        12
+
+// Entries in the table converting linear values back to sRGB bytes
+#define IGLU_MIP_SRGB_TABLE      16384
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// The filter for one axis.  Destination pixel x is the weighted sum of source pixels
+//    2*x + first + k, for k in [0..numTaps-1].
+struct IGLUMipTaps
+{
+	int   numTaps, first;
+	float weights[IGLU_MIP_MAX_TAPS];
+};
+
+// Everything a band of rows needs to know
+struct IGLUMipJob
+{
+	unsigned char       *dst;
+	const unsigned char *src;
+	int                  srcW, srcH, dstW, dstH, channels;
+	bool                 sRGB, wrapX, wrapY;
+	IGLUMipTaps          xTaps, yTaps;
+	const int           *xIndex;   // Source column of each destination column's taps (dstW * xTaps.numTaps)
+};
+
+// Conversions between bytes and floats in [0..1]
+struct IGLUMipTables
+{
+	float         toUnit[256];                        // Byte to [0..1]
+	float         toLinear[256];                      // sRGB byte to linear [0..1]
+	unsigned char toSRGB[IGLU_MIP_SRGB_TABLE+1];      // Linear [0..1] (scaled by table size) to sRGB byte
+
+	IGLUMipTables()
+	{
+		for (int i=0; i<256; i++)
+		{
+			double c = i / 255.0;
+			toUnit[i]   = float( c );
+			toLinear[i] = float( (c <= 0.04045) ? c / 12.92 : pow( (c + 0.055) / 1.055, 2.4 ) );
+		}
+		for (int i=0; i<=IGLU_MIP_SRGB_TABLE; i++)
+		{
+			double l = double(i) / IGLU_MIP_SRGB_TABLE;
+			double c = (l <= 0.0031308) ? l * 12.92 : 1.055 * pow( l, 1.0/2.4 ) - 0.055;
+			toSRGB[i] = (unsigned char)( c * 255.0 + 0.5 );
+		}
+	}
+};
+static IGLUMipTables mipTables;
+
+static double MipSinc( double x )
+{
+	x *= 3.14159265358979323846;
+	return (fabs( x ) < 1e-8) ? 1.0 : sin( x ) / x;
+}
+
+// The zeroth order modified Bessel function of the first kind (for the Kaiser window)
+static double BesselI0( double x )
+{
+	double sum = 1.0, term = 1.0, q = x*x / 4.0;
+	for (int k=1; k<30 && term > 1e-12*sum; k++)
+	{
+		term *= q / double(k*k);
+		sum  += term;
+	}
+	return sum;
+}
+
+// The filter kernels, as a function of distance in destination pixels.  Both span 3
+//    destination pixels on either side.
+static double MipKernel( IGLUMipFilter filter, double d )
+{
+	if (fabs( d ) >= 3.0) return 0.0;
+	if (filter == IGLU_MIP_LANCZOS)
+		return MipSinc( d ) * MipSinc( d / 3.0 );
+
+	const double alpha = 4.0;
+	double r = d / 3.0;
+	return MipSinc( d ) * BesselI0( alpha * sqrt( 1.0 - r*r ) ) / BesselI0( alpha );
+}
+
+// Sets up the taps for reducing an axis of srcSize pixels
+static void GetMipTaps( IGLUMipFilter filter, int srcSize, IGLUMipTaps *taps )
+{
+	// An axis that is already 1 pixel wide stays put
+	if (srcSize == 1)
+	{
+		taps->numTaps = 1;
+		taps->first = 0;
+		taps->weights[0] = 1.0f;
+		return;
+	}
+	if (filter == IGLU_MIP_BOX)
+	{
+		taps->numTaps = 2;
+		taps->first = 0;
+		taps->weights[0] = taps->weights[1] = 0.5f;
+		return;
+	}
+
+	// Destination pixel x is centered at source coordinate 2*x + 0.5, between two source pixels
+	taps->numTaps = IGLU_MIP_MAX_TAPS;
+	taps->first   = 1 - IGLU_MIP_MAX_TAPS/2;
+	double sum = 0.0, w[IGLU_MIP_MAX_TAPS];
+	for (int k=0; k<taps->numTaps; k++)
+		sum += (w[k] = MipKernel( filter, (taps->first + k - 0.5) / 2.0 ));
+	for (int k=0; k<taps->numTaps; k++)
+		taps->weights[k] = float( w[k] / sum );
+}
+
+// Brings a source index back into the image, by clamping or wrapping around
+static inline int MipSourceIndex( int i, int size, bool wrap )
+{
+	if (i >= 0 && i < size) return i;
+	if (wrap) return ((i % size) + size) % size;
+	return (i < 0) ? 0 : size-1;
+}
+
+// Converts a row of bytes to four floats per pixel (alpha = 1 if there is none)
+static void MipRowToFloat( float *out, const unsigned char *in, int width, int channels, bool sRGB )
+{
+	const float *color = sRGB ? mipTables.toLinear : mipTables.toUnit;
+	for (int x=0; x<width; x++, in += channels, out += 4)
+	{
+		out[0] = color[ in[0] ];
+		out[1] = color[ in[1] ];
+		out[2] = color[ in[2] ];
+		out[3] = (channels == 4) ? mipTables.toUnit[ in[3] ] : 1.0f;
+	}
+}
+
+// Converts four floats per pixel back to bytes
+static void MipRowToBytes( unsigned char *out, const float *in, int width, int channels, bool sRGB )
+{
+	int x = 0;
+#ifdef IGLU_MIP_USE_SSE
+	if (!sRGB)
+	{
+		// Clamp, scale, round, and pack down to bytes, a pixel at a time
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f ), scale = _mm_set1_ps( 255.0f );
+		for ( ; x < width-1; x++, in += 4, out += channels)
+		{
+			__m128 v = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( in ), zero ), one ), scale );
+			__m128i b = _mm_cvtps_epi32( v );
+			b = _mm_packus_epi16( _mm_packs_epi32( b, b ), b );
+			int px = _mm_cvtsi128_si32( b );
+			memcpy( out, &px, 4 );   // (Writes one byte past an RGB pixel, which the next one overwrites)
+		}
+	}
+#endif
+	for ( ; x < width; x++, in += 4, out += channels)
+	{
+		for (int c=0; c<channels; c++)
+		{
+			float v = (in[c] < 0.0f) ? 0.0f : ((in[c] > 1.0f) ? 1.0f : in[c]);
+			out[c] = (sRGB && c < 3) ? mipTables.toSRGB[ int( v * IGLU_MIP_SRGB_TABLE + 0.5f ) ]
+			                         : (unsigned char)( v * 255.0f + 0.5f );
+		}
+	}
+}
+
+// out = sum of weights[k] * pixel idx[k] of in, for each of numOut pixels (with numTaps index per pixel)
+static void MipFilterRow( float *out, const float *in, const int *idx, const float *weights, int numTaps, int numOut )
+{
+	for (int x=0; x<numOut; x++, idx += numTaps, out += 4)
+	{
+#ifdef IGLU_MIP_USE_SSE
+		__m128 acc = _mm_setzero_ps();
+		for (int k=0; k<numTaps; k++)
+			acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( in + 4*idx[k] ), _mm_set1_ps( weights[k] ) ) );
+		_mm_storeu_ps( out, acc );
+#else
+		out[0] = out[1] = out[2] = out[3] = 0.0f;
+		for (int k=0; k<numTaps; k++)
+			for (int c=0; c<4; c++)
+				out[c] += weights[k] * in[4*idx[k]+c];
+#endif
+	}
+}
+
+// out = sum of weights[k] * rows[k], for numTaps rows of numFloats floats each
+static void MipFilterColumns( float *out, const float * const *rows, const float *weights, int numTaps, int numFloats )
+{
+	int i = 0;
+#ifdef IGLU_MIP_USE_SSE
+	for ( ; i+4 <= numFloats; i+=4)
+	{
+		__m128 acc = _mm_setzero_ps();
+		for (int k=0; k<numTaps; k++)
+			acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( rows[k] + i ), _mm_set1_ps( weights[k] ) ) );
+		_mm_storeu_ps( out + i, acc );
+	}
+#endif
+	for ( ; i<numFloats; i++)
+	{
+		float acc = 0.0f;
+		for (int k=0; k<numTaps; k++)
+			acc += weights[k] * rows[k][i];
+		out[i] = acc;
+	}
+}
+
+// Called by IGLUParallel::For() to produce one band of destination rows
+static void DownsampleBand( int band, void *jobPtr )
+{
+	const IGLUMipJob *job = (const IGLUMipJob *)jobPtr;
+	int y0 = band * IGLU_MIP_BAND_ROWS;
+	int y1 = (y0 + IGLU_MIP_BAND_ROWS < job->dstH) ? y0 + IGLU_MIP_BAND_ROWS : job->dstH;
+
+	// The (unwrapped) source rows the band's vertical taps touch
+	int rowLo = 2*y0 + job->yTaps.first;
+	int rowHi = 2*(y1-1) + job->yTaps.first + job->yTaps.numTaps - 1;
+	int numRows = rowHi - rowLo + 1;
+
+	// Scratch:  one source row as floats, the horizontally filtered rows, and one output row
+	size_t dstFloats = 4 * size_t(job->dstW);
+	float *srcLine  = (float *)malloc( sizeof(float) * (4*size_t(job->srcW) + dstFloats * (numRows + 1)) );
+	float *filtered = srcLine + 4*size_t(job->srcW);
+	float *outLine  = filtered + dstFloats * numRows;
+	if (!srcLine) return;
+
+	// Filter the band's source rows horizontally.  (Wrapped or clamped rows repeat work,
+	//    but only near the top and bottom of the image.)
+	size_t srcRowBytes = size_t(job->channels) * job->srcW;
+	for (int r=rowLo; r<=rowHi; r++)
+	{
+		int srcRow = MipSourceIndex( r, job->srcH, job->wrapY );
+		MipRowToFloat( srcLine, job->src + srcRowBytes * srcRow, job->srcW, job->channels, job->sRGB );
+		MipFilterRow( filtered + dstFloats * (r - rowLo), srcLine, job->xIndex, job->xTaps.weights,
+			          job->xTaps.numTaps, job->dstW );
+	}
+
+	// Then vertically, into the output rows
+	const float *rows[IGLU_MIP_MAX_TAPS];
+	size_t dstRowBytes = size_t(job->channels) * job->dstW;
+	for (int y=y0; y<y1; y++)
+	{
+		for (int k=0; k<job->yTaps.numTaps; k++)
+			rows[k] = filtered + dstFloats * (2*y + job->yTaps.first + k - rowLo);
+		MipFilterColumns( outLine, rows, job->yTaps.weights, job->yTaps.numTaps, int( dstFloats ) );
+		MipRowToBytes( job->dst + dstRowBytes * y, outLine, job->dstW, job->channels, job->sRGB );
+	}
+
+	free( srcLine );
+}
+
+// Gets the size & modification time of a file.  Returns false if the file doesn't exist.
+static bool GetSourceFileInfo( const char *filename, unsigned long long *size, long long *modTime )
+{
+#if defined(_MSC_VER)
+	struct _stat64 info;
+	if (_stat64( filename, &info ) != 0) return false;
+#else
+	struct stat info;
+	if (stat( filename, &info ) != 0) return false;
+#endif
+	*size    = (unsigned long long) info.st_size;
+	*modTime = (long long) info.st_mtime;
+	return true;
+}
+
+// A 64-bit FNV-1a hash of a file's contents, for when its timestamp changes
+static unsigned long long HashFileContents( const char *filename )
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	IGLUMappedFile file( filename );
+	if (!file.IsValid()) return 0;
+
+	const unsigned char *ptr = (const unsigned char *)file.GetData();
+	const unsigned char *end = (const unsigned char *)file.GetEnd();
+	for ( ; ptr < end; ptr++ )
+	{
+		hash ^= *ptr;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// The header at the start of each cache file, followed by numLevels IGLUMipCacheLevels.
+//    Offsets are from the start of the file.
+struct IGLUMipCacheHeader
+{
+	char               magic[8];          // "IGLUMIP"
+	unsigned int       version;           // IGLU_MIP_CACHE_VERSION
+	unsigned int       options;           // Chosen by the application
+	unsigned long long fileSize;          // Size of the entire cache (catches partially written files)
+
+	// Identifies the image file this cache was built from
+	unsigned long long srcSize;
+	long long          srcModTime;
+	unsigned long long srcHash;
+
+	unsigned int       channels, numLevels;
+	unsigned int       format;            // An IGLUBlockFormat
+};
+
+struct IGLUMipCacheLevel
+{
+	unsigned int       width, height;
+	unsigned long long offset, size;
+};
+
+// };  End: anonymous namespace
+
+
+IGLUMipChain::IGLUMipChain() : m_channels( 0 ), m_format( IGLU_BLOCK_NONE ), m_cacheData( 0 )
+{
+}
+
+IGLUMipChain::~IGLUMipChain()
+{
+	Clear();
+}
+
+void IGLUMipChain::Clear( void )
+{
+	if (m_cacheData)
+		delete m_cacheData;
+	else
+		for (size_t i=0; i<m_levels.size(); i++)
+			free( m_levels[i].data );
+	m_cacheData = 0;
+	m_levels.clear();
+	m_channels = 0;
+	m_format   = IGLU_BLOCK_NONE;
+}
+
+void IGLUMipChain::Downsample( unsigned char *dst, const unsigned char *src, int width, int height, int channels,
+							   IGLUMipFilter filter, bool sRGB, bool wrapX, bool wrapY, int numThreads )
+{
+	IGLUMipJob job;
+	job.dst      = dst;
+	job.src      = src;
+	job.srcW     = width;
+	job.srcH     = height;
+	job.dstW     = (width  > 1) ? width/2  : 1;
+	job.dstH     = (height > 1) ? height/2 : 1;
+	job.channels = channels;
+	job.sRGB     = sRGB;
+	job.wrapX    = wrapX;
+	job.wrapY    = wrapY;
+	GetMipTaps( filter, width,  &job.xTaps );
+	GetMipTaps( filter, height, &job.yTaps );
+
+	// The horizontal taps' source columns are the same for every row
+	int *xIndex = (int *)malloc( sizeof(int) * size_t(job.dstW) * job.xTaps.numTaps );
+	for (int x=0; x<job.dstW; x++)
+		for (int k=0; k<job.xTaps.numTaps; k++)
+			xIndex[x*job.xTaps.numTaps + k] = MipSourceIndex( 2*x + job.xTaps.first + k, width, wrapX );
+	job.xIndex = xIndex;
+
+	// Small levels aren't worth handing to other threads
+	int numBands = (job.dstH + IGLU_MIP_BAND_ROWS - 1) / IGLU_MIP_BAND_ROWS;
+	if (numBands > 1 && size_t(job.dstW) * job.dstH >= 65536)
+		IGLUParallel::For( numBands, DownsampleBand, &job, numThreads );
+	else
+		for (int b=0; b<numBands; b++)
+			DownsampleBand( b, &job );
+
+	free( xIndex );
+}
+
+bool IGLUMipChain::SetBaseLevel( const unsigned char *image, int width, int height, int channels )
+{
+	Clear();
+	if (!image || width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+		return false;
+
+	IGLUMipLevel level;
+	level.width  = width;
+	level.height = height;
+	level.size   = size_t(width) * height * channels;
+	level.data   = (unsigned char *)malloc( level.size );
+	if (!level.data) return false;
+	memcpy( level.data, image, level.size );
+	m_levels.push_back( level );
+	m_channels = channels;
+	return true;
+}
+
+bool IGLUMipChain::Generate( const unsigned char *image, int width, int height, int channels,
+							 IGLUMipFilter filter, bool sRGB, bool wrapX, bool wrapY, int numThreads )
+{
+	if (!SetBaseLevel( image, width, height, channels ))
+		return false;
+
+	// Each level is made from the one before it
+	IGLUMipLevel level = m_levels[0];
+	while (level.width > 1 || level.height > 1)
+	{
+		IGLUMipLevel prev = level;
+		level.width  = (prev.width  > 1) ? prev.width/2  : 1;
+		level.height = (prev.height > 1) ? prev.height/2 : 1;
+		level.size   = size_t(level.width) * level.height * channels;
+		level.data   = (unsigned char *)malloc( level.size );
+		if (!level.data)
+		{
+			Clear();
+			return false;
+		}
+		Downsample( level.data, prev.data, prev.width, prev.height, channels, filter, sRGB, wrapX, wrapY, numThreads );
+		m_levels.push_back( level );
+	}
+	return true;
+}
+
+bool IGLUMipChain::Compress( IGLUBlockFormat format, int numThreads )
+{
+	if (m_levels.empty() || m_format != IGLU_BLOCK_NONE || IGLUBlockCompressor::GetBlockBytes( format ) == 0)
+		return false;
+
+	// Compress into new buffers, so a failure part way through leaves the chain untouched
+	std::vector<unsigned char *> blocks( m_levels.size(), (unsigned char *)0 );
+	bool ok = true;
+	for (size_t i=0; ok && i<m_levels.size(); i++)
+	{
+		const IGLUMipLevel &level = m_levels[i];
+		blocks[i] = (unsigned char *)malloc( IGLUBlockCompressor::GetCompressedSize( format, level.width, level.height ) );
+		ok = blocks[i] && IGLUBlockCompressor::Compress( blocks[i], level.data, level.width, level.height,
+			                                             m_channels, format, numThreads );
+	}
+	if (!ok)
+	{
+		for (size_t i=0; i<blocks.size(); i++)
+			free( blocks[i] );
+		return false;
+	}
+
+	// Swap in the compressed levels (which we now own, even if the old ones were in a cache)
+	for (size_t i=0; i<m_levels.size(); i++)
+	{
+		if (!m_cacheData) free( m_levels[i].data );
+		m_levels[i].data = blocks[i];
+		m_levels[i].size = IGLUBlockCompressor::GetCompressedSize( format, m_levels[i].width, m_levels[i].height );
+	}
+	delete m_cacheData;
+	m_cacheData = 0;
+	m_format    = format;
+	return true;
+}
+
+void IGLUMipChain::Upload( unsigned int target, unsigned int internalFormat ) const
+{
+	if (m_levels.empty()) return;
+
+	if (m_format != IGLU_BLOCK_NONE)
+	{
+		GLenum blockFormat = IGLUBlockCompressor::GetGLFormat( m_format, m_channels );
+		for (size_t i=0; i<m_levels.size(); i++)
+			glCompressedTexImage2D( target, GLint(i), blockFormat, m_levels[i].width, m_levels[i].height, 0,
+			                        GLsizei( m_levels[i].size ), m_levels[i].data );
+		glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, 0 );
+		glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, GLint( m_levels.size() ) - 1 );
+		return;
+	}
+
+	// Small levels of RGB textures have rows that aren't multiples of 4 bytes
+	GLint oldAlignment;
+	glGetIntegerv( GL_UNPACK_ALIGNMENT, &oldAlignment );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	for (size_t i=0; i<m_levels.size(); i++)
+		glTexImage2D( target, GLint(i), internalFormat, m_levels[i].width, m_levels[i].height, 0,
+		              (m_channels == 4) ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, m_levels[i].data );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, oldAlignment );
+
+	glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, 0 );
+	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, GLint( m_levels.size() ) - 1 );
+}
+
+bool IGLUMipChain::SaveCache( const char *cacheFile, const char *srcFile, unsigned int options ) const
+{
+	IGLUMipCacheHeader hdr;
+	memset( &hdr, 0, sizeof( hdr ) );
+	if (m_levels.empty() || !GetSourceFileInfo( srcFile, &hdr.srcSize, &hdr.srcModTime ))
+		return false;
+
+	strcpy( hdr.magic, "IGLUMIP" );
+	hdr.version   = IGLU_MIP_CACHE_VERSION;
+	hdr.options   = options;
+	hdr.srcHash   = HashFileContents( srcFile );
+	hdr.channels  = m_channels;
+	hdr.numLevels = (unsigned int) m_levels.size();
+	hdr.format    = m_format;
+
+	// Lay out the file, with each level's data 16-byte aligned
+	std::vector<IGLUMipCacheLevel> levels( m_levels.size() );
+	unsigned long long offset = sizeof( hdr ) + sizeof( IGLUMipCacheLevel ) * levels.size();
+	for (size_t i=0; i<levels.size(); i++)
+	{
+		offset = (offset + 15) & ~15ULL;
+		levels[i].width  = m_levels[i].width;
+		levels[i].height = m_levels[i].height;
+		levels[i].offset = offset;
+		levels[i].size   = m_levels[i].size;
+		offset += m_levels[i].size;
+	}
+	hdr.fileSize = offset;
+
+	FILE *f = fopen( cacheFile, "wb" );
+	if (!f)
+	{
+		printf("*** Warning: Unable to create mipmap cache file '%s'\n", cacheFile );
+		return false;
+	}
+
+	static const char zeros[16] = { 0 };
+	unsigned long long curOff = sizeof( hdr ) + sizeof( IGLUMipCacheLevel ) * levels.size();
+	bool ok = fwrite( &hdr, sizeof( hdr ), 1, f ) == 1 &&
+		      fwrite( &levels[0], sizeof( IGLUMipCacheLevel ), levels.size(), f ) == levels.size();
+	for (size_t i=0; ok && i<levels.size(); i++)
+	{
+		size_t pad = size_t( levels[i].offset - curOff );
+		ok = (!pad || fwrite( zeros, 1, pad, f ) == pad) &&
+			 fwrite( m_levels[i].data, 1, m_levels[i].size, f ) == m_levels[i].size;
+		curOff = levels[i].offset + levels[i].size;
+	}
+	ok = (fclose( f ) == 0) && ok;
+
+	// Don't leave a partial cache lying around
+	if (!ok)
+	{
+		remove( cacheFile );
+		printf("*** Warning: Unable to write mipmap cache file '%s'\n", cacheFile );
+	}
+	return ok;
+}
+
+bool IGLUMipChain::LoadCache( const char *cacheFile, const char *srcFile, unsigned int options )
+{
+	Clear();
+	IGLUMappedFile *cache = new IGLUMappedFile( cacheFile );
+	if (!cache->IsValid() || cache->GetSize() < sizeof( IGLUMipCacheHeader ))
+	{
+		delete cache;
+		return false;
+	}
+
+	// Make sure this cache was built with the same options, is complete, and is still up to date
+	IGLUMipCacheHeader hdr;
+	const char *data = cache->GetData();
+	memcpy( &hdr, data, sizeof( hdr ) );
+	unsigned long long srcSize;
+	long long srcModTime;
+	bool ok = !memcmp( hdr.magic, "IGLUMIP", 8 ) && hdr.version == IGLU_MIP_CACHE_VERSION &&
+		      hdr.options == options && hdr.fileSize == (unsigned long long) cache->GetSize() &&
+		      (hdr.channels == 3 || hdr.channels == 4) && hdr.numLevels > 0 && hdr.numLevels <= 32 &&
+		      hdr.format <= IGLU_BLOCK_BC7 &&
+		      sizeof( hdr ) + sizeof( IGLUMipCacheLevel ) * size_t(hdr.numLevels) <= hdr.fileSize &&
+		      GetSourceFileInfo( srcFile, &srcSize, &srcModTime ) && srcSize == hdr.srcSize &&
+		      (srcModTime == hdr.srcModTime || HashFileContents( srcFile ) == hdr.srcHash);
+
+	// Sanity check the levels, in case the cache is corrupt
+	const IGLUMipCacheLevel *levels = (const IGLUMipCacheLevel *)(data + sizeof( hdr ));
+	for (unsigned int i=0; ok && i<hdr.numLevels; i++)
+	{
+		unsigned int w = levels[i].width, h = levels[i].height;
+		if (i > 0)
+			ok = (w == ((levels[i-1].width  > 1) ? levels[i-1].width/2  : 1)) &&
+			     (h == ((levels[i-1].height > 1) ? levels[i-1].height/2 : 1));
+		unsigned long long size = (hdr.format != IGLU_BLOCK_NONE) ?
+			IGLUBlockCompressor::GetCompressedSize( IGLUBlockFormat( hdr.format ), w, h ) : (unsigned long long)w * h * hdr.channels;
+		ok = ok && w > 0 && h > 0 && levels[i].size == size &&
+			 levels[i].offset <= hdr.fileSize && levels[i].size <= hdr.fileSize - levels[i].offset;
+	}
+	if (!ok)
+	{
+		delete cache;
+		return false;
+	}
+
+	// The levels point straight into the mapped cache
+	m_cacheData = cache;
+	m_channels  = hdr.channels;
+	m_format    = IGLUBlockFormat( hdr.format );
+	for (unsigned int i=0; i<hdr.numLevels; i++)
+	{
+		IGLUMipLevel level;
+		level.width  = levels[i].width;
+		level.height = levels[i].height;
+		level.size   = size_t( levels[i].size );
+		level.data   = (unsigned char *)( data + levels[i].offset );
+		m_levels.push_back( level );
+	}
+	return true;
+}
@@ -26,6 +26,7 @@ IGLUTexture2D::IGLUTexture2D( char *filename, unsigned int flags, bool initializ
 {
 	m_filename      = strdup( filename );
 	m_texImg        = new IGLUImage( filename );
+	m_mipChain      = 0;
 	SetTextureParameters( flags );
 	m_compressTex   = (flags & IGLU_COMPRESS_TEXTURE) ? true : false;
 
@@ -42,6 +43,7 @@ IGLUTexture2D::IGLUTexture2D( unsigned char *image, int width, int height, bool
 {
 	m_filename      = strdup( "(Image from memory!)" );
 	m_texImg        = new IGLUImage( image, width, height, false, freeMemory );
+	m_mipChain      = 0;
 	SetTextureParameters( flags );
 	m_compressTex   = true;
 
@@ -52,6 +54,22 @@ IGLUTexture2D::IGLUTexture2D( unsigned char *image, int width, int height, bool
 	if (initializeImmediately) Initialize();
 }
 
+IGLUTexture2D::IGLUTexture2D( IGLUImage *image, char *filename, unsigned int flags, bool initializeImmediately ) : 
+	IGLUTexture()
+{
+	m_filename      = strdup( filename ? filename : "(Image from memory!)" );
+	m_texImg        = image;
+	m_mipChain      = 0;
+	SetTextureParameters( flags );
+	m_compressTex   = (flags & IGLU_COMPRESS_TEXTURE) ? true : false;
+
+	m_width         = m_texImg->GetWidth();
+	m_height        = m_texImg->GetHeight();
+	m_pixelFormat   = m_texImg->GetGLFormat();
+
+	if (initializeImmediately) Initialize();
+}
+
 IGLUTexture2D::IGLUTexture2D( int builtInTexID, unsigned int flags, bool initializeImmediately )
 {
 	if (builtInTexID < 0 || builtInTexID >= IGLU_BUILTIN_TEX_MAX)
@@ -62,6 +80,7 @@ IGLUTexture2D::IGLUTexture2D( int builtInTexID, unsigned int flags, bool initial
 		                             g_igluBuiltInTex[builtInTexID].m_width, 
 									 g_igluBuiltInTex[builtInTexID].m_height,
 									 (g_igluBuiltInTex[builtInTexID].m_bytesPerPixel > 3) );  // has alpha?
+	m_mipChain      = 0;
 	SetTextureParameters( flags );
 	m_compressTex   = (flags & IGLU_COMPRESS_TEXTURE) ? true : false;
 
@@ -76,6 +95,7 @@ IGLUTexture2D::IGLUTexture2D( int builtInTexID, unsigned int flags, bool initial
 IGLUTexture2D::~IGLUTexture2D()
 {
 	if (m_filename) free( m_filename );
+	delete m_mipChain;
 }
 
 void IGLUTexture2D::SetTextureParameters( unsigned int flags )
@@ -85,6 +105,7 @@ void IGLUTexture2D::SetTextureParameters( unsigned int flags )
 	m_sWrap         = GetSWrap( flags );
 	m_tWrap         = GetTWrap( flags );
 	m_mipmapsNeeded = UsingMipmaps( flags );
+	m_mipFlags      = flags & (IGLU_MIPMAP_CPU_FLAGS | IGLU_COMPRESS_BC_MASK);
 
 	if (m_initialized)
 	{
@@ -120,21 +141,86 @@ void IGLUTexture2D::Initialize( void )
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_sWrap );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_tWrap );
 
-	glTexImage2D( GL_TEXTURE_2D, 0, GetCompressedFormat( m_texImg->GetGLFormat() ),  
-						   m_texImg->GetWidth(), m_texImg->GetHeight(), 0,
-						   m_texImg->GetGLFormat(), m_texImg->GetGLDatatype(), 
-						   (void *)m_texImg->ImageData() );
+	// Upload the CPU-built mipmaps, if we're using them, or let GL build them
+	PrepareMipmaps();
+	if (m_mipChain && m_mipChain->GetLevelCount() > 0)
+		m_mipChain->Upload( GL_TEXTURE_2D, GetCompressedFormat( m_texImg->GetGLFormat() ) );
+	else
+	{
+		glTexImage2D( GL_TEXTURE_2D, 0, GetCompressedFormat( m_texImg->GetGLFormat() ),  
+							   m_texImg->GetWidth(), m_texImg->GetHeight(), 0,
+							   m_texImg->GetGLFormat(), m_texImg->GetGLDatatype(), 
+							   (void *)m_texImg->ImageData() );
+		if (m_mipmapsNeeded)
+			glGenerateMipmap( GL_TEXTURE_2D );
+	}
 	GLenum error = glGetError(	);
-
-	if (m_mipmapsNeeded)
-		glGenerateMipmap( GL_TEXTURE_2D );
+	delete m_mipChain;
+	m_mipChain = 0;
 
 	glBindTexture( GL_TEXTURE_2D, 0 );
 
 	// Now that we've copied the data into texture memory, free the CPU side copy.
 	delete m_texImg;
+	m_texImg = 0;
 
 	// Done initializing
 	m_initialized = true;
 }
 
+
+void IGLUTexture2D::PrepareMipmaps( void )
+{
+	IGLUBlockFormat format = GetBlockFormat( m_mipFlags );
+	bool cpuMipmaps = m_mipmapsNeeded && (m_mipFlags & IGLU_MIPMAP_CPU_FLAGS);
+	if (m_mipChain || (!cpuMipmaps && format == IGLU_BLOCK_NONE) || !m_texImg || !m_texImg->IsValid())
+		return;
+
+	IGLUMipFilter filter = (m_mipFlags & IGLU_MIPMAP_KAISER)  ? IGLU_MIP_KAISER :
+		                   ((m_mipFlags & IGLU_MIPMAP_LANCZOS) ? IGLU_MIP_LANCZOS : IGLU_MIP_BOX);
+	bool sRGB  = (m_mipFlags & IGLU_MIPMAP_SRGB) ? true : false;
+	bool wrapX = (m_sWrap == GL_REPEAT), wrapY = (m_tWrap == GL_REPEAT);
+	int width = m_texImg->GetWidth(), height = m_texImg->GetHeight();
+	int channels = (m_texImg->GetGLFormat() == GL_RGBA) ? 4 : 3;
+	m_mipChain = new IGLUMipChain();
+
+	// Images loaded from files can keep their levels in a cache next to the file.  (The
+	//    cache is ignored if it was built with other settings, or from a different image.)
+	//    Compressed textures always use it, as compressing is far slower than filtering.
+	char cacheFile[1024];
+	unsigned int options = ((m_mipFlags & IGLU_MIPMAP_CPU_FLAGS) >> 24) | ((unsigned int)( format ) << 12) |
+		                   (wrapX ? 0x100 : 0) | (wrapY ? 0x200 : 0) | (m_mipmapsNeeded ? 0x400 : 0);
+	bool useCache = ((m_mipFlags & IGLU_MIPMAP_CACHE) || format != IGLU_BLOCK_NONE) &&
+		            strlen( m_filename ) < sizeof( cacheFile ) - 9;
+	if (useCache)
+	{
+		sprintf( cacheFile, "%s.iglumip", m_filename );
+		if (m_mipChain->LoadCache( cacheFile, m_filename, options ) &&
+			m_mipChain->GetChannels() == channels && m_mipChain->GetFormat() == format &&
+			m_mipChain->GetLevel(0).width == width && m_mipChain->GetLevel(0).height == height)
+			return;
+	}
+
+	// Compressed textures can't use glGenerateMipmap(), so they always get CPU-built levels
+	if (m_mipmapsNeeded)
+		m_mipChain->Generate( m_texImg->ImageData(), width, height, channels, filter, sRGB, wrapX, wrapY );
+	else
+		m_mipChain->SetBaseLevel( m_texImg->ImageData(), width, height, channels );
+	if (format != IGLU_BLOCK_NONE && !m_mipChain->Compress( format ))
+		printf("*** Warning: Unable to block compress texture '%s'!  Leaving it uncompressed.\n", m_filename );
+	if (useCache)
+		m_mipChain->SaveCache( cacheFile, m_filename, options );
+}
+
+IGLUBlockFormat IGLUTexture2D::GetBlockFormat( unsigned int flags )
+{
+	switch (flags & IGLU_COMPRESS_BC_MASK)
+	{
+	case IGLU_COMPRESS_BC1: return IGLU_BLOCK_BC1;
+	case IGLU_COMPRESS_BC3: return IGLU_BLOCK_BC3;
+	case IGLU_COMPRESS_BC4: return IGLU_BLOCK_BC4;
+	case IGLU_COMPRESS_BC5: return IGLU_BLOCK_BC5;
+	case IGLU_COMPRESS_BC7: return IGLU_BLOCK_BC7;
+	default:                return IGLU_BLOCK_NONE;
+	}
+}
@@ -0,0 +1,211 @@
+/******************************************************************/
+/* igluTextureCache.cpp                                           */
+/* -----------------------                                        */
+/*                                                                */
+/* A global cache of 2D textures loaded from files, found by      */
+/*    canonical path (and optionally by a hash of the contents).  */
+/*                                                                */
+/******************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+#include "iglu.h"
+
+using namespace iglu;
+
+#pragma warning( disable : 4996 )
+
+bool                  IGLUTextureCache::s_hashContents = false;
+IGLUTextureCacheStats IGLUTextureCache::s_stats        = { 0, 0, 0, 0, 0 };
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// One cached texture
+struct IGLUTextureCacheEntry
+{
+	IGLUTexture2D     *tex;
+	unsigned int       flags;
+	bool               hashed;       // Have we hashed the file this came from?
+	unsigned long long hash;
+};
+
+// The cached textures, and the map from a path's ID in cachePaths to its cache entry (or -1).
+//    Several paths may map to one entry.
+static std::vector<IGLUTextureCacheEntry> cacheEntries;
+static IGLUStringTable                    cachePaths;
+static std::vector<int>                   cacheEntryForPath;
+
+// Paths (as IDs in cachePaths) are only unique given the texture flags, so we look up
+//    the canonical path with the flags tacked on the end.
+static void GetCacheKey( char *key, const char *filename, unsigned int flags )
+{
+	IGLUTextureCache::GetCanonicalPath( key, filename );
+	sprintf( key + strlen( key ), "|%08x", flags );
+}
+
+// A 64-bit FNV-1a hash of a file's contents.  Returns false if the file can't be read.
+static bool HashTextureFile( const char *filename, unsigned long long *hash )
+{
+	IGLUFileData *data = IGLUFileSystem::Open( filename );
+	if (!data) return false;
+
+	*hash = 14695981039346656037ULL;
+	const unsigned char *ptr = (const unsigned char *)data->GetData();
+	const unsigned char *end = (const unsigned char *)data->GetEnd();
+	for ( ; ptr < end; ptr++ )
+	{
+		*hash ^= *ptr;
+		*hash *= 1099511628211ULL;
+	}
+	delete data;
+	return true;
+}
+
+// Point this path at a cache entry
+static void SetCacheEntryForPath( const char *key, int entry )
+{
+	uint pathID = cachePaths.Add( key );
+	if (pathID >= cacheEntryForPath.size())
+		cacheEntryForPath.resize( cachePaths.Size(), -1 );
+	cacheEntryForPath[pathID] = entry;
+}
+
+// Roughly how much memory the texture uses
+static size_t TextureBytes( IGLUTexture2D *tex )
+{
+	size_t texelSize = (tex->GetTextureFormat() == GL_RGBA8) ? 4 : 3;
+	return texelSize * size_t(tex->GetWidth() > 0 ? tex->GetWidth() : 0) * size_t(tex->GetHeight() > 0 ? tex->GetHeight() : 0);
+}
+
+// };  End: anonymous namespace
+
+
+void IGLUTextureCache::GetCanonicalPath( char *result, const char *filename )
+{
+	// Let the OS resolve "..", ".", and symbolic links.  (If it can't, e.g., for files
+	//    served by an I/O provider, just clean up the slashes.)
+#if defined(_MSC_VER)
+	bool resolved = _fullpath( result, filename, 1024 ) != 0;
+#else
+	char buf[4096];
+	bool resolved = realpath( filename, buf ) != 0 && strlen( buf ) < 1024;
+	if (resolved) strcpy( result, buf );
+#endif
+	if (!resolved)
+	{
+		strncpy( result, filename, 1023 );
+		result[1023] = 0;
+	}
+	IGLUFileSystem::NormalizeName( result, result );
+
+#if defined(_MSC_VER)
+	// Windows paths are case insensitive
+	for (char *ptr = result; *ptr; ptr++)
+		*ptr = tolower( *ptr );
+#endif
+}
+
+IGLUTexture2D *IGLUTextureCache::Find( const char *filename, unsigned int flags )
+{
+	char key[1040];
+	GetCacheKey( key, filename, flags );
+
+	uint pathID = cachePaths.Find( key );
+	if (pathID > 0 && pathID < cacheEntryForPath.size() && cacheEntryForPath[pathID] >= 0)
+	{
+		IGLUTexture2D *tex = cacheEntries[ cacheEntryForPath[pathID] ].tex;
+		s_stats.hits++;
+		s_stats.bytesSaved += TextureBytes( tex );
+		return tex;
+	}
+
+	// Not found by name.  Does any cached texture have the same contents?
+	unsigned long long hash;
+	if (s_hashContents && !cacheEntries.empty() && HashTextureFile( filename, &hash ))
+	{
+		for (uint i=0; i<cacheEntries.size(); i++)
+		{
+			IGLUTextureCacheEntry &entry = cacheEntries[i];
+			if (entry.flags != flags) continue;
+			if (!entry.hashed)
+			{
+				entry.hashed = HashTextureFile( entry.tex->GetFilename(), &entry.hash );
+				if (!entry.hashed) continue;
+			}
+			if (entry.hash != hash) continue;
+
+			// Found one!  Remember this path, so we find it by name next time.
+			SetCacheEntryForPath( key, int(i) );
+			s_stats.contentHits++;
+			s_stats.bytesSaved += TextureBytes( entry.tex );
+			return entry.tex;
+		}
+	}
+
+	s_stats.misses++;
+	return 0;
+}
+
+IGLUTexture2D *IGLUTextureCache::FindByPath( const char *filename, unsigned int flags )
+{
+	char key[1040];
+	GetCacheKey( key, filename, flags );
+
+	uint pathID = cachePaths.Find( key );
+	if (pathID > 0 && pathID < cacheEntryForPath.size() && cacheEntryForPath[pathID] >= 0)
+		return cacheEntries[ cacheEntryForPath[pathID] ].tex;
+	return 0;
+}
+
+void IGLUTextureCache::Add( const char *filename, IGLUTexture2D *tex, unsigned int flags )
+{
+	if (!tex) return;
+
+	IGLUTextureCacheEntry entry;
+	entry.tex    = tex;
+	entry.flags  = flags;
+	entry.hashed = false;
+	entry.hash   = 0;
+	cacheEntries.push_back( entry );
+
+	char key[1040];
+	GetCacheKey( key, filename, flags );
+	SetCacheEntryForPath( key, int(cacheEntries.size())-1 );
+	s_stats.textures = (unsigned int)cacheEntries.size();
+}
+
+IGLUTexture2D *IGLUTextureCache::Load( char *filename, unsigned int flags )
+{
+	IGLUTexture2D *tex = Find( filename, flags );
+	if (!tex)
+	{
+		tex = new IGLUTexture2D( filename, flags );
+		Add( filename, tex, flags );
+	}
+	return tex;
+}
+
+void IGLUTextureCache::Clear( void )
+{
+	cacheEntries.clear();
+	cachePaths.Clear();
+	cacheEntryForPath.clear();
+	s_stats.textures = 0;
+}
+
+void IGLUTextureCache::ResetStats( void )
+{
+	unsigned int numTextures = s_stats.textures;
+	memset( &s_stats, 0, sizeof( s_stats ) );
+	s_stats.textures = numTextures;
+}
+
+void IGLUTextureCache::PrintStats( void )
+{
+	printf("IGLUTextureCache: %u textures, %u hits, %u content hits, %u misses (saved %.1f MB)\n",
+		   s_stats.textures, s_stats.hits, s_stats.contentHits, s_stats.misses,
+		   double(s_stats.bytesSaved) / (1024.0*1024.0) );
+}
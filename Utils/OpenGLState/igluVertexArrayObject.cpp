@@ -111,14 +111,14 @@ void IGLUVertexArray::UnmapElementArray( void )
 void IGLUVertexArray::EnableAttribute( const IGLUShaderVariable &attrib, 
 									   GLint size, GLenum type, 
 									   GLsizei stride, const GLvoid *pointer,
-									   int instancesDivisor )
+									   int instancesDivisor, bool normalized )
 {
 	m_enableAttribCalled = true;
 
 	Bind();
 	m_vertArray->Bind();
 	glEnableVertexAttribArray( attrib.GetVariableIndex() );
-	glVertexAttribPointer( attrib.GetVariableIndex(), size, type, false, stride, pointer );
+	glVertexAttribPointer( attrib.GetVariableIndex(), size, type, normalized, stride, pointer );
 	if (instancesDivisor > 0) glVertexAttribDivisor( attrib.GetVariableIndex(), instancesDivisor );
 	Unbind();
 }
@@ -126,14 +126,14 @@ void IGLUVertexArray::EnableAttribute( const IGLUShaderVariable &attrib,
 void IGLUVertexArray::EnableAttribute( int glAttribIdx,                          
 		                               GLint size, GLenum type,                  
 						               GLsizei stride, const GLvoid *pointer,    
-						               int instancesDivisor )
+						               int instancesDivisor, bool normalized )
 {
 	m_enableAttribCalled = true;
 
 	Bind();
 	m_vertArray->Bind();
 	glEnableVertexAttribArray( glAttribIdx );
-	glVertexAttribPointer( glAttribIdx, size, type, false, stride, pointer );
+	glVertexAttribPointer( glAttribIdx, size, type, normalized, stride, pointer );
 	if (instancesDivisor > 0) glVertexAttribDivisor( glAttribIdx, instancesDivisor );
 	Unbind();
 }
@@ -226,6 +226,42 @@ void IGLUVertexArray::DrawElementsInstanced( GLenum mode, GLsizei count, GLsizei
 
 	Internal_StopPrimRestart( primRestartEnabled );
 }
+void IGLUVertexArray::MultiDrawElements( GLenum mode, const GLsizei *count, const GLvoid * const *bufOffsets, GLsizei drawCount )
+{
+	assert( m_elemArray );
+	bool primRestartEnabled = Internal_InitPrimRestart();
+
+	Bind();
+	if (!m_elementArrayBound)
+	{
+		m_elemArray->Bind();
+		m_elementArrayBound = true;
+	}
+	glMultiDrawElements( mode, count, m_elemType, (const GLvoid **)bufOffsets, drawCount );
+	Unbind();
+
+	Internal_StopPrimRestart( primRestartEnabled );
+}
+
+void IGLUVertexArray::MultiDrawElementsIndirect( GLenum mode, IGLUBuffer::Ptr commands, GLsizei drawCount, GLuint bufOffsetBytes )
+{
+	assert( m_elemArray && commands );
+	bool primRestartEnabled = Internal_InitPrimRestart();
+
+	Bind();
+	if (!m_elementArrayBound)
+	{
+		m_elemArray->Bind();
+		m_elementArrayBound = true;
+	}
+	commands->Bind();
+	glMultiDrawElementsIndirect( mode, m_elemType, BUFFER_OFFSET(bufOffsetBytes), drawCount, sizeof( IGLUDrawElementsCommand ) );
+	commands->Unbind();
+	Unbind();
+
+	Internal_StopPrimRestart( primRestartEnabled );
+}
+
 void IGLUVertexArray::DrawElements( GLenum mode, GLsizei count, GLuint bufOffsetBytes )
 {
 	assert( m_elemArray );
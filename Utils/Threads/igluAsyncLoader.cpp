@@ -0,0 +1,226 @@
+/************************************************************************/
+/* igluAsyncLoader.cpp                                                  */
+/* -------------------                                                  */
+/*                                                                      */
+/* Loads assets on background threads, and uploads them to OpenGL a     */
+/* little at a time from the GL thread.                                 */
+/*                                                                      */
+/************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iglu.h"
+
+using namespace iglu;
+
+#pragma warning( disable : 4996 )
+
+
+IGLUAsyncLoader::IGLUAsyncLoader( int numThreads ) :
+	m_maxThreads( numThreads > 0 ? numThreads : IGLUParallel::GetProcessorCount() ),
+	m_stopping( false ), m_numLoading( 0 ), m_numActive( 0 )
+{
+}
+
+IGLUAsyncLoader::~IGLUAsyncLoader()
+{
+	// Throw away anything not yet started, then wait for the workers to finish what they're doing
+	m_lock.Lock();
+	m_stopping = true;
+	for (size_t i=0; i<m_waiting.size(); i++)
+		delete m_waiting[i];
+	m_waiting.clear();
+	m_lock.Unlock();
+	JoinFinishedWorkers( true );
+
+	for (size_t i=0; i<m_loaded.size(); i++)
+		delete m_loaded[i];
+}
+
+void IGLUAsyncLoader::WorkerLoop( void *workerPtr )
+{
+	Worker *worker = (Worker *)workerPtr;
+	IGLUAsyncLoader *loader = worker->loader;
+	while (1)
+	{
+		loader->m_lock.Lock();
+		if (loader->m_stopping || loader->m_waiting.empty())
+		{
+			// Deciding to exit (under the lock) means Submit() knows to start a new worker
+			loader->m_numActive--;
+			worker->done = true;
+			loader->m_lock.Unlock();
+			return;
+		}
+		IGLUAsyncJob *job = loader->m_waiting.front();
+		loader->m_waiting.pop_front();
+		loader->m_numLoading++;
+		loader->m_lock.Unlock();
+
+		job->Load();
+
+		loader->m_lock.Lock();
+		loader->m_loaded.push_back( job );
+		loader->m_numLoading--;
+		loader->m_lock.Unlock();
+	}
+}
+
+void IGLUAsyncLoader::JoinFinishedWorkers( bool waitForAll )
+{
+	std::vector< Worker * > finished;
+	m_lock.Lock();
+	for (size_t i=0; i<m_workers.size(); )
+	{
+		if (waitForAll || m_workers[i]->done)
+		{
+			finished.push_back( m_workers[i] );
+			m_workers[i] = m_workers.back();
+			m_workers.pop_back();
+		}
+		else
+			i++;
+	}
+	m_lock.Unlock();
+
+	// Join outside the lock, since unfinished workers need it to exit
+	for (size_t i=0; i<finished.size(); i++)
+	{
+		IGLUParallel::JoinThread( finished[i]->thread );
+		delete finished[i];
+	}
+}
+
+void IGLUAsyncLoader::Submit( IGLUAsyncJob *job )
+{
+	if (!job) return;
+
+	m_lock.Lock();
+	m_waiting.push_back( job );
+	if (m_numActive < m_maxThreads && !m_stopping)
+	{
+		Worker *worker = new Worker;
+		worker->done   = false;
+		worker->loader = this;
+		m_numActive++;
+		worker->thread = IGLUParallel::StartThread( WorkerLoop, worker );
+		if (worker->thread)
+			m_workers.push_back( worker );
+		else
+		{
+			m_numActive--;
+			delete worker;
+		}
+	}
+
+	// If we have no way to load the job in the background, load it now.
+	if (m_numActive <= 0 && !m_waiting.empty())
+	{
+		printf("*** Warning: IGLUAsyncLoader unable to start a thread, loading synchronously!\n");
+		while (!m_waiting.empty())
+		{
+			IGLUAsyncJob *cur = m_waiting.front();
+			m_waiting.pop_front();
+			cur->Load();
+			m_loaded.push_back( cur );
+		}
+	}
+	m_lock.Unlock();
+}
+
+int IGLUAsyncLoader::Update( float budgetMs )
+{
+	JoinFinishedWorkers( false );
+
+	// Only this thread removes jobs from m_loaded, so the front job stays put while
+	//    we upload it (without holding the lock).
+	IGLUCPUTimer timer;
+	timer.Start();
+	int completed = 0;
+	while (1)
+	{
+		m_lock.Lock();
+		IGLUAsyncJob *job = m_loaded.empty() ? 0 : m_loaded.front();
+		m_lock.Unlock();
+		if (!job) break;
+
+		if (job->Upload())
+		{
+			m_lock.Lock();
+			m_loaded.pop_front();
+			m_lock.Unlock();
+			delete job;
+			completed++;
+		}
+
+		if (timer.GetTime() >= budgetMs) break;
+	}
+	return completed;
+}
+
+void IGLUAsyncLoader::Finish( void )
+{
+	// Workers exit once nothing is left waiting, so joining them all means everything is loaded
+	JoinFinishedWorkers( true );
+	while (GetPendingCount() > 0)
+		Update( 1.0e9f );
+}
+
+int IGLUAsyncLoader::GetPendingCount( void )
+{
+	m_lock.Lock();
+	int count = int( m_waiting.size() + m_loaded.size() ) + m_numLoading;
+	m_lock.Unlock();
+	return count;
+}
+
+
+IGLUOBJLoadJob::IGLUOBJLoadJob( const char *filename, int params, IGLUOBJLoadCallback callback, void *userData,
+							    IGLUOBJCancelCallback cancelled ) :
+	m_filename( strdup( filename ) ), m_params( params & ~IGLU_OBJ_STREAMING ), m_callback( callback ),
+	m_cancelled( cancelled ), m_userData( userData ), m_reader( 0 ), m_uploadedGeometry( false ), m_completed( false )
+{
+	// Streaming readers fill their vertex array as they parse, which needs a GL context
+	if (params & IGLU_OBJ_STREAMING)
+		printf("*** Warning: IGLUOBJLoadJob ignores IGLU_OBJ_STREAMING for '%s'\n", filename );
+}
+
+IGLUOBJLoadJob::~IGLUOBJLoadJob()
+{
+	// If we never handed the reader to the callback, it's ours to get rid of (and the
+	//    application may need to hear its userData won't be coming back)
+	delete m_reader;
+	if (!m_completed && m_cancelled)
+		m_cancelled( m_userData );
+	free( m_filename );
+}
+
+void IGLUOBJLoadJob::Load( void )
+{
+	m_reader = new IGLUOBJReader( m_filename, m_params | IGLU_OBJ_DEFER_UPLOAD );
+}
+
+bool IGLUOBJLoadJob::Upload( void )
+{
+	// First the vertex & element arrays...
+	if (!m_uploadedGeometry)
+	{
+		m_reader->UploadToGPU();
+		m_uploadedGeometry = true;
+		return false;
+	}
+
+	// ...then textures, one per call.  (The textures waiting may belong to other models'
+	//    materials, too, but once none are left, all of ours are done.)
+	if (IGLUOBJMaterialReader::UploadPendingTextures( 1 ) > 0)
+		return false;
+
+	if (m_callback)
+	{
+		m_callback( m_reader, m_userData );
+		m_reader = 0;
+	}
+	m_completed = true;
+	return true;
+}
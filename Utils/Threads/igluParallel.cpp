@@ -0,0 +1,203 @@
+/************************************************************************/
+/* igluParallel.cpp                                                     */
+/* ----------------                                                     */
+/*                                                                      */
+/* A very simple fork-join "parallel for" based on system-dependent OS  */
+/* thread calls, plus plain threads and mutexes.                        */
+/*                                                                      */
+/************************************************************************/
+
+#include "iglu/igluParallel.h"
+
+/************************************************************************/
+/*  First, identify which OS we're using.                               */
+/*      (May need to be tweaked, esp on Windows if not using MS VC++)   */
+/************************************************************************/
+
+// Check are we using Windows?
+#if defined(WIN32) && defined(_MSC_VER) && !defined(USING_MSVC)
+	#define USING_MSVC
+#endif
+
+// Check are we using MacOS?
+#if defined(__APPLE__) && !defined(USING_MACOSX) && !defined(USING_LINUX)
+	#define USING_MACOSX
+#endif
+
+// Check are we using Linux?
+#if defined(__GNUC__) && !defined(USING_MACOSX) && !defined(USING_LINUX)
+	#define USING_LINUX
+#endif
+
+/************************************************************************/
+/*  Now define OS-specific thread routines needed by our class          */
+/************************************************************************/
+
+#if   defined(USING_MSVC)
+          #include <windows.h>
+          typedef HANDLE ThreadHandle;
+          typedef DWORD (WINAPI *ThreadFunc)( LPVOID );
+		  #define IGLU_THREAD_FUNC( name, arg )  DWORD WINAPI name( LPVOID arg )
+		  #define IGLU_THREAD_RETURN             return 0
+          int  igluGetProcessorCount( void )
+			{ SYSTEM_INFO info; GetSystemInfo( &info ); return int(info.dwNumberOfProcessors); }
+          bool igluStartThread( ThreadHandle *t, ThreadFunc func, void *arg )
+			{ *t = CreateThread( NULL, 0, func, arg, 0, NULL ); return *t != NULL; }
+          void igluJoinThread( ThreadHandle *t )
+			{ WaitForSingleObject( *t, INFINITE ); CloseHandle( *t ); }
+          int  igluAtomicIncrement( volatile long *val )
+			{ return int( InterlockedIncrement( val ) - 1 ); }
+          typedef CRITICAL_SECTION MutexHandle;       // Critical sections are always recursive
+          void igluCreateMutex( MutexHandle *m )     { InitializeCriticalSection( m ); }
+          void igluDestroyMutex( MutexHandle *m )    { DeleteCriticalSection( m ); }
+          void igluLockMutex( MutexHandle *m )       { EnterCriticalSection( m ); }
+          void igluUnlockMutex( MutexHandle *m )     { LeaveCriticalSection( m ); }
+#else
+          #include <pthread.h>
+          #include <unistd.h>
+          typedef pthread_t ThreadHandle;
+          typedef void *(*ThreadFunc)( void * );
+		  #define IGLU_THREAD_FUNC( name, arg )  void *name( void *arg )
+		  #define IGLU_THREAD_RETURN             return 0
+          int  igluGetProcessorCount( void )
+			{ long cnt = sysconf( _SC_NPROCESSORS_ONLN ); return cnt > 0 ? int(cnt) : 1; }
+          bool igluStartThread( ThreadHandle *t, ThreadFunc func, void *arg )
+			{ return pthread_create( t, NULL, func, arg ) == 0; }
+          void igluJoinThread( ThreadHandle *t )
+			{ pthread_join( *t, NULL ); }
+          int  igluAtomicIncrement( volatile long *val )
+			{ return int( __sync_fetch_and_add( val, 1L ) ); }
+          typedef pthread_mutex_t MutexHandle;
+          void igluCreateMutex( MutexHandle *m )
+			{ pthread_mutexattr_t attr; pthread_mutexattr_init( &attr ); 
+			  pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+			  pthread_mutex_init( m, &attr ); pthread_mutexattr_destroy( &attr ); }
+          void igluDestroyMutex( MutexHandle *m )    { pthread_mutex_destroy( m ); }
+          void igluLockMutex( MutexHandle *m )       { pthread_mutex_lock( m ); }
+          void igluUnlockMutex( MutexHandle *m )     { pthread_mutex_unlock( m ); }
+#endif
+
+
+using namespace iglu;
+
+// namespace {  anonymous namespace for stuff used inside this file
+
+// The state shared between all threads working on one IGLUParallel::For() call
+struct IGLUParallelJob
+{
+	IGLUParallelFunc func;
+	void            *userData;
+	int              numItems;
+	volatile long    nextItem;
+};
+
+// Each thread simply grabs the next unprocessed item until there are none left.
+static IGLU_THREAD_FUNC( igluParallelWorker, jobPtr )
+{
+	IGLUParallelJob *job = (IGLUParallelJob *)jobPtr;
+	int item;
+	while ( (item = igluAtomicIncrement( &job->nextItem )) < job->numItems )
+		job->func( item, job->userData );
+	IGLU_THREAD_RETURN;
+}
+
+// A thread started by IGLUParallel::StartThread()
+struct IGLUThreadData
+{
+	ThreadHandle     handle;
+	IGLUThreadFunc   func;
+	void            *userData;
+};
+
+static IGLU_THREAD_FUNC( igluThreadStart, threadPtr )
+{
+	IGLUThreadData *thread = (IGLUThreadData *)threadPtr;
+	thread->func( thread->userData );
+	IGLU_THREAD_RETURN;
+}
+
+// };  End: anonymous namespace
+
+
+int IGLUParallel::GetProcessorCount( void )
+{
+	static int numProcs = 0;
+	if (numProcs <= 0)
+		numProcs = igluGetProcessorCount();
+	return numProcs;
+}
+
+void IGLUParallel::For( int numItems, IGLUParallelFunc func, void *userData, int numThreads )
+{
+	if (numItems <= 0) return;
+
+	// How many threads should we use?  Never more than there are items to process.
+	if (numThreads <= 0) numThreads = GetProcessorCount();
+	if (numThreads > numItems) numThreads = numItems;
+
+	IGLUParallelJob job;
+	job.func     = func;
+	job.userData = userData;
+	job.numItems = numItems;
+	job.nextItem = 0;
+
+	// Start our helper threads.  The calling thread does work, too, so we need one fewer.
+	ThreadHandle *threads = new ThreadHandle[ numThreads ];
+	int numStarted = 0;
+	for (int i=1; i<numThreads; i++)
+		if (igluStartThread( &threads[numStarted], (ThreadFunc)igluParallelWorker, &job ))
+			numStarted++;
+
+	// Do our share, then wait for everyone else.  (If some thread failed to start,
+	//    the remaining threads simply pick up its share of the work.)
+	igluParallelWorker( &job );
+	for (int i=0; i<numStarted; i++)
+		igluJoinThread( &threads[i] );
+
+	delete [] threads;
+}
+
+void *IGLUParallel::StartThread( IGLUThreadFunc func, void *userData )
+{
+	IGLUThreadData *thread = new IGLUThreadData;
+	thread->func     = func;
+	thread->userData = userData;
+	if (!igluStartThread( &thread->handle, (ThreadFunc)igluThreadStart, thread ))
+	{
+		delete thread;
+		return 0;
+	}
+	return thread;
+}
+
+void IGLUParallel::JoinThread( void *threadPtr )
+{
+	IGLUThreadData *thread = (IGLUThreadData *)threadPtr;
+	if (!thread) return;
+	igluJoinThread( &thread->handle );
+	delete thread;
+}
+
+
+IGLUMutex::IGLUMutex()
+{
+	MutexHandle *mutex = new MutexHandle;
+	igluCreateMutex( mutex );
+	m_mutex = mutex;
+}
+
+IGLUMutex::~IGLUMutex()
+{
+	igluDestroyMutex( (MutexHandle *)m_mutex );
+	delete (MutexHandle *)m_mutex;
+}
+
+void IGLUMutex::Lock( void )
+{
+	igluLockMutex( (MutexHandle *)m_mutex );
+}
+
+void IGLUMutex::Unlock( void )
+{
+	igluUnlockMutex( (MutexHandle *)m_mutex );
+}
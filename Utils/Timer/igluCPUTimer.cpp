@@ -52,7 +52,7 @@
 	  double igluConvertTimeDifferenceToSec( TimerStruct *end, TimerStruct *begin ) 
 		{ return (end->tv_sec - begin->tv_sec) + (1e-9)*(end->tv_nsec - begin->tv_nsec); }
 	  double igluConvertTimeDifferenceToMSec( TimerStruct *end, TimerStruct *begin ) 
-		{ return (end->tv_sec - begin->tv_sec) + (1e-6)*(end->tv_nsec - begin->tv_nsec); }
+		{ return (1e3)*(end->tv_sec - begin->tv_sec) + (1e-6)*(end->tv_nsec - begin->tv_nsec); }
 #elif defined(USING_MACOSX)
           #include <CoreServices/CoreServices.h>
           #include <mach/mach.h>
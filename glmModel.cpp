@@ -19,6 +19,11 @@
 
 #include <climits>
 
+#include "iglu/igluParallel.h"
+#include "iglu/igluCPUTimer.h"
+#include "iglu/parsing/igluFileSystem.h"
+#include "iglu/parsing/igluTextParsing.h"
+
 /* defines */
 #define T(x) model->triangles[(x)]
 
@@ -30,17 +35,6 @@ static const char* default_material_name = "No Material";
 enum { X, Y, Z, W }; /* elements of a vertex */
 
 
-/* typedefs */
-
-/* _GLMnode: general purpose node
-*/
-typedef struct _GLMnode {
-  unsigned int     index;
-  bool        averaged;
-  struct _GLMnode* next;
-} GLMnode;
-
-
 /* private functions */
 
 /* _glmMax: returns the maximum of two floats */
@@ -153,7 +147,7 @@ _glmWeldVectors(float* vectors, unsigned int* numvectors, float epsilon)
 
   copied = 1;
   for (i = 1; i <= *numvectors; i++) {
-    for (j = 1; j <= copied; j++) {
+    for (j = 1; j < copied; j++) {
       if (_glmEqual(&vectors[3 * i], &copies[3 * j], epsilon)) {
         goto duplicate;
       }
@@ -176,6 +170,440 @@ duplicate:
   return copies;
 }
 
+/* _GLMweldslot: an entry in the hash table of grid cells used by
+ * _glmWeldHashed().  The cell's coordinates are stored in the table, so
+ * lookups touch less memory.
+ */
+typedef struct {
+  long long    key[3];
+  unsigned int cell;         /* UINT_MAX if the slot is empty */
+} GLMweldslot;
+
+/* _GLMweldgrid: the grid cells used by _glmWeldHashed().  Cells are
+ * (slightly over) 2 epsilon wide, so a vector can only match vectors in
+ * its own cell, or in the neighboring cells it's within epsilon of.
+ */
+typedef struct {
+  float*        vectors;     /* the vectors being welded */
+  float         epsilon;
+  double        invsize;     /* 1 / cell size */
+  double        reach;       /* epsilon / cell size (rounded up a bit) */
+  GLMweldslot*  table;       /* hash table of cells (tablesize is a power of 2) */
+  unsigned int  tablesize;
+  unsigned int  numcells;
+  long long*    keys;        /* coordinates of each cell */
+  unsigned int* cellof;      /* cell containing each vector (UINT_MAX if none) */
+  unsigned int* cellstart;   /* cell c's space in cellcopies starts at cellstart[c] */
+  unsigned int* numcopies;   /* copies found so far in each cell; they are stored in */
+  unsigned int* cellcopies;  /*    cellcopies[cellstart[c]..cellstart[c]+numcopies[c]-1] */
+  unsigned int* rep;         /* the copy each vector is welded to (itself, if it's a copy) */
+
+  /* For welding in parallel:  the vectors in each group of connected cells
+   * (in increasing order), and the groups handed to each work item */
+  unsigned int* groupstart;
+  unsigned int* groupverts;
+  unsigned int  numgroups, groupsperitem;
+} GLMweldgrid;
+
+/* _glmWeldCell: finds the grid cell containing a vector.  Returns false
+ * if the vector can never match anything (i.e., it isn't finite).
+ */
+  static bool
+_glmWeldCell(float* v, double invsize, long long* cell)
+{
+  int i;
+  for (i = 0; i < 3; i++) {
+    double c = floor(v[i] * invsize);
+    if (!(c == c) || c > 4.0e18 || c < -4.0e18)
+      return false;
+    cell[i] = (long long)c;
+  }
+  return true;
+}
+
+/* _glmWeldHash: hashes a grid cell */
+  static unsigned int
+_glmWeldHash(long long* cell)
+{
+  unsigned long long h = (unsigned long long)cell[0] * 0x9E3779B97F4A7C15ULL;
+  h = (h ^ (h >> 29) ^ (unsigned long long)cell[1]) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 32) ^ (unsigned long long)cell[2]) * 0x94D049BB133111EBULL;
+  return (unsigned int)(h ^ (h >> 31));
+}
+
+/* _glmWeldFind: finds a cell in the hash table.  Returns the slot
+ * holding it, or the empty slot where it belongs.
+ */
+  static GLMweldslot*
+_glmWeldFind(GLMweldslot* table, unsigned int tablesize, long long* cell)
+{
+  unsigned int slot = _glmWeldHash(cell) & (tablesize - 1);
+  while (table[slot].cell != UINT_MAX) {
+    long long* key = table[slot].key;
+    if (key[0] == cell[0] && key[1] == cell[1] && key[2] == cell[2])
+      break;
+    slot = (slot + 1) & (tablesize - 1);
+  }
+  return &table[slot];
+}
+
+/* _glmWeldNeighbors: finds the (non-empty) cells that might hold a
+ * vector within epsilon of vector i:  its own cell, plus any neighbor
+ * it is within epsilon of.  Returns how many cells were put in cells[].
+ */
+  static unsigned int
+_glmWeldNeighbors(GLMweldgrid* grid, unsigned int i, unsigned int* cells)
+{
+  long long*   key = &grid->keys[3 * grid->cellof[i]];
+  long long    cell[3];
+  int          lo[3], hi[3], x, y, z, k;
+  unsigned int count = 0;
+
+  for (k = 0; k < 3; k++) {
+    double frac = grid->vectors[3 * i + k] * grid->invsize - (double)key[k];
+    lo[k] = (frac < grid->reach) ? -1 : 0;
+    hi[k] = (frac > 1.0 - grid->reach) ? 1 : 0;
+  }
+  for (z = lo[2]; z <= hi[2]; z++)
+    for (y = lo[1]; y <= hi[1]; y++)
+      for (x = lo[0]; x <= hi[0]; x++) {
+        cell[0] = key[0] + x;
+        cell[1] = key[1] + y;
+        cell[2] = key[2] + z;
+        cells[count] = _glmWeldFind(grid->table, grid->tablesize, cell)->cell;
+        if (cells[count] != UINT_MAX)
+          count++;
+      }
+  return count;
+}
+
+/* _glmWeldVector: welds vector i to the first (i.e., lowest numbered)
+ * earlier copy within epsilon, or makes it a new copy.  This gives the
+ * same answer as comparing it against every copy in turn, as long as all
+ * earlier vectors in the surrounding cells have already been welded.
+ */
+  static void
+_glmWeldVector(GLMweldgrid* grid, unsigned int i)
+{
+  unsigned int cells[27];
+  unsigned int numcells, best = UINT_MAX;
+  unsigned int k, j;
+
+  if (grid->cellof[i] == UINT_MAX) {
+    grid->rep[i] = i;
+    return;
+  }
+
+  numcells = _glmWeldNeighbors(grid, i, cells);
+  for (k = 0; k < numcells; k++) {
+    unsigned int n = cells[k];
+    for (j = 0; j < grid->numcopies[n]; j++) {
+      unsigned int copy = grid->cellcopies[grid->cellstart[n] + j];
+      if (copy >= best)
+        break;
+      if (_glmEqual(&grid->vectors[3 * i], &grid->vectors[3 * copy], grid->epsilon)) {
+        best = copy;
+        break;
+      }
+    }
+  }
+
+  if (best == UINT_MAX) {
+    unsigned int cell = grid->cellof[i];
+    best = i;
+    grid->cellcopies[grid->cellstart[cell] + grid->numcopies[cell]++] = i;
+  }
+  grid->rep[i] = best;
+}
+
+/* _glmWeldGroups: IGLUParallel::For() callback that welds the vectors in
+ * one work item's groups of connected cells.  Different groups never
+ * share cells, so they can be welded at the same time.
+ */
+  static void
+_glmWeldGroups(int item, void* data)
+{
+  GLMweldgrid* grid = (GLMweldgrid*)data;
+  unsigned int first = item * grid->groupsperitem;
+  unsigned int last  = first + grid->groupsperitem;
+  unsigned int g, i;
+
+  if (last > grid->numgroups)
+    last = grid->numgroups;
+  for (g = first; g < last; g++)
+    for (i = grid->groupstart[g]; i < grid->groupstart[g + 1]; i++)
+      _glmWeldVector(grid, grid->groupverts[i]);
+}
+
+/* _glmWeldRoot: union-find root of cell c (with path halving) */
+  static unsigned int
+_glmWeldRoot(unsigned int* parent, unsigned int c)
+{
+  while (parent[c] != c) {
+    parent[c] = parent[parent[c]];
+    c = parent[c];
+  }
+  return c;
+}
+
+/* _glmWeldHashed: eliminate (weld) vectors that are within an epsilon
+ * of each other.  Gives exactly the same results as _glmWeldVectors()
+ * (each vector is welded to the first earlier copy within epsilon), but
+ * uses a spatial hash, so it takes roughly linear time.
+ *
+ * vectors    - array of float[3]'s to be welded
+ * numvectors - number of float[3]'s in vectors
+ * epsilon    - maximum difference between vectors 
+ * parallel   - weld unconnected parts of the grid on all processors
+ *
+ */
+  static float*
+_glmWeldHashed(float* vectors, unsigned int* numvectors, float epsilon, bool parallel)
+{
+  GLMweldgrid   grid;
+  unsigned int  n = *numvectors;
+  unsigned int  i, j, c, copied;
+  unsigned int* newindex;
+  GLMweldslot*  slot;
+  long long     cell[3];
+  float*        copies;
+
+  copies = (float*)malloc(sizeof(float) * 3 * (n + 1));
+  memcpy(copies, vectors, (sizeof(float) * 3 * (n + 1)));
+
+  /* Nothing is within a non-positive epsilon of anything */
+  if (!(epsilon > 0)) {
+    for (i = 1; i <= n; i++)
+      vectors[3 * i + 0] = (float)i;
+    return copies;
+  }
+
+  memset(&grid, 0, sizeof(grid));
+  grid.vectors = vectors;
+  grid.epsilon = epsilon;
+  grid.invsize = 1.0 / (2.0002 * (double)epsilon);
+  grid.reach   = (double)epsilon * grid.invsize + 1.0e-4;
+
+  /* Find each vector's cell */
+  grid.tablesize = 1;
+  while (grid.tablesize < 2 * n)
+    grid.tablesize <<= 1;
+  grid.table  = (GLMweldslot*)malloc(sizeof(GLMweldslot) * grid.tablesize);
+  grid.keys   = (long long*)malloc(sizeof(long long) * 3 * (n + 1));
+  grid.cellof = (unsigned int*)malloc(sizeof(unsigned int) * (n + 1));
+  for (j = 0; j < grid.tablesize; j++)
+    grid.table[j].cell = UINT_MAX;
+  for (i = 1; i <= n; i++) {
+    grid.cellof[i] = UINT_MAX;
+    if (!_glmWeldCell(&vectors[3 * i], grid.invsize, cell))
+      continue;
+    slot = _glmWeldFind(grid.table, grid.tablesize, cell);
+    if (slot->cell == UINT_MAX) {
+      slot->cell = grid.numcells;
+      memcpy(slot->key, cell, sizeof(cell));
+      memcpy(&grid.keys[3 * grid.numcells++], cell, sizeof(cell));
+    }
+    grid.cellof[i] = slot->cell;
+  }
+
+  /* Make room for (at most) every vector in each cell to be a copy */
+  grid.cellstart  = (unsigned int*)calloc(grid.numcells + 1, sizeof(unsigned int));
+  grid.cellcopies = (unsigned int*)malloc(sizeof(unsigned int) * (n + 1));
+  grid.numcopies  = (unsigned int*)calloc(grid.numcells + 1, sizeof(unsigned int));
+  grid.rep        = (unsigned int*)malloc(sizeof(unsigned int) * (n + 1));
+  for (i = 1; i <= n; i++)
+    if (grid.cellof[i] != UINT_MAX)
+      grid.cellstart[grid.cellof[i] + 1]++;
+  for (c = 0; c < grid.numcells; c++)
+    grid.cellstart[c + 1] += grid.cellstart[c];
+
+  if (!parallel) {
+    for (i = 1; i <= n; i++)
+      _glmWeldVector(&grid, i);
+  }
+  else {
+    /* Split the cells into groups of cells that vectors reach across.  No
+       vector can be welded to one in another group, so groups can be
+       welded in any order, or simultaneously. */
+    unsigned int* parent  = (unsigned int*)malloc(sizeof(unsigned int) * (grid.numcells + 1));
+    unsigned int* groupof = (unsigned int*)malloc(sizeof(unsigned int) * (grid.numcells + 1));
+    unsigned int  cells[27], numcells, k;
+    int           numitems;
+    for (c = 0; c < grid.numcells; c++)
+      parent[c] = c;
+    for (i = 1; i <= n; i++) {
+      if (grid.cellof[i] == UINT_MAX)
+        continue;
+      numcells = _glmWeldNeighbors(&grid, i, cells);
+      for (k = 0; k < numcells; k++) {
+        unsigned int a = _glmWeldRoot(parent, grid.cellof[i]);
+        unsigned int b = _glmWeldRoot(parent, cells[k]);
+        if (a != b)
+          parent[a < b ? b : a] = (a < b ? a : b);
+      }
+    }
+
+    /* Number the groups, and list their vectors in order.  Vectors that
+       can't match anything are their own copies. */
+    for (c = 0; c < grid.numcells; c++)
+      groupof[c] = UINT_MAX;
+    for (c = 0; c < grid.numcells; c++) {
+      unsigned int root = _glmWeldRoot(parent, c);
+      if (groupof[root] == UINT_MAX)
+        groupof[root] = grid.numgroups++;
+      groupof[c] = groupof[root];
+    }
+    grid.groupstart = (unsigned int*)calloc(grid.numgroups + 2, sizeof(unsigned int));
+    grid.groupverts = (unsigned int*)malloc(sizeof(unsigned int) * (n + 1));
+    for (i = 1; i <= n; i++) {
+      if (grid.cellof[i] == UINT_MAX)
+        grid.rep[i] = i;
+      else
+        grid.groupstart[groupof[grid.cellof[i]] + 1]++;
+    }
+    for (j = 0; j < grid.numgroups; j++)
+      grid.groupstart[j + 1] += grid.groupstart[j];
+    for (i = 1; i <= n; i++)
+      if (grid.cellof[i] != UINT_MAX)
+        grid.groupverts[grid.groupstart[groupof[grid.cellof[i]]]++] = i;
+    for (j = grid.numgroups; j > 0; j--)
+      grid.groupstart[j] = grid.groupstart[j - 1];
+    grid.groupstart[0] = 0;
+
+    /* Hand out a few groups at a time, so tiny groups aren't too costly */
+    numitems = 16 * iglu::IGLUParallel::GetProcessorCount();
+    grid.groupsperitem = (grid.numgroups + numitems - 1) / numitems;
+    if (grid.groupsperitem < 1)
+      grid.groupsperitem = 1;
+    numitems = (int)((grid.numgroups + grid.groupsperitem - 1) / grid.groupsperitem);
+    iglu::IGLUParallel::For(numitems, _glmWeldGroups, &grid);
+
+    free(parent);
+    free(groupof);
+    free(grid.groupstart);
+    free(grid.groupverts);
+  }
+
+  /* Number the copies in the order they were found, as _glmWeldVectors() does */
+  newindex = (unsigned int*)malloc(sizeof(unsigned int) * (n + 1));
+  copied = 0;
+  for (i = 1; i <= n; i++) {
+    if (grid.rep[i] == i) {
+      newindex[i] = ++copied;
+      copies[3 * copied + 0] = vectors[3 * i + 0];
+      copies[3 * copied + 1] = vectors[3 * i + 1];
+      copies[3 * copied + 2] = vectors[3 * i + 2];
+    }
+  }
+  for (i = 1; i <= n; i++)
+    vectors[3 * i + 0] = (float)newindex[grid.rep[i]];
+
+  free(newindex);
+  free(grid.table);
+  free(grid.keys);
+  free(grid.cellof);
+  free(grid.cellstart);
+  free(grid.cellcopies);
+  free(grid.numcopies);
+  free(grid.rep);
+
+  *numvectors = copied;
+  return copies;
+}
+
+/* _GLMnormaldata: the state shared by the threads in glmVertexNormals().
+ * The triangles using vertex v are tris[start[v] .. start[v+1]-1], in
+ * increasing order.
+ */
+typedef struct {
+  GLMmodel*      model;
+  unsigned int*  start;
+  unsigned int*  tris;
+  unsigned char* averaged;     /* was each of those triangles' facet normals averaged in? */
+  float*         average;      /* each vertex's (normalized) average normal */
+  unsigned char* hasaverage;   /* ...if it has one */
+  float          cos_angle;
+  unsigned int   vertsperitem;
+} GLMnormaldata;
+
+/* _glmAverageNormals: IGLUParallel::For() callback that averages the
+ * facet normals around one work item's range of vertices.  Each vertex
+ * only writes its own entries, so ranges can be done at the same time.
+ */
+  static void
+_glmAverageNormals(int item, void* data)
+{
+  GLMnormaldata* nd = (GLMnormaldata*)data;
+  GLMmodel*      model = nd->model;
+  unsigned int   first = 1 + item * nd->vertsperitem;
+  unsigned int   last  = first + nd->vertsperitem;
+  unsigned int   v, k;
+
+  if (last > model->numvertices + 1)
+    last = model->numvertices + 1;
+  for (v = first; v < last; v++) {
+    float* average = &nd->average[3 * v];
+    float* ref;
+    bool   avg = false;
+
+    nd->hasaverage[v] = 0;
+    if (nd->start[v] == nd->start[v + 1])
+      continue;
+
+    /* Like the linked lists this replaced, go from the newest triangle
+       to the oldest, and compare against the newest one's normal (this
+       keeps the results, down to the summation order, the same) */
+    ref = &model->facetnorms[3 * T(nd->tris[nd->start[v + 1] - 1]).findex];
+    average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+    for (k = nd->start[v + 1]; k-- > nd->start[v]; ) {
+      float* facet = &model->facetnorms[3 * T(nd->tris[k]).findex];
+      /* only average if the dot product of the angle between the two
+         facet normals is greater than the cosine of the threshold
+         angle -- or, said another way, the angle between the two
+         facet normals is less than (or equal to) the threshold angle */
+      if (_glmDot(facet, ref) > nd->cos_angle) {
+        nd->averaged[k] = 1;
+        average[0] += facet[0];
+        average[1] += facet[1];
+        average[2] += facet[2];
+        avg = true;
+      } else {
+        nd->averaged[k] = 0;
+      }
+    }
+
+    if (avg) {
+      _glmNormalize(average);
+      nd->hasaverage[v] = 1;
+    }
+  }
+}
+
+/* _glmAddNormal: adds a normal to model->normals, unless there's already
+ * one with exactly the same value (found using a hash table of normal
+ * indices, of size tablesize, a power of two).  Returns its index.
+ */
+  static unsigned int
+_glmAddNormal(GLMmodel* model, unsigned int* table, unsigned int tablesize, float* n)
+{
+  unsigned int bits[3], slot;
+
+  memcpy(bits, n, sizeof(bits));
+  slot = (bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+  slot = (slot ^ (slot >> 15)) & (tablesize - 1);
+  while (table[slot]) {
+    if (!memcmp(&model->normals[3 * table[slot]], n, 3 * sizeof(float)))
+      return table[slot];
+    slot = (slot + 1) & (tablesize - 1);
+  }
+
+  table[slot] = ++model->numnormals;
+  model->normals[3 * model->numnormals + 0] = n[0];
+  model->normals[3 * model->numnormals + 1] = n[1];
+  model->normals[3 * model->numnormals + 2] = n[2];
+  return model->numnormals;
+}
+
 /* _glmFindGroup: Find a group in the model
 */
   static GLMgroup*
@@ -270,6 +698,192 @@ _glmDirName(char* path)
 }
 
 
+/* _glmWriteMTL: write a wavefront material library file
+ *
+ * model      - properly initialized GLMmodel structure
+ * modelpath  - pathname of the model being written
+ * mtllibname - name of the material library to be written
+ */
+  static int
+_glmWriteMTL(GLMmodel* model, char* modelpath, char* mtllibname)
+{
+  FILE* file;
+  char* dir;
+  char* filename;
+  GLMmaterial* material;
+  unsigned int i;
+
+  dir = _glmDirName(modelpath);
+  filename = (char*)malloc(sizeof(char) * (strlen(dir) + strlen(mtllibname)));
+  strcpy(filename, dir);
+  strcat(filename, mtllibname);
+  free(dir);
+
+  /* open the file */
+  file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "_glmWriteMTL() failed: can't open file \"%s\".\n",
+        filename);
+    free(filename);
+    return 1;
+  }
+  free(filename);
+
+  /* spit out a header */
+  fprintf(file, "#  \n");
+  fprintf(file, "#  Wavefront MTL generated by GLM library\n");
+  fprintf(file, "#  \n");
+  fprintf(file, "#  GLM library copyright (C) 1997 by Nate Robins\n");
+  fprintf(file, "#  email: ndr@pobox.com\n");
+  fprintf(file, "#  www:   http://www.pobox.com/~ndr\n");
+  fprintf(file, "#  \n\n");
+
+  for (i = 0; i < model->nummaterials; i++) {
+    material = &model->materials[i];
+    fprintf(file, "newmtl %s\n", material->name);
+    fprintf(file, "Ka %f %f %f\n", 
+        material->ambient[0], material->ambient[1], material->ambient[2]);
+    fprintf(file, "Kd %f %f %f\n", 
+        material->diffuse[0], material->diffuse[1], material->diffuse[2]);
+    fprintf(file, "Ks %f %f %f\n", 
+        material->specular[0],material->specular[1],material->specular[2]);
+    fprintf(file, "Ns %f\n", material->shininess);
+    fprintf(file, "\n");
+  }
+  return 0;
+}
+
+/* _glmGrow: makes sure array (with room for count-1 elements of size
+ * bytes) has room for count elements.  Arrays grow by doubling, so this
+ * must be called each time the count goes up by one.
+ */
+  static void*
+_glmGrow(void* array, unsigned int count, unsigned int size)
+{
+  unsigned int capacity;
+
+  if (count > 1 && (count <= 16 || ((count - 1) & (count - 2))))
+    return array;
+
+  capacity = (count <= 16) ? 16 : 2 * (count - 1);
+  return realloc(array, (size_t)size * capacity);
+}
+
+/* _glmParseFloat: reads a number the way scanf("%f") does, from the
+ * (not null-terminated) text [ptr, end).  Plain numbers are converted
+ * directly;  anything unusual goes through strtod() on a copy.
+ * Returns a pointer to the next non-whitespace character.
+ */
+  static const char*
+_glmParseFloat(const char* ptr, const char* end, float* f)
+{
+  static const double pow10[] = { 
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11, 
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+  const char*        tokenend = iglu::SkipTokenInPlace(ptr, end);
+  const char*        cur = ptr;
+  unsigned long long mantissa = 0;
+  int                digits = 0, sigdigits = 0, exponent = 0, e = 0;
+  bool               negative = false, negexp = false;
+  double             value;
+  char               buf[128];
+
+  if (cur < tokenend && (*cur == '-' || *cur == '+'))
+    negative = (*cur++ == '-');
+  for ( ; cur < tokenend && *cur >= '0' && *cur <= '9'; cur++, digits++) {
+    mantissa = mantissa * 10 + (*cur - '0');
+    if (mantissa) sigdigits++;
+  }
+  if (cur < tokenend && *cur == '.') {
+    for (cur++; cur < tokenend && *cur >= '0' && *cur <= '9'; cur++, digits++) {
+      mantissa = mantissa * 10 + (*cur - '0');
+      if (mantissa) sigdigits++;
+      exponent--;
+    }
+  }
+  if (digits && cur < tokenend && (*cur == 'e' || *cur == 'E')) {
+    cur++;
+    if (cur < tokenend && (*cur == '-' || *cur == '+'))
+      negexp = (*cur++ == '-');
+    for ( ; cur < tokenend && *cur >= '0' && *cur <= '9' && e < 10000; cur++)
+      e = e * 10 + (*cur - '0');
+    exponent += negexp ? -e : e;
+  }
+
+  if (digits && cur == tokenend && sigdigits <= 15 && exponent >= -22 && exponent <= 22) {
+    value = (exponent < 0) ? mantissa / pow10[-exponent] : mantissa * pow10[exponent];
+    *f = (float)(negative ? -value : value);
+  } else {
+    iglu::CopyStringInPlace(buf, sizeof(buf), ptr, tokenend);
+    *f = (float)strtod(buf, NULL);
+  }
+
+  return iglu::SkipWhiteSpaceInPlace(tokenend, end);
+}
+
+/* _glmParseName: copies the first token on [ptr, end) into buf (of size
+ * bufsize), or the name given if the line is empty.
+ */
+  static char*
+_glmParseName(char* buf, int bufsize, const char* ptr, const char* end,
+              const char* name)
+{
+  if (ptr >= end)
+    return strcpy(buf, name);
+  return iglu::CopyStringInPlace(buf, bufsize, ptr, iglu::SkipTokenInPlace(ptr, end));
+}
+
+/* _glmParseIndex: reads one index from a face (e.g., the "5" or "-2"
+ * in "5/-2/7"), turning negative indices into absolute ones given the
+ * number of elements read so far.  Missing indices (like the "t" in
+ * "v//n") are 0.
+ */
+  static const char*
+_glmParseIndex(const char* ptr, const char* end, unsigned int count,
+               unsigned int* index)
+{
+  const char* next;
+  int         i;
+
+  *index = 0;
+  next = iglu::ParseIntegerInPlace(ptr, end, &i);
+  if (!next)
+    return ptr;
+  *index = (i >= 0) ? i : (count + 1 + i);
+  return next;
+}
+
+/* _glmParseCorner: reads one face corner, in any of the v, v/t, v//n
+ * or v/t/n formats, into triangle corner j.
+ */
+  static const char*
+_glmParseCorner(GLMmodel* model, const char* ptr, const char* end,
+                unsigned int tri, unsigned int j)
+{
+  ptr = _glmParseIndex(ptr, end, model->numvertices, &T(tri).vindices[j]);
+  T(tri).tindices[j] = 0;
+  T(tri).nindices[j] = 0;
+  if (ptr < end && *ptr == '/') {
+    ptr = _glmParseIndex(ptr + 1, end, model->numtexcoords, &T(tri).tindices[j]);
+    if (ptr < end && *ptr == '/')
+      ptr = _glmParseIndex(ptr + 1, end, model->numnormals, &T(tri).nindices[j]);
+  }
+  return iglu::SkipWhiteSpaceInPlace(iglu::SkipTokenInPlace(ptr, end), end);
+}
+
+/* _glmAddTriangle: adds a triangle to the model and to the current group
+ */
+  static unsigned int
+_glmAddTriangle(GLMmodel* model, GLMgroup* group)
+{
+  model->triangles = (GLMtriangle*)_glmGrow(model->triangles,
+      model->numtriangles + 1, sizeof(GLMtriangle));
+  group->triangles = (unsigned int*)_glmGrow(group->triangles,
+      group->numtriangles + 1, sizeof(unsigned int));
+  group->triangles[group->numtriangles++] = model->numtriangles;
+  return model->numtriangles++;
+}
+
 /* _glmReadMTL: read a wavefront material library file
  *
  * model - properly initialized GLMmodel structure
@@ -278,10 +892,17 @@ _glmDirName(char* path)
   static int
 _glmReadMTL(GLMmodel* model, char* name)
 {
-  FILE* file;
+  iglu::IGLUFileData* file;
   char* dir;
   char* filename;
   char  buf[2048];
+  const char* data;
+  const char* end;
+  const char* ptr;
+  const char* line;
+  const char* lineend;
+  const char* token;
+  const char* tokenend;
   unsigned int nummaterials, i;
 
   dir = _glmDirName(model->pathname);
@@ -290,8 +911,9 @@ _glmReadMTL(GLMmodel* model, char* name)
   strcat(filename, name);
   free(dir);
 
-  /* open the file */
-  file = fopen(filename, "r");
+  /* open the file (mapped, or from a mounted I/O provider, just like
+     the .obj that refers to it) */
+  file = iglu::IGLUFileSystem::Open(filename);
   if (!file) {
     fprintf(stderr, "_glmReadMTL() failed: can't open material file \"%s\".\n",
         filename);
@@ -299,29 +921,21 @@ _glmReadMTL(GLMmodel* model, char* name)
     return 1;
   }
   free(filename);
+  data = file->GetData();
+  end  = file->GetEnd();
 
   /* count the number of materials in the file */
   nummaterials = 1;
-  while(fscanf(file, "%s", buf) != EOF) {
-    switch(buf[0]) {
-      case '#':       /* comment */
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        break;
-      case 'n':       /* newmtl */
-        fgets(buf, sizeof(buf), file);
-        nummaterials++;
-        sscanf(buf, "%s %s", buf, buf);
-        break;
-      default:
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        break;
-    }
+  for (ptr = data; ptr < end; ) {
+    lineend = (const char*)memchr(ptr, '\n', end - ptr);
+    if (!lineend)
+      lineend = end;
+    line = iglu::SkipWhiteSpaceInPlace(ptr, lineend);
+    ptr = (lineend < end) ? lineend + 1 : end;
+    if (line < lineend && line[0] == 'n')  /* newmtl */
+      nummaterials++;
   }
 
-  rewind(file);
-
   /* allocate memory for the materials */
   model->materials = (GLMmaterial*)malloc(sizeof(GLMmaterial) * nummaterials);
   model->nummaterials = nummaterials;
@@ -370,11 +984,21 @@ _glmReadMTL(GLMmodel* model, char* name)
 
   /* now, read in the data */
   nummaterials = 0;
-  while(fscanf(file, "%s", buf) != EOF) {
+  for (ptr = data; ptr < end; ) {
+    /* find the next line, and its first token */
+    lineend = (const char*)memchr(ptr, '\n', end - ptr);
+    if (!lineend)
+      lineend = end;
+    line = iglu::SkipWhiteSpaceInPlace(ptr, lineend);
+    ptr = (lineend < end) ? lineend + 1 : end;
+    if (line >= lineend)
+      continue;
+    tokenend = iglu::SkipTokenInPlace(line, lineend);
+    token = iglu::SkipWhiteSpaceInPlace(tokenend, lineend);
+    iglu::CopyStringInPlace(buf, sizeof(buf), line, tokenend);
+
     switch(buf[0]) {
       case '#':       /* comment */
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
         break;
       case 'n':       /* newmtl */
 
@@ -382,31 +1006,29 @@ _glmReadMTL(GLMmodel* model, char* name)
         assert( model->materials[nummaterials].name );
 
         // Read in the new material name.
-        fgets(buf, sizeof(buf), file);
-        sscanf(buf, "%s %s", buf, buf);
+        _glmParseName(buf, sizeof(buf), token, lineend, "");
         nummaterials++;
         model->materials[nummaterials].name = strdup(buf);
         break;
       case 'N':
-        fscanf(file, "%f", &model->materials[nummaterials].shininess);
+        _glmParseFloat(token, lineend, &model->materials[nummaterials].shininess);
         break;
       case 'T': // Tr
-        fscanf(file, "%f", &model->materials[nummaterials].refraction);
+        _glmParseFloat(token, lineend, &model->materials[nummaterials].refraction);
         break;
       case 'd': // d
-        fscanf(file, "%f", &model->materials[nummaterials].alpha);
+        _glmParseFloat(token, lineend, &model->materials[nummaterials].alpha);
         break;
       case 'i': // illum
-        fscanf(file, "%d", &model->materials[nummaterials].shader);
+        iglu::ParseIntegerInPlace(token, lineend, &model->materials[nummaterials].shader);
         break;
       case 'r': // reflectivity
-        fscanf(file, "%f", &model->materials[nummaterials].reflectivity);
+        _glmParseFloat(token, lineend, &model->materials[nummaterials].reflectivity);
         break;
       case 'e': // emissive
-        fscanf(file, "%f %f %f",
-            &model->materials[nummaterials].emissive[0],
-            &model->materials[nummaterials].emissive[1],
-            &model->materials[nummaterials].emissive[2]);
+        token = _glmParseFloat(token, lineend, &model->materials[nummaterials].emissive[0]);
+        token = _glmParseFloat(token, lineend, &model->materials[nummaterials].emissive[1]);
+        token = _glmParseFloat(token, lineend, &model->materials[nummaterials].emissive[2]);
         break;
       case 'm':
         {
@@ -432,55 +1054,45 @@ _glmReadMTL(GLMmodel* model, char* name)
             break;
           }
 
-          char string_litteral[2048];
-          sprintf(string_litteral, "%%%ds", (int)MaxStringLength-1);
-          //fprintf(stderr, "string_litteral = %s\n", string_litteral);
-
           // Check to see if we have scaled textures or not
-          fscanf(file, string_litteral, map_name);
+          _glmParseName(map_name, MaxStringLength, token, lineend, "");
           if (strcmp(map_name, "-s") == 0) {
             // pick up the float scaled textures
-            fscanf(file, "%f %f", &scaling[0], &scaling[1]);
+            token = iglu::SkipWhiteSpaceInPlace(iglu::SkipTokenInPlace(token, lineend), lineend);
+            token = _glmParseFloat(token, lineend, &scaling[0]);
+            token = _glmParseFloat(token, lineend, &scaling[1]);
             // Now the name of the file
-            fscanf(file, string_litteral, map_name);
-            //fprintf(stderr, "      scale = %f %f ,", scaling[0], scaling[1]);
+            _glmParseName(map_name, MaxStringLength, token, lineend, "");
           }
-          //fprintf(stderr, "name = %s\n", map_name);
         } // end case 'm'
         break;
 
       case 'K':
         switch(buf[1]) {
           case 'd':
-            fscanf(file, "%f %f %f",
-                &model->materials[nummaterials].diffuse[0],
-                &model->materials[nummaterials].diffuse[1],
-                &model->materials[nummaterials].diffuse[2]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].diffuse[0]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].diffuse[1]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].diffuse[2]);
             break;
           case 's':
-            fscanf(file, "%f %f %f",
-                &model->materials[nummaterials].specular[0],
-                &model->materials[nummaterials].specular[1],
-                &model->materials[nummaterials].specular[2]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].specular[0]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].specular[1]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].specular[2]);
             break;
           case 'a':
-            fscanf(file, "%f %f %f",
-                &model->materials[nummaterials].ambient[0],
-                &model->materials[nummaterials].ambient[1],
-                &model->materials[nummaterials].ambient[2]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].ambient[0]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].ambient[1]);
+            token = _glmParseFloat(token, lineend, &model->materials[nummaterials].ambient[2]);
             break;
           default:
-            /* eat up rest of line */
-            fgets(buf, sizeof(buf), file);
             break;
         }
         break;
       default:
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
         break;
     }
   }
+  delete file;
 
   // Make sure we found the same number of materials the second time around.
   // Note that glm adds a default material to the beginning of the array
@@ -489,496 +1101,193 @@ _glmReadMTL(GLMmodel* model, char* name)
   return 0;
 }
 
-/* _glmWriteMTL: write a wavefront material library file
- *
- * model      - properly initialized GLMmodel structure
- * modelpath  - pathname of the model being written
- * mtllibname - name of the material library to be written
- */
-  static int
-_glmWriteMTL(GLMmodel* model, char* modelpath, char* mtllibname)
-{
-  FILE* file;
-  char* dir;
-  char* filename;
-  GLMmaterial* material;
-  unsigned int i;
-
-  dir = _glmDirName(modelpath);
-  filename = (char*)malloc(sizeof(char) * (strlen(dir) + strlen(mtllibname)));
-  strcpy(filename, dir);
-  strcat(filename, mtllibname);
-  free(dir);
-
-  /* open the file */
-  file = fopen(filename, "w");
-  if (!file) {
-    fprintf(stderr, "_glmWriteMTL() failed: can't open file \"%s\".\n",
-        filename);
-    free(filename);
-    return 1;
-  }
-  free(filename);
-
-  /* spit out a header */
-  fprintf(file, "#  \n");
-  fprintf(file, "#  Wavefront MTL generated by GLM library\n");
-  fprintf(file, "#  \n");
-  fprintf(file, "#  GLM library copyright (C) 1997 by Nate Robins\n");
-  fprintf(file, "#  email: ndr@pobox.com\n");
-  fprintf(file, "#  www:   http://www.pobox.com/~ndr\n");
-  fprintf(file, "#  \n\n");
-
-  for (i = 0; i < model->nummaterials; i++) {
-    material = &model->materials[i];
-    fprintf(file, "newmtl %s\n", material->name);
-    fprintf(file, "Ka %f %f %f\n", 
-        material->ambient[0], material->ambient[1], material->ambient[2]);
-    fprintf(file, "Kd %f %f %f\n", 
-        material->diffuse[0], material->diffuse[1], material->diffuse[2]);
-    fprintf(file, "Ks %f %f %f\n", 
-        material->specular[0],material->specular[1],material->specular[2]);
-    fprintf(file, "Ns %f\n", material->shininess);
-    fprintf(file, "\n");
-  }
-  return 0;
-}
-
-/* _glmFirstPass: first pass at a Wavefront OBJ file that gets all the
- * statistics of the model (such as #vertices, #normals, etc)
+/* _glmParseOBJ: reads a Wavefront OBJ file's contents in one pass,
+ * growing the model's arrays as it goes.
  *
  * model - properly initialized GLMmodel structure
- * file  - (fopen'd) file descriptor 
+ * data  - the file contents (need not be null-terminated)
+ * end   - one past the last character of the contents
  */
   static int
-_glmFirstPass(GLMmodel* model, FILE* file) 
+_glmParseOBJ(GLMmodel* model, const char* data, const char* end) 
 {
-  unsigned int    numvertices;    /* number of vertices in model */
-  unsigned int    numnormals;     /* number of normals in model */
-  unsigned int    numtexcoords;   /* number of texcoords in model */
-  unsigned int    numtriangles;   /* number of triangles in model */
-
-
-
-  GLMgroup* group;      /* current group */
-  char*     current_group_base_name = strdup(default_group_name);
-  char*     current_material_name = strdup(default_material_name);
-  int       v, n, t;
-  char      buf[2048];
-
-  /* make a default group */
-  group = _glmAddGroup(model, current_group_base_name);
-
-  numvertices = numnormals = numtexcoords = numtriangles = 0;
-
-  while(fscanf(file, "%s", buf) != EOF) {
-    switch(buf[0]) {
+  GLMgroup*    group;         /* current group */
+  unsigned int material;      /* current material */
+  char         grpname[1024]; /* current group base name */
+  char         mtlname[1024]; /* current material name */
+  char         buf[sizeof(grpname) + sizeof(mtlname) + 5];  /* room for "<grpname>_MAT_<mtlname>" */
+  const char*  ptr;
+  const char*  line;
+  const char*  lineend;
+  const char*  token;
+  const char*  tokenend;
+  unsigned int i, tri;
+  int          r, g, b;
+
+  /* start out in the default group */
+  strcpy(grpname, default_group_name);
+  strcpy(mtlname, default_material_name);
+  material = 0;
+  group = _glmAddGroup(model, grpname);
+
+  /* the arrays are 1-indexed, so they start out with one element */
+  model->vertices     = (float*)_glmGrow(NULL, 1, 3 * sizeof(float));
+  model->vertexColors = (unsigned char*)_glmGrow(NULL, 1, 3 * sizeof(unsigned char));
+  model->normals      = (float*)_glmGrow(NULL, 1, 3 * sizeof(float));
+  model->texcoords    = (float*)_glmGrow(NULL, 1, 2 * sizeof(float));
+
+  for (ptr = data; ptr < end; ) {
+    /* find the next line, and its first token */
+    lineend = (const char*)memchr(ptr, '\n', end - ptr);
+    if (!lineend)
+      lineend = end;
+    line = iglu::SkipWhiteSpaceInPlace(ptr, lineend);
+    ptr = (lineend < end) ? lineend + 1 : end;
+    if (line >= lineend)
+      continue;
+    tokenend = iglu::SkipTokenInPlace(line, lineend);
+    token = iglu::SkipWhiteSpaceInPlace(tokenend, lineend);
+
+    switch(line[0]) {
       case '#':     /* comment */
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
         break;
       case 'v':     /* v, vn, vt */
-        switch(buf[1]) {
-          case '\0':  { /* vertex */
-                        /* eat up rest of line */
-                        fgets(buf, sizeof(buf), file);
-
-                        // TODO: Check if colors for this vertex
-                        float vx,vy,vz;
-                        int   val = -1;
-                        sscanf(buf,"%f %f %f %d",&vx, &vy, &vz, &val);
-                        if (val >= 0) {
-                          model->usePerVertexColors = true;
-                        }
-
-                        numvertices++;
-                        break;
-                      }
+        switch((tokenend - line > 1) ? line[1] : '\0') {
+          case '\0': {  /* vertex */
+            i = ++model->numvertices;
+            model->vertices = (float*)_glmGrow(model->vertices, i + 1, 3 * sizeof(float));
+            model->vertexColors = (unsigned char*)_glmGrow(model->vertexColors,
+                i + 1, 3 * sizeof(unsigned char));
+            token = _glmParseFloat(token, lineend, &model->vertices[3 * i + X]);
+            token = _glmParseFloat(token, lineend, &model->vertices[3 * i + Y]);
+            token = _glmParseFloat(token, lineend, &model->vertices[3 * i + Z]);
+
+            /* there may be an r g b color after the position */
+            r = g = b = 0;
+            if (iglu::ParseIntegerInPlace(token, lineend, &r)) {
+              model->usePerVertexColors = true;
+              token = iglu::SkipWhiteSpaceInPlace(iglu::SkipTokenInPlace(token, lineend), lineend);
+              if (iglu::ParseIntegerInPlace(token, lineend, &g))
+                token = iglu::SkipWhiteSpaceInPlace(iglu::SkipTokenInPlace(token, lineend), lineend);
+              iglu::ParseIntegerInPlace(token, lineend, &b);
+            }
+            model->vertexColors[3 * i + X] = (unsigned char)r;
+            model->vertexColors[3 * i + Y] = (unsigned char)g;
+            model->vertexColors[3 * i + Z] = (unsigned char)b;
+            break;
+          }
           case 'n':   /* normal */
-                      /* eat up rest of line */
-                      fgets(buf, sizeof(buf), file);
-                      numnormals++;
-                      break;
+            i = ++model->numnormals;
+            model->normals = (float*)_glmGrow(model->normals, i + 1, 3 * sizeof(float));
+            token = _glmParseFloat(token, lineend, &model->normals[3 * i + X]);
+            token = _glmParseFloat(token, lineend, &model->normals[3 * i + Y]);
+            token = _glmParseFloat(token, lineend, &model->normals[3 * i + Z]);
+            break;
           case 't':   /* texcoord */
-                      /* eat up rest of line */
-                      fgets(buf, sizeof(buf), file);
-                      numtexcoords++;
-                      break;
+            i = ++model->numtexcoords;
+            model->texcoords = (float*)_glmGrow(model->texcoords, i + 1, 2 * sizeof(float));
+            token = _glmParseFloat(token, lineend, &model->texcoords[2 * i + X]);
+            token = _glmParseFloat(token, lineend, &model->texcoords[2 * i + Y]);
+            break;
           default:
-                      printf("_glmFirstPass(): Unknown token \"%s\".\n", buf);
-                      /* Could error out here, but we'll just skip it for now.*/
-                      /* return 1; */
-                      break;
+            iglu::CopyStringInPlace(buf, 64, line, tokenend);
+            printf("glmReadOBJ(): Unknown token \"%s\".\n", buf);
+            /* Could error out here, but we'll just skip it for now.*/
+            break;
         }
         break;
-      case 'm':
-        fgets(buf, sizeof(buf), file);
-        sscanf(buf, "%s %s", buf, buf);
+      case 'm':     /* mtllib */
+        _glmParseName(buf, sizeof(buf), token, lineend, "");
+        if (model->mtllibname) free(model->mtllibname);
         model->mtllibname = strdup(buf);
-        if (_glmReadMTL(model, buf)) {
-
-          break; /* Dont bail if MTL file not found */
-
-          /* Uh oh.  Trouble reading in the material file. */
-          if (current_group_base_name) free(current_group_base_name);
-          if (current_material_name)   free(current_material_name);
-          return 1;
-        }
+        _glmReadMTL(model, buf);  /* Dont bail if MTL file not found */
         break;
-      case 'u':
+      case 'u':     /* usemtl */
         /* We need to create groups with their own materials */
-        fgets(buf, sizeof(buf), file);
-        sscanf(buf, "%s %s", buf, buf);
-        if (current_material_name) free(current_material_name);
-        current_material_name = strdup(buf);
-        sprintf(buf, "%s_MAT_%s",
-            current_group_base_name, current_material_name);
+        _glmParseName(mtlname, sizeof(mtlname), token, lineend, default_material_name);
+        material = _glmFindMaterial(model, mtlname);
+        sprintf(buf, "%s_MAT_%s", grpname, mtlname);
         group = _glmAddGroup(model, buf);
+        group->material = material;
+        if (group->mtlname) free(group->mtlname);
+        group->mtlname = strdup(mtlname);
         break;
-      case 'o':
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        break;
-      case 'g':       /* group */
-        fgets(buf, sizeof(buf), file);
-        sscanf(buf, "%s", buf);
-        if (current_group_base_name) free(current_group_base_name);
-        current_group_base_name = strdup(buf);
-        sprintf(buf, "%s_MAT_%s",
-            current_group_base_name, current_material_name);
+      case 'g':     /* group */
+        _glmParseName(grpname, sizeof(grpname), token, lineend, default_group_name);
+        sprintf(buf, "%s_MAT_%s", grpname, mtlname);
         group = _glmAddGroup(model, buf);
+        group->material = material;
+        if (group->mtlname) free(group->mtlname);
+        group->mtlname = strdup(mtlname);
         break;
-      case 'f':       /* face */
-        v = n = t = 0;
-        fscanf(file, "%s", buf);
-        /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-        if (strstr(buf, "//")) {
-          /* v//n */
-          sscanf(buf, "%d//%d", &v, &n);  
-          fscanf(file, "%d//%d", &v, &n); 
-          fscanf(file, "%d//%d", &v, &n); 
-          numtriangles++;
-          group->numtriangles++;
-          while(fscanf(file, "%d//%d", &v, &n) > 0) {
-            numtriangles++;
-            group->numtriangles++;
-          }
-        } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) { 
-          /* v/t/n */
-          fscanf(file, "%d/%d/%d", &v, &t, &n); 
-          fscanf(file, "%d/%d/%d", &v, &t, &n); 
-          numtriangles++;
-          group->numtriangles++;
-          while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
-            numtriangles++;
-            group->numtriangles++;
-          }
-        } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
-          /* v/t */
-          fscanf(file, "%d/%d", &v, &t); 
-          fscanf(file, "%d/%d", &v, &t); 
-          numtriangles++;
-          group->numtriangles++;
-          while(fscanf(file, "%d/%d", &v, &t) > 0) {
-            numtriangles++;
-            group->numtriangles++;
-          }
-        } else {
-          /* v */
-          fscanf(file, "%d", &v);
-          fscanf(file, "%d", &v);
-          numtriangles++;
-          group->numtriangles++;
-          while(fscanf(file, "%d", &v) > 0) {
-            numtriangles++;
-            group->numtriangles++;
-          }
+      case 'f':     /* face */
+        /* each corner can be one of %d, %d//%d, %d/%d, %d/%d/%d; faces
+           with more than three corners are split up into a fan */
+        tri = _glmAddTriangle(model, group);
+        for (i = 0; i < 3 && token < lineend; i++)
+          token = _glmParseCorner(model, token, lineend, tri, i);
+        if (i < 3) {
+          /* not really a face, so take it back out */
+          model->numtriangles--;
+          group->numtriangles--;
+          break;
+        }
+        while (token < lineend) {
+          tri = _glmAddTriangle(model, group);
+          T(tri).vindices[0] = T(tri-1).vindices[0];
+          T(tri).nindices[0] = T(tri-1).nindices[0];
+          T(tri).tindices[0] = T(tri-1).tindices[0];
+          T(tri).vindices[1] = T(tri-1).vindices[2];
+          T(tri).nindices[1] = T(tri-1).nindices[2];
+          T(tri).tindices[1] = T(tri-1).tindices[2];
+          token = _glmParseCorner(model, token, lineend, tri, 2);
         }
         break;
-
-      default:
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
+      default:      /* o, s, etc. */
         break;
     }
   }
 
   // #if 0
   /* announce the model statistics */
-  // printf(" Vertices: %d\n", numvertices);
-  // printf(" Normals: %d\n", numnormals);
-  // printf(" Texcoords: %d\n", numtexcoords);
-  // printf(" Triangles: %d\n", numtriangles);
+  // printf(" Vertices: %d\n", model->numvertices);
+  // printf(" Normals: %d\n", model->numnormals);
+  // printf(" Texcoords: %d\n", model->numtexcoords);
+  // printf(" Triangles: %d\n", model->numtriangles);
   // printf(" Groups: %d\n", model->numgroups);
   // #endif
 
-  /* set the stats in the model structure */
-  model->numvertices  = numvertices;
-  model->numnormals   = numnormals;
-  model->numtexcoords = numtexcoords;
-  model->numtriangles = numtriangles;
-
-  /* allocate memory for the triangles in each group */
-  group = model->groups;
-  while(group) {
-    group->triangles = (unsigned int*)malloc(sizeof(unsigned int) * group->numtriangles);
-    group->numtriangles = 0;
-    group = group->next;
+  /* shrink the arrays down to what was actually read */
+  model->vertices = (float*)realloc(model->vertices,
+      sizeof(float) * 3 * (model->numvertices + 1));
+  model->vertexColors = (unsigned char*)realloc(model->vertexColors,
+      sizeof(unsigned char) * 3 * (model->numvertices + 1));
+  if (model->numnormals) {
+    model->normals = (float*)realloc(model->normals,
+        sizeof(float) * 3 * (model->numnormals + 1));
+  } else {
+    free(model->normals);
+    model->normals = NULL;
   }
-
-  if (current_group_base_name) free(current_group_base_name);
-  if (current_material_name)   free(current_material_name);
-  return 0;
-}
-
-/* _glmSecondPass: second pass at a Wavefront OBJ file that gets all
- * the data.
- *
- * model - properly initialized GLMmodel structure
- * file  - (fopen'd) file descriptor 
- */
-  static void
-_glmSecondPass(GLMmodel* model, FILE* file) 
-{
-  unsigned int    numvertices;    /* number of vertices in model */
-  unsigned int    numnormals;     /* number of normals in model */
-  unsigned int    numtexcoords;   /* number of texcoords in model */
-  unsigned int    numtriangles;   /* number of triangles in model */
-  float*  vertices;     /* array of vertices  */
-  unsigned char*  vertexColors;       /* array of vertex colors */
-  float*  normals;      /* array of normals */
-  float*  texcoords;     /* array of texture coordinates */
-  GLMgroup* group;      /* current group pointer */
-  unsigned int    material;     /* current material */
-  char*           grpname;      /* current group base name */
-  char*           mtlname;      /* current material name */
-  int     v, n, t;
-  char      buf[2048];
-
-  /* set the pointer shortcuts */
-  vertices     = model->vertices;
-  vertexColors = model->vertexColors;
-  normals      = model->normals;
-  texcoords    = model->texcoords;
-  group        = model->groups;
-
-  /* on the second pass through the file, read all the data into the
-     allocated arrays */
-  numvertices = numnormals = numtexcoords = 1;
-  numtriangles = 0;
-  material = 0;
-  grpname = strdup(default_group_name);
-  mtlname = strdup(default_material_name);
-  while(fscanf(file, "%s", buf) != EOF) {
-    switch(buf[0]) {
-      case '#':       /* comment */
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        break;
-      case 'v':       /* v, vn, vt */
-        switch(buf[1]) {
-          case '\0':      /* vertex */
-            if (!model->usePerVertexColors) {
-              fscanf(file, "%f %f %f", 
-                  &vertices[3 * numvertices + X], 
-                  &vertices[3 * numvertices + Y], 
-                  &vertices[3 * numvertices + Z]);
-            }
-            else {
-              int r,g,b;
-              fscanf(file, "%f %f %f %d %d %d", 
-                  &vertices[3 * numvertices + X], 
-                  &vertices[3 * numvertices + Y], 
-                  &vertices[3 * numvertices + Z], &r, &g, &b);
-              vertexColors[3 * numvertices + X] = (unsigned char)r; 
-              vertexColors[3 * numvertices + Y] = (unsigned char)g; 
-              vertexColors[3 * numvertices + Z] = (unsigned char)b;
-            }
-            numvertices++;
-            break;
-          case 'n':       /* normal */
-            fscanf(file, "%f %f %f", 
-                &normals[3 * numnormals + X],
-                &normals[3 * numnormals + Y], 
-                &normals[3 * numnormals + Z]);
-            numnormals++;
-            break;
-          case 't':       /* texcoord */
-            fscanf(file, "%f %f", 
-                &texcoords[2 * numtexcoords + X],
-                &texcoords[2 * numtexcoords + Y]);
-            numtexcoords++;
-            break;
-        }
-        break;
-      case 'u': // usemtl
-        fgets(buf, sizeof(buf), file);
-        sscanf(buf, "%s %s", buf, buf);
-        if (mtlname) free(mtlname);
-        mtlname  = strdup(buf);
-        material = _glmFindMaterial(model, buf);
-        sprintf(buf, "%s_MAT_%s",
-            grpname, mtlname);
-        group = _glmFindGroup(model, buf);
-        group->material = material;
-        if (group->mtlname) free(group->mtlname);
-        group->mtlname = strdup(mtlname);
-        break;
-      case 'o': 
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        break;
-      case 'g':       /* group */
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        sscanf(buf, "%s", buf);
-        if (grpname) free(grpname);
-        grpname = strdup(buf);
-        sprintf(buf, "%s_MAT_%s",
-            grpname, mtlname);
-        group = _glmFindGroup(model, buf);
-        group->material = material;
-        if (group->mtlname) free(group->mtlname);
-        group->mtlname = strdup(mtlname);
-        break;
-      case 'f':       /* face */
-        v = n = t = 0;
-        fscanf(file, "%s", buf);
-        /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-        if (strstr(buf, "//")) {
-          /* v//n */
-          sscanf(buf, "%d//%d", &v, &n);
-          T(numtriangles).vindices[0] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[0] = n;
-          T(numtriangles).tindices[0] = 0;
-          fscanf(file, "%d//%d", &v, &n);
-          T(numtriangles).vindices[1] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[1] = n;
-          T(numtriangles).tindices[1] = 0;
-          fscanf(file, "%d//%d", &v, &n);
-          T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[2] = n;
-          T(numtriangles).tindices[2] = 0;
-          group->triangles[group->numtriangles++] = numtriangles;
-          numtriangles++;
-          while(fscanf(file, "%d//%d", &v, &n) > 0) {
-            T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-            T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-            T(numtriangles).tindices[0] = 0;
-            T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-            T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-            T(numtriangles).tindices[1] = 0;
-            T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-            T(numtriangles).nindices[2] = n;
-            T(numtriangles).tindices[2] = 0;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-          }
-        } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
-          /* v/t/n */
-          T(numtriangles).vindices[0] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[0] = n;
-          T(numtriangles).tindices[0] = t;
-          fscanf(file, "%d/%d/%d", &v, &t, &n);
-          T(numtriangles).vindices[1] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[1] = n;
-          T(numtriangles).tindices[1] = t;
-          fscanf(file, "%d/%d/%d", &v, &t, &n);
-          T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[2] = n;
-          T(numtriangles).tindices[2] = t;
-          group->triangles[group->numtriangles++] = numtriangles;
-          numtriangles++;
-          while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
-            T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-            T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-            T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-            T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-            T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-            T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-            T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-            T(numtriangles).nindices[2] = n;
-            T(numtriangles).tindices[2] = t;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-          }
-        } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
-          /* v/t */
-          T(numtriangles).vindices[0] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[0] = 0;
-          T(numtriangles).tindices[0] = t;
-          fscanf(file, "%d/%d", &v, &t);
-          T(numtriangles).vindices[1] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[1] = 0;
-          T(numtriangles).tindices[1] = t;
-          fscanf(file, "%d/%d", &v, &t);
-          T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[2] = 0;
-          T(numtriangles).tindices[2] = t;
-          group->triangles[group->numtriangles++] = numtriangles;
-          numtriangles++;
-          while(fscanf(file, "%d/%d", &v, &t) > 0) {
-            T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-            T(numtriangles).nindices[0] = 0;
-            T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-            T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-            T(numtriangles).nindices[1] = 0;
-            T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-            T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-            T(numtriangles).nindices[2] = 0;
-            T(numtriangles).tindices[2] = t;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-          }
-        } else {
-          /* v */
-          sscanf(buf, "%d", &v);
-          T(numtriangles).vindices[0] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[0] = 0;
-          T(numtriangles).tindices[0] = 0;
-          fscanf(file, "%d", &v);
-          T(numtriangles).vindices[1] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[1] = 0;
-          T(numtriangles).tindices[1] = 0;
-          fscanf(file, "%d", &v);
-          T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-          T(numtriangles).nindices[2] = 0;
-          T(numtriangles).tindices[2] = 0;
-          group->triangles[group->numtriangles++] = numtriangles;
-          numtriangles++;
-          while(fscanf(file, "%d", &v) > 0) {
-            T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-            T(numtriangles).nindices[0] = 0;
-            T(numtriangles).tindices[0] = 0;
-            T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-            T(numtriangles).nindices[1] = 0;
-            T(numtriangles).tindices[1] = 0;
-            T(numtriangles).vindices[2] = (v >= 0) ? v : (numvertices + v);
-            T(numtriangles).nindices[2] = 0;
-            T(numtriangles).tindices[2] = 0;
-            group->triangles[group->numtriangles++] = numtriangles;
-            numtriangles++;
-          }
-        }
-        break;
-
-      default:
-        /* eat up rest of line */
-        fgets(buf, sizeof(buf), file);
-        break;
+  if (model->numtexcoords) {
+    model->texcoords = (float*)realloc(model->texcoords,
+        sizeof(float) * 2 * (model->numtexcoords + 1));
+  } else {
+    free(model->texcoords);
+    model->texcoords = NULL;
+  }
+  if (model->numtriangles) {
+    model->triangles = (GLMtriangle*)realloc(model->triangles,
+        sizeof(GLMtriangle) * model->numtriangles);
+  }
+  for (group = model->groups; group; group = group->next) {
+    if (group->numtriangles) {
+      group->triangles = (unsigned int*)realloc(group->triangles,
+          sizeof(unsigned int) * group->numtriangles);
     }
-  } 
+  }
 
-#if 0
-  /* announce the memory requirements */
-  printf(" Memory: %d bytes\n",
-      numvertices  * 3*sizeof(float) +
-      numnormals   * 3*sizeof(float) * (numnormals ? 1 : 0) +
-      numtexcoords * 3*sizeof(float) * (numtexcoords ? 1 : 0) +
-      numtriangles * sizeof(GLMtriangle));
-#endif
-  if (grpname) free(grpname);
-  if (mtlname) free(mtlname);
+  return 0;
 }
 
 
@@ -1249,16 +1558,17 @@ glmFacetNormals(GLMmodel* model)
 
 /* glmVertexNormals: Generates smooth vertex normals for a model.
  * First builds a list of all the triangles each vertex is in.  Then
- * loops through each vertex in the the list averaging all the facet
+ * loops through each vertex (in parallel) averaging all the facet
  * normals of the triangles each vertex is in.  Finally, sets the
  * normal index in the triangle for the vertex to the generated smooth
  * normal.  If the dot product of a facet normal and the facet normal
- * associated with the first triangle in the list of triangles the
- * current vertex is in is greater than the cosine of the angle
- * parameter to the function, that facet normal is not added into the
- * average normal calculation and the corresponding vertex is given
- * the facet normal.  This tends to preserve hard edges.  The angle to
- * use depends on the model, but 90 degrees is usually a good start.
+ * of the last triangle the current vertex is in is not greater than
+ * the cosine of the angle parameter to the function, that facet
+ * normal is not added into the average normal calculation and the
+ * corresponding vertex is given the facet normal.  This tends to
+ * preserve hard edges.  The angle to use depends on the model, but 90
+ * degrees is usually a good start.  Identical normals are only stored
+ * once.
  *
  * model - initialized GLMmodel structure
  * angle - maximum angle (in degrees) to smooth across
@@ -1266,150 +1576,89 @@ glmFacetNormals(GLMmodel* model)
   void
 glmVertexNormals(GLMmodel* model, float angle)
 {
-  GLMnode*  node;
-  GLMnode*  tail;
-  GLMnode** members;
-  float*  normals;
-  unsigned int    numnormals;
-  float   average[3];
-  float   dot, cos_angle;
-  unsigned int    i, avg;
+  GLMnormaldata nd;
+  unsigned int* table;
+  unsigned int  tablesize, maxnormals;
+  unsigned int  i, j, k, v, avg;
+  int           numitems;
 
   assert(model);
   assert(model->facetnorms);
 
   /* calculate the cosine of the angle (in degrees) */
-  cos_angle = cosf(angle * (float)M_PI / 180.0f);
+  nd.model     = model;
+  nd.cos_angle = cosf(angle * (float)M_PI / 180.0f);
 
   /* nuke any previous normals */
   if (model->normals)
     free(model->normals);
 
-  /* allocate space for new normals */
-  model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-  model->normals = (float*)malloc(sizeof(float)* 3* (model->numnormals+1));
-
-  /* allocate a structure that will hold a linked list of triangle
-     indices for each vertex */
-  members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-  for (i = 1; i <= model->numvertices; i++)
-    members[i] = NULL;
-
-  /* for every triangle, create a node for each vertex in it */
-  for (i = 0; i < model->numtriangles; i++) {
-    node = (GLMnode*)malloc(sizeof(GLMnode));
-    node->index = i;
-    node->next  = members[T(i).vindices[0]];
-    members[T(i).vindices[0]] = node;
-
-    node = (GLMnode*)malloc(sizeof(GLMnode));
-    node->index = i;
-    node->next  = members[T(i).vindices[1]];
-    members[T(i).vindices[1]] = node;
-
-    node = (GLMnode*)malloc(sizeof(GLMnode));
-    node->index = i;
-    node->next  = members[T(i).vindices[2]];
-    members[T(i).vindices[2]] = node;
-  }
-
-  /* calculate the average normal for each vertex */
-  numnormals = 1;
-  for (i = 1; i <= model->numvertices; i++) {
-    /* calculate an average normal for this vertex by averaging the
-       facet normal of every triangle this vertex is in */
-    node = members[i];
-    if (!node)
+  /* allocate space for the most normals we could need:  one average per
+     vertex, and one facet normal per triangle corner */
+  maxnormals = model->numvertices + model->numtriangles * 3;
+  model->numnormals = 0;
+  model->normals = (float*)malloc(sizeof(float)* 3* (maxnormals+1));
+
+  /* build the list of triangles each vertex is in:  count them, then
+     put each triangle in its vertices' lists (in order) */
+  nd.start = (unsigned int*)calloc(model->numvertices + 2, sizeof(unsigned int));
+  nd.tris  = (unsigned int*)malloc(sizeof(unsigned int) * (model->numtriangles * 3 + 1));
+  for (i = 0; i < model->numtriangles; i++)
+    for (j = 0; j < 3; j++)
+      nd.start[T(i).vindices[j] + 1]++;
+  for (v = 1; v <= model->numvertices; v++)
+    nd.start[v + 1] += nd.start[v];
+  for (i = 0; i < model->numtriangles; i++)
+    for (j = 0; j < 3; j++)
+      nd.tris[nd.start[T(i).vindices[j]]++] = i;
+  for (v = model->numvertices + 1; v > 1; v--)
+    nd.start[v] = nd.start[v - 1];
+  nd.start[1] = 0;
+
+  /* calculate the average normal for each vertex, in parallel */
+  nd.averaged   = (unsigned char*)malloc(model->numtriangles * 3 + 1);
+  nd.hasaverage = (unsigned char*)malloc(model->numvertices + 1);
+  nd.average    = (float*)malloc(sizeof(float) * 3 * (model->numvertices + 1));
+  nd.vertsperitem = 4096;
+  numitems = (int)((model->numvertices + nd.vertsperitem - 1) / nd.vertsperitem);
+  iglu::IGLUParallel::For(numitems, _glmAverageNormals, &nd);
+
+  /* now hand out normal indices (in the same order as always), sharing
+     normals that are identical */
+  tablesize = 1;
+  while (tablesize < 2 * maxnormals)
+    tablesize <<= 1;
+  table = (unsigned int*)calloc(tablesize, sizeof(unsigned int));
+  for (v = 1; v <= model->numvertices; v++) {
+    if (nd.start[v] == nd.start[v + 1])
       fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
-    average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
-    avg = 0;
-    while (node) {
-      /* only average if the dot product of the angle between the two
-         facet normals is greater than the cosine of the threshold
-         angle -- or, said another way, the angle between the two
-         facet normals is less than (or equal to) the threshold angle */
-      dot = _glmDot(&model->facetnorms[3 * T(node->index).findex],
-          &model->facetnorms[3 * T(members[i]->index).findex]);
-      if (dot > cos_angle) {
-        node->averaged = true;
-        average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-        average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-        average[2] += model->facetnorms[3 * T(node->index).findex + 2];
-        avg = 1;      /* we averaged at least one normal! */
-      } else {
-        node->averaged = false;
-      }
-      node = node->next;
-    }
-
-    if (avg) {
-      /* normalize the averaged normal */
-      _glmNormalize(average);
 
-      /* add the normal to the vertex normals list */
-      model->normals[3 * numnormals + 0] = average[0];
-      model->normals[3 * numnormals + 1] = average[1];
-      model->normals[3 * numnormals + 2] = average[2];
-      avg = numnormals;
-      numnormals++;
-    }
-
-    /* set the normal of this vertex in each triangle it is in */
-    node = members[i];
-    while (node) {
-      if (node->averaged) {
-        /* if this node was averaged, use the average normal */
-        if (T(node->index).vindices[0] == i)
-          T(node->index).nindices[0] = avg;
-        else if (T(node->index).vindices[1] == i)
-          T(node->index).nindices[1] = avg;
-        else if (T(node->index).vindices[2] == i)
-          T(node->index).nindices[2] = avg;
-      } else {
-        /* if this node wasn't averaged, use the facet normal */
-        model->normals[3 * numnormals + 0] = 
-          model->facetnorms[3 * T(node->index).findex + 0];
-        model->normals[3 * numnormals + 1] = 
-          model->facetnorms[3 * T(node->index).findex + 1];
-        model->normals[3 * numnormals + 2] = 
-          model->facetnorms[3 * T(node->index).findex + 2];
-        if (T(node->index).vindices[0] == i)
-          T(node->index).nindices[0] = numnormals;
-        else if (T(node->index).vindices[1] == i)
-          T(node->index).nindices[1] = numnormals;
-        else if (T(node->index).vindices[2] == i)
-          T(node->index).nindices[2] = numnormals;
-        numnormals++;
-      }
-      node = node->next;
+    avg = 0;
+    if (nd.hasaverage[v])
+      avg = _glmAddNormal(model, table, tablesize, &nd.average[3 * v]);
+
+    /* set the normal of this vertex in each triangle it is in:  the
+       average if this triangle was averaged, or else its facet normal */
+    for (k = nd.start[v + 1]; k-- > nd.start[v]; ) {
+      i = nd.tris[k];
+      j = (T(i).vindices[0] == v) ? 0 : ((T(i).vindices[1] == v) ? 1 : 2);
+      if (nd.averaged[k])
+        T(i).nindices[j] = avg;
+      else
+        T(i).nindices[j] = _glmAddNormal(model, table, tablesize,
+                                         &model->facetnorms[3 * T(i).findex]);
     }
   }
 
-  model->numnormals = numnormals - 1;
-
-  /* free the member information */
-  for (i = 1; i <= model->numvertices; i++) {
-    node = members[i];
-    while (node) {
-      tail = node;
-      node = node->next;
-      free(tail);
-    }
-  }
-  free(members);
+  free(table);
+  free(nd.start);
+  free(nd.tris);
+  free(nd.averaged);
+  free(nd.hasaverage);
+  free(nd.average);
 
-  /* pack the normals array (we previously allocated the maximum
-     number of normals that could possibly be created (numtriangles *
-     3), so get rid of some of them (usually alot unless none of the
-     facet normals were averaged)) */
-  normals = model->normals;
-  model->normals = (float*)malloc(sizeof(float)* 3* (model->numnormals+1));
-  for (i = 1; i <= model->numnormals; i++) {
-    model->normals[3 * i + 0] = normals[3 * i + 0];
-    model->normals[3 * i + 1] = normals[3 * i + 1];
-    model->normals[3 * i + 2] = normals[3 * i + 2];
-  }
-  free(normals);
+  /* shrink the normals array down to the normals we actually used */
+  model->normals = (float*)realloc(model->normals, sizeof(float)* 3* (model->numnormals+1));
 
   // printf("glmVertexNormals(): %u normals generated\n", model->numnormals);
 }
@@ -1590,23 +1839,42 @@ glmDelete(GLMmodel* model)
 glmReadOBJ(const char* filename)
 {
   GLMmodel* model;
-  FILE*     file;
 
-  /* open the file */
-  file = fopen(filename, "r");
+  /* map the file (or get it from a mounted I/O provider), and read it
+     straight out of memory */
+  iglu::IGLUFileData* file = iglu::IGLUFileSystem::Open(filename);
   if (!file) {
     perror("glmReadOBJ() failed: can't open data file");
     return 0;
   }
 
+  model = glmReadOBJFromMemory(file->GetData(), file->GetSize(), filename);
+  delete file;
+  return model;
+}
+
+/* glmReadOBJFromMemory: Reads a model description from Wavefront .OBJ
+ * data that is already in memory.  Returns a pointer to the created
+ * object which should be free'd with glmDelete().
+ *
+ * data     - the .OBJ file contents (need not be null-terminated)
+ * size     - the number of characters in data
+ * pathname - where the data came from; material libraries are looked
+ *            for in the same directory.
+ */
+  GLMmodel* 
+glmReadOBJFromMemory(const char* data, size_t size, const char* pathname)
+{
+  GLMmodel* model;
+
 #if 0
   /* announce the model name */
-  printf("Model: %s\n", filename);
+  printf("Model: %s\n", pathname);
 #endif
 
   /* allocate a new model */
   model = (GLMmodel*)malloc(sizeof(GLMmodel));
-  model->pathname      = strdup(filename);
+  model->pathname      = strdup(pathname ? pathname : "");
   model->mtllibname    = NULL;
   model->numvertices   = 0;
   model->vertices      = NULL;
@@ -1627,39 +1895,14 @@ glmReadOBJ(const char* filename)
   model->position[1]   = 0.0;
   model->position[2]   = 0.0;
   model->usePerVertexColors = 0;
-  /* make a first pass through the file to get a count of the number
-     of vertices, normals, texcoords & triangles */
-  if (_glmFirstPass(model, file)) {
+
+  /* read in all the data in one pass */
+  if (_glmParseOBJ(model, data, data + size)) {
     /* There was a problem here, so cleanup and exit. */
     glmDelete(model);
-    fclose(file);
     return 0;
   }
 
-  /* allocate memory */
-  model->vertices = (float*)malloc(sizeof(float) *
-      3 * (model->numvertices + 1));
-  model->vertexColors = (unsigned char*)malloc(sizeof(unsigned char) *
-      3 * (model->numvertices + 1));
-  model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
-      model->numtriangles);
-  if (model->numnormals) {
-    model->normals = (float*)malloc(sizeof(float) *
-        3 * (model->numnormals + 1));
-  }
-  if (model->numtexcoords) {
-    model->texcoords = (float*)malloc(sizeof(float) *
-        2 * (model->numtexcoords + 1));
-  }
-
-  /* rewind to beginning of file and read in the data this pass */
-  rewind(file);
-
-  _glmSecondPass(model, file);
-
-  /* close the file */
-  fclose(file);
-
   return model;
 }
 
@@ -1852,10 +2095,11 @@ glmWriteOBJ(GLMmodel* model, char* filename, unsigned int mode)
  * model      - initialized GLMmodel structure
  * epsilon    - maximum difference between vertices
  *              ( 0.00001 is a good start for a unitized model)
+ * parallel   - use all processors
  *
  */
   void
-glmWeld(GLMmodel* model, float epsilon)
+glmWeld(GLMmodel* model, float epsilon, bool parallel)
 {
   float* vectors;
   float* copies;
@@ -1865,10 +2109,10 @@ glmWeld(GLMmodel* model, float epsilon)
   /* vertices */
   numvectors = model->numvertices;
   vectors    = model->vertices;
-  copies = _glmWeldVectors(vectors, &numvectors, epsilon);
+  copies = _glmWeldHashed(vectors, &numvectors, epsilon, parallel);
 
   printf("glmWeld(): %u redundant vertices.\n", 
-      model->numvertices - numvectors - 1);
+      model->numvertices - numvectors);
 
   for (i = 0; i < model->numtriangles; i++) {
     T(i).vindices[0] = (unsigned int)vectors[3 * T(i).vindices[0] + 0];
@@ -1894,6 +2138,124 @@ glmWeld(GLMmodel* model, float epsilon)
   free(copies);
 }
 
+/* _glmWeldRandom: a small, repeatable random number generator for
+ * glmWeldBenchmark().  Returns a value in [0..1).
+ */
+  static float
+_glmWeldRandom(unsigned int* state)
+{
+  *state = *state * 1664525u + 1013904223u;
+  return (float)(*state >> 8) / 16777216.0f;
+}
+
+/* _glmWeldCompare: runs one of the weld implementations on a copy of
+ * vectors, returning the time taken (in ms).  The welded copies and
+ * remapped vectors are returned in *copies and *remapped.
+ */
+  static double
+_glmWeldCompare(float* vectors, unsigned int numvectors, float epsilon, int method,
+                float** copies, float** remapped, unsigned int* numcopies)
+{
+  iglu::IGLUCPUTimer timer;
+
+  *remapped = (float*)malloc(sizeof(float) * 3 * (numvectors + 1));
+  memcpy(*remapped, vectors, sizeof(float) * 3 * (numvectors + 1));
+  *numcopies = numvectors;
+
+  timer.Start();
+  if (method == 0)
+    *copies = _glmWeldVectors(*remapped, numcopies, epsilon);
+  else
+    *copies = _glmWeldHashed(*remapped, numcopies, epsilon, method == 2);
+  return timer.Tick();
+}
+
+/* glmWeldBenchmark: times the brute force and spatial hash welds on
+ * synthetic meshes, and checks that they give identical results.
+ */
+  void
+glmWeldBenchmark(unsigned int numvectors, float epsilon)
+{
+  static const char* methodnames[3] = { "brute force", "hashed", "hashed (parallel)" };
+  static const char* meshnames[2]   = { "duplicated grid", "dense cloud" };
+  unsigned int state = 12345;
+  unsigned int mesh, method, i, k;
+  float* vectors;
+
+  if (numvectors == 0 || !(epsilon > 0))
+    return;
+  vectors = (float*)malloc(sizeof(float) * 3 * (numvectors + 1));
+
+  for (mesh = 0; mesh < 2; mesh++) {
+    float*       refcopies   = 0;
+    float*       refremapped = 0;
+    unsigned int refcount    = 0;
+
+    if (mesh == 0) {
+      /* Points on a grid (spaced 4 epsilon apart), each repeated a few
+         times with tiny offsets, in random order.  Like a mesh that was
+         stored as separate triangles. */
+      unsigned int side = (unsigned int)ceil(pow(numvectors / 3.0, 1.0 / 3.0));
+      for (i = 1; i <= numvectors; i++) {
+        unsigned int pt = (unsigned int)(_glmWeldRandom(&state) * (numvectors / 3 + 1));
+        for (k = 0; k < 3; k++) {
+          unsigned int coord = (k == 0) ? pt % side : ((k == 1) ? (pt / side) % side : pt / (side * side));
+          vectors[3 * i + k] = 4.0f * epsilon * coord + 0.2f * epsilon * _glmWeldRandom(&state);
+        }
+      }
+    }
+    else {
+      /* Random points about epsilon apart, so welds chain across cells */
+      float size = epsilon * (float)pow((double)numvectors, 1.0 / 3.0);
+      for (i = 1; i <= numvectors; i++)
+        for (k = 0; k < 3; k++)
+          vectors[3 * i + k] = size * _glmWeldRandom(&state);
+    }
+
+    for (method = 0; method < 3; method++) {
+      float*       copies;
+      float*       remapped;
+      unsigned int numcopies;
+      double       ms;
+      bool         same = true;
+
+      /* The brute force weld is quadratic; don't wait forever for it */
+      if (method == 0 && numvectors > 100000) {
+        printf("glmWeldBenchmark(): %s, %u vectors, %s: skipped (too slow)\n",
+            meshnames[mesh], numvectors, methodnames[method]);
+        continue;
+      }
+
+      ms = _glmWeldCompare(vectors, numvectors, epsilon, method, &copies, &remapped, &numcopies);
+      if (refcopies) {
+        same = (numcopies == refcount);
+        for (i = 1; same && i <= numvectors; i++)
+          same = (remapped[3 * i] == refremapped[3 * i]);
+        for (i = 1; same && i <= numcopies; i++)
+          same = !memcmp(&copies[3 * i], &refcopies[3 * i], 3 * sizeof(float));
+      }
+      printf("glmWeldBenchmark(): %s, %u vectors, %s: %u left, %.2f ms%s\n",
+          meshnames[mesh], numvectors, methodnames[method], numcopies, ms,
+          same ? "" : " -- MISMATCH");
+
+      if (!refcopies) {
+        refcopies   = copies;
+        refremapped = remapped;
+        refcount    = numcopies;
+      }
+      else {
+        free(copies);
+        free(remapped);
+      }
+    }
+
+    free(refcopies);
+    free(refremapped);
+  }
+
+  free(vectors);
+}
+
 #if 0   /** This is left in only as a reference to how to get to the data. */
 /* glmDraw: Renders the model to the current OpenGL context using the
  * mode specified.
@@ -12,6 +12,7 @@
 #define M_PI 3.1415924
 
 /* includes */
+#include <stddef.h>
 
 /* defines */
 #if 0
@@ -182,16 +183,17 @@ glmFacetNormals(GLMmodel* model);
 
 /* glmVertexNormals: Generates smooth vertex normals for a model.
  * First builds a list of all the triangles each vertex is in.  Then
- * loops through each vertex in the the list averaging all the facet
+ * loops through each vertex (in parallel) averaging all the facet
  * normals of the triangles each vertex is in.  Finally, sets the
  * normal index in the triangle for the vertex to the generated smooth
  * normal.  If the dot product of a facet normal and the facet normal
- * associated with the first triangle in the list of triangles the
- * current vertex is in is greater than the cosine of the angle
- * parameter to the function, that facet normal is not added into the
- * average normal calculation and the corresponding vertex is given
- * the facet normal.  This tends to preserve hard edges.  The angle to
- * use depends on the model, but 90 degrees is usually a good start.
+ * of the last triangle the current vertex is in is not greater than
+ * the cosine of the angle parameter to the function, that facet
+ * normal is not added into the average normal calculation and the
+ * corresponding vertex is given the facet normal.  This tends to
+ * preserve hard edges.  The angle to use depends on the model, but 90
+ * degrees is usually a good start.  Identical normals are only stored
+ * once.
  *
  * model - initialized GLMmodel structure
  * angle - maximum angle (in degrees) to smooth across
@@ -238,6 +240,20 @@ void glmDelete(GLMmodel* model);
  */
 GLMmodel* glmReadOBJ(const char* filename);
 
+/* glmReadOBJFromMemory: Reads a model description from Wavefront .OBJ
+ * data that is already in memory (e.g., a file read from an archive).
+ * Returns a pointer to the created object which should be free'd with
+ * glmDelete().
+ *
+ * data     - the .OBJ file contents (need not be null-terminated)
+ * size     - the number of characters in data
+ * pathname - where the data came from; material libraries are looked
+ *            for in the same directory.
+ *
+ * returns 0 if there was a problem reading the data.
+ */
+GLMmodel* glmReadOBJFromMemory(const char* data, size_t size, const char* pathname);
+
 /* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
  * a file.
  *
@@ -257,15 +273,25 @@ int
 glmWriteOBJ(GLMmodel* model, char* filename, unsigned int mode);
 
 /* glmWeld: eliminate (weld) vectors that are within an epsilon of
- * each other.
+ * each other.  Each vertex is welded to the first (lowest numbered)
+ * earlier vertex within epsilon, found with a spatial hash, so this
+ * takes roughly linear time.
  *
  * model      - initialized GLMmodel structure
  * epsilon    - maximum difference between vertices
  *              ( 0.00001 is a good start for a unitized model)
+ * parallel   - use all processors (the results are identical)
  *
  */
 void
-glmWeld(GLMmodel* model, float epsilon);
+glmWeld(GLMmodel* model, float epsilon, bool parallel = false);
+
+/* glmWeldBenchmark: times the old brute force (quadratic) weld against
+ * the spatial hash welds on synthetic meshes of numvectors vertices,
+ * checks they give identical results, and prints the timings.
+ */
+void
+glmWeldBenchmark(unsigned int numvectors, float epsilon);
 
 
 #endif 
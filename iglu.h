@@ -68,6 +68,9 @@
 #include "iglu/igluCPUTimer.h"
 #include "iglu/igluFrameRate.h"
 
+// Simple multi-threading utilities
+#include "iglu/igluParallel.h"
+
 // Random number generation
 #include "iglu/igluRandom.h"
 
@@ -84,10 +87,14 @@
 
 // Image input/video IO utilities
 #include "iglu/igluImage.h"
+#include "iglu/igluImageDecoder.h"
 #include "iglu/igluVideo.h"
 
 // Texturing utilities
 #include "iglu/igluTexture2D.h"
+#include "iglu/igluTextureCache.h"
+#include "iglu/igluBlockCompress.h"
+#include "iglu/igluMipmap.h"
 #include "iglu/igluTextureLightprobeCubemap.h"
 #include "iglu/igluTextureBuffer.h"
 #include "iglu/igluRandomTexture2D.h"
@@ -108,6 +115,9 @@
 #include "iglu/igluParsing.h"
 #include "iglu/igluModels.h"
 
+// Loading models (and other assets) on background threads
+#include "iglu/igluAsyncLoader.h"
+
 // User interface utilities
 #include "iglu/interactors/igluMouseInteractor.h"
 #include "iglu/interactors/igluTrackball.h"
@@ -35,6 +35,15 @@
 
 namespace iglu { 
 
+// One draw in the buffer given to IGLUVertexArray::MultiDrawElementsIndirect().  (This layout
+//    is defined by OpenGL;  see glDrawElementsIndirect().)
+struct IGLUDrawElementsCommand
+{
+	GLuint count, instanceCount, firstIndex;
+	GLint  baseVertex;
+	GLuint baseInstance;
+};
+
 class IGLUVertexArray {
 public:
 	IGLUVertexArray();
@@ -67,13 +76,15 @@ public:
 		                  GLint size, GLenum type,                  // 'size' values of the specified type are sent down per vertex
 						  GLsizei stride=0,                         // Vertices are stride bytes apart.  Default (=0) means densely packed data 
 						  const GLvoid *pointer=BUFFER_OFFSET(0),   // Pointer to start of array data.  Default is the start of the buffer (0 bytes)
-						  int instancesDivisor=-1 );                // If instancing (and > 0), this is passed to glVertexAttribDivisor
+						  int instancesDivisor=-1,                  // If instancing (and > 0), this is passed to glVertexAttribDivisor
+						  bool normalized=false );                  // Should integer data be mapped to [0..1] (or [-1..1] if signed)?
 
 	void EnableAttribute( int glAttribIdx,                          // Typically an built-in IGLU define like IGLU_ATTRIB_VERTEX (matching a GLSL layout specifier)
 		                  GLint size, GLenum type,                  // 'size' values of the specified type are sent down per vertex
 						  GLsizei stride=0,                         // Vertices are stride bytes apart.  Default (=0) means densely packed data 
 						  const GLvoid *pointer=BUFFER_OFFSET(0),   // Pointer to start of array data.  Default is the start of the buffer (0 bytes)
-						  int instancesDivisor=-1 );                // If instancing (and > 0), this is passed to glVertexAttribDivisor
+						  int instancesDivisor=-1,                  // If instancing (and > 0), this is passed to glVertexAttribDivisor
+						  bool normalized=false );                  // Should integer data be mapped to [0..1] (or [-1..1] if signed)?
 
 
 	// If you're using primitive restart (e.g., to specify a stream of triangle strips) give the restart index here.
@@ -87,6 +98,9 @@ public:
 	void MultiDrawArrays( GLenum mode, GLint *first, GLsizei *count, GLsizei primCount );
 	void DrawArraysInstanced( GLenum mode, GLint first, GLsizei count, GLsizei primCount, GLuint baseInstance=0 );
 	void DrawElements( GLenum mode, GLsizei count, GLuint bufOffsetBytes=0 );
+	void MultiDrawElements( GLenum mode, const GLsizei *count, const GLvoid * const *bufOffsets, GLsizei drawCount );
+	// Draws drawCount IGLUDrawElementsCommands stored in an IGLU_DRAW_INDIRECT buffer
+	void MultiDrawElementsIndirect( GLenum mode, IGLUBuffer::Ptr commands, GLsizei drawCount, GLuint bufOffsetBytes=0 );
 	//add by sunf draw elements instanced
 	void DrawElementsInstanced( GLenum mode, GLsizei count, GLsizei instanceNum, GLuint bufOffsetBytes=0);
 	// Transform feedback draw routine.  This should only be used if the internal buffers were
@@ -46,7 +46,14 @@ namespace iglu
 
 	}
 
-	IGLUApp::IGLUApp(const char* sceneFile):_initialized(false)
+	// What IGLUApp::ModelLoaded() needs to know about a model being loaded
+	struct IGLUAppLoadingModel
+	{
+		IGLUApp *app;
+		IGLUMatrix4x4 transform;
+	};
+
+	IGLUApp::IGLUApp(const char* sceneFile):_initialized(false),_loader(NULL),_uploadBudgetMs(2.0f),_materialsChanged(false)
 	{
 		_sceneData = new SceneData(sceneFile);
 		SceneData& helper = *_sceneData;
@@ -113,6 +120,7 @@ namespace iglu
 
 	IGLUApp::~IGLUApp()
 	{
+		delete _loader;
 		_shaders.clear();
 		_objReaders.clear();
 		_objTransforms.clear();
@@ -133,6 +141,9 @@ namespace iglu
 
 	void IGLUApp::InitScene()
 	{
+		if (!_loader)
+			_loader = new IGLUAsyncLoader();
+
 		for (int i=0; i<_sceneData->getObjects().size(); i++)
 		{
 			SceneObject* obj = _sceneData->getObjects()[i];
@@ -141,14 +152,17 @@ namespace iglu
 			case SceneObjType::mesh:
 				{
 					ObjModelObject* mesh = (ObjModelObject*)obj;				
-					IGLUOBJReader::Ptr objReader;
 					int params = mesh->getCompactFlag() ? IGLU_OBJ_COMPACT_STORAGE : 0;					
 					params |=mesh->getUnitizeFlag() ?  IGLU_OBJ_UNITIZE : 0;
-					objReader  = new IGLUOBJReader( (char*)mesh->getObjFileName().c_str(), params);
-					_objReaders.push_back(objReader);
 					glm::mat4 trans = mesh->getTransform();			
-					_objTransforms.push_back(IGLUMatrix4x4(&trans[0][0]));				
-
+					IGLUAppLoadingModel *model = new IGLUAppLoadingModel;
+					model->app       = this;
+					model->transform = IGLUMatrix4x4(&trans[0][0]);
+
+					// The model is parsed on a worker thread, and shows up in _objReaders
+					//    (via ModelLoaded()) once Display() has uploaded it.
+					_loader->Submit( new IGLUOBJLoadJob( mesh->getObjFileName().c_str(), params, ModelLoaded, model,
+						                                 ModelCancelled ) );
 					break;
 				}
 			default:
@@ -156,10 +170,21 @@ namespace iglu
 			}
 		}
 
-		// We've loaded all our materials, so prepare to use them in rendering
-		IGLUOBJMaterialReader::FinalizeMaterialsForRendering(IGLU_TEXTURE_REPEAT);
+		// Materials are prepared for rendering as the models using them arrive (see Display())
+	}
 
+	void IGLUApp::ModelLoaded( IGLUOBJReader *reader, void *data )
+	{
+		IGLUAppLoadingModel *model = (IGLUAppLoadingModel *)data;
+		model->app->_objReaders.push_back( reader );
+		model->app->_objTransforms.push_back( model->transform );
+		model->app->_materialsChanged = true;
+		delete model;
+	}
 
+	void IGLUApp::ModelCancelled( void *data )
+	{
+		delete (IGLUAppLoadingModel *)data;
 	}
 
 	void IGLUApp::Display()
@@ -167,6 +192,17 @@ namespace iglu
 
 		// Start timing this frame draw
 		_frameRate->StartFrame();
+
+		// Upload whatever models have finished loading since last frame.  Their materials
+		//    (and any new textures) need adding to the material buffer & texture array.
+		if (_loader && !_loader->IsIdle())
+			_loader->Update( _uploadBudgetMs );
+		if (_materialsChanged)
+		{
+			IGLUOBJMaterialReader::FinalizeMaterialsForRendering(IGLU_TEXTURE_REPEAT);
+			_materialsChanged = false;
+		}
+
 		glDisable(GL_BLEND);
 		// Clear the screen
 		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
@@ -23,7 +23,8 @@ namespace iglu
 	{
 	public:
 		IGLUApp(const char* sceneFile);
-		IGLUApp():_winWidth(512),_winHeight(512),_sceneData(NULL),_initialized(false)
+		IGLUApp():_winWidth(512),_winHeight(512),_sceneData(NULL),_initialized(false),
+			_loader(NULL),_uploadBudgetMs(2.0f),_materialsChanged(false)
 		{}
 		virtual ~IGLUApp();
 		IGLUApp(IGLUApp const&);              // Don't Implement
@@ -76,6 +77,14 @@ namespace iglu
 		bool _initialized;
 
 		Camera * _camera;
+
+		// Models load in the background;  each frame, Display() spends up to _uploadBudgetMs
+		//    uploading what has finished loading, and models are drawn as they arrive.
+		IGLUAsyncLoader::Ptr _loader;
+		float _uploadBudgetMs;
+		bool _materialsChanged;
+		static void ModelLoaded( IGLUOBJReader *reader, void *data );
+		static void ModelCancelled( void *data );
 	};
 
 }
@@ -0,0 +1,137 @@
+/************************************************************************/
+/* igluAsyncLoader.h                                                    */
+/* -----------------                                                    */
+/*                                                                      */
+/* Loads assets on background threads, so applications can start       */
+/* drawing before (large) scenes finish loading.                        */
+/*                                                                      */
+/* Each job is split into two halves.  Load() runs on a worker thread   */
+/* and does all the file reading, parsing & decoding;  it must not      */
+/* touch OpenGL.  Upload() runs on the thread with the GL context,      */
+/* whenever the application calls IGLUAsyncLoader::Update() (usually    */
+/* once a frame).  Update() is given a time budget, so uploads are      */
+/* spread over several frames rather than causing one long hitch.       */
+/*                                                                      */
+/* IGLUOBJLoadJob loads an OBJ model (and its materials & textures)     */
+/* this way, using IGLU_OBJ_DEFER_UPLOAD.  (IGLU_OBJ_STREAMING can't be */
+/* deferred, so those jobs ignore it.)                                  */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef __IGLU_ASYNC_LOADER_H__
+#define __IGLU_ASYNC_LOADER_H__
+
+#include <deque>
+#include <vector>
+#include "iglu/igluParallel.h"
+
+namespace iglu {
+
+class IGLUOBJReader;
+
+// The base class for work done by an IGLUAsyncLoader
+class IGLUAsyncJob
+{
+public:
+	IGLUAsyncJob()                                  {}
+	virtual ~IGLUAsyncJob()                         {}
+
+	// Called once, on a worker thread.  Must not make any OpenGL calls.
+	virtual void Load( void ) = 0;
+
+	// Called on the GL thread after Load() finishes.  Jobs with a lot to upload can do a
+	//    piece at a time and return false;  they'll be called again (maybe next frame)
+	//    until they return true, after which the job is deleted.
+	virtual bool Upload( void )                     { return true; }
+
+	// A pointer to a IGLUAsyncJob could have type IGLUAsyncJob::Ptr
+	typedef IGLUAsyncJob *Ptr;
+};
+
+class IGLUAsyncLoader
+{
+public:
+	// Uses up to numThreads worker threads (0 means one per processor)
+	IGLUAsyncLoader( int numThreads=0 );
+
+	// Waits for jobs already being loaded, and deletes any other jobs without running them
+	~IGLUAsyncLoader();
+
+	// Queues a job for loading.  The loader owns (and eventually deletes) the job.
+	void Submit( IGLUAsyncJob *job );
+
+	// Call from the GL thread (e.g., once a frame).  Uploads loaded jobs until budgetMs
+	//    milliseconds have passed (but always makes at least one Upload() call if any job is
+	//    ready).  Returns the number of jobs that completed.
+	int Update( float budgetMs=2.0f );
+
+	// Waits until every submitted job has been loaded and uploaded
+	void Finish( void );
+
+	// How many submitted jobs have not yet completed?
+	int GetPendingCount( void );
+	bool IsIdle( void )                             { return GetPendingCount() == 0; }
+
+	// A pointer to a IGLUAsyncLoader could have type IGLUAsyncLoader::Ptr
+	typedef IGLUAsyncLoader *Ptr;
+
+private:
+	// A worker thread.  Workers exit when they find no more jobs waiting to load, and are
+	//    joined by the next Update() (or a new worker is started by the next Submit()).
+	struct Worker { void *thread; bool done; IGLUAsyncLoader *loader; };
+
+	IGLUMutex                    m_lock;
+	int                          m_maxThreads;
+	bool                         m_stopping;
+	std::deque< IGLUAsyncJob * > m_waiting;     // Submitted, not yet loaded
+	std::deque< IGLUAsyncJob * > m_loaded;      // Loaded, waiting for Upload()
+	std::vector< Worker * >      m_workers;
+	int                          m_numLoading;  // Jobs in Load() right now
+	int                          m_numActive;   // Workers that have not yet decided to exit
+
+	static void WorkerLoop( void *workerPtr );
+	void JoinFinishedWorkers( bool waitForAll );
+
+	IGLUAsyncLoader( const IGLUAsyncLoader & );
+	IGLUAsyncLoader &operator=( const IGLUAsyncLoader & );
+};
+
+
+// Called (on the GL thread) with each OBJ model once it is ready to draw.  The callback
+//    takes ownership of the reader.
+typedef void (*IGLUOBJLoadCallback)( IGLUOBJReader *reader, void *userData );
+
+// Called instead, if the job is deleted before it completes (e.g., by ~IGLUAsyncLoader()),
+//    so the userData can be freed
+typedef void (*IGLUOBJCancelCallback)( void *userData );
+
+// Loads an OBJ file on a worker thread, then uploads its geometry (and, one per Upload()
+//    call, any textures its materials use) on the GL thread.  Materials are available to
+//    IGLUOBJMaterialReader once the callback is called, though the application still needs
+//    to call FinalizeMaterialsForRendering() to use them in shaders.
+class IGLUOBJLoadJob : public IGLUAsyncJob
+{
+public:
+	// params are the IGLUOBJReader flags, except that IGLU_OBJ_STREAMING is removed (streaming
+	//    readers upload as they parse, so they can't run on a worker thread)
+	IGLUOBJLoadJob( const char *filename, int params, IGLUOBJLoadCallback callback, void *userData=0,
+		            IGLUOBJCancelCallback cancelled=0 );
+	virtual ~IGLUOBJLoadJob();
+
+	virtual void Load( void );
+	virtual bool Upload( void );
+
+private:
+	char                 *m_filename;
+	int                   m_params;
+	IGLUOBJLoadCallback   m_callback;
+	IGLUOBJCancelCallback m_cancelled;
+	void                 *m_userData;
+	IGLUOBJReader        *m_reader;
+	bool                  m_uploadedGeometry;
+	bool                  m_completed;        // Has the callback been called?
+};
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+/******************************************************************/
+/* igluBlockCompress.h                                            */
+/* -----------------------                                        */
+/*                                                                */
+/* Compresses 8-bit images into the GPU block formats (BC1, BC3,  */
+/*    BC4, BC5, and BC7) on the CPU.  Unlike asking the driver to */
+/*    compress during glTexImage2D() (IGLU_COMPRESS_TEXTURE), the */
+/*    quality is the same everywhere, and the results can be kept */
+/*    on disk (see IGLUMipChain) so the work is done only once.   */
+/*                                                                */
+/* Each 4x4 block's endpoints start at the principal axis of its  */
+/*    colors and are refined by least squares;  the search for    */
+/*    the best palette entry covers four pixels at a time with    */
+/*    SSE.  Rows of blocks are compressed in parallel.            */
+/*                                                                */
+/******************************************************************/
+
+#ifndef IGLU_BLOCK_COMPRESS_H
+#define IGLU_BLOCK_COMPRESS_H
+
+#include <stddef.h>
+
+namespace iglu {
+
+// The block formats the compressor can write.  Blocks cover 4x4 pixels;  images whose
+//    sizes aren't multiples of 4 get partial blocks along their right and bottom edges.
+enum IGLUBlockFormat {
+	IGLU_BLOCK_NONE = 0,     // Not compressed
+	IGLU_BLOCK_BC1,          // RGB, 8 bytes per block (DXT1).  RGBA images get 1-bit alpha (< 128 is transparent).
+	IGLU_BLOCK_BC3,          // RGBA, 16 bytes per block (DXT5)
+	IGLU_BLOCK_BC4,          // Red only, 8 bytes per block (RGTC1), e.g., for height maps
+	IGLU_BLOCK_BC5,          // Red & green, 16 bytes per block (RGTC2), e.g., for normal maps
+	IGLU_BLOCK_BC7           // RGBA, 16 bytes per block (BPTC).  Higher quality than BC1 or BC3.
+};
+
+class IGLUBlockCompressor
+{
+private:
+	IGLUBlockCompressor() {};
+	~IGLUBlockCompressor() {};
+
+public:
+	// Bytes in each 4x4 block, and in a whole compressed image
+	static size_t GetBlockBytes( IGLUBlockFormat format );
+	static size_t GetCompressedSize( IGLUBlockFormat format, int width, int height );
+
+	// The OpenGL internal format for data in this format (e.g., for glCompressedTexImage2D()),
+	//    given how many channels the uncompressed image had
+	static unsigned int GetGLFormat( IGLUBlockFormat format, int channels );
+
+	// Compresses a 3- or 4-channel image (rows top to bottom, tightly packed) into dst, which
+	//    must hold GetCompressedSize() bytes.  Uses up to numThreads threads (0 means one per
+	//    processor).  Returns false if the format or image is unusable.
+	static bool Compress( unsigned char *dst, const unsigned char *src, int width, int height, int channels,
+		                  IGLUBlockFormat format, int numThreads=0 );
+};
+
+// End namespace iglu
+}
+
+#endif
@@ -18,7 +18,8 @@ namespace iglu {
 class IGLUImage
 {
 public:
-	// Loads an image from a file
+	// Loads an image from a file (any format IGLUImageDecoder reads).  SGI images are
+	//    loaded as RGBA, others as RGB.
     IGLUImage( char *filename );
 
 	// Loads an image from a memory buffer.  The memory buffer is *not* copied.
@@ -51,11 +52,7 @@ protected:
 	unsigned int m_glFormat, m_glDatatype;
 	unsigned char *m_imgData;
 	bool m_freeMemory;
-
-	bool LoadPPM ( char *filename );
-	bool LoadRGB ( char *filename );
-	bool LoadBMP ( char *filename );
-	bool LoadJPEG( char *filename );
+	bool m_pooledMemory;   // m_imgData came from IGLUImageBufferPool (rather than malloc())
 };
 
 
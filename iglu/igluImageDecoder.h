@@ -0,0 +1,128 @@
+/******************************************************************/
+/* igluImageDecoder.h                                             */
+/* -----------------------                                        */
+/*                                                                */
+/* The common layer under IGLUImage's file readers.  Files are    */
+/*    read in place through IGLUFileSystem (i.e., memory mapped,  */
+/*    or from a mounted I/O provider), and every format decodes   */
+/*    straight into a destination buffer using the shared pixel   */
+/*    kernels in IGLUPixelOps (byte swizzles, row flips, and      */
+/*    gray/RGB to RGB/RGBA expansion, using SSE when available).  */
+/*                                                                */
+/* The destination is either a buffer the caller provides (e.g.,  */
+/*    a mapped pixel buffer object) or one from a pool of aligned */
+/*    buffers, so loading many images doesn't keep going back to  */
+/*    the heap for multi-megabyte blocks.                         */
+/*                                                                */
+/* Output pixels are 8-bit RGB or RGBA, in rows from the top of   */
+/*    the image down (unless bottomUp is requested), with no      */
+/*    padding between rows.                                       */
+/*                                                                */
+/******************************************************************/
+
+#ifndef IGLU_IMAGE_DECODER_H
+#define IGLU_IMAGE_DECODER_H
+
+#include <stddef.h>
+
+namespace iglu {
+
+// The image formats the decoder understands
+enum IGLUImageFormat {
+	IGLU_IMAGE_UNKNOWN = 0,
+	IGLU_IMAGE_PPM,              // .ppm, .pgm, .pbm (all 6 variants)
+	IGLU_IMAGE_RGB,              // .rgb, .rgba (SGI)
+	IGLU_IMAGE_BMP,              // .bmp (24-bit, uncompressed)
+	IGLU_IMAGE_JPEG              // .jpg, .jpeg
+};
+
+// What an image file contains
+struct IGLUImageInfo
+{
+	int             width, height;
+	int             channels;    // Channels the file naturally decodes to (3 = RGB, 4 = RGBA)
+	IGLUImageFormat format;
+};
+
+// Byte-level pixel conversions.  Where the source and destination may overlap, it says so.
+class IGLUPixelOps
+{
+private:
+	IGLUPixelOps() {};
+	~IGLUPixelOps() {};
+
+public:
+	// Swaps the first and third channels of numPixels 3- or 4-channel pixels (i.e., BGR <-> RGB
+	//    or BGRA <-> RGBA).  dst may equal src.
+	static void SwapRedBlue( unsigned char *dst, const unsigned char *src, size_t numPixels, int channels );
+
+	// RGB (or BGR, if swapRedBlue) to RGBA, with a constant alpha
+	static void ExpandRGBToRGBA( unsigned char *dst, const unsigned char *src, size_t numPixels,
+		                         unsigned char alpha=255, bool swapRedBlue=false );
+
+	// Gray to RGB (channels == 3) or RGBA (channels == 4, with a constant alpha)
+	static void ExpandGray( unsigned char *dst, const unsigned char *src, size_t numPixels, int channels,
+		                    unsigned char alpha=255 );
+
+	// Drops the alpha channel:  RGBA to RGB.  dst may equal src.
+	static void DropAlpha( unsigned char *dst, const unsigned char *src, size_t numPixels );
+
+	// Flips an image upside down (in place)
+	static void FlipRows( unsigned char *data, size_t rowBytes, int height );
+};
+
+// A pool of 64-byte aligned buffers for decoded images.  Buffers released to the pool are
+//    handed out again for later requests of similar size.  Thread safe.
+class IGLUImageBufferPool
+{
+private:
+	IGLUImageBufferPool() {};
+	~IGLUImageBufferPool() {};
+
+public:
+	// Gets a buffer with room for at least size bytes.  Returns NULL if out of memory.
+	static unsigned char *Acquire( size_t size );
+
+	// Returns a buffer from Acquire() to the pool (which frees it if the pool is full)
+	static void Release( unsigned char *buffer );
+
+	// How many bytes of unused buffers the pool may hold onto (default: 64 MB)
+	static void SetMaxPooledBytes( size_t maxBytes );
+
+	// Frees all the unused buffers
+	static void Trim( void );
+};
+
+class IGLUImageDecoder
+{
+private:
+	IGLUImageDecoder() {};
+	~IGLUImageDecoder() {};
+
+public:
+	// Finds a file's format from its extension (or, failing that, from the start of its data)
+	static IGLUImageFormat GetFormat( const char *filename, const unsigned char *data=0, size_t size=0 );
+
+	// Reads just enough of a file to describe it.  Returns false if the file can't be read.
+	static bool GetInfo( const char *filename, IGLUImageInfo *info );
+
+	// Decodes a file into the caller's buffer, which must hold dstSize >= width*height*channels
+	//    bytes.  channels is 3 or 4 (or 0 for the file's natural count, returned in info).
+	static bool Decode( const char *filename, unsigned char *dst, size_t dstSize, IGLUImageInfo *info,
+		                int channels=0, bool bottomUp=false );
+
+	// Decodes a file into a buffer from IGLUImageBufferPool.  Returns NULL if decoding fails;
+	//    otherwise, give the result back with IGLUImageBufferPool::Release() when done.
+	static unsigned char *Decode( const char *filename, IGLUImageInfo *info, int channels=0, bool bottomUp=false );
+
+	// As above, but for file contents already in memory (the filename is only used to
+	//    identify the format, and in error messages)
+	static bool GetInfo( const char *filename, const unsigned char *data, size_t size, IGLUImageInfo *info );
+	static bool Decode( const char *filename, const unsigned char *data, size_t size,
+		                unsigned char *dst, size_t dstSize, IGLUImageInfo *info, int channels=0, bool bottomUp=false );
+};
+
+// End namespace iglu
+}
+
+#endif
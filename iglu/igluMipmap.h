@@ -0,0 +1,113 @@
+/******************************************************************/
+/* igluMipmap.h                                                   */
+/* -----------------------                                        */
+/*                                                                */
+/* Builds texture mipmap chains on the CPU, rather than relying   */
+/*    on glGenerateMipmap().  This gives the same result on every */
+/*    driver, allows better filters than the usual 2x2 box, and   */
+/*    lets the chain be stored in a cache file so later runs can  */
+/*    upload it without filtering anything.                       */
+/*                                                                */
+/* Chains can also be block compressed (see igluBlockCompress.h), */
+/*    and are then uploaded with glCompressedTexImage2D() and     */
+/*    cached in their compressed form.                            */
+/*                                                                */
+/* Levels are filtered a band of rows at a time, in parallel, on  */
+/*    pixels converted to (linear) floats, using SSE to process   */
+/*    all four channels of a pixel at once.  With sRGB averaging  */
+/*    on, color channels are converted to linear light before     */
+/*    filtering and back afterwards (alpha is always linear).     */
+/*                                                                */
+/* Nothing here needs a GL context except Upload().               */
+/******************************************************************/
+
+#ifndef IGLU_MIPMAP_H
+#define IGLU_MIPMAP_H
+
+#include <stddef.h>
+#include <vector>
+#include "igluBlockCompress.h"
+
+namespace iglu {
+
+class IGLUFileData;
+
+// The filters available for reducing one level to the next
+enum IGLUMipFilter {
+	IGLU_MIP_BOX = 0,        // Average of 2x2 pixels (what glGenerateMipmap() usually does)
+	IGLU_MIP_KAISER,         // Kaiser-windowed sinc:  sharper, with little ringing
+	IGLU_MIP_LANCZOS         // Lanczos (3 lobes):  sharper still, may ring near hard edges
+};
+
+// One level of a chain.  Rows are tightly packed, top row first (as in IGLUImage).
+struct IGLUMipLevel
+{
+	int            width, height;
+	size_t         size;          // Bytes of data (compressed, if the chain is)
+	unsigned char *data;
+};
+
+class IGLUMipChain
+{
+public:
+	IGLUMipChain();
+	~IGLUMipChain();
+
+	// Builds the whole chain (down to 1x1) from a 3- or 4-channel, 8-bit image, which is
+	//    copied as level 0.  Edges are clamped, or wrapped around in x and/or y (e.g., for
+	//    repeating textures).  Uses up to numThreads threads (0 means one per processor).
+	bool Generate( const unsigned char *image, int width, int height, int channels,
+		           IGLUMipFilter filter=IGLU_MIP_BOX, bool sRGB=false, bool wrapX=false, bool wrapY=false,
+		           int numThreads=0 );
+
+	// Makes a chain with just level 0 (a copy of image), e.g., to compress a texture without mipmaps
+	bool SetBaseLevel( const unsigned char *image, int width, int height, int channels );
+
+	// Block compresses every level, replacing the uncompressed data.  Returns false (leaving
+	//    the chain as it was) if the chain is empty, already compressed, or out of memory.
+	bool Compress( IGLUBlockFormat format, int numThreads=0 );
+
+	// Reduces one level to the next (max( 1, width/2 ) by max( 1, height/2 )).  dst must hold
+	//    that many pixels, with the same number of channels as src.
+	static void Downsample( unsigned char *dst, const unsigned char *src, int width, int height, int channels,
+		                    IGLUMipFilter filter=IGLU_MIP_BOX, bool sRGB=false, bool wrapX=false, bool wrapY=false,
+		                    int numThreads=0 );
+
+	// Stores the chain in a cache file, tagged with the file the image came from (so the cache
+	//    goes stale when that changes) and an application-chosen options value (e.g., the filter
+	//    settings).  LoadCache() returns false if the cache is missing, stale, or built with
+	//    different options, leaving the chain empty.
+	bool SaveCache( const char *cacheFile, const char *srcFile, unsigned int options ) const;
+	bool LoadCache( const char *cacheFile, const char *srcFile, unsigned int options );
+
+	// Uploads every level to the currently bound texture (target is usually GL_TEXTURE_2D),
+	//    and limits the texture's max level to the chain's last level.  Compressed chains use
+	//    their block format's internal format (see IGLUBlockCompressor::GetGLFormat()) instead.
+	void Upload( unsigned int target, unsigned int internalFormat ) const;
+
+	// Forget all the levels
+	void Clear( void );
+
+	// Information about the chain
+	int                 GetLevelCount( void ) const     { return int( m_levels.size() ); }
+	const IGLUMipLevel &GetLevel( int level ) const     { return m_levels[level]; }
+	int                 GetChannels( void ) const       { return m_channels; }
+	IGLUBlockFormat     GetFormat( void ) const         { return m_format; }
+
+	// A pointer to a IGLUMipChain could have type IGLUMipChain::Ptr
+	typedef IGLUMipChain *Ptr;
+
+private:
+	std::vector<IGLUMipLevel> m_levels;
+	int                       m_channels;
+	IGLUBlockFormat           m_format;      // IGLU_BLOCK_NONE if the levels aren't compressed
+	IGLUFileData             *m_cacheData;   // If the levels came from a cache, its mapping (which they point into)
+
+	IGLUMipChain( const IGLUMipChain & );
+	IGLUMipChain &operator=( const IGLUMipChain & );
+};
+
+// End namespace iglu
+}
+
+#endif
@@ -11,8 +11,11 @@
 #define IGLU_MODELS_H
 
 #include "models/igluModel.h"
+#include "models/igluMeshOptimizer.h"
+#include "models/igluMeshSimplifier.h"
 #include "models/igluOBJReader.h"
 #include "models/igluOBJMaterial.h"
+#include "models/igluBVH.h"
 
 #endif
 
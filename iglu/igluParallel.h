@@ -0,0 +1,89 @@
+/************************************************************************/
+/* igluParallel.h                                                       */
+/* --------------                                                       */
+/*                                                                      */
+/* A very simple fork-join "parallel for" based on system-dependent OS  */
+/* thread calls.  The work is split into a number of independent items */
+/* (indexed 0..count-1) that are handed out to a set of threads; the    */
+/* call returns once every item has been processed.                     */
+/*                                                                      */
+/* Also includes the few other threading pieces IGLU needs:  starting   */
+/* and joining a long-running thread, and a (recursive) mutex.          */
+/*                                                                      */
+/* System specific info:                                                */
+/*     * Windows:  Uses Win32 threads;  should work out-of-the-box      */
+/*     * Linux/MacOS:  Uses pthreads.  Must link with the "pthread"     */
+/*                 library (i.e., add "-lpthread" when linking)         */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef __IGLU_PARALLEL_H__
+#define __IGLU_PARALLEL_H__
+
+namespace iglu {
+
+// The type of function executed by IGLUParallel::For().  It is called once for each
+//    item index, with the userData pointer passed to For().  Calls for different items
+//    may happen simultaneously on different threads, so they must be independent.
+typedef void (*IGLUParallelFunc)( int itemIdx, void *userData );
+
+// The type of function run by a thread started with IGLUParallel::StartThread()
+typedef void (*IGLUThreadFunc)( void *userData );
+
+class IGLUParallel
+{
+private:
+	IGLUParallel() {};
+	~IGLUParallel() {};
+
+public:
+	// How many processors (hardware threads) does this machine have?
+	static int GetProcessorCount( void );
+
+	// Calls func( i, userData ) for every i in [0..numItems-1], using up to numThreads
+	//    threads (including the calling thread).  A value of 0 means one thread per
+	//    processor.  Items are handed out dynamically, so they need not be equally sized.
+	static void For( int numItems, IGLUParallelFunc func, void *userData, int numThreads=0 );
+
+	// Starts a thread that calls func( userData ).  Returns a handle that must be passed to
+	//    JoinThread() (which waits for the thread to finish), or NULL if the thread couldn't start.
+	static void *StartThread( IGLUThreadFunc func, void *userData );
+	static void JoinThread( void *thread );
+};
+
+// A mutex.  It is recursive, so a thread that holds the lock may Lock() it again (as long
+//    as each Lock() is matched by an Unlock()).
+class IGLUMutex
+{
+public:
+	IGLUMutex();
+	~IGLUMutex();
+
+	void Lock( void );
+	void Unlock( void );
+
+private:
+	void *m_mutex;
+
+	IGLUMutex( const IGLUMutex & );
+	IGLUMutex &operator=( const IGLUMutex & );
+};
+
+// Holds a mutex locked until the end of the current scope
+class IGLUMutexLock
+{
+public:
+	IGLUMutexLock( IGLUMutex &mutex ) : m_mutex( mutex )  { m_mutex.Lock(); }
+	~IGLUMutexLock()                                      { m_mutex.Unlock(); }
+
+private:
+	IGLUMutex &m_mutex;
+
+	IGLUMutexLock( const IGLUMutexLock & );
+	IGLUMutexLock &operator=( const IGLUMutexLock & );
+};
+
+}
+
+#endif
+
@@ -11,7 +11,11 @@
 #define IGLU_PARSING_UTILS_H
 
 #include "parsing/igluTextParsing.h"
+#include "parsing/igluFileData.h"
+#include "parsing/igluMappedFile.h"
+#include "parsing/igluFileSystem.h"
 #include "parsing/igluFileParser.h"
+#include "parsing/igluStringTable.h"
 
 #endif
 
@@ -167,10 +167,26 @@ enum {
 	IGLU_IMAGE_READ 		   = 0x400000,
 	IGLU_IMAGE_WRITE           = 0x800000,
 	IGLU_IMAGE_READ_WRITE	   = IGLU_IMAGE_READ | IGLU_IMAGE_WRITE,
+	IGLU_MIPMAP_CPU            = 0x01000000,  // With a mipmapped min filter:  build the levels on the CPU (box filter), not with glGenerateMipmap()
+	IGLU_MIPMAP_KAISER         = 0x02000000,  //    ... using a Kaiser filter instead (implies IGLU_MIPMAP_CPU)
+	IGLU_MIPMAP_LANCZOS        = 0x04000000,  //    ... using a Lanczos filter instead (implies IGLU_MIPMAP_CPU)
+	IGLU_MIPMAP_SRGB           = 0x08000000,  //    ... averaging sRGB colors in linear light (implies IGLU_MIPMAP_CPU)
+	IGLU_MIPMAP_CACHE          = 0x10000000,  //    ... keeping the levels in <image>.iglumip for next time (implies IGLU_MIPMAP_CPU)
+	IGLU_MIPMAP_CPU_FLAGS      = IGLU_MIPMAP_CPU | IGLU_MIPMAP_KAISER | IGLU_MIPMAP_LANCZOS | IGLU_MIPMAP_SRGB | IGLU_MIPMAP_CACHE,
 	IGLU_TEXTURE_DEFAULT       = IGLU_COMPRESS_TEXTURE | IGLU_MIN_LINEAR | IGLU_MAG_LINEAR | IGLU_CLAMP_TO_EDGE_S | IGLU_CLAMP_TO_EDGE_T,
 	IGLU_TEXTURE_REPEAT      =  IGLU_COMPRESS_TEXTURE | IGLU_MIN_LINEAR | IGLU_MAG_LINEAR | IGLU_REPEAT_S | IGLU_REPEAT_T
 };
 
+// Block compression on the CPU (instead of IGLU_COMPRESS_TEXTURE), cached in <image>.iglumip.
+//    These are values of a 3-bit field in the top bits of the flags, not separate flags.  (They
+//    don't fit in an int, so they can't go in the enum above.)
+static const unsigned int IGLU_COMPRESS_BC1     = 0x20000000u;  // BC1 / DXT1
+static const unsigned int IGLU_COMPRESS_BC3     = 0x40000000u;  // BC3 / DXT5 (RGBA)
+static const unsigned int IGLU_COMPRESS_BC4     = 0x60000000u;  // BC4 / RGTC1 (red only)
+static const unsigned int IGLU_COMPRESS_BC5     = 0x80000000u;  // BC5 / RGTC2 (red & green, e.g., normal maps)
+static const unsigned int IGLU_COMPRESS_BC7     = 0xA0000000u;  // BC7 / BPTC (RGBA, best quality)
+static const unsigned int IGLU_COMPRESS_BC_MASK = 0xE0000000u;
+
 // End namespace iglu
 }
 
@@ -19,6 +19,7 @@
 #include <GL/glut.h>
 #include "igluTexture.h"
 #include "igluImage.h"
+#include "igluMipmap.h"
 
 namespace iglu {
 
@@ -34,6 +35,10 @@ public:
 	IGLUTexture2D( unsigned char *image, int width, int height, bool freeMemory=false,
 		           unsigned int flags = IGLU_TEXTURE_DEFAULT, bool initializeImmediately=true );
 	IGLUTexture2D( int builtInTexID, unsigned int flags = IGLU_TEXTURE_DEFAULT, bool initializeImmediately=true );
+
+	// Creates a texture from an image that has already been loaded (e.g., decoded on a worker
+	//    thread).  The texture takes ownership of the image.  The filename is only informational.
+	IGLUTexture2D( IGLUImage *image, char *filename, unsigned int flags = IGLU_TEXTURE_DEFAULT, bool initializeImmediately=true );
     virtual ~IGLUTexture2D();
 
 	// Initialize() must be called after an OpenGL context has been created.
@@ -55,6 +60,12 @@ public:
 	// Set/update the texture parameters for this texture
 	virtual void SetTextureParameters( unsigned int flags );
 
+	// With the IGLU_MIPMAP_* or IGLU_COMPRESS_BC* flags, builds (and compresses) the levels on
+	//    the CPU, or loads them from the cache, now rather than in Initialize().  This doesn't
+	//    touch OpenGL, so it can be called on a worker thread for a texture created with
+	//    initializeImmediately=false.
+	void PrepareMipmaps( void );
+
 	// This reads from a texture image.  Types are pretty basic. 
 	//   --> If you need more complex types, you might want to overload IGLUTexture yourself!
 	virtual GLenum GetTextureFormat( void ) const       { return ( m_pixelFormat == GL_RGBA ? GL_RGBA8 : GL_RGB8 ); }
@@ -74,6 +85,14 @@ protected:
 	GLenum m_pixelFormat;
 
 	bool m_mipmapsNeeded;
+
+	// CPU-built mipmaps (see igluMipmap.h), used instead of glGenerateMipmap() if any
+	//    of the IGLU_MIPMAP_* flags are set, or if the texture is block compressed
+	unsigned int  m_mipFlags;
+	IGLUMipChain *m_mipChain;
+
+	// Which block format (if any) the IGLU_COMPRESS_BC* flags ask for
+	static IGLUBlockFormat GetBlockFormat( unsigned int flags );
 };
 
 
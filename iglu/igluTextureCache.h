@@ -0,0 +1,84 @@
+/******************************************************************/
+/* igluTextureCache.h                                             */
+/* -----------------------                                        */
+/*                                                                */
+/* A global cache of 2D textures loaded from files, so an image   */
+/*    used by many materials (or by several models sharing one    */
+/*    texture directory) is only decoded and stored on the GPU    */
+/*    once.                                                       */
+/*                                                                */
+/* Textures are found by canonical path (so "a/../tex.jpg" and    */
+/*    "tex.jpg" match) and by the flags used to create them.  If  */
+/*    content hashing is enabled, files at different paths with   */
+/*    identical contents also share a texture.                    */
+/*                                                                */
+/* The cache does not own the textures; cached textures should    */
+/*    live until the cache is cleared.                            */
+/*                                                                */
+/******************************************************************/
+
+#ifndef IGLU_TEXTURE_CACHE_H
+#define IGLU_TEXTURE_CACHE_H
+
+#include <stddef.h>
+#include "igluTexture2D.h"
+
+namespace iglu {
+
+// Counts of how well the cache has worked
+struct IGLUTextureCacheStats
+{
+	unsigned int hits;           // Lookups that found a texture with the same path
+	unsigned int contentHits;    // Lookups that found a texture with a different path, but the same contents
+	unsigned int misses;         // Lookups that found nothing (so the caller loaded the texture)
+	unsigned int textures;       // Textures in the cache
+	size_t       bytesSaved;     // Texture memory that hits avoided allocating (uncompressed size)
+};
+
+class IGLUTextureCache
+{
+private:
+	IGLUTextureCache() {};
+	~IGLUTextureCache() {};
+
+public:
+	// Returns the cached texture for this file (created with these flags), or NULL if there
+	//    is none.  Misses are expected to be followed by Add()ing the texture once it is loaded.
+	static IGLUTexture2D *Find( const char *filename, unsigned int flags=IGLU_TEXTURE_DEFAULT );
+
+	// Like Find(), but only matches by path, and doesn't count towards the statistics (e.g., to
+	//    check again for a texture someone else may have added since a Find() missed)
+	static IGLUTexture2D *FindByPath( const char *filename, unsigned int flags=IGLU_TEXTURE_DEFAULT );
+
+	// Adds a texture created from the specified file (with the specified flags)
+	static void Add( const char *filename, IGLUTexture2D *tex, unsigned int flags=IGLU_TEXTURE_DEFAULT );
+
+	// Returns the cached texture for this file, loading it (and adding it) if needed
+	static IGLUTexture2D *Load( char *filename, unsigned int flags=IGLU_TEXTURE_DEFAULT );
+
+	// Should files that miss by path be hashed, to see if they match a cached file's contents?
+	//    (Off by default.  This requires reading each file once more.)
+	static void SetContentHashing( bool enable )          { s_hashContents = enable; }
+
+	// Converts a filename to the form the cache uses to compare paths.  The result
+	//    needs room for at least 1024 characters.
+	static void GetCanonicalPath( char *result, const char *filename );
+
+	// Forget all the cached textures (without deleting them)
+	static void Clear( void );
+
+	// Statistics about cache use
+	static const IGLUTextureCacheStats &GetStats( void )  { return s_stats; }
+	static void ResetStats( void );
+	static void PrintStats( void );
+
+private:
+	static bool                  s_hashContents;
+	static IGLUTextureCacheStats s_stats;
+};
+
+// End namespace iglu
+}
+
+#endif
+
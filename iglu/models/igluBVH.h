@@ -0,0 +1,142 @@
+/******************************************************************/
+/* igluBVH.h                                                      */
+/* -----------------------                                        */
+/*                                                                */
+/* A CPU-side bounding volume hierarchy over a triangle mesh, for */
+/*    mouse picking, visibility rays, and other ray queries that  */
+/*    don't need the GPU.                                         */
+/*                                                                */
+/* The tree is built with the surface area heuristic (SAH), using */
+/*    binned splits, on multiple threads.  It is stored as a      */
+/*    4-wide tree whose child bounds are laid out so that a ray   */
+/*    can be tested against all four children at once with SSE.  */
+/*                                                                */
+/* When vertices move (but the triangles stay the same), Refit()  */
+/*    updates the bounds without rebuilding.  This is cheap, but  */
+/*    the tree gets slower to traverse if vertices move a lot     */
+/*    relative to each other.  (For rigid motion, transforming    */
+/*    the rays into the model's space is better still.)           */
+/*                                                                */
+/* Nothing here uses OpenGL.                                      */
+/******************************************************************/
+
+#ifndef IGLU_BVH_H
+#define IGLU_BVH_H
+
+#include <float.h>
+#include <vector>
+
+namespace iglu {
+
+class IGLUOBJReader;
+class IGLUMatrix4x4;
+
+// The triangle ID in a IGLURayHit that didn't hit anything
+#define IGLU_BVH_NO_HIT   0xFFFFFFFFu
+
+// A ray.  Only hits with tMin < t < tMax count.  The direction need not be normalized
+//    (t is measured in multiples of it).
+struct IGLURay
+{
+	float origin[3],    tMin;
+	float direction[3], tMax;
+
+	IGLURay() {}
+	IGLURay( const vec3 &org, const vec3 &dir, float minT=0.0f, float maxT=FLT_MAX ) : tMin( minT ), tMax( maxT )
+	{
+		origin[0]    = org.X(); origin[1]    = org.Y(); origin[2]    = org.Z();
+		direction[0] = dir.X(); direction[1] = dir.Y(); direction[2] = dir.Z();
+	}
+};
+
+// Where a ray hit.  The hit point is (1-u-v)*v0 + u*v1 + v*v2 for the triangle's vertices.
+struct IGLURayHit
+{
+	float t, u, v;
+	uint  triID;          // The triangle's index, as given to Build(), or IGLU_BVH_NO_HIT
+};
+
+// A node of the 4-wide tree.  The bounds are stored as structures of arrays (e.g.,
+//    bounds[0] is the minimum x of all four children), so one SSE instruction
+//    handles one slab of all four boxes.  Unused child slots have empty (inverted) bounds.
+struct IGLUBVHNode
+{
+	float bounds[6][4];   // Min x, y, z, then max x, y, z, of each child
+	uint  child[4];       // Inner child:  its node's index.  Leaf:  its first triangle (in the BVH's order)
+	uint  count[4];       // Leaf:  its number of triangles.  Inner child or unused slot:  0
+};
+
+class IGLUBVH
+{
+public:
+	IGLUBVH();
+	~IGLUBVH();
+
+	// Builds the tree over numTris triangles.  Triangle i uses vertices indices[3*i+0..2],
+	//    each of which must be less than numVerts.  Vertices are (x,y,z) floats every
+	//    posStride bytes.  The positions are copied, so they can go away after this returns.
+	//    Uses up to numThreads threads (0 means one per processor).
+	void Build( const float *positions, uint posStride, uint numVerts,
+		        const uint *indices, uint numTris, int numThreads=0 );
+
+	// Builds the tree over an OBJ model's GetTriangles(), so hit triangle IDs index that
+	//    array.  Fails (returns false) if the model has no triangle data, e.g., because it
+	//    was loaded from a cache.
+	bool Build( IGLUOBJReader *model, int numThreads=0 );
+
+	// Moves the vertices to new positions (same count and stride as in Build()), and
+	//    updates the bounds to match.
+	void Refit( const float *positions, uint posStride );
+
+	// Transforms the vertices (as last given to Build() or Refit()) by a matrix, and
+	//    updates the bounds to match.
+	void Refit( const IGLUMatrix4x4 &xform );
+
+	// Finds the closest hit along a ray.  Returns false (and hit->triID is IGLU_BVH_NO_HIT)
+	//    if there is none.
+	bool IntersectClosest( const IGLURay &ray, IGLURayHit *hit ) const;
+
+	// Does the ray hit anything at all?  (Faster than IntersectClosest(), e.g., for shadow
+	//    or visibility rays.)
+	bool IntersectAny( const IGLURay &ray ) const;
+
+	// The same queries for many rays, spread over up to numThreads threads (0 means one per processor)
+	void IntersectClosest( const IGLURay *rays, IGLURayHit *hits, uint numRays, int numThreads=0 ) const;
+	void IntersectAny( const IGLURay *rays, bool *occluded, uint numRays, int numThreads=0 ) const;
+
+	// Get rid of the tree
+	void Clear( void );
+
+	// Information about the tree
+	bool IsBuilt( void ) const                            { return !m_nodes.empty(); }
+	uint GetTriangleCount( void ) const                   { return uint( m_triIDs.size() ); }
+	uint GetNodeCount( void ) const                       { return uint( m_nodes.size() ); }
+	const std::vector<IGLUBVHNode> &GetNodes( void ) const  { return m_nodes; }
+	void GetBounds( float bMin[3], float bMax[3] ) const;
+
+	// Checks that every node's bounds contain its children's bounds and triangles.  (For
+	//    testing;  returns false and prints a warning if not.)
+	bool Validate( void ) const;
+
+	// A pointer to a IGLUBVH could have type IGLUBVH::Ptr
+	typedef IGLUBVH *Ptr;
+
+private:
+	std::vector<IGLUBVHNode> m_nodes;      // m_nodes[0] is the root;  children come after their parents
+	std::vector<uint>        m_triIDs;     // Original triangle IDs, in the order leaves refer to them
+	std::vector<uint>        m_triIndices; // Vertex indices of each triangle, in the same order
+	std::vector<float>       m_triVerts;   // 9 floats per triangle (three vertex positions), in the same order
+	std::vector<float>       m_positions;  // The vertex positions given to Build()/Refit(), 3 floats each
+
+	// Copies (possibly transformed) vertex positions into m_triVerts, then recomputes the bounds
+	void UpdateTriangleVerts( const IGLUMatrix4x4 *xform );
+	void RefitNodes( void );
+
+	IGLUBVH( const IGLUBVH & );
+	IGLUBVH &operator=( const IGLUBVH & );
+};
+
+// End namespace iglu
+}
+
+#endif
@@ -0,0 +1,104 @@
+/******************************************************************/
+/* igluMeshOptimizer.h                                            */
+/* -----------------------                                        */
+/*                                                                */
+/* A set of CPU-side utilities for reordering indexed triangle    */
+/*    meshes so they render faster on the GPU.  The triangle      */
+/*    order is improved for the post-transform vertex cache using */
+/*    Sander et al.'s "Tipsify" algorithm (optionally followed by */
+/*    their overdraw-reducing cluster sort), and vertices are     */
+/*    then renumbered in the order they are first used so vertex  */
+/*    fetches walk linearly through memory.                       */
+/*                                                                */
+/* Triangles can also be partitioned into small clusters (i.e.,   */
+/*    "meshlets") with bounds suitable for culling.               */
+/*                                                                */
+/* All of these work on a plain GL_TRIANGLES index list, so they  */
+/*    (and their statistics) can be used without an OpenGL        */
+/*    context.                                                    */
+/******************************************************************/
+
+#ifndef IGLU_MESH_OPTIMIZER_H
+#define IGLU_MESH_OPTIMIZER_H
+
+#include <vector>
+
+namespace iglu {
+
+// The FIFO cache size we optimize for (and simulate) unless told otherwise.  Most
+//    hardware has at least this many post-transform cache entries.
+#define IGLU_VERTEX_CACHE_SIZE   16
+
+// Statistics from simulating a FIFO post-transform vertex cache over an index list.
+//    ACMR (average cache miss ratio) is the number of vertices transformed per triangle,
+//    ranging from 3.0 (no reuse) to about 0.5 (a perfect regular grid).  ATVR (average
+//    transformed vertex ratio) is the number transformed per unique vertex, where 1.0
+//    is optimal.
+struct IGLUVertexCacheStats
+{
+	uint  numTris, numVerts, numTransformed;
+	float acmr, atvr;
+};
+
+// A cluster ("meshlet") of up to a few hundred spatially coherent triangles, stored 
+//    contiguously in an element array.  The layout is four vec4s, so arrays of clusters
+//    can be read directly on the GPU (e.g., from a GL_RGBA32F texture buffer, using 
+//    floatBitsToUint() on firstIndex and indexCount).
+//
+// A cluster faces entirely away from a viewer at eye (and can be backface culled) if:
+//    dot( sphereCenter - eye, coneAxis ) >= coneCutoff * length( sphereCenter - eye ) + sphereRadius
+//    Clusters whose triangles face too many directions have coneCutoff = 1 (never culled).
+struct IGLUMeshCluster
+{
+	float aabbMin[3];        uint  firstIndex;    // First index (not byte offset) in the element array
+	float aabbMax[3];        uint  indexCount;    // Number of indices (3 per triangle)
+	float sphereCenter[3];   float sphereRadius;
+	float coneAxis[3];       float coneCutoff;    // sin() of the cone's half angle
+};
+
+class IGLUMeshOptimizer
+{
+private:
+	IGLUMeshOptimizer() {};
+	~IGLUMeshOptimizer() {};
+
+public:
+	// Reorders the triangles in indices[0..numIndices-1] (which reference vertices
+	//    0..numVerts-1) for better post-transform vertex cache use.  If positions is
+	//    non-NULL (x,y,z floats every posStride bytes), the triangles are also grouped
+	//    into clusters that are sorted to reduce overdraw.  overdrawThreshold (>= 1)
+	//    trades cache efficiency for more (smaller) clusters; values near 1 keep the
+	//    vertex cache behavior almost unchanged.
+	static void OptimizeVertexCache( uint *indices, uint numIndices, uint numVerts,
+		                             uint cacheSize=IGLU_VERTEX_CACHE_SIZE,
+									 const float *positions=0, uint posStride=3*sizeof(float),
+									 float overdrawThreshold=1.05f );
+
+	// Renumbers the vertices in the order they are first referenced by indices[] and
+	//    rewrites the indices to match.  On return, remap[oldVertID] is the new ID of each
+	//    vertex (or 0xFFFFFFFF if unused).  Returns the number of vertices used.
+	static uint OptimizeVertexFetch( uint *indices, uint numIndices, uint numVerts, uint *remap );
+
+	// As above, but also moves the vertex data (numVerts vertices, each vertStride bytes) to
+	//    match the new numbering.  Unused vertices are dropped from the end of the array.
+	static uint OptimizeVertexFetch( uint *indices, uint numIndices, void *vertData,
+		                             uint numVerts, uint vertStride );
+
+	// Partitions the triangles into clusters of at most maxTris triangles, grown greedily
+	//    across shared vertices (starting from triangles in their current order), and rewrites
+	//    indices[] so each cluster is contiguous.  Computes each cluster's bounds from the
+	//    positions (x,y,z floats every posStride bytes).  Returns the number of clusters.
+	static uint BuildClusters( uint *indices, uint numIndices, uint numVerts,
+		                       const float *positions, uint posStride, uint maxTris,
+							   std::vector<IGLUMeshCluster> &clusters );
+
+	// Simulates a FIFO post-transform cache of the given size over the index list
+	static IGLUVertexCacheStats AnalyzeVertexCache( const uint *indices, uint numIndices, uint numVerts,
+		                                            uint cacheSize=IGLU_VERTEX_CACHE_SIZE );
+};
+
+// End iglu namespace
+}
+
+#endif
+
@@ -0,0 +1,50 @@
+/******************************************************************/
+/* igluMeshSimplifier.h                                           */
+/* -----------------------                                        */
+/*                                                                */
+/* Simplifies indexed triangle meshes on the CPU by collapsing    */
+/*    edges in order of their quadric error (Garland & Heckbert,  */
+/*    "Surface Simplification Using Quadric Error Metrics,"       */
+/*    SIGGRAPH 1997).                                             */
+/*                                                                */
+/* Vertices are only ever collapsed onto other existing vertices, */
+/*    so the simplified index lists reference the same vertex     */
+/*    array as the original (i.e., all levels of detail can share */
+/*    one vertex buffer).                                         */
+/*                                                                */
+/* Vertices that share a position but not other attributes (e.g., */
+/*    along texture or material seams) are kept together:  they   */
+/*    only move along the seam, and all copies move at once.      */
+/*    Open mesh borders only move along the border, and vertices  */
+/*    where more complex seams/borders meet never move.           */
+/******************************************************************/
+
+#ifndef IGLU_MESH_SIMPLIFIER_H
+#define IGLU_MESH_SIMPLIFIER_H
+
+namespace iglu {
+
+class IGLUMeshSimplifier
+{
+private:
+	IGLUMeshSimplifier() {};
+	~IGLUMeshSimplifier() {};
+
+public:
+	// Simplifies the GL_TRIANGLES list indices[0..numIndices-1] (referencing vertices whose
+	//    x,y,z positions are every posStride bytes in positions[]) until it has no more than
+	//    targetIndexCount indices, or until further collapses would cause more than maxError
+	//    error.  Errors are relative to the size of the mesh (i.e., 0.01 is 1% of the largest
+	//    bounding box dimension).  The result goes in outIndices (which needs room for
+	//    numIndices values, and may be the same as indices).  Returns the new index count,
+	//    and (if resultError is non-NULL) the relative error of the result.
+	static uint Simplify( uint *outIndices, const uint *indices, uint numIndices,
+		                  const float *positions, uint posStride, uint numVerts,
+						  uint targetIndexCount, float maxError=1.0f, float *resultError=0 );
+};
+
+// End iglu namespace
+}
+
+#endif
+
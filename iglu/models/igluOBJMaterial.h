@@ -35,11 +35,22 @@ public:
 };
 void InitializeMaterial( IGLUOBJMaterial *mtl );
 void AddDefaultMaterial( void );
+
+// Returns a shared copy of a material name (which lives as long as the program does), so
+//    materials don't each need their own copy of the same name.
+char *InternMaterialName( const char *name );
+
+// Finds a texture in IGLUTextureCache (loading and adding it if it isn't there), and returns
+//    its index in IGLUOBJMaterialReader::s_matlTexture.  Needs the GL context.
+int AddMaterialTexture( char *filename );
 class IGLUOBJMaterialReader : public IGLUFileParser
 {
 public:
-	// Read & create a bunch of materials from a .mtl file
-	IGLUOBJMaterialReader( char *filename );
+	// Read & create a bunch of materials from a .mtl file.  If deferTextures is true, this
+	//    makes no OpenGL calls (so it can run on a worker thread);  the textures are decoded,
+	//    but not created until UploadPendingTextures() is called on the GL thread.  Material
+	//    files may be read from several threads at once.
+	IGLUOBJMaterialReader( char *filename, bool deferTextures=false );
 
 	// Arrays storing lists of textures & materials used by all OBJ materials loaded thus far.
 	//    These values are set during the constructor IGLUOBJMaterialReader().  Each new object
@@ -59,8 +70,17 @@ public:
 	// should be called, to create the textures that are used in IGLU shaders
 	//////////////////////////////////////////////////////////////////////////
 	//modified by sunf, handle different texture format(repeat for sponza model)
+	//    (This may be called again as more materials are loaded, e.g., by IGLUOBJLoadJob.)
 	static bool FinalizeMaterialsForRendering( GLuint TextureFormat = IGLU_TEXTURE_DEFAULT );
 
+	//////////////////////////////////////////////////////////////////////////
+	// Textures from material files read with deferTextures wait here until
+	// the GL thread creates them (at most maxTextures, or all if negative).
+	// Returns how many were created.
+	//////////////////////////////////////////////////////////////////////////
+	static int UploadPendingTextures( int maxTextures=-1 );
+	static int GetPendingTextureCount( void );
+
 	//////////////////////////////////////////////////////////////////////////
 	// After calling the FinalizeMaterialsForRendering() method, the following
 	// data can be accessed.
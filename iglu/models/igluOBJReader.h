@@ -29,40 +29,234 @@ add glm construction fuction, code from Nate Robins, 1997
 #include "glmModel.h"
 #include <vector>
 namespace iglu {
+
+struct IGLUOBJTri;
+class  IGLUOBJTriRef;
+
+// The triangles read from an OBJ file, stored as a structure of arrays.  The vertex, normal,
+//    and texture indices have 3 entries per triangle (i.e., vIdx[3*tri+k]), everything else
+//    has one.  Material, group, and object names are interned in a string table, and each 
+//    triangle refers to them by ID (ID 0 means the triangle had no name).
+struct IGLUOBJTriArray
+{
+	std::vector<int>    vIdx, nIdx, tIdx;
+	std::vector<int>    matlID, objectID;
+	std::vector<uint>   mtlNameID, grpNameID, objNameID;
+	IGLUStringTable     names;
+
+	// How many triangles are there?  (Named to match the std::vector this replaced)
+	uint size( void ) const                             { return uint( matlID.size() ); }
+
+	// Change the number of triangles.  New triangles have all their indices set to -1.
+	void Resize( uint numTris );
+	void Reserve( uint numTris );
+
+	// Add a triangle (with all indices -1), returning its index
+	uint Add( int matl, int object, uint mtlName, uint grpName, uint objName );
+
+	// Add a name to the name table (if it's not already there), returning its ID.  Look names up by ID.
+	uint AddName( const char *name )                    { return names.Add( name ); }
+	const char *GetName( uint nameID ) const            { return names.GetString( nameID ); }
+
+	// Access a single triangle.  This returns a pointer-like object, so code written for
+	//    the old std::vector<IGLUOBJTri *> (e.g., tris[i]->vIdx[0]) still works.
+	IGLUOBJTriRef operator[]( uint tri );
+};
+
+// A view of one triangle in an IGLUOBJTriArray.  The indices, material, and object IDs
+//    refer directly to the data in the array (so they may be changed); the names point into the array's name table.
 struct IGLUOBJTri
 {
-	IGLUOBJTri(char *m, char *g, char*o) : mtlName(m), grpName(g), objName(o) {}
-	int vIdx[3], nIdx[3], tIdx[3], matlID, objectID;
-	char *mtlName, *grpName, *objName;
+	IGLUOBJTri( IGLUOBJTriArray &arr, uint tri ) : 
+		vIdx( &arr.vIdx[3*tri] ), nIdx( &arr.nIdx[3*tri] ), tIdx( &arr.tIdx[3*tri] ),
+		matlID( arr.matlID[tri] ), objectID( arr.objectID[tri] ), 
+		mtlName( arr.GetName( arr.mtlNameID[tri] ) ), grpName( arr.GetName( arr.grpNameID[tri] ) ),
+		objName( arr.GetName( arr.objNameID[tri] ) ) {}
+	int *vIdx, *nIdx, *tIdx, &matlID, &objectID;
+	const char *mtlName, *grpName, *objName;
 };
+
+class IGLUOBJTriRef
+{
+public:
+	IGLUOBJTriRef( IGLUOBJTriArray &arr, uint tri ) : m_tri( arr, tri ) {}
+	IGLUOBJTri *operator->()                            { return &m_tri; }
+	IGLUOBJTri &operator*()                             { return m_tri; }
+private:
+	IGLUOBJTri m_tri;
+};
+
+inline IGLUOBJTriRef IGLUOBJTriArray::operator[]( uint tri )  { return IGLUOBJTriRef( *this, tri ); }
+
 enum IGLUModelParams {
 	IGLU_OBJ_DEFAULT_STATE      = 0x0000,
 	IGLU_OBJ_CENTER             = 0x0001,  // Recenter model around the origin
 	IGLU_OBJ_UNITIZE            = 0x0002,  // Resize model so it ranges from [-1..1]
 	IGLU_OBJ_COMPACT_STORAGE    = 0x0004,  // Attempt to reuse vertices shared between triangles
 	IGLU_OBJ_NO_MATERIALS       = 0x0008,  // Do no load an .mtl file.
-	IGLU_OBJ_NO_OBJECTS			= 0x000F
+	IGLU_OBJ_NO_OBJECTS			= 0x000F,
+	IGLU_OBJ_MEMORY_MAPPED      = 0x0010,  // Map the file into memory and parse it in place (faster for big files)
+	IGLU_OBJ_PARALLEL_PARSE     = 0x0020,  // Memory map the file and parse it using all processors (implies MEMORY_MAPPED)
+	IGLU_OBJ_USE_CACHE          = 0x0040,  // Load GPU buffers from a binary cache next to the OBJ (<file>.iglucache), 
+	                                       //    or create the cache if it's missing or out of date.
+	IGLU_OBJ_OPTIMIZE           = 0x0080,  // Reorder triangles for the vertex cache & vertices for fetch locality (implies COMPACT_STORAGE)
+	IGLU_OBJ_OPTIMIZE_OVERDRAW  = 0x0100,  // As IGLU_OBJ_OPTIMIZE, but also sort triangle clusters to reduce overdraw
+
+	// Compact vertex encodings.  Those marked (*) need shader changes to decode;  the rest are
+	//    converted back to floats by OpenGL, so existing shaders work unchanged.
+	IGLU_OBJ_HALF_POSITIONS     = 0x0200,  // Positions stored as 16-bit floats
+	IGLU_OBJ_UNORM16_POSITIONS  = 0x0400,  // (*) Positions stored as 16-bit fixed point in the bounding box (see GetPositionDequantization())
+	IGLU_OBJ_OCT_NORMALS        = 0x0800,  // (*) Normals stored as two 16-bit octahedral coordinates (see below)
+	IGLU_OBJ_HALF_TEXCOORDS     = 0x1000,  // Texture coordinates stored as 16-bit floats
+	IGLU_OBJ_INTEGER_IDS        = 0x2000,  // Material & object IDs stored as 16-bit (or if needed, 32-bit) integers
+	IGLU_OBJ_SHORT_INDICES      = 0x4000,  // Use 16-bit indices if there are few enough vertices
+	IGLU_OBJ_PACKED_VERTICES    = 0x7200,  // All of the encodings above that work with unmodified shaders
+
+	IGLU_OBJ_CLUSTERS           = 0x8000,  // Group triangles into contiguous clusters with culling bounds (implies COMPACT_STORAGE)
+	IGLU_OBJ_LODS               = 0x10000, // Build simplified levels of detail sharing our vertex array (implies COMPACT_STORAGE)
+	IGLU_OBJ_STREAMING          = 0x20000, // Read the file in batches with bounded memory (see IGLUOBJBatch).  Implies MEMORY_MAPPED;
+	                                       //    ignores COMPACT_STORAGE, OPTIMIZE*, USE_CACHE, packing, CLUSTERS & LODS.
+	IGLU_OBJ_DEFER_UPLOAD       = 0x40000, // Make no OpenGL calls in the constructor (so it can run on a worker thread);
+	                                       //    call UploadToGPU() on the GL thread before drawing.  Material textures
+	                                       //    wait for IGLUOBJMaterialReader::UploadPendingTextures().  Ignored with STREAMING.
+	IGLU_OBJ_DRAW_RANGES        = 0x80000  // Sort triangles by material & object into contiguous ranges that can be drawn
+	                                       //    separately (see IGLUOBJDrawRange).  Ignored with STREAMING.
 };
 
+// The maximum number of triangles in each cluster created by IGLU_OBJ_CLUSTERS
+#define IGLU_OBJ_CLUSTER_TRIANGLES   128
 
-struct IGLUOBJTri;
+// The most levels of detail (including the full model) built by IGLU_OBJ_LODS.  Each level
+//    has about half the triangles of the one before.
+#define IGLU_OBJ_LOD_LEVELS          5
+
+// One level of detail in our element array:  it covers indices [firstIndex, firstIndex+indexCount).
+//    error is how far (at most, roughly) it strays from the full model, as a fraction of the
+//    model's largest bounding box dimension.
+struct IGLUOBJLod
+{
+	uint  firstIndex, indexCount;
+	float error;
+};
+
+// With IGLU_OBJ_DRAW_RANGES, the triangles of LOD 0 are sorted by material, then object, and
+//    each run of triangles sharing both is a range covering indices [firstIndex, firstIndex+indexCount)
+//    of the element array.  (Clusters never straddle two ranges;  coarser LODs are not split up.)
+struct IGLUOBJDrawRange
+{
+	uint  matlID, objectID;
+	uint  firstIndex, indexCount;
+};
+
+// The most triangles in each batch read by IGLU_OBJ_STREAMING
+#define IGLU_OBJ_STREAM_BATCH_TRIANGLES  65536
+
+// With IGLU_OBJ_STREAMING, the file is read in batches of up to IGLU_OBJ_STREAM_BATCH_TRIANGLES
+//    triangles (in file order), each with its own vertices (in the same interleaved float layout
+//    as our usual vertex array) and indices into them.  Add firstVert to the indices to get
+//    indices into all the batches' vertices, one after another.  Batches are either uploaded
+//    one at a time into our vertex array (with SetVertexArraySubset()), or, if a callback is 
+//    given to the constructor, passed to it and then thrown away.
+struct IGLUOBJBatch
+{
+	const float *verts;                  // numVerts vertices, each stride bytes
+	const uint  *indices;                // 3*numTris indices into verts
+	uint  numVerts, numTris;
+	uint  firstVert, firstTri;           // How many vertices & triangles came in earlier batches
+	uint  stride, vertOff, normOff, texOff, matlIdOff, objectIdOff;  // Vertex layout, in bytes (normOff/texOff are 0 if absent)
+};
+typedef void (*IGLUOBJBatchCallback)( const IGLUOBJBatch &batch, void *userData );
+
+// With IGLU_OBJ_OCT_NORMALS, the (signed, normalized) 2-component normal attribute 'e' is 
+//    decoded in GLSL as:
+//        vec3 n = vec3( e.xy, 1.0 - abs(e.x) - abs(e.y) );
+//        if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+//        n = normalize( n );
+
+
+struct IGLUOBJChunk;
+struct IGLUOBJStreamBatch;
 class  IGLUBuffer;
 
 class IGLUOBJReader : public IGLUFileParser, public IGLUModel
 {
 public:
-	// Constructor reads from the file.
-	IGLUOBJReader( char *filename, int params=IGLU_OBJ_DEFAULT_STATE );
+	// Constructor reads from the file.  With IGLU_OBJ_STREAMING, batches go to batchFunc (if 
+	//    non-NULL) instead of our vertex array, leaving us with no geometry to draw.
+	IGLUOBJReader( char *filename, int params=IGLU_OBJ_DEFAULT_STATE, 
+		           IGLUOBJBatchCallback batchFunc=0, void *batchData=0 );
 	// Constructor from GLMmodel
 	IGLUOBJReader( GLMmodel* model, int parms = IGLU_OBJ_DEFAULT_STATE);
 	virtual ~IGLUOBJReader();
 
 	// Get some data about the object file
-	uint GetTriangleCount( void ) const       { return m_objTris.size(); }
+	uint GetTriangleCount( void ) const       { return m_numTris; }
+
+	// How many vertices are in our vertex array buffer?  Without IGLU_OBJ_COMPACT_STORAGE this is
+	//    always 3*GetTriangleCount() (i.e., GetUncompactedVertexCount()).  With compact storage, 
+	//    each unique vertex/normal/texcoord/material/object combination is stored just once.
+	uint GetVertexCount( void ) const              { return m_numArrayVerts; }
+	uint GetUncompactedVertexCount( void ) const   { return 3*m_numTris; }
+
+	// Simulates a FIFO post-transform vertex cache over our element array (on the CPU).  If
+	//    the model was loaded with IGLU_OBJ_OPTIMIZE, GetUnoptimizedVertexCacheStats() gives 
+	//    the same statistics for the element array before it was reordered.
+	IGLUVertexCacheStats GetVertexCacheStats( uint cacheSize=IGLU_VERTEX_CACHE_SIZE ) const;
+	const IGLUVertexCacheStats &GetUnoptimizedVertexCacheStats( void ) const   { return m_unoptimizedStats; }
+
+	// Which type of indices are in our element array?  (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+	GLenum GetIndexType( void ) const         { return UseShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
+	// With IGLU_OBJ_UNORM16_POSITIONS, the shader gets positions in [0..1] and needs to compute
+	//    position = attribute * scale + offset.  (Otherwise scale is 1 and offset is 0.)
+	void GetPositionDequantization( vec3 &scale, vec3 &offset ) const   { scale = m_posScale; offset = m_posOffset; }
+
+	// With IGLU_OBJ_CLUSTERS, the triangle clusters in our element array (see IGLUMeshCluster),
+	//    and a buffer containing the same table for use on the GPU (or NULL without clusters).
+	//    Cluster c covers indices [firstIndex, firstIndex+indexCount) of the element array.
+	const std::vector<IGLUMeshCluster> &GetClusters( void ) const   { return m_clusters; }
+	IGLUBuffer::Ptr GetClusterBuffer( void ) const                  { return m_clusterBuf; }
+
+	// Levels of detail.  LOD 0 is always the full model (the first 3*GetTriangleCount() indices,
+	//    which are also the only ones covered by our clusters).  With IGLU_OBJ_LODS, there are
+	//    up to IGLU_OBJ_LOD_LEVELS coarser levels after it, all using the same vertex array.
+	uint GetLODCount( void ) const            { return m_lods.empty() ? 1 : uint( m_lods.size() ); }
+	IGLUOBJLod GetLOD( uint lod ) const;
+
+	// Picks the coarsest LOD whose error stays under maxPixelError pixels when the model's largest 
+	//    bounding box dimension covers projectedSize pixels on screen (see GetProjectedSize()).
+	uint SelectLOD( float projectedSize, float maxPixelError=1.0f ) const;
+
+	// How many pixels an object of the given size covers at the given distance from the eye, with a
+	//    perspective projection with vertical field of view fovy (in degrees) and viewport height.
+	static float GetProjectedSize( float size, float distance, float fovy, float viewportHeight );
+
+	// Which LOD gets drawn by Draw() and DrawMultipleInstances()?  (By default, LOD 0.)
+	void SetDrawLOD( uint lod )               { m_drawLod = (lod < GetLODCount()) ? lod : GetLODCount()-1; }
+	uint GetDrawLOD( void ) const             { return m_drawLod; }
+
+	// With IGLU_OBJ_DRAW_RANGES, the material/object ranges (otherwise empty).  DrawRanges() draws 
+	//    the listed ranges (indices into GetDrawRanges()) with one glMultiDrawElements() call, so 
+	//    callers can skip some (e.g., hidden objects) or draw others in a separate pass (e.g., 
+	//    transparent materials).  DrawRangesIndirect() does the same with one indirect draw
+	//    (OpenGL 4.3), passing each range's index as its baseInstance.
+	const std::vector<IGLUOBJDrawRange> &GetDrawRanges( void ) const  { return m_drawRanges; }
+	int DrawRanges( IGLUShaderProgram::Ptr &shader, const uint *ranges, uint numRanges );
+	int DrawRangesIndirect( IGLUShaderProgram::Ptr &shader, const uint *ranges, uint numRanges );
+
+	// Was this model loaded from a binary cache (see IGLU_OBJ_USE_CACHE)?  If so, the OBJ was never
+	//    parsed, so only the GPU buffers, GetVaoVerts() and GetElementArrayData() are available;
+	//    GetVertecies(), GetTriangles(), GetNormals(), and GetTexCoords() are empty.
+	bool IsLoadedFromCache( void ) const      { return m_loadedFromCache; }
 
 	// Get OpenGL buffers for vertex/triangle/normal data
 	IGLUVertexArray::Ptr &GetVertexArray( void )         { return m_vertArr; }
 
+	// With IGLU_OBJ_DEFER_UPLOAD, creates our GPU buffers from the data the constructor left
+	//    waiting.  Must be called on the GL thread.  Returns false if there was nothing to upload.
+	bool UploadToGPU( void );
+	bool IsUploaded( void ) const             { return !m_deferUpload; }
+
 	// Get vertex attrib array data
 	uint GetArrayBufferStride( void );
 
@@ -90,7 +284,7 @@ public:
 		return m_objVerts;
 	}
 
-	std::vector<IGLUOBJTri *>& GetTriangles()
+	IGLUOBJTriArray& GetTriangles()
 	{
 		return m_objTris;
 	}
@@ -112,6 +306,27 @@ public:
 	}
 private:
 	bool m_compactFormat, m_loadMtlFile, m_assignObjects;
+	bool m_optimize, m_optimizeOverdraw;
+	// Which IGLU_OBJ_*_POSITIONS/NORMALS/... encodings are used in our vertex array?  For IDs, 
+	//    which type we ended up using;  for positions, how to undo the 16-bit quantization.
+	uint   m_packing;
+	GLenum m_idType;
+	vec3   m_posScale, m_posOffset;
+
+	// Triangle clusters (if IGLU_OBJ_CLUSTERS), and a GPU copy of the cluster table
+	bool m_buildClusters;
+	std::vector<IGLUMeshCluster> m_clusters;
+	IGLUBuffer::Ptr m_clusterBuf;
+
+	// Material/object draw ranges (if IGLU_OBJ_DRAW_RANGES), and a buffer for indirect draws of them
+	bool m_buildDrawRanges;
+	std::vector<IGLUOBJDrawRange> m_drawRanges;
+	IGLUBuffer::Ptr m_indirectBuf;
+
+	// Levels of detail (if IGLU_OBJ_LODS;  otherwise empty) and the one we currently draw
+	bool m_buildLods;
+	std::vector<IGLUOBJLod> m_lods;
+	uint m_drawLod;
 	uint  m_curMatlId;
 	uint  m_curObjectId;
 	// When drawing we need to bind the vertex buffer to the appropriate 
@@ -131,15 +346,25 @@ private:
 	std::vector<float> m_vaoVerts;
 	//VAO еelement array
 	uint* m_elementArray;
+	// Number of triangles and vertices in our GPU buffers
+	uint m_numTris, m_numArrayVerts;
+	// Vertex cache behavior of our element array prior to IGLU_OBJ_OPTIMIZE reordering it
+	IGLUVertexCacheStats m_unoptimizedStats;
 	// Basic geometric triangles definitions
-	std::vector<IGLUOBJTri *> m_objTris;
+	IGLUOBJTriArray m_objTris;
 	
 	// Locations for material file(s)
 	std::vector<char *> m_objMtlFiles;
 
 
-	// Array of object names inside the file
-	std::vector<char *> m_objObjectNames;
+	// Array of object names inside the file (as IDs in m_objTris' name table), and the
+	//    reverse mapping from a name ID to its object ID (or -1, if that name isn't an object)
+	std::vector<uint> m_objObjectNames;
+	std::vector<int>  m_objectIdForName;
+
+	// If we're using a binary cache, its filename (or NULL if not)
+	char *m_cacheFile;
+	bool  m_loadedFromCache;
 
 	// Does the user want us to resize and center the object around the origin?
 	//    Some/many models use completely arbitrary coordinates, so it's difficult
@@ -152,6 +377,25 @@ private:
 	// What is the stride of the data?
 	GLuint m_vertStride, m_vertOff, m_normOff, m_texOff, m_matlIdOff, m_objectIdOff;
 
+	// Parse the OBJ file, either line-by-line through the IGLUFileParser buffer or (if the
+	//    file is memory-mapped) directly from the mapped data.  Both give identical results.
+	void ParseFile( void );
+	void ParseMappedFile( void );
+
+	// Parses the memory-mapped file in parallel (see igluOBJReaderParallel.cpp).  The file is
+	//    split into line-aligned chunks that are parsed independently, then stitched back
+	//    together in file order.  Again, results are identical to ParseFile().
+	void ParseMappedFileInParallel( void );
+	void ParseMappedChunk( IGLUOBJChunk *chunk ) const;
+	static void ParseMappedChunkCallback( int chunkIdx, void *chunkData );
+	static void StitchMappedChunkCallback( int chunkIdx, void *chunkData );
+
+	// Streams the memory-mapped file in batches (see igluOBJReaderStream.cpp), never holding 
+	//    more than one batch of geometry in memory.  StreamMappedFacets() does one run through
+	//    the facets, returning the total number of vertices in the batches.
+	void StreamMappedFile( IGLUOBJBatchCallback batchFunc, void *batchData );
+	uint StreamMappedFacets( IGLUOBJStreamBatch *batch );
+
 	// When drawing, sometimes we need to setup our vertex array to work with
 	//    the currently selected shader.  This method does that.
 	int SetupVertexArray( IGLUShaderProgram::Ptr &shader );
@@ -169,11 +413,59 @@ private:
 	void GetElementArrayBuffer( void );
 	void GetCompactArrayBuffer( void );
 
+	// Binary cache support (see igluOBJReaderCache.cpp).  LoadCache() returns false if the cache
+	//    is missing or out of date.  SaveCache() is called with the final interleaved vertex data
+	//    once the element array has been created.
+	bool LoadCache( void );
+	void SaveCache( const void *vertBuf, uint numArrayVerts );
+
+	// Converts the float vertex array built by AddDataToArray() into the compact encodings 
+	//    requested by the user (see igluOBJReaderPacking.cpp), updating the stride & offsets.  
+	//    Returns a new malloc()'d array, or floatBuf itself if no encodings were requested.
+	void *PackVertexArray( const float *floatBuf, uint numVerts );
+
+	// With IGLU_OBJ_DEFER_UPLOAD, the vertex array data waiting for UploadToGPU()
+	bool   m_deferUpload;
+	void  *m_deferredVerts;
+	size_t m_deferredVertBytes;
+
+	// Sends vertex data to the GPU (or, with IGLU_OBJ_DEFER_UPLOAD, keeps a copy for later)
+	void UploadVertexArray( size_t bytes, const void *data );
+
+	// Sends m_elementArray to the GPU, as 16-bit indices if requested and possible
+	bool UseShortIndices( void ) const        { return (m_packing & IGLU_OBJ_SHORT_INDICES) && m_numArrayVerts <= 0xFFFF; }
+	void UploadElementArray( void );
+
+	// How many indices are in m_elementArray?  (All LODs, not just 3*m_numTris.)
+	uint GetElementCount( void ) const;
+
+	// Clusters the triangles in m_elementArray (using positions from our float vertex array),
+	//    and copies the cluster table to the GPU.
+	void BuildClusters( const float *floatBuf );
+	void UploadClusters( void );
+
+	// Sorts the triangles in m_elementArray by material & object (read from our vertex array,
+	//    in the layout given by m_vertStride, m_idType, etc.), and builds m_drawRanges.  Loading
+	//    from a cache, the triangles are already sorted, so we just find the ranges.
+	void SortIntoDrawRanges( const void *vertBuf );
+	void FindDrawRanges( const void *vertBuf );
+	void GetDrawRangeKeys( const void *vertBuf, std::vector<unsigned long long> &keys ) const;
+
+	// Appends simplified copies of the triangles in m_elementArray to it (see igluMeshSimplifier.h),
+	//    filling in m_lods.  Uses positions from our float vertex array.
+	void BuildLODs( const float *floatBuf );
+
+	// Gets the index count and byte offset in our element array of the LOD we're drawing
+	void GetDrawRange( uint *count, uint *offsetBytes ) const;
+
+	// Enables the vertex attributes (with the right formats) for our interleaved vertex array
+	void EnableVertexAttributes( void );
+
 	// Read appropriate facet tokens
-	void Read_V_Token( IGLUOBJTri *tri, int idx, char *token=0 );
-	void Read_VT_Token( IGLUOBJTri *tri, int idx, char *token=0 );
-	void Read_VN_Token( IGLUOBJTri *tri, int idx, char *token=0 );
-	void Read_VTN_Token( IGLUOBJTri *tri, int idx, char *token=0 );
+	void Read_V_Token( uint tri, int idx, char *token=0 );
+	void Read_VT_Token( uint tri, int idx, char *token=0 );
+	void Read_VN_Token( uint tri, int idx, char *token=0 );
+	void Read_VTN_Token( uint tri, int idx, char *token=0 );
 
 	// Helper function for adding data to a float array for our GPU-packed array
 	void AddDataToArray( float *arr, int startIdx, int matlID, int objectID, vec3 *vert, vec3 *norm, vec2 *tex );
@@ -182,11 +474,22 @@ private:
 	void CenterAndResize( float *arr, int numVerts );
 
 	// This declares an ugly type FnParserPtr that points to one of the Read_???_Token methods
-	typedef void (iglu::IGLUOBJReader::*FnParserPtr)(IGLUOBJTri *, int, char *); 
+	typedef void (iglu::IGLUOBJReader::*FnParserPtr)(uint, int, char *); 
+
+	// The in-place (memory-mapped) equivalents of SelectReadMethod() and the Read_???_Token() 
+	//    methods.  The facet format is one of the four formats below.
+	enum { IGLU_OBJ_FACET_V, IGLU_OBJ_FACET_VT, IGLU_OBJ_FACET_VN, IGLU_OBJ_FACET_VTN };
+	int  SelectFacetFormatInPlace( const char *token, const char *tokenEnd );
+	void ReadFacetTokenInPlace( int format, uint tri, int idx, const char *token, const char *tokenEnd );
+
+	// These do the actual work for the two methods above, without touching the reader's state
+	//    (so they are safe to call from multiple threads).  The indices are the raw (1-based or
+	//    negative) values from the file; an index that is absent is returned as 0.
+	static int  GetFacetFormatInPlace( const char *token, const char *tokenEnd );
+	static void GetFacetIndicesInPlace( int format, const char *token, const char *tokenEnd, int *vIdx, int *tIdx, int *nIdx );
 
 	// Copy from prior triangle facets when triangulating
-	void CopyForTriangleFan( IGLUOBJTri *newTri );
-	void CopyForTriangleFan( const IGLUOBJTri * lastTri, IGLUOBJTri* newTri);
+	void CopyForTriangleFan( uint newTri );
 	// A method that is called after finding an 'f' line that identifies
 	//    the appropriate Read_???_Token() method to call when parsing
 	void SelectReadMethod( FnParserPtr *pPtr );
@@ -198,6 +501,10 @@ private:
 	//Determines if objName has been seen before in this obj file
 	int GetObjectID( char *objName );
 
+	// Returns the object ID for a name in m_objTris' name table, assigning a new one if
+	//    we have not seen this object name before.
+	uint GetObjectIDForName( uint nameID );
+
 	
 };
 
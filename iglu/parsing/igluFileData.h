@@ -0,0 +1,58 @@
+/******************************************************************/
+/* igluFileData.h                                                 */
+/* -----------------------                                        */
+/*                                                                */
+/* A read-only block of file contents in memory.  This is the     */
+/*    base class for memory-mapped disk files (IGLUMappedFile),   */
+/*    files registered from memory, and entries in pack files,    */
+/*    so parsers can scan any of them in place without caring     */
+/*    where the bytes actually came from.                         */
+/*                                                                */
+/* Note: the data is *not* null-terminated.  Always use GetSize() */
+/*    (or GetEnd()) to find the end of the data.                  */
+/*                                                                */
+/******************************************************************/
+
+#ifndef __IGLU_FILE_DATA_H
+#define __IGLU_FILE_DATA_H
+
+#include <stddef.h>
+
+namespace iglu {
+
+class IGLUFileData {
+public:
+	// Wraps someone else's data, which must stay around as long as this object does.
+	IGLUFileData( const char *data, size_t size ) :
+		m_valid(data != 0), m_data(data), m_size(size) {}
+	virtual ~IGLUFileData()                                 {}
+
+	// Is the data available?  (Empty files are valid, with size 0)
+	bool IsValid( void ) const                              { return m_valid; }
+
+	// Accessors to the data.  The data is read-only.
+	const char *GetData( void ) const                       { return m_data; }
+	const char *GetEnd( void ) const                        { return m_data + m_size; }
+	size_t GetSize( void ) const                            { return m_size; }
+
+	// A hint that the bytes [offset, offset+size) will be read soon, so derived classes
+	//    backed by slower storage can start fetching them.  Data already in memory ignores this.
+	virtual void WillNeed( size_t /*offset*/, size_t /*size*/ ) {}
+
+	// A pointer to a IGLUFileData could have type IGLUFileData::Ptr
+	typedef IGLUFileData *Ptr;
+
+protected:
+	IGLUFileData() : m_valid(false), m_data(0), m_size(0) {}
+
+	bool m_valid;
+	const char *m_data;
+	size_t m_size;
+};
+
+
+// End namespace iglu
+}
+
+#endif
+
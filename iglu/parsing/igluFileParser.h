@@ -16,6 +16,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "igluTextParsing.h"
+#include "igluMappedFile.h"
+#include "igluFileSystem.h"
 
 namespace iglu {
 
@@ -34,7 +36,16 @@ class dvec4;
 
 class IGLUFileParser {
 public:
-	IGLUFileParser( char *filename, bool verbose=true );
+	// If memoryMapped is true, the file is mapped into memory rather than read via stdio.
+	//    All the methods below work identically in either mode, but memory-mapped parsers 
+	//    may also use the ReadNextLineInPlace() interface to avoid copying lines entirely.
+	//    Files served by a mounted I/O provider (see igluFileSystem.h) are always treated
+	//    as memory mapped.
+	IGLUFileParser( char *filename, bool verbose=true, bool memoryMapped=false );
+
+	// Parses data that is already in memory (the parser takes ownership of data).  The
+	//    filename is only used for messages and to find files relative to this one.
+	IGLUFileParser( IGLUFileData *data, char *filename, bool verbose=true );
 	virtual ~IGLUFileParser();
 
 	// Read the next line in the file into an internal buffer.  Discarding blanks
@@ -43,6 +54,14 @@ public:
 	// Returns a pointer to the start of the first non-blank character.
 	char *ReadNextLine( bool discardBlanks=true );
 
+	// For memory-mapped parsers only.  Finds the next line directly in the mapped file,
+	//    *without* copying it to the internal buffer (so GetToken(), GetFloat(), etc. do 
+	//    not see this line).  Returns a pointer to the first non-blank character of the 
+	//    line and sets lineEnd to one past its last character (the line is NOT null 
+	//    terminated).  Blanks and comments are discarded as in ReadNextLine().  Returns
+	//    NULL at the end of the file.
+	const char *ReadNextLineInPlace( const char **lineEnd, bool discardBlanks=true );
+
 	// Get a pointer to the as-yet-unprocessed part of the current line
 	char *GetCurrentLinePointer( void )						{ return internalBufPtr; }
 
@@ -86,9 +105,13 @@ public:
 	int GetLineNumber( void ) const                         { return lineNum; }
 
 	// Accessors to the underlying file handle
-	bool IsFileValid( void ) const							{ return f != NULL; }
+	bool IsFileValid( void ) const							{ return f != NULL || m_mappedFile != NULL; }
 	FILE *GetFileHandle( void ) const						{ return f; }
 
+	// Accessors for memory-mapped parsers.  (The file handle above is NULL for these.)
+	bool IsMemoryMapped( void ) const                       { return m_mappedFile != NULL; }
+	IGLUFileData *GetMappedFile( void ) const               { return m_mappedFile; }
+
 	// Get information about the scene file
 	char *GetFileDirectory( void )							{ return fileDirectory; }
 	char *GetFileName( void )								{ return unqualifiedFileName; }
@@ -119,11 +142,19 @@ protected:
 	char *fileName, *unqualifiedFileName, *fileDirectory;
 	char internalBuf[ 2048 ], *internalBufPtr;
 
+	// When memory-mapped, the file data and our current position in it.
+	IGLUFileData *m_mappedFile;
+	const char *m_mapPtr, *m_mapEnd;
+
 	// A simple call to fgets, storing data internally, and increment our line counter
+	//    (Memory-mapped parsers copy from the mapping, with the same semantics as fgets)
 	char *__ReadLine( void );
 
 	// Derived classes may want to go ahead and close the file when they're ready
 	void CloseFile( void );
+
+	// Sets up fileName, unqualifiedFileName, and fileDirectory
+	void SetFileName( const char *filename );
 };
 
 
@@ -0,0 +1,152 @@
+/******************************************************************/
+/* igluFileSystem.h                                               */
+/* -----------------------                                        */
+/*                                                                */
+/* Lets IGLU's loaders (OBJ & MTL readers, shaders, the GLM OBJ   */
+/*    loader, and anything else using IGLUFileParser) read files  */
+/*    from places other than the disk.  Applications Mount() I/O  */
+/*    providers, and every file open first asks those providers   */
+/*    (most recently mounted first) before falling back to memory */
+/*    mapping the file from disk.                                 */
+/*                                                                */
+/* Two providers come with IGLU:                                  */
+/*    - IGLUMemoryIOProvider serves blocks of memory registered   */
+/*         under a filename (e.g., data embedded in the binary).  */
+/*    - IGLUPackIOProvider serves files from one uncompressed     */
+/*         pack file, which is mapped once and handed out in      */
+/*         pieces.  Use IGLUPackIOProvider::WritePack() to build  */
+/*         these.                                                 */
+/*    Other archive formats can derive from IGLUIOProvider.       */
+/*                                                                */
+/* Filenames are compared after converting '\' to '/' and         */
+/*    removing leading "./" (and repeated '/'), but are otherwise */
+/*    case sensitive.                                             */
+/*                                                                */
+/******************************************************************/
+
+#ifndef __IGLU_FILE_SYSTEM_H
+#define __IGLU_FILE_SYSTEM_H
+
+#include <stddef.h>
+#include <vector>
+#include "igluFileData.h"
+
+namespace iglu {
+
+class IGLUMappedFile;
+
+// The interface all I/O providers implement
+class IGLUIOProvider {
+public:
+	IGLUIOProvider()                                        {}
+	virtual ~IGLUIOProvider()                               {}
+
+	// Returns the contents of the (normalized) filename, or NULL if this provider does not
+	//    have that file.  The caller deletes the returned object when done.
+	virtual IGLUFileData *Open( const char *filename ) = 0;
+
+	// A hint that the file will be opened soon.  Returns true if this provider has the file.
+	virtual bool Prefetch( const char * /*filename*/ )     { return false; }
+
+	// A pointer to a IGLUIOProvider could have type IGLUIOProvider::Ptr
+	typedef IGLUIOProvider *Ptr;
+};
+
+// Serves files from memory blocks owned by the application
+class IGLUMemoryIOProvider : public IGLUIOProvider {
+public:
+	IGLUMemoryIOProvider()                                  {}
+	virtual ~IGLUMemoryIOProvider();
+
+	// Registers size bytes at data as the contents of filename (replacing any earlier
+	//    registration).  If copyData is false, data must stay valid while registered.
+	void AddFile( const char *filename, const char *data, size_t size, bool copyData=false );
+
+	// Stops serving the file.  Data returned by earlier Open()s must no longer be in use.
+	void RemoveFile( const char *filename );
+
+	virtual IGLUFileData *Open( const char *filename );
+	virtual bool Prefetch( const char *filename );
+
+	// A pointer to a IGLUMemoryIOProvider could have type IGLUMemoryIOProvider::Ptr
+	typedef IGLUMemoryIOProvider *Ptr;
+
+protected:
+	struct MemoryFile { char *name; const char *data; size_t size; bool owned; };
+	std::vector< MemoryFile > m_files;
+
+	int FindFile( const char *normalizedName );
+};
+
+// Serves files from a single pack file, which contains a directory followed by the
+//    (uncompressed, 16-byte aligned) contents of each file.  Files are returned as views
+//    into one memory mapping of the pack, so opening them neither copies nor allocates.
+class IGLUPackIOProvider : public IGLUIOProvider {
+public:
+	// Maps the pack file.  Files in the pack are served as if they lived in mountDir
+	//    (i.e., an entry "models/a.obj" with mountDir "data" is opened as "data/models/a.obj").
+	IGLUPackIOProvider( const char *packFile, const char *mountDir=0 );
+	virtual ~IGLUPackIOProvider();
+
+	// Did the pack open correctly?
+	bool IsValid( void ) const                              { return m_pack != 0; }
+
+	// Number of files in the pack
+	int GetNumFiles( void ) const                           { return (int)m_entries.size(); }
+
+	virtual IGLUFileData *Open( const char *filename );
+	virtual bool Prefetch( const char *filename );
+
+	// Builds a pack file from the given files.  Each file is stored under its name, minus
+	//    the leading baseDir (if specified).  Returns false if any file could not be read.
+	static bool WritePack( const char *packFile, const char **files, int numFiles, const char *baseDir=0 );
+
+	// A pointer to a IGLUPackIOProvider could have type IGLUPackIOProvider::Ptr
+	typedef IGLUPackIOProvider *Ptr;
+
+protected:
+	struct PackEntry { const char *name; size_t offset, size; };
+
+	IGLUMappedFile *m_pack;
+	char *m_mountDir;
+	std::vector< PackEntry > m_entries;   // Sorted by name
+
+	int FindEntry( const char *normalizedName );
+	static bool EntryLess( const PackEntry &a, const PackEntry &b );
+};
+
+// The (global) list of mounted providers
+class IGLUFileSystem {
+public:
+	// Adds a provider, which is searched before all previously mounted ones.  The file
+	//    system does not take ownership; Unmount() the provider before deleting it.
+	static void Mount( IGLUIOProvider *provider );
+	static void Unmount( IGLUIOProvider *provider );
+
+	// Opens a file from the first provider that has it.  If none do and mapDiskFiles is
+	//    true, memory maps the file from disk.  Returns NULL if the file cannot be found.
+	//    The caller deletes the returned object when done.
+	static IGLUFileData *Open( const char *filename, bool mapDiskFiles=true );
+
+	// Reads a whole file into a null-terminated, malloc()'d buffer (which the caller frees).
+	//    Returns NULL if the file cannot be found.  If size is non-NULL, it gets the file size.
+	static char *ReadFile( const char *filename, size_t *size=0 );
+
+	// A hint that the file will be opened soon, so its data can be read ahead of time.
+	static void Prefetch( const char *filename );
+
+	// Converts filename to the form providers compare against.  The result always fits in
+	//    strlen(filename)+1 characters.
+	static void NormalizeName( char *result, const char *filename );
+
+private:
+	IGLUFileSystem()                                        {}
+	static std::vector< IGLUIOProvider * > s_providers;
+};
+
+
+// End namespace iglu
+}
+
+#endif
+
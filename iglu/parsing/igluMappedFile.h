@@ -0,0 +1,48 @@
+/******************************************************************/
+/* igluMappedFile.h                                               */
+/* -----------------------                                        */
+/*                                                                */
+/* A class that maps a file read-only into memory, so parsers can */
+/*    scan the file contents in place rather than copying them    */
+/*    through stdio buffers.  The OS-specific mapping calls are   */
+/*    handled in the library.                                     */
+/*                                                                */
+/* Note: the mapped data is *not* null-terminated.  Always use    */
+/*    GetSize() (or GetEnd()) to find the end of the data.        */
+/*                                                                */
+/******************************************************************/
+
+#ifndef __IGLU_MAPPED_FILE_H
+#define __IGLU_MAPPED_FILE_H
+
+#include <stddef.h>
+#include "igluFileData.h"
+
+namespace iglu {
+
+class IGLUMappedFile : public IGLUFileData {
+public:
+	// Opens and maps the specified file.  Check IsValid() to see if this succeeded.
+	IGLUMappedFile( const char *filename );
+	virtual ~IGLUMappedFile();
+
+	// Asks the OS to start paging in the specified range of the file
+	virtual void WillNeed( size_t offset, size_t size );
+
+	// A pointer to a IGLUMappedFile could have type IGLUMappedFile::Ptr
+	typedef IGLUMappedFile *Ptr;
+
+protected:
+	// OS-specific handles (a file descriptor on Linux/MacOS, HANDLEs on Windows)
+	void *m_fileHandle, *m_mapHandle;
+
+	// Unmaps the data and closes any open handles
+	void Close( void );
+};
+
+
+// End namespace iglu
+}
+
+#endif
+
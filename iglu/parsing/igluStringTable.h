@@ -0,0 +1,76 @@
+/******************************************************************/
+/* igluStringTable.h                                              */
+/* -----------------------                                        */
+/*                                                                */
+/* An interned string table.  Each distinct string is stored once */
+/*    and identified by a small integer ID, so parsers can keep   */
+/*    IDs (rather than their own copies of names) and compare or  */
+/*    look up names with a hash rather than with strcmp() scans.  */
+/*                                                                */
+/* ID 0 always refers to the NULL string.  Strings live until the */
+/*    table is destroyed or cleared, and pointers returned by     */
+/*    GetString() never move, even as the table grows.            */
+/*                                                                */
+/******************************************************************/
+
+#ifndef __IGLU_STRING_TABLE_H
+#define __IGLU_STRING_TABLE_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace iglu {
+
+class IGLUStringTable {
+public:
+	IGLUStringTable();
+	~IGLUStringTable();
+
+	// Returns the ID of the string, adding a copy to the table if it's not already there.
+	//    The second version takes strings that are not null-terminated (e.g., in a mapped file).
+	//    Adding a NULL string returns 0.
+	unsigned int Add( const char *str );
+	unsigned int Add( const char *str, const char *strEnd );
+
+	// Returns the ID of the string, or 0 if it is not in the table
+	unsigned int Find( const char *str ) const;
+	unsigned int Find( const char *str, const char *strEnd ) const;
+
+	// Look up a string by its ID
+	const char *GetString( unsigned int id ) const          { return m_strings[id]; }
+
+	// The number of IDs in use (including ID 0), so valid IDs are [0..Size()-1]
+	unsigned int Size( void ) const                         { return (unsigned int)m_strings.size(); }
+
+	// Remove all the strings (invalidating all IDs and pointers)
+	void Clear( void );
+
+	// A pointer to a IGLUStringTable could have type IGLUStringTable::Ptr
+	typedef IGLUStringTable *Ptr;
+
+private:
+	std::vector< char * >       m_strings;  // m_strings[id].  The 0th is always NULL.
+	std::vector< unsigned int > m_hashes;   // The hash of each string, so we can grow without rehashing
+	std::vector< unsigned int > m_buckets;  // Open-addressed hash of IDs (0 == empty); size is a power of 2
+
+	// Strings are copied into large blocks, rather than individually malloc()'d
+	std::vector< char * > m_blocks;
+	char *m_blockPtr;
+	size_t m_blockLeft;
+
+	// Finds the bucket holding the string, or the empty bucket where it should go
+	unsigned int FindBucket( const char *str, size_t len, unsigned int hash ) const;
+	char *CopyString( const char *str, size_t len );
+	void Rehash( size_t numBuckets );
+
+	// Copying would leave two tables sharing the same blocks
+	IGLUStringTable( const IGLUStringTable & );
+	IGLUStringTable &operator=( const IGLUStringTable & );
+};
+
+
+// End namespace iglu
+}
+
+#endif
+
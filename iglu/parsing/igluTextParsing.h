@@ -67,6 +67,32 @@ char *StripLeadingNumericalToken( char *string, char *result );
 // Checks to see if a character is a white space.
 int IsWhiteSpace( char c );
 
+
+// The following routines work in-place on read-only text that need not be null-terminated
+//    (e.g., a memory-mapped file).  In all cases, 'end' points one character past the last 
+//    valid character, and no routine ever reads at or beyond 'end'.
+
+// Returns a ptr to the first non-whitespace character at or after 'string' (or 'end')
+const char *SkipWhiteSpaceInPlace( const char *string, const char *end );
+
+// Returns a ptr to the first whitespace character at or after 'string' (or 'end'),
+//    i.e., the end of the token starting at 'string'.
+const char *SkipTokenInPlace( const char *string, const char *end );
+
+// Computes the same result as atof() applied to the output of StripLeadingNumericalToken(),
+//    without copying the token.  Returns a ptr to the next non-whitespace character after
+//    the token (or 'end'), just as StripLeadingNumericalToken() does.
+const char *ParseNumericalTokenInPlace( const char *string, const char *end, double *result );
+
+// Parses a decimal integer the way sscanf's "%d" does (an optional sign, then digits).
+//    Returns a ptr to the character just after the last digit, or NULL if there was no
+//    integer to parse (in which case result is unchanged).
+const char *ParseIntegerInPlace( const char *string, const char *end, int *result );
+
+// Copies the characters in [string, end) into buf as a null-terminated string, truncating
+//    it to fit in bufSize characters (including the null).  Returns buf.
+char *CopyStringInPlace( char *buf, int bufSize, const char *string, const char *end );
+
 };
 
 #endif